@@ -30,6 +30,12 @@ public:
 		m_logging_level_ = l;
 	}
 
+	// allows to skip building of a message which won't be logged anyway
+	bool IsEnabled(int lvl) const
+	{
+		return lvl <= m_logging_level_;
+	}
+
 	std::string GetLogLevel()
 	{
 		switch (m_logging_level_)
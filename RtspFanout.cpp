@@ -0,0 +1,375 @@
+#include "RtspFanout.h"
+#include "Logger.h"
+#include "RtspSignals.h"
+
+#include "utility/Metrics.h"
+#include "utility/RtspClip.h"
+
+#include <gst/app/gstappsink.h>
+#include <gst/app/gstappsrc.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+	using osrv::rtsp::SharedSource;
+
+	struct MediaConsumer
+	{
+		std::weak_ptr<SharedSource> source;
+		GstElement* appsrc;
+	};
+
+	// the media doesn't ask for data before it's playing or while its queue is full, e.g. for a slow client
+	utility::metrics::Counter& dropped_buffers()
+	{
+		static auto counter = utility::metrics::make_counter("onvif_rtsp_dropped_buffers_total",
+			"Buffers of the shared streams, which were not pushed to a media as it didn't ask for data.");
+		return *counter;
+	}
+
+	GstClockTime running_time(GstElement* element)
+	{
+		GstClock* clock = gst_element_get_clock(element);
+		if (clock == nullptr)
+			return 0;
+
+		const auto now = gst_clock_get_time(clock);
+		gst_object_unref(clock);
+
+		return now - gst_element_get_base_time(element);
+	}
+
+	GstClockTime shift(GstClockTime time, GstClockTimeDiff offset)
+	{
+		if (!GST_CLOCK_TIME_IS_VALID(time))
+			return time;
+
+		const auto result = static_cast<GstClockTimeDiff>(time) + offset;
+		return result > 0 ? static_cast<GstClockTime>(result) : 0;
+	}
+}
+
+namespace osrv::rtsp
+{
+	SharedSource::~SharedSource()
+	{
+		for (auto& consumer : consumers_)
+			gst_object_unref(consumer.appsrc);
+
+		if (caps_ != nullptr)
+			gst_caps_unref(caps_);
+	}
+
+	void SharedSource::attach(GstRTSPMediaFactory* factory)
+	{
+		connect_signal(factory, "media-configure", G_CALLBACK(on_media_configure),
+			new std::shared_ptr<SharedSource>(shared_from_this()));
+	}
+
+	std::size_t SharedSource::consumers_count() const
+	{
+		std::lock_guard<std::mutex> lock(consumers_mutex_);
+		return consumers_.size();
+	}
+
+	GstSample* SharedSource::key_frame() const
+	{
+		return key_frame_.sample();
+	}
+
+	void SharedSource::push(GstBuffer* buffer, GstCaps* caps)
+	{
+		std::lock_guard<std::mutex> lock(consumers_mutex_);
+
+		if (caps != nullptr && (caps_ == nullptr || !gst_caps_is_equal(caps, caps_)))
+		{
+			gst_caps_replace(&caps_, caps);
+			for (auto& consumer : consumers_)
+				gst_app_src_set_caps(GST_APP_SRC(consumer.appsrc), caps_);
+		}
+
+		const bool key_frame = !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+		if (key_frame)
+			key_frame_.update(buffer, caps_);
+		for (auto& consumer : consumers_)
+		{
+			if (!consumer.wants_data)
+			{
+				// the stream can be continued only from the next key frame
+				consumer.started = false;
+				dropped_buffers().inc();
+				continue;
+			}
+
+			if (!consumer.started)
+			{
+				if (!key_frame)
+					continue;
+
+				consumer.offset = static_cast<GstClockTimeDiff>(running_time(consumer.appsrc))
+					- static_cast<GstClockTimeDiff>(GST_BUFFER_PTS(buffer));
+				consumer.started = true;
+			}
+
+			// only the metadata is copied, the memory is shared by all the consumers
+			GstBuffer* copy = gst_buffer_copy(buffer);
+			GST_BUFFER_PTS(copy) = shift(GST_BUFFER_PTS(copy), consumer.offset);
+			GST_BUFFER_DTS(copy) = shift(GST_BUFFER_DTS(copy), consumer.offset);
+
+			gst_app_src_push_buffer(GST_APP_SRC(consumer.appsrc), copy);
+		}
+	}
+
+	void SharedSource::add_consumer(GstElement* appsrc)
+	{
+		{
+			std::lock_guard<std::mutex> lock(consumers_mutex_);
+
+			Consumer consumer;
+			consumer.appsrc = appsrc;
+			consumers_.push_back(consumer);
+
+			if (caps_ != nullptr)
+				gst_app_src_set_caps(GST_APP_SRC(appsrc), caps_);
+		}
+
+		update_producer();
+	}
+
+	void SharedSource::remove_consumer(GstElement* appsrc)
+	{
+		{
+			std::lock_guard<std::mutex> lock(consumers_mutex_);
+
+			auto it = std::find_if(consumers_.begin(), consumers_.end(),
+				[appsrc](const Consumer& consumer) { return consumer.appsrc == appsrc; });
+			if (it == consumers_.end())
+				return;
+
+			gst_object_unref(it->appsrc);
+			consumers_.erase(it);
+		}
+
+		update_producer();
+	}
+
+	void SharedSource::set_wants_data(GstElement* appsrc, bool wants_data)
+	{
+		std::lock_guard<std::mutex> lock(consumers_mutex_);
+
+		for (auto& consumer : consumers_)
+		{
+			if (consumer.appsrc == appsrc)
+				consumer.wants_data = wants_data;
+		}
+	}
+
+	void SharedSource::update_producer()
+	{
+		std::lock_guard<std::mutex> lock(producer_mutex_);
+
+		const bool needed = consumers_count() != 0;
+		if (needed && !running_)
+		{
+			running_ = start();
+		}
+		else if (!needed && running_)
+		{
+			stop();
+			running_ = false;
+			key_frame_.reset();
+		}
+	}
+
+	void SharedSource::on_media_configure(GstRTSPMediaFactory* /*factory*/, GstRTSPMedia* media, gpointer user_data)
+	{
+		const auto& source = *static_cast<std::shared_ptr<SharedSource>*>(user_data);
+
+		GstElement* element = gst_rtsp_media_get_element(media);
+		GstElement* appsrc = gst_bin_get_by_name(GST_BIN(element), "src");
+		gst_object_unref(element);
+
+		if (appsrc == nullptr)
+			return source->logger_->Error("The media of a shared stream has no appsrc \"src\"");
+
+		connect_signal(appsrc, "need-data", G_CALLBACK(on_need_data), new std::weak_ptr<SharedSource>(source));
+		connect_signal(appsrc, "enough-data", G_CALLBACK(on_enough_data), new std::weak_ptr<SharedSource>(source));
+		connect_signal(media, "unprepared", G_CALLBACK(on_media_unprepared), new MediaConsumer{ source, appsrc });
+
+		source->add_consumer(appsrc);
+	}
+
+	void SharedSource::on_media_unprepared(GstRTSPMedia* /*media*/, gpointer user_data)
+	{
+		const auto& consumer = *static_cast<MediaConsumer*>(user_data);
+		if (auto source = consumer.source.lock())
+			source->remove_consumer(consumer.appsrc);
+	}
+
+	void SharedSource::on_need_data(GstElement* appsrc, guint /*length*/, gpointer user_data)
+	{
+		if (auto source = static_cast<std::weak_ptr<SharedSource>*>(user_data)->lock())
+			source->set_wants_data(appsrc, true);
+	}
+
+	void SharedSource::on_enough_data(GstElement* appsrc, gpointer user_data)
+	{
+		if (auto source = static_cast<std::weak_ptr<SharedSource>*>(user_data)->lock())
+			source->set_wants_data(appsrc, false);
+	}
+
+	EncoderSource::EncoderSource(std::string description, ILogger* logger)
+		: SharedSource(logger)
+		, description_(std::move(description))
+	{
+	}
+
+	EncoderSource::~EncoderSource()
+	{
+		if (pipeline_ != nullptr)
+			stop();
+	}
+
+	bool EncoderSource::start()
+	{
+		GError* error = nullptr;
+		pipeline_ = gst_parse_launch(description_.c_str(), &error);
+		if (error != nullptr)
+		{
+			logger_->Error("Could not create the shared encoding \"" + description_ + "\": " + error->message);
+			g_error_free(error);
+		}
+		if (pipeline_ == nullptr)
+			return false;
+
+		GstElement* appsink = gst_bin_get_by_name(GST_BIN(pipeline_), "sink");
+		if (appsink == nullptr)
+		{
+			logger_->Error("The shared encoding has no appsink \"sink\": " + description_);
+			gst_object_unref(pipeline_);
+			pipeline_ = nullptr;
+			return false;
+		}
+
+		// the pipeline is stopped before the source is destroyed, so the callback may use it
+		g_object_set(appsink, "emit-signals", TRUE, NULL);
+		g_signal_connect(appsink, "new-sample", G_CALLBACK(on_new_sample), this);
+		gst_object_unref(appsink);
+
+		if (gst_element_set_state(pipeline_, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE)
+		{
+			logger_->Error("Could not start the shared encoding: " + description_);
+			stop();
+			return false;
+		}
+
+		logger_->Debug("The shared encoding is started: " + description_);
+		return true;
+	}
+
+	void EncoderSource::stop()
+	{
+		gst_element_set_state(pipeline_, GST_STATE_NULL);
+		gst_object_unref(pipeline_);
+		pipeline_ = nullptr;
+
+		logger_->Debug("The shared encoding is stopped: " + description_);
+	}
+
+	GstFlowReturn EncoderSource::on_new_sample(GstElement* appsink, gpointer user_data)
+	{
+		GstSample* sample = gst_app_sink_pull_sample(GST_APP_SINK(appsink));
+		if (sample == nullptr)
+			return GST_FLOW_EOS;
+
+		static_cast<EncoderSource*>(user_data)->push(gst_sample_get_buffer(sample), gst_sample_get_caps(sample));
+		gst_sample_unref(sample);
+
+		return GST_FLOW_OK;
+	}
+
+	ClipSource::ClipSource(std::shared_ptr<const utility::rtsp::Clip> clip, GstClockTime frame_duration,
+		ILogger* logger)
+		: SharedSource(logger)
+		, clip_(std::move(clip))
+		, frame_duration_(frame_duration)
+	{
+	}
+
+	ClipSource::~ClipSource()
+	{
+		if (thread_.joinable())
+			stop();
+	}
+
+	bool ClipSource::start()
+	{
+		stopping_ = false;
+		thread_ = std::thread([this]() { stream(); });
+
+		logger_->Debug("The clip is started: " + clip_->path());
+		return true;
+	}
+
+	void ClipSource::stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		stopped_.notify_all();
+		thread_.join();
+
+		logger_->Debug("The clip is stopped: " + clip_->path());
+	}
+
+	void ClipSource::stream()
+	{
+		using utility::rtsp::Codec;
+
+		GstCaps* caps = gst_caps_from_string(clip_->codec() == Codec::H264
+			? "video/x-h264,stream-format=byte-stream,alignment=au"
+			: "video/x-h265,stream-format=byte-stream,alignment=au");
+
+		// the memory of each access unit is a part of the whole clip's memory,
+		// which keeps the clip mapped while any buffer exists
+		GstMemory* memory = gst_memory_new_wrapped(GST_MEMORY_FLAG_READONLY, const_cast<char*>(clip_->data()),
+			clip_->size(), 0, clip_->size(), new std::shared_ptr<const utility::rtsp::Clip>(clip_),
+			[](gpointer clip) { delete static_cast<std::shared_ptr<const utility::rtsp::Clip>*>(clip); });
+
+		const auto& access_units = clip_->access_units();
+		const auto started = std::chrono::steady_clock::now();
+
+		// the timestamps continue through the loops, as the clip starts with a key frame,
+		// the decoders see only a new GOP
+		for (std::uint64_t frame = 0;; ++frame)
+		{
+			const GstClockTime pts = frame * frame_duration_;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				if (stopped_.wait_until(lock, started + std::chrono::nanoseconds(pts), [this]() { return stopping_; }))
+					break;
+			}
+
+			const auto& access_unit = access_units[frame % access_units.size()];
+
+			GstBuffer* buffer = gst_buffer_new();
+			gst_buffer_append_memory(buffer, gst_memory_share(memory, static_cast<gssize>(access_unit.offset),
+				static_cast<gssize>(access_unit.size)));
+			GST_BUFFER_PTS(buffer) = pts;
+			// the order of decoding is not known without parsing the slices, the clip should have no B-frames
+			GST_BUFFER_DTS(buffer) = pts;
+			GST_BUFFER_DURATION(buffer) = frame_duration_;
+			if (!access_unit.key_frame)
+				GST_BUFFER_FLAG_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+
+			push(buffer, caps);
+			gst_buffer_unref(buffer);
+		}
+
+		gst_memory_unref(memory);
+		gst_caps_unref(caps);
+	}
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "RtspSnapshots.h"
+
+#include <gst/gst.h>
+#include <gst/rtsp-server/rtsp-server.h>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ILogger;
+
+namespace utility::rtsp
+{
+	class Clip;
+}
+
+// The streams, which are produced once and pushed into the appsrc "src" of each media using them,
+// so the cost of producing a stream doesn't depend on the number of mounts serving it.
+// The buffers are pushed without copying their memory, only the timestamps are rewritten
+// to the running time of each media, and each media's payloader has its own SSRC.
+namespace osrv::rtsp
+{
+	class SharedSource : public std::enable_shared_from_this<SharedSource>
+	{
+	public:
+		explicit SharedSource(ILogger* logger) : logger_(logger) {}
+		virtual ~SharedSource();
+
+		SharedSource(const SharedSource&) = delete;
+		SharedSource& operator=(const SharedSource&) = delete;
+
+		// the medias of the factory get the source's stream, the factory keeps the source alive
+		void attach(GstRTSPMediaFactory* /*factory*/);
+
+		std::size_t consumers_count() const;
+
+		// a reference to the latest key frame, while the producer is running, otherwise nullptr
+		GstSample* key_frame() const;
+
+	protected:
+		// called by the producer with each access unit, the buffer is not taken
+		void push(GstBuffer* /*buffer*/, GstCaps* /*caps*/);
+
+		// the producer runs only while the stream has consumers,
+		// they are called from the RTSP thread
+		virtual bool start() = 0;
+		virtual void stop() = 0;
+
+		ILogger* logger_;
+
+	private:
+		struct Consumer
+		{
+			GstElement* appsrc = nullptr;
+			// the difference between the media's and the source's running time
+			GstClockTimeDiff offset = 0;
+			// the stream is pushed from a key frame, after the appsrc asked for data,
+			// which happens when the media is playing
+			bool started = false;
+			bool wants_data = false;
+		};
+
+		// takes the reference to @appsrc
+		void add_consumer(GstElement* /*appsrc*/);
+		void remove_consumer(GstElement* /*appsrc*/);
+		void set_wants_data(GstElement* /*appsrc*/, bool /*wants_data*/);
+		// starts the producer for the first consumer and stops it after the last one
+		void update_producer();
+
+		static void on_media_configure(GstRTSPMediaFactory* /*factory*/, GstRTSPMedia* /*media*/, gpointer /*user_data*/);
+		static void on_media_unprepared(GstRTSPMedia* /*media*/, gpointer /*user_data*/);
+		static void on_need_data(GstElement* /*appsrc*/, guint /*length*/, gpointer /*user_data*/);
+		static void on_enough_data(GstElement* /*appsrc*/, gpointer /*user_data*/);
+
+		// serializes start() and stop(), it's never taken by push()
+		std::mutex producer_mutex_;
+		bool running_ = false;
+
+		mutable std::mutex consumers_mutex_;
+		std::vector<Consumer> consumers_;
+		GstCaps* caps_ = nullptr;
+
+		// the snapshots of the stream are decoded from it
+		LatestKeyFrame key_frame_;
+	};
+
+	// encodes the stream with a pipeline ending with appsink "sink", see utility::rtsp::make_shared_encoding
+	class EncoderSource : public SharedSource
+	{
+	public:
+		EncoderSource(std::string description, ILogger* logger);
+		~EncoderSource() override;
+
+	protected:
+		bool start() override;
+		void stop() override;
+
+	private:
+		static GstFlowReturn on_new_sample(GstElement* /*appsink*/, gpointer /*user_data*/);
+
+		const std::string description_;
+		GstElement* pipeline_ = nullptr;
+	};
+
+	// loops a recorded clip in real time, the buffers wrap the clip's mapped memory
+	class ClipSource : public SharedSource
+	{
+	public:
+		ClipSource(std::shared_ptr<const utility::rtsp::Clip> clip, GstClockTime frame_duration, ILogger* logger);
+		~ClipSource() override;
+
+	protected:
+		bool start() override;
+		void stop() override;
+
+	private:
+		// pushes the access units until it's stopped
+		void stream();
+
+		const std::shared_ptr<const utility::rtsp::Clip> clip_;
+		const GstClockTime frame_duration_;
+
+		std::thread thread_;
+		std::mutex mutex_;
+		std::condition_variable stopped_;
+		bool stopping_ = false;
+	};
+}
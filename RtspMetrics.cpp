@@ -0,0 +1,216 @@
+#include "RtspMetrics.h"
+#include "RtspSignals.h"
+
+namespace
+{
+	// the key of the media's MediaState
+	const gchar* MEDIA_STATE = "osrv-media-state";
+}
+
+namespace osrv::rtsp
+{
+	struct ServerMetrics::Mount
+	{
+		explicit Mount(const std::string& path)
+			: prepared_medias(utility::metrics::make_counter("onvif_rtsp_prepared_medias_total",
+				"Medias prepared for the clients of the RTSP mount.", { {"mount", path} }))
+			, medias(utility::metrics::make_gauge("onvif_rtsp_medias",
+				"Prepared medias of the RTSP mount.", { {"mount", path} }))
+			, sessions(utility::metrics::make_gauge("onvif_rtsp_mount_sessions",
+				"RTSP sessions using the mount.", { {"mount", path} }))
+			, rtp_bytes(utility::metrics::make_counter("onvif_rtsp_rtp_bytes_total",
+				"RTP bytes produced by the payloaders of the RTSP mount, a shared media is counted once for all its clients.",
+				{ {"mount", path} }))
+		{
+		}
+
+		const std::shared_ptr<utility::metrics::Counter> prepared_medias;
+		const std::shared_ptr<utility::metrics::Gauge> medias;
+		const std::shared_ptr<utility::metrics::Gauge> sessions;
+		const std::shared_ptr<utility::metrics::Counter> rtp_bytes;
+	};
+
+	// it's the media's data, so it's destroyed with the media
+	struct ServerMetrics::MediaState
+	{
+		std::shared_ptr<Mount> mount;
+		// a media may be unprepared after its preparation failed
+		bool prepared = false;
+	};
+
+	ServerMetrics::ServerMetrics()
+		: connected_clients_(utility::metrics::make_counter("onvif_rtsp_connected_clients_total",
+			"Connections accepted by the RTSP server."))
+		, clients_(utility::metrics::make_gauge("onvif_rtsp_clients", "Connected RTSP clients."))
+		, created_sessions_(utility::metrics::make_counter("onvif_rtsp_created_sessions_total",
+			"RTSP sessions created by the clients' SETUP requests."))
+		, sessions_(utility::metrics::make_gauge("onvif_rtsp_sessions", "RTSP sessions of the session pool."))
+	{
+	}
+
+	ServerMetrics::~ServerMetrics()
+	{
+		if (sessions_source_ != nullptr)
+		{
+			g_source_destroy(sessions_source_);
+			g_source_unref(sessions_source_);
+		}
+
+		if (pool_ != nullptr)
+			g_object_unref(pool_);
+	}
+
+	void ServerMetrics::attach(GstRTSPServer* server, GMainContext* context, guint interval_seconds)
+	{
+		const auto self = shared_from_this();
+
+		connect_signal(server, "client-connected", G_CALLBACK(on_client_connected),
+			new std::weak_ptr<ServerMetrics>(self));
+
+		pool_ = gst_rtsp_server_get_session_pool(server);
+		connect_signal(pool_, "session-removed", G_CALLBACK(on_session_removed), new std::weak_ptr<ServerMetrics>(self));
+
+		sessions_source_ = g_timeout_source_new_seconds(interval_seconds);
+		g_source_set_callback(sessions_source_,
+			[](gpointer user_data) -> gboolean {
+				if (auto metrics = static_cast<std::weak_ptr<ServerMetrics>*>(user_data)->lock())
+					metrics->update_sessions();
+				return G_SOURCE_CONTINUE;
+			},
+			new std::weak_ptr<ServerMetrics>(self),
+			[](gpointer user_data) { delete static_cast<std::weak_ptr<ServerMetrics>*>(user_data); });
+		g_source_attach(sessions_source_, context);
+	}
+
+	void ServerMetrics::watch(GstRTSPMediaFactory* factory, const std::string& path)
+	{
+		connect_signal(factory, "media-configure", G_CALLBACK(on_media_configure),
+			new std::shared_ptr<Mount>(mount_of(path)));
+	}
+
+	std::shared_ptr<ServerMetrics::Mount> ServerMetrics::mount_of(const std::string& path)
+	{
+		std::lock_guard<std::mutex> lock(mounts_mutex_);
+
+		auto& mount = mounts_[path];
+		if (!mount)
+			mount = std::make_shared<Mount>(path);
+
+		return mount;
+	}
+
+	void ServerMetrics::update_sessions()
+	{
+		std::map<const Mount*, std::int64_t> sessions;
+
+		// the sessions are not removed or referenced, the filters only iterate them
+		gst_rtsp_session_pool_filter(pool_,
+			[](GstRTSPSessionPool*, GstRTSPSession* session, gpointer user_data) {
+				gst_rtsp_session_filter(session,
+					[](GstRTSPSession*, GstRTSPSessionMedia* session_media, gpointer user_data) {
+						auto media = gst_rtsp_session_media_get_media(session_media);
+						if (auto state = static_cast<MediaState*>(g_object_get_data(G_OBJECT(media), MEDIA_STATE)))
+							++(*static_cast<std::map<const Mount*, std::int64_t>*>(user_data))[state->mount.get()];
+						return GST_RTSP_FILTER_KEEP;
+					},
+					user_data);
+				return GST_RTSP_FILTER_KEEP;
+			},
+			&sessions);
+
+		std::lock_guard<std::mutex> lock(mounts_mutex_);
+		for (const auto& mount : mounts_)
+		{
+			const auto it = sessions.find(mount.second.get());
+			mount.second->sessions->set(it != sessions.end() ? it->second : 0);
+		}
+	}
+
+	void ServerMetrics::on_client_connected(GstRTSPServer* /*server*/, GstRTSPClient* client, gpointer user_data)
+	{
+		auto metrics = static_cast<std::weak_ptr<ServerMetrics>*>(user_data)->lock();
+		if (!metrics)
+			return;
+
+		metrics->connected_clients_->inc();
+		metrics->clients_->add(1);
+
+		connect_signal(client, "closed", G_CALLBACK(on_client_closed), new std::weak_ptr<ServerMetrics>(metrics));
+		connect_signal(client, "new-session", G_CALLBACK(on_new_session), new std::weak_ptr<ServerMetrics>(metrics));
+	}
+
+	void ServerMetrics::on_client_closed(GstRTSPClient* /*client*/, gpointer user_data)
+	{
+		if (auto metrics = static_cast<std::weak_ptr<ServerMetrics>*>(user_data)->lock())
+			metrics->clients_->add(-1);
+	}
+
+	void ServerMetrics::on_new_session(GstRTSPClient* /*client*/, GstRTSPSession* /*session*/, gpointer user_data)
+	{
+		if (auto metrics = static_cast<std::weak_ptr<ServerMetrics>*>(user_data)->lock())
+		{
+			metrics->created_sessions_->inc();
+			metrics->sessions_->add(1);
+		}
+	}
+
+	void ServerMetrics::on_session_removed(GstRTSPSessionPool* /*pool*/, GstRTSPSession* /*session*/, gpointer user_data)
+	{
+		if (auto metrics = static_cast<std::weak_ptr<ServerMetrics>*>(user_data)->lock())
+			metrics->sessions_->add(-1);
+	}
+
+	void ServerMetrics::on_media_configure(GstRTSPMediaFactory* /*factory*/, GstRTSPMedia* media, gpointer user_data)
+	{
+		const auto& mount = *static_cast<std::shared_ptr<Mount>*>(user_data);
+
+		auto state = new MediaState{ mount };
+		g_object_set_data_full(G_OBJECT(media), MEDIA_STATE, state,
+			[](gpointer state) { delete static_cast<MediaState*>(state); });
+		g_signal_connect(media, "prepared", G_CALLBACK(on_media_prepared), state);
+		g_signal_connect(media, "unprepared", G_CALLBACK(on_media_unprepared), state);
+
+		GstElement* element = gst_rtsp_media_get_element(media);
+		GstElement* payloader = gst_bin_get_by_name(GST_BIN(element), "pay0");
+		gst_object_unref(element);
+		if (payloader == nullptr)
+			return;
+
+		GstPad* pad = gst_element_get_static_pad(payloader, "src");
+		gst_pad_add_probe(pad, static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST),
+			on_payloaded, new std::shared_ptr<Mount>(mount),
+			[](gpointer mount) { delete static_cast<std::shared_ptr<Mount>*>(mount); });
+		gst_object_unref(pad);
+		gst_object_unref(payloader);
+	}
+
+	void ServerMetrics::on_media_prepared(GstRTSPMedia* /*media*/, gpointer user_data)
+	{
+		auto& state = *static_cast<MediaState*>(user_data);
+		state.prepared = true;
+		state.mount->prepared_medias->inc();
+		state.mount->medias->add(1);
+	}
+
+	void ServerMetrics::on_media_unprepared(GstRTSPMedia* /*media*/, gpointer user_data)
+	{
+		auto& state = *static_cast<MediaState*>(user_data);
+		if (!state.prepared)
+			return;
+
+		state.prepared = false;
+		state.mount->medias->add(-1);
+	}
+
+	GstPadProbeReturn ServerMetrics::on_payloaded(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data)
+	{
+		const auto& mount = *static_cast<std::shared_ptr<Mount>*>(user_data);
+
+		if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_BUFFER_LIST)
+			mount->rtp_bytes->inc(gst_buffer_list_calculate_size(GST_PAD_PROBE_INFO_BUFFER_LIST(info)));
+		else
+			mount->rtp_bytes->inc(gst_buffer_get_size(GST_PAD_PROBE_INFO_BUFFER(info)));
+
+		return GST_PAD_PROBE_OK;
+	}
+}
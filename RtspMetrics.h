@@ -0,0 +1,65 @@
+#pragma once
+
+#include "utility/Metrics.h"
+
+#include <gst/gst.h>
+#include <gst/rtsp-server/rtsp-server.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// The metrics of the RTSP server exported by utility::metrics, so the streaming load
+// may be compared with the load of the ONVIF requests.
+// The clients and the sessions are counted by the signals of the server, its clients and its session pool,
+// the medias and the payloaded bytes by the signals of the mounts' factories.
+// The sessions of each mount are counted periodically, as a session doesn't signal its medias' changes.
+namespace osrv::rtsp
+{
+	class ServerMetrics : public std::enable_shared_from_this<ServerMetrics>
+	{
+	public:
+		ServerMetrics();
+		~ServerMetrics();
+
+		ServerMetrics(const ServerMetrics&) = delete;
+		ServerMetrics& operator=(const ServerMetrics&) = delete;
+
+		// counts the clients and the sessions of the server, the sessions of the mounts are updated
+		// every @interval_seconds on @context, which runs the server
+		void attach(GstRTSPServer* /*server*/, GMainContext* /*context*/, guint /*interval_seconds*/ = 5);
+
+		// counts the medias of the factory mounted on @path, the factories of the same path share the metrics
+		void watch(GstRTSPMediaFactory* /*factory*/, const std::string& /*path*/);
+
+	private:
+		struct Mount;
+		struct MediaState;
+
+		std::shared_ptr<Mount> mount_of(const std::string& /*path*/);
+		// called on the server's context
+		void update_sessions();
+
+		static void on_client_connected(GstRTSPServer* /*server*/, GstRTSPClient* /*client*/, gpointer /*user_data*/);
+		static void on_client_closed(GstRTSPClient* /*client*/, gpointer /*user_data*/);
+		static void on_new_session(GstRTSPClient* /*client*/, GstRTSPSession* /*session*/, gpointer /*user_data*/);
+		static void on_session_removed(GstRTSPSessionPool* /*pool*/, GstRTSPSession* /*session*/, gpointer /*user_data*/);
+		static void on_media_configure(GstRTSPMediaFactory* /*factory*/, GstRTSPMedia* /*media*/, gpointer /*user_data*/);
+		static void on_media_prepared(GstRTSPMedia* /*media*/, gpointer /*user_data*/);
+		static void on_media_unprepared(GstRTSPMedia* /*media*/, gpointer /*user_data*/);
+		static GstPadProbeReturn on_payloaded(GstPad* /*pad*/, GstPadProbeInfo* /*info*/, gpointer /*user_data*/);
+
+		std::shared_ptr<utility::metrics::Counter> connected_clients_;
+		std::shared_ptr<utility::metrics::Gauge> clients_;
+		std::shared_ptr<utility::metrics::Counter> created_sessions_;
+		std::shared_ptr<utility::metrics::Gauge> sessions_;
+
+		GstRTSPSessionPool* pool_ = nullptr;
+		GSource* sessions_source_ = nullptr;
+
+		std::mutex mounts_mutex_;
+		// path -> metrics, a removed mount keeps its metrics, as it may be mounted again
+		std::map<std::string, std::shared_ptr<Mount>> mounts_;
+	};
+}
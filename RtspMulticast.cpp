@@ -0,0 +1,181 @@
+#include "RtspMulticast.h"
+
+#include <stdexcept>
+
+namespace osrv::rtsp
+{
+	GstRTSPAddressPool* make_address_pool(const utility::media::Multicast& multicast)
+	{
+		GstRTSPAddressPool* pool = gst_rtsp_address_pool_new();
+		if (!gst_rtsp_address_pool_add_range(pool, multicast.ipv4_address.c_str(), multicast.ipv4_address.c_str(),
+			static_cast<guint16>(multicast.port), static_cast<guint16>(multicast.port + 1),
+			static_cast<guint8>(multicast.ttl)))
+		{
+			g_object_unref(pool);
+			throw std::runtime_error("The multicast group is not correct: " + multicast.ipv4_address + ":"
+				+ std::to_string(multicast.port));
+		}
+
+		return pool;
+	}
+
+	AutoStart::AutoStart(GstRTSPServer* server, GstRTSPMediaFactory* factory, const std::string& path)
+	{
+		// the shared media is found by the key of the URL, which is made of the port and the path,
+		// so the clients of the path get the same media
+		const auto uri = "rtsp://127.0.0.1:" + std::to_string(gst_rtsp_server_get_bound_port(server)) + path;
+		GstRTSPUrl* url = nullptr;
+		if (gst_rtsp_url_parse(uri.c_str(), &url) != GST_RTSP_OK)
+			throw std::runtime_error("The URI of the multicast media is not correct: " + uri);
+
+		media_ = gst_rtsp_media_factory_construct(factory, url);
+		gst_rtsp_url_free(url);
+		if (media_ == nullptr)
+			throw std::runtime_error("Could not construct the multicast media of " + path);
+
+		GstRTSPThreadPool* thread_pool = gst_rtsp_server_get_thread_pool(server);
+		GstRTSPThread* thread = gst_rtsp_thread_pool_get_thread(thread_pool, GST_RTSP_THREAD_TYPE_MEDIA, NULL);
+		g_object_unref(thread_pool);
+
+		// the status waits until the media is prerolled
+		if (!gst_rtsp_media_prepare(media_, thread)
+			|| gst_rtsp_media_get_status(media_) != GST_RTSP_MEDIA_STATUS_PREPARED)
+		{
+			stop();
+			throw std::runtime_error("Could not prepare the multicast media of " + path);
+		}
+
+		transports_ = g_ptr_array_new();
+		try
+		{
+			add_transports();
+		}
+		catch (const std::exception& e)
+		{
+			stop();
+			throw std::runtime_error("Could not start the multicast of " + path + ": " + e.what());
+		}
+
+		watch_key_frames();
+		if (!gst_rtsp_media_set_state(media_, GST_STATE_PLAYING, transports_))
+		{
+			stop();
+			throw std::runtime_error("Could not play the multicast media of " + path);
+		}
+	}
+
+	GstSample* AutoStart::key_frame() const
+	{
+		return key_frame_->sample();
+	}
+
+	void AutoStart::watch_key_frames()
+	{
+		GstElement* element = gst_rtsp_media_get_element(media_);
+		GstElement* payloader = gst_bin_get_by_name(GST_BIN(element), "pay0");
+		gst_object_unref(element);
+		if (payloader == nullptr)
+			return;
+
+		payloader_pad_ = gst_element_get_static_pad(payloader, "sink");
+		gst_object_unref(payloader);
+		if (payloader_pad_ == nullptr)
+			return;
+
+		probe_id_ = gst_pad_add_probe(payloader_pad_, GST_PAD_PROBE_TYPE_BUFFER,
+			[](GstPad* pad, GstPadProbeInfo* info, gpointer user_data) -> GstPadProbeReturn {
+				const auto& key_frame = *static_cast<std::shared_ptr<LatestKeyFrame>*>(user_data);
+				GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+				if (!GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT))
+				{
+					GstCaps* caps = gst_pad_get_current_caps(pad);
+					key_frame->update(buffer, caps);
+					if (caps != nullptr)
+						gst_caps_unref(caps);
+				}
+				return GST_PAD_PROBE_OK;
+			},
+			new std::shared_ptr<LatestKeyFrame>(key_frame_),
+			[](gpointer user_data) { delete static_cast<std::shared_ptr<LatestKeyFrame>*>(user_data); });
+	}
+
+	AutoStart::~AutoStart()
+	{
+		stop();
+	}
+
+	void AutoStart::add_transports()
+	{
+		for (guint i = 0; i < gst_rtsp_media_n_streams(media_); ++i)
+		{
+			GstRTSPStream* stream = gst_rtsp_media_get_stream(media_, i);
+
+			// it's the same group, which is given to the clients requesting multicast
+			GstRTSPAddress* address = gst_rtsp_stream_get_multicast_address(stream, G_SOCKET_FAMILY_IPV4);
+			if (address == nullptr)
+				throw std::runtime_error("the stream " + std::to_string(i) + " has no multicast group");
+
+			GstRTSPTransport* transport = nullptr;
+			gst_rtsp_transport_new(&transport);
+			transport->trans = GST_RTSP_TRANS_RTP;
+			transport->profile = GST_RTSP_PROFILE_AVP;
+			transport->lower_transport = GST_RTSP_LOWER_TRANS_UDP_MCAST;
+			transport->destination = g_strdup(address->address);
+			transport->port.min = address->port;
+			transport->port.max = address->port + address->n_ports - 1;
+			transport->ttl = address->ttl;
+			gst_rtsp_address_free(address);
+
+			if (!gst_rtsp_stream_complete_stream(stream, transport))
+			{
+				gst_rtsp_transport_free(transport);
+				throw std::runtime_error("could not create the multicast sockets of the stream " + std::to_string(i));
+			}
+
+			// the stream transport owns the transport
+			GstRTSPStreamTransport* stream_transport = gst_rtsp_stream_transport_new(stream, transport);
+			if (!gst_rtsp_stream_add_transport(stream, stream_transport))
+			{
+				gst_rtsp_stream_transport_free(stream_transport);
+				throw std::runtime_error("could not add the multicast transport of the stream " + std::to_string(i));
+			}
+			g_ptr_array_add(transports_, stream_transport);
+		}
+	}
+
+	void AutoStart::stop()
+	{
+		if (payloader_pad_ != nullptr)
+		{
+			if (probe_id_ != 0)
+				gst_pad_remove_probe(payloader_pad_, probe_id_);
+			gst_object_unref(payloader_pad_);
+			payloader_pad_ = nullptr;
+		}
+		key_frame_->reset();
+
+		if (transports_ != nullptr)
+		{
+			// the media keeps playing, while the clients' transports are active
+			if (transports_->len != 0)
+				gst_rtsp_media_set_state(media_, GST_STATE_NULL, transports_);
+
+			for (guint i = 0; i < transports_->len; ++i)
+			{
+				auto stream_transport = static_cast<GstRTSPStreamTransport*>(g_ptr_array_index(transports_, i));
+				gst_rtsp_stream_remove_transport(gst_rtsp_stream_transport_get_stream(stream_transport),
+					stream_transport);
+				gst_rtsp_stream_transport_free(stream_transport);
+			}
+			g_ptr_array_free(transports_, TRUE);
+			transports_ = nullptr;
+		}
+
+		// the last inactive transport may have already unprepared the media,
+		// otherwise it's unprepared by the last of its preparations
+		if (gst_rtsp_media_get_status(media_) != GST_RTSP_MEDIA_STATUS_UNPREPARED)
+			gst_rtsp_media_unprepare(media_);
+		g_object_unref(media_);
+		media_ = nullptr;
+	}
+}
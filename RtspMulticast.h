@@ -0,0 +1,55 @@
+#pragma once
+
+#include "RtspSnapshots.h"
+
+#include "utility/MediaProfiles.h"
+
+#include <gst/gst.h>
+#include <gst/rtsp-server/rtsp-server.h>
+
+#include <memory>
+#include <string>
+
+// RTP multicast of the mounts, whose encoders have a multicast group, see utility::rtsp::Mount.
+// The factory of such a mount gets an address pool with only its group, so all the clients requesting
+// the multicast transport share one stream sent to the group, as the factory's media is shared.
+// With AutoStart the group is streamed without any client since the server is started,
+// the clients of the mount join the same media and group.
+namespace osrv::rtsp
+{
+	// the pool of the group's RTP port and the next one for RTCP
+	GstRTSPAddressPool* make_address_pool(const utility::media::Multicast& /*multicast*/);
+
+	class AutoStart
+	{
+	public:
+		// prepares the shared media of the factory mounted on @path of @server, which is attached,
+		// and plays it to the multicast group of the factory's address pool,
+		// throws std::runtime_error if it could not be started
+		AutoStart(GstRTSPServer* /*server*/, GstRTSPMediaFactory* /*factory*/, const std::string& /*path*/);
+		// the media is unprepared, unless the clients still use it
+		~AutoStart();
+
+		AutoStart(const AutoStart&) = delete;
+		AutoStart& operator=(const AutoStart&) = delete;
+
+		// a reference to the latest key frame payloaded by the media, nullptr if there is none yet
+		GstSample* key_frame() const;
+
+	private:
+		// adds the multicast transport of each stream, throws if a stream has no group
+		void add_transports();
+		// the encoded frames are watched on the sink pad of the payloader "pay0"
+		void watch_key_frames();
+		void stop();
+
+		GstRTSPMedia* media_ = nullptr;
+		// GstRTSPStreamTransport of each stream
+		GPtrArray* transports_ = nullptr;
+
+		// the probe's pad and id, the probe shares the frame, as it may be called while it's removed
+		GstPad* payloader_pad_ = nullptr;
+		gulong probe_id_ = 0;
+		std::shared_ptr<LatestKeyFrame> key_frame_ = std::make_shared<LatestKeyFrame>();
+	};
+}
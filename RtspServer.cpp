@@ -1,85 +1,554 @@
 #include "Server.h"
 #include "RtspServer.h"
 #include "Logger.h"
+#include "RtspFanout.h"
+#include "RtspMetrics.h"
+#include "RtspMulticast.h"
+#include "RtspSessions.h"
+#include "RtspSnapshots.h"
+
+#include "utility/ConfigSnapshot.h"
+#include "utility/ConfigStore.h"
+#include "utility/MediaProfiles.h"
+#include "utility/RtspClip.h"
+#include "utility/RtspMounts.h"
 
 #include <gst/gst.h>
 #include <gst/rtsp-server/rtsp-server.h>
 
+#include <boost/property_tree/ptree.hpp>
+
+#include <map>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <sstream>
+#include <vector>
+
+static const std::string MEDIA_CONFIGS_FILE = "media.config";
+
+// the frame rate of a clip, if its encoder has no frame rate limit
+static const float DEFAULT_CLIP_FRAME_RATE = 25;
+
+static GstClockTime frame_duration_of(const utility::media::VideoEncoderConfiguration& encoder)
+{
+	const auto frame_rate = encoder.rate_control && encoder.rate_control->frame_rate_limit > 0
+		? encoder.rate_control->frame_rate_limit : DEFAULT_CLIP_FRAME_RATE;
+
+	return static_cast<GstClockTime>(GST_SECOND / frame_rate);
+}
 
 namespace osrv
 {
 	namespace rtsp
 	{
-		Server::Server(ILogger* logger, ServerConfigs& server_configs)
+		struct Server::Mounts : public std::enable_shared_from_this<Server::Mounts>
+		{
+			Mounts(GstRTSPServer* server, GMainContext* context, boost::property_tree::ptree stream_configs,
+				utility::rtsp::StreamOptions options, std::shared_ptr<ServerMetrics> metrics,
+				std::shared_ptr<Sessions> sessions, std::shared_ptr<Snapshots> snapshots, ILogger* logger)
+				: server_(server)
+				, context_(g_main_context_ref(context))
+				, mount_points_(gst_rtsp_server_get_mount_points(server))
+				, stream_configs_(std::move(stream_configs))
+				, options_(options)
+				, metrics_(std::move(metrics))
+				, sessions_(std::move(sessions))
+				, snapshots_(std::move(snapshots))
+				, logger_(logger)
+			{
+			}
+
+			~Mounts()
+			{
+				clear();
+				g_object_unref(mount_points_);
+				g_main_context_unref(context_);
+			}
+
+			// a changed mount gets a new factory, the clients of the previous one keep
+			// their media until they disconnect.
+			// It's called by the listener of the profiles under the store's lock, so the multicast,
+			// which waits for the media's preroll, is started later on the server's context
+			void update(const utility::media::MediaProfiles& profiles)
+			{
+				const auto mounts = utility::rtsp::make_mounts(profiles,
+					profiles.resolve_stream_uris(stream_configs_), options_, *logger_);
+				sessions_->update(mounts);
+				snapshots_->update(mounts);
+
+				std::lock_guard<std::mutex> lock(mutex_);
+				if (stopped_)
+					return;
+
+				std::map<std::string, std::string> launches;
+				std::map<std::string, std::string> profile_paths;
+				std::map<std::string, std::weak_ptr<SharedSource>> path_sources;
+				for (const auto& mount : mounts)
+				{
+					const auto source = source_of(mount);
+					auto description = source.empty() ? mount.launch : source + " => " + mount.launch;
+					if (const auto& multicast = mount.multicast)
+					{
+						description += " => multicast " + multicast->ipv4_address + ":" + std::to_string(multicast->port)
+							+ " ttl=" + std::to_string(multicast->ttl) + (multicast->auto_start ? " auto-start" : "");
+					}
+
+					auto it = launches_.find(mount.path);
+					if (it != launches_.end() && it->second == description)
+					{
+						launches.emplace(mount.path, description);
+						profile_paths.emplace(mount.profile_token, mount.path);
+						const auto sourced = path_sources_.find(mount.path);
+						if (sourced != path_sources_.end())
+							path_sources.insert(*sourced);
+						continue;
+					}
+
+					// the group is released for the new factory
+					stop_multicast(mount.path);
+
+					std::shared_ptr<SharedSource> shared_source;
+					GstRTSPAddressPool* address_pool = nullptr;
+					try
+					{
+						if (!source.empty())
+							shared_source = shared_source_of(mount, source);
+						if (mount.multicast)
+							address_pool = make_address_pool(*mount.multicast);
+					}
+					catch (const std::exception& e)
+					{
+						logger_->Error("RTSP mount " + mount.path + " of " + mount.profile_token + " is not served: " + e.what());
+						continue;
+					}
+					launches.emplace(mount.path, description);
+					profile_paths.emplace(mount.profile_token, mount.path);
+					if (shared_source)
+						path_sources.emplace(mount.path, shared_source);
+
+					GstRTSPMediaFactory* factory = gst_rtsp_media_factory_new();
+					gst_rtsp_media_factory_set_launch(factory, mount.launch.c_str());
+					gst_rtsp_media_factory_set_shared(factory, TRUE);
+					if (address_pool != nullptr)
+					{
+						gst_rtsp_media_factory_set_address_pool(factory, address_pool);
+						g_object_unref(address_pool);
+						gst_rtsp_media_factory_set_protocols(factory, static_cast<GstRTSPLowerTrans>(
+							GST_RTSP_LOWER_TRANS_UDP | GST_RTSP_LOWER_TRANS_UDP_MCAST | GST_RTSP_LOWER_TRANS_TCP));
+					}
+					if (shared_source)
+						shared_source->attach(factory);
+					metrics_->watch(factory, mount.path);
+					gst_rtsp_mount_points_add_factory(mount_points_, mount.path.c_str(), factory);
+
+					logger_->Debug("RTSP mount " + mount.path + " of " + mount.profile_token + ": " + description);
+
+					if (mount.multicast && mount.multicast->auto_start)
+					{
+						auto_start_factories_[mount.path] = GST_RTSP_MEDIA_FACTORY(g_object_ref(factory));
+						if (started_)
+							schedule_multicast(mount.path, factory);
+					}
+				}
+
+				for (const auto& mounted : launches_)
+				{
+					if (launches.count(mounted.first) == 0)
+					{
+						stop_multicast(mounted.first);
+						gst_rtsp_mount_points_remove_factory(mount_points_, mounted.first.c_str());
+						logger_->Debug("RTSP mount " + mounted.first + " is removed");
+					}
+				}
+
+				launches_ = std::move(launches);
+				profile_paths_ = std::move(profile_paths);
+				path_sources_ = std::move(path_sources);
+			}
+
+			// the AutoStart multicast is started by the server's loop, the media are found by the port
+			// of the attached server
+			void start()
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				if (stopped_)
+					return;
+
+				started_ = true;
+				for (const auto& factory : auto_start_factories_)
+					schedule_multicast(factory.first, factory.second);
+			}
+
+			// stops the AutoStart multicast and removes all the factories, the mounts are not updated anymore
+			void clear()
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+
+				stopped_ = true;
+				for (const auto& mounted : launches_)
+				{
+					stop_multicast(mounted.first);
+					gst_rtsp_mount_points_remove_factory(mount_points_, mounted.first.c_str());
+				}
+				launches_.clear();
+				profile_paths_.clear();
+				path_sources_.clear();
+			}
+
+			// a reference to the latest key frame of the profile's stream, while it's streamed to the multicast
+			// group by AutoStart or its shared source has clients, otherwise nullptr
+			GstSample* key_frame(const std::string& profile_token) const
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+
+				const auto path = profile_paths_.find(profile_token);
+				if (path == profile_paths_.end())
+					return nullptr;
+
+				const auto auto_start = auto_starts_.find(path->second);
+				if (auto_start != auto_starts_.end())
+				{
+					if (GstSample* key_frame = auto_start->second->key_frame())
+						return key_frame;
+				}
+
+				const auto sourced = path_sources_.find(path->second);
+				if (sourced != path_sources_.end())
+				{
+					if (const auto shared_source = sourced->second.lock())
+						return shared_source->key_frame();
+				}
+
+				return nullptr;
+			}
+
+			std::vector<std::string> paths() const
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+
+				std::vector<std::string> result;
+				for (const auto& mounted : launches_)
+					result.push_back(mounted.first);
+
+				return result;
+			}
+
+		private:
+			struct PendingMulticast
+			{
+				std::weak_ptr<Mounts> mounts;
+				std::string path;
+				// it's referenced, so the address isn't reused by a newer factory of the path
+				GstRTSPMediaFactory* factory;
+			};
+
+			// the multicast is started by an idle source of the server's context, it's called under @mutex_
+			void schedule_multicast(const std::string& path, GstRTSPMediaFactory* factory)
+			{
+				auto pending = new PendingMulticast{ weak_from_this(), path,
+					GST_RTSP_MEDIA_FACTORY(g_object_ref(factory)) };
+
+				GSource* source = g_idle_source_new();
+				g_source_set_callback(source,
+					[](gpointer user_data) -> gboolean {
+						const auto pending = static_cast<PendingMulticast*>(user_data);
+						if (auto mounts = pending->mounts.lock())
+							mounts->start_multicast(pending->path, pending->factory);
+						return G_SOURCE_REMOVE;
+					},
+					pending,
+					[](gpointer user_data) {
+						const auto pending = static_cast<PendingMulticast*>(user_data);
+						g_object_unref(pending->factory);
+						delete pending;
+					});
+				g_source_attach(source, context_);
+				g_source_unref(source);
+			}
+
+			// it's called on the server's context, the media is prerolled without @mutex_,
+			// so the updates of the mounts aren't blocked
+			void start_multicast(const std::string& path, GstRTSPMediaFactory* factory)
+			{
+				{
+					std::lock_guard<std::mutex> lock(mutex_);
+					// it's already started by the previous scheduling
+					if (!is_auto_start(path, factory) || auto_starts_.count(path) != 0)
+						return;
+				}
+
+				std::unique_ptr<AutoStart> auto_start;
+				try
+				{
+					auto_start = std::make_unique<AutoStart>(server_, factory, path);
+				}
+				catch (const std::exception& e)
+				{
+					logger_->Error(e.what());
+					return;
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(mutex_);
+					// the mount is changed or removed while the media is prerolled
+					if (!is_auto_start(path, factory))
+						return;
+
+					std::swap(auto_starts_[path], auto_start);
+				}
+				logger_->Info("RTSP mount " + path + " is streamed to its multicast group");
+			}
+
+			bool is_auto_start(const std::string& path, GstRTSPMediaFactory* factory) const
+			{
+				const auto it = auto_start_factories_.find(path);
+				return !stopped_ && it != auto_start_factories_.end() && it->second == factory;
+			}
+
+			void stop_multicast(const std::string& path)
+			{
+				auto_starts_.erase(path);
+
+				const auto it = auto_start_factories_.find(path);
+				if (it != auto_start_factories_.end())
+				{
+					g_object_unref(it->second);
+					auto_start_factories_.erase(it);
+				}
+			}
+
+			// the description of the mount's shared source, it's empty if the factory encodes the stream itself
+			static std::string source_of(const utility::rtsp::Mount& mount)
+			{
+				if (!mount.clip.empty())
+					return "clip " + mount.clip + " " + std::to_string(frame_duration_of(mount.encoder)) + "ns per frame";
+
+				return mount.shared_encoding;
+			}
+
+			// the mounts with the same source share it, while any of their factories exists,
+			// throws if the clip could not be loaded
+			std::shared_ptr<SharedSource> shared_source_of(const utility::rtsp::Mount& mount, const std::string& description)
+			{
+				auto& source = sources_[description];
+				auto result = source.lock();
+				if (!result)
+				{
+					if (!mount.clip.empty())
+					{
+						const auto codec = mount.encoder.encoding == "H265" ? utility::rtsp::Codec::H265
+							: utility::rtsp::Codec::H264;
+						result = std::make_shared<ClipSource>(utility::rtsp::Clip::open(mount.clip, codec),
+							frame_duration_of(mount.encoder), logger_);
+					}
+					else
+					{
+						result = std::make_shared<EncoderSource>(mount.shared_encoding, logger_);
+					}
+					source = result;
+				}
+
+				return result;
+			}
+
+			GstRTSPServer* server_;
+			// the AutoStart multicast is started on it
+			GMainContext* context_;
+			GstRTSPMountPoints* mount_points_;
+			// GetStreamUri list of media.config
+			const boost::property_tree::ptree stream_configs_;
+			const utility::rtsp::StreamOptions options_;
+			const std::shared_ptr<ServerMetrics> metrics_;
+			const std::shared_ptr<Sessions> sessions_;
+			const std::shared_ptr<Snapshots> snapshots_;
+			ILogger* logger_;
+
+			mutable std::mutex mutex_;
+			// path -> launch description
+			std::map<std::string, std::string> launches_;
+			// shared source description -> source
+			std::map<std::string, std::weak_ptr<SharedSource>> sources_;
+			// profile token -> path of the mounted profile
+			std::map<std::string, std::string> profile_paths_;
+			// path -> the shared source of the mount's factory
+			std::map<std::string, std::weak_ptr<SharedSource>> path_sources_;
+			// the AutoStart multicast is started after the server is attached
+			bool started_ = false;
+			// the factories are removed
+			bool stopped_ = false;
+			// path -> the factory with AutoStart multicast
+			std::map<std::string, GstRTSPMediaFactory*> auto_start_factories_;
+			// path -> the started multicast
+			std::map<std::string, std::unique_ptr<AutoStart>> auto_starts_;
+		};
+
+		Server::Server(ILogger* logger, ServerConfigs& server_configs, const std::string& configs_dir)
 			:logger_(logger),
 			server_configs_(&server_configs)
 		{
 			gst_init(NULL, NULL);
-					
-			loop_ = g_main_loop_new(NULL, FALSE);
+
+			// the server doesn't share the default context with the other GLib users of the process
+			context_ = g_main_context_new();
+			loop_ = g_main_loop_new(context_, FALSE);
 
 			server_ = gst_rtsp_server_new();
 
-			//FIX_ME: address and port are hardcoded
 			gst_rtsp_server_set_address(server_, server_configs_->ipv4_address_.c_str());
 			gst_rtsp_server_set_service(server_, server_configs_->rtsp_port_.c_str());
 
-			mounts = gst_rtsp_server_get_mount_points(server_);
-			factoryHighStream = gst_rtsp_media_factory_new();
-			gst_rtsp_media_factory_set_launch(factoryHighStream,
-				"(videotestsrc is-live=1 ! video/x-raw,width=1280,height=720 ! x264enc ! rtph264pay name=pay0 pt=96 )");
-			
-			factoryLowStream = gst_rtsp_media_factory_new();
-			gst_rtsp_media_factory_set_launch(factoryLowStream,
-				"(videotestsrc is-live=1 ! video/x-raw,width=640,height=480! x264enc ! rtph264pay name=pay0 pt=96 )");
+			const auto media_configs = utility::config::ConfigSnapshot::read(configs_dir, MEDIA_CONFIGS_FILE);
+			const auto& options = server_configs_->rtsp_options_;
+			if (options.shared_encoding)
+				logger_->Info("RTSP streams with the same encoder's configuration are encoded once");
+			for (const auto& clip : options.clips)
+				logger_->Info("RTSP streams of " + clip.first + " are looped from " + clip.second);
+			if (!options.preset.empty())
+				logger_->Info("RTSP streams are encoded with the preset " + options.preset);
 
-			gst_rtsp_media_factory_set_shared(factoryHighStream, TRUE);
-			gst_rtsp_media_factory_set_shared(factoryLowStream, TRUE);
+			metrics_ = std::make_shared<ServerMetrics>();
+			metrics_->attach(server_, context_);
 
-			//FIX_ME: path is hardcoded
-			gst_rtsp_mount_points_add_factory(mounts, "/Live&HighStream", factoryHighStream);
-			gst_rtsp_mount_points_add_factory(mounts, "/Live&LowStream", factoryLowStream);
+			sessions_ = std::make_shared<Sessions>(server_configs_->rtsp_sessions_, logger_);
+			sessions_->attach(server_, context_);
 
-			g_object_unref(mounts);
+			snapshots_ = std::make_shared<Snapshots>(server_configs_->snapshots_interval_, logger_);
+
+			mounts_ = std::make_shared<Mounts>(server_, context_,
+				media_configs->get_child("GetStreamUri").tree(), options, metrics_, sessions_, snapshots_, logger_);
+
+			// the snapshots of the running streams are their current frames
+			snapshots_->set_key_frames(
+				[mounts = std::weak_ptr<Mounts>(mounts_)](const std::string& profile_token) -> GstSample* {
+					const auto m = mounts.lock();
+					return m ? m->key_frame(profile_token) : nullptr;
+				});
+
+			const auto profiles_store = utility::media::MediaProfiles::store(configs_dir, *logger_);
+			mounts_->update(*utility::media::MediaProfiles::instance(profiles_store->load()));
+
+			// the listener may outlive the server, as the store is shared with the media services
+			profiles_store->subscribe(
+				[mounts = std::weak_ptr<Mounts>(mounts_)](const utility::config::ConfigSnapshotSP& profiles_configs) {
+					if (auto m = mounts.lock())
+						m->update(*utility::media::MediaProfiles::instance(profiles_configs));
+				});
 		};
 
 		Server::~Server()
 		{
-			try
-			{
-				worker_thread->join();
-			}
-			catch (const std::exception&) {}
+			stop();
 		};
 
 		void Server::run()
 		{
-			//TODO: stop GSt main loop by signal
-			worker_thread = new std::thread(
+			worker_thread = std::thread(
 				[this]() {
+					g_main_context_push_thread_default(context_);
 
-					/* attach the server to the default maincontext */
-					gst_rtsp_server_attach(server_, NULL);
+					server_source_ = gst_rtsp_server_attach(server_, context_);
+					if (server_source_ == 0)
+					{
+						logger_->Error("RTSP Server could not be attached to port " + server_configs_->rtsp_port_);
+						g_main_context_pop_thread_default(context_);
+						return;
+					}
 
 					int actually_used_port = gst_rtsp_server_get_bound_port(server_);
 					if (stoi(server_configs_->rtsp_port_) != actually_used_port)
 						logger_->Warn("RTSP Server port is binding on: " + std::to_string(actually_used_port));
 
 					gchar* server_address = gst_rtsp_server_get_address(server_);
-					std::stringstream first_uri;
-					first_uri << "rtsp://" << server_address << ":" << actually_used_port << "/Live&HighStream";
-					std::stringstream second_uri;
-					second_uri << "rtsp://" << server_address << ":" << actually_used_port << "/Live&LowStream";
+					std::stringstream uris;
+					for (const auto& path : mounts_->paths())
+						uris << "\nrtsp://" << server_address << ":" << actually_used_port << path;
 
 					g_free(server_address);
 
-					logger_->Info("RTSP Server is running. URIs:\n" + first_uri.str()
-						+ "\n" + second_uri.str());
+					mounts_->start();
+					logger_->Info("RTSP Server is running. URIs:" + uris.str());
 					g_main_loop_run(loop_);
+
+					g_main_context_pop_thread_default(context_);
 				}
 			);
 		};
+
+		void Server::stop()
+		{
+			if (server_ == nullptr)
+				return;
+
+			if (worker_thread.joinable())
+			{
+				// the clients are released on the loop's thread, which serves them, so no request is
+				// handled at the same time, the loop is quit after that
+				GSource* source = g_idle_source_new();
+				g_source_set_callback(source,
+					[](gpointer user_data) -> gboolean {
+						auto server = static_cast<Server*>(user_data);
+						server->release_clients();
+						g_main_loop_quit(server->loop_);
+						return G_SOURCE_REMOVE;
+					},
+					this, nullptr);
+				g_source_attach(source, context_);
+				g_source_unref(source);
+
+				worker_thread.join();
+			}
+			else
+			{
+				release_clients();
+			}
+
+			if (server_source_ != 0)
+			{
+				// the listening socket is closed with the source
+				if (GSource* source = g_main_context_find_source_by_id(context_, server_source_))
+					g_source_destroy(source);
+				server_source_ = 0;
+			}
+
+			// the listener of the profiles only holds a weak pointer
+			mounts_.reset();
+			sessions_.reset();
+			metrics_.reset();
+
+			g_object_unref(server_);
+			server_ = nullptr;
+			g_main_loop_unref(loop_);
+			loop_ = nullptr;
+			g_main_context_unref(context_);
+			context_ = nullptr;
+
+			logger_->Info("RTSP Server is stopped");
+		}
+
+		int Server::bound_port() const
+		{
+			return server_ != nullptr ? gst_rtsp_server_get_bound_port(server_) : -1;
+		}
+
+		std::shared_ptr<const std::string> Server::snapshot(const std::string& profile_token)
+		{
+			return snapshots_->take(profile_token);
+		}
+
+		void Server::release_clients()
+		{
+			// the AutoStart multicast is stopped and no client can get a new media
+			mounts_->clear();
+
+			gst_rtsp_server_client_filter(server_,
+				[](GstRTSPServer*, GstRTSPClient*, gpointer) { return GST_RTSP_FILTER_REMOVE; }, nullptr);
+
+			// the sessions of the closed clients would be kept until they expire
+			GstRTSPSessionPool* pool = gst_rtsp_server_get_session_pool(server_);
+			gst_rtsp_session_pool_filter(pool,
+				[](GstRTSPSessionPool*, GstRTSPSession*, gpointer) { return GST_RTSP_FILTER_REMOVE; }, nullptr);
+			g_object_unref(pool);
+		}
 	}
-}
\ No newline at end of file
+}
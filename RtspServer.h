@@ -3,6 +3,7 @@
 #include <gst/gst.h>
 #include <gst/rtsp-server/rtsp-server.h>
 
+#include <memory>
 #include <string>
 #include <thread>
 
@@ -13,25 +14,57 @@ namespace osrv
 	struct ServerConfigs;
 	namespace rtsp
 	{
+		class ServerMetrics;
+		class Sessions;
+		class Snapshots;
+
 		class Server
 		{
 		public:
-			Server(ILogger* /*logger*/, ServerConfigs& /*server_configs*/);
+			// mounts a factory for each media profile, which has a stream URI in media.config,
+			// the factories are replaced when the encoders' configurations are changed
+			Server(ILogger* /*logger*/, ServerConfigs& /*server_configs*/, const std::string& /*configs_dir*/);
 			~Server();
+
+			Server(const Server&) = delete;
+			Server& operator=(const Server&) = delete;
+
+			// serves the clients on the server's own main context in a separate thread
 			void run();
+			// disconnects the clients, unprepares their medias and quits the main loop,
+			// the server can't be run again, it's called by the destructor
+			void stop();
+
+			// the port the server is listening on, -1 before it's attached by run() and after stop()
+			int bound_port() const;
+
+			// the JPEG snapshot of the profile, which is cached for the snapshots' interval of ServerConfigs,
+			// nullptr if the profile is not mounted, throws std::runtime_error if it could not be encoded
+			std::shared_ptr<const std::string> snapshot(const std::string& /*profile_token*/);
 
 		private:
-			GMainLoop* loop_;
-			GstRTSPServer* server_;
-			GstRTSPMountPoints* mounts;
-			GstRTSPMediaFactory* factoryHighStream;
-			GstRTSPMediaFactory* factoryLowStream;
+			struct Mounts;
+
+			// the clients' sessions are removed, so their medias are unprepared
+			void release_clients();
+
+			GMainContext* context_ = nullptr;
+			GMainLoop* loop_ = nullptr;
+			GstRTSPServer* server_ = nullptr;
+			// the id of the server's source in @context_, 0 if it's not attached
+			guint server_source_ = 0;
+			std::shared_ptr<ServerMetrics> metrics_;
+			std::shared_ptr<Sessions> sessions_;
+			// it's independent of the GStreamer server, so it's kept after stop()
+			std::shared_ptr<Snapshots> snapshots_;
+			// shared with the listener of the profiles' changes
+			std::shared_ptr<Mounts> mounts_;
 
 			ServerConfigs* server_configs_ = nullptr;
 
-			std::thread* worker_thread = nullptr;
+			std::thread worker_thread;
 
 			ILogger* logger_;
 		};
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,156 @@
+#include "RtspSessions.h"
+#include "RtspSignals.h"
+#include "Logger.h"
+
+namespace osrv::rtsp
+{
+	Sessions::Sessions(const utility::rtsp::SessionOptions& options, ILogger* logger)
+		: options_(options)
+		, logger_(logger)
+	{
+	}
+
+	Sessions::~Sessions()
+	{
+		if (cleanup_source_ != nullptr)
+		{
+			g_source_destroy(cleanup_source_);
+			g_source_unref(cleanup_source_);
+		}
+
+		if (pool_ != nullptr)
+			g_object_unref(pool_);
+		if (mount_points_ != nullptr)
+			g_object_unref(mount_points_);
+	}
+
+	void Sessions::attach(GstRTSPServer* server, GMainContext* context)
+	{
+		const auto self = shared_from_this();
+
+		pool_ = gst_rtsp_server_get_session_pool(server);
+		mount_points_ = gst_rtsp_server_get_mount_points(server);
+
+		// the pool itself answers 503 Service Unavailable, when it has no room for a new session
+		gst_rtsp_session_pool_set_max_sessions(pool_, options_.max_sessions);
+
+		if (options_.client_threads != 0)
+		{
+			GstRTSPThreadPool* thread_pool = gst_rtsp_server_get_thread_pool(server);
+			gst_rtsp_thread_pool_set_max_threads(thread_pool, static_cast<gint>(options_.client_threads));
+			g_object_unref(thread_pool);
+		}
+
+		connect_signal(server, "client-connected", G_CALLBACK(on_client_connected), new std::weak_ptr<Sessions>(self));
+
+		cleanup_source_ = g_timeout_source_new_seconds(options_.cleanup_interval);
+		g_source_set_callback(cleanup_source_,
+			[](gpointer user_data) -> gboolean {
+				if (auto sessions = static_cast<std::weak_ptr<Sessions>*>(user_data)->lock())
+				{
+					if (const auto removed = gst_rtsp_session_pool_cleanup(sessions->pool_))
+						sessions->logger_->Debug("Expired RTSP sessions are removed: " + std::to_string(removed));
+				}
+				return G_SOURCE_CONTINUE;
+			},
+			new std::weak_ptr<Sessions>(self),
+			[](gpointer user_data) { delete static_cast<std::weak_ptr<Sessions>*>(user_data); });
+		g_source_attach(cleanup_source_, context);
+	}
+
+	void Sessions::update(const std::vector<utility::rtsp::Mount>& mounts)
+	{
+		std::map<std::string, guint> timeouts;
+		for (const auto& mount : mounts)
+			timeouts[mount.path] = static_cast<guint>(mount.session_timeout.count());
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		timeouts_ = std::move(timeouts);
+	}
+
+	std::string Sessions::path_of(const GstRTSPContext* ctx) const
+	{
+		if (ctx == nullptr || ctx->uri == nullptr || ctx->uri->abspath == nullptr)
+			return {};
+
+		gint matched = 0;
+		GstRTSPMediaFactory* factory = gst_rtsp_mount_points_match(mount_points_, ctx->uri->abspath, &matched);
+		if (factory == nullptr)
+			return {};
+
+		g_object_unref(factory);
+		return std::string(ctx->uri->abspath, matched);
+	}
+
+	unsigned Sessions::sessions_of(const std::string& path) const
+	{
+		struct Counting
+		{
+			const std::string& path;
+			unsigned sessions;
+		} counting{ path, 0 };
+
+		// the sessions are not removed or referenced, the filter only iterates them
+		gst_rtsp_session_pool_filter(pool_,
+			[](GstRTSPSessionPool*, GstRTSPSession* session, gpointer user_data) {
+				auto& counting = *static_cast<Counting*>(user_data);
+				gint matched = 0;
+				if (gst_rtsp_session_get_media(session, counting.path.c_str(), &matched) != nullptr)
+					++counting.sessions;
+				return GST_RTSP_FILTER_KEEP;
+			},
+			&counting);
+
+		return counting.sessions;
+	}
+
+	void Sessions::on_client_connected(GstRTSPServer* /*server*/, GstRTSPClient* client, gpointer user_data)
+	{
+		auto sessions = static_cast<std::weak_ptr<Sessions>*>(user_data)->lock();
+		if (!sessions)
+			return;
+
+		if (sessions->options_.max_mount_sessions != 0)
+			connect_signal(client, "pre-setup-request", G_CALLBACK(on_pre_setup_request),
+				new std::weak_ptr<Sessions>(sessions));
+		connect_signal(client, "new-session", G_CALLBACK(on_new_session), new std::weak_ptr<Sessions>(sessions));
+	}
+
+	GstRTSPStatusCode Sessions::on_pre_setup_request(GstRTSPClient* /*client*/, GstRTSPContext* ctx, gpointer user_data)
+	{
+		auto sessions = static_cast<std::weak_ptr<Sessions>*>(user_data)->lock();
+		if (!sessions)
+			return GST_RTSP_STS_OK;
+
+		const auto path = sessions->path_of(ctx);
+		if (path.empty())
+			return GST_RTSP_STS_OK;
+
+		// another stream of the session's media is not a new session
+		gint matched = 0;
+		if (ctx->session != nullptr && gst_rtsp_session_get_media(ctx->session, path.c_str(), &matched) != nullptr)
+			return GST_RTSP_STS_OK;
+
+		if (sessions->sessions_of(path) < sessions->options_.max_mount_sessions)
+			return GST_RTSP_STS_OK;
+
+		sessions->logger_->Warn("RTSP SETUP is rejected, the mount " + path + " has the max number of sessions: "
+			+ std::to_string(sessions->options_.max_mount_sessions));
+		return GST_RTSP_STS_SERVICE_UNAVAILABLE;
+	}
+
+	void Sessions::on_new_session(GstRTSPClient* /*client*/, GstRTSPSession* session, gpointer user_data)
+	{
+		auto sessions = static_cast<std::weak_ptr<Sessions>*>(user_data)->lock();
+		if (!sessions)
+			return;
+
+		// the session is created by the SETUP request, which is being handled
+		const auto path = sessions->path_of(gst_rtsp_context_get_current());
+
+		std::lock_guard<std::mutex> lock(sessions->mutex_);
+		const auto timeout = sessions->timeouts_.find(path);
+		if (timeout != sessions->timeouts_.end() && timeout->second != 0)
+			gst_rtsp_session_set_timeout(session, timeout->second);
+	}
+}
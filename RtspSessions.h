@@ -0,0 +1,61 @@
+#pragma once
+
+#include "utility/RtspMounts.h"
+
+#include <gst/gst.h>
+#include <gst/rtsp-server/rtsp-server.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class ILogger;
+
+// The limits and the timeouts of the RTSP sessions.
+// The pool limits the number of all the sessions, the sessions of a mount are limited by rejecting
+// the SETUP requests, which would create a new session for it, with 503 Service Unavailable.
+// A new session gets the SessionTimeout of its mount's encoder. The expired sessions, e.g. of the crashed
+// clients, are removed by a periodic source, so their medias are unprepared and the pipelines are released.
+namespace osrv::rtsp
+{
+	class Sessions : public std::enable_shared_from_this<Sessions>
+	{
+	public:
+		Sessions(const utility::rtsp::SessionOptions& options, ILogger* logger);
+		~Sessions();
+
+		Sessions(const Sessions&) = delete;
+		Sessions& operator=(const Sessions&) = delete;
+
+		// configures the server's session and thread pools, the expired sessions are removed on @context,
+		// which runs the server
+		void attach(GstRTSPServer* /*server*/, GMainContext* /*context*/);
+
+		// the timeouts of the mounted paths
+		void update(const std::vector<utility::rtsp::Mount>& /*mounts*/);
+
+	private:
+		// the mounted path of the request's URI, it's empty if the URI is not mounted
+		std::string path_of(const GstRTSPContext* /*ctx*/) const;
+		// the sessions, which have a media of the path
+		unsigned sessions_of(const std::string& /*path*/) const;
+
+		static void on_client_connected(GstRTSPServer* /*server*/, GstRTSPClient* /*client*/, gpointer /*user_data*/);
+		static GstRTSPStatusCode on_pre_setup_request(GstRTSPClient* /*client*/, GstRTSPContext* /*ctx*/,
+			gpointer /*user_data*/);
+		static void on_new_session(GstRTSPClient* /*client*/, GstRTSPSession* /*session*/, gpointer /*user_data*/);
+
+		const utility::rtsp::SessionOptions options_;
+		ILogger* logger_;
+
+		GstRTSPSessionPool* pool_ = nullptr;
+		GstRTSPMountPoints* mount_points_ = nullptr;
+		GSource* cleanup_source_ = nullptr;
+
+		mutable std::mutex mutex_;
+		// path -> the session timeout in seconds, 0 - the pool's default
+		std::map<std::string, guint> timeouts_;
+	};
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <gst/gst.h>
+
+namespace osrv::rtsp
+{
+	// the data of a signal's handler is deleted with the handler
+	template<typename T>
+	void connect_signal(gpointer instance, const gchar* signal, GCallback callback, T* data)
+	{
+		g_signal_connect_data(instance, signal, callback, data,
+			[](gpointer data, GClosure*) { delete static_cast<T*>(data); }, static_cast<GConnectFlags>(0));
+	}
+}
@@ -0,0 +1,200 @@
+#include "RtspSnapshots.h"
+#include "Logger.h"
+
+#include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+#include <gst/app/gstappsrc.h>
+
+#include <stdexcept>
+
+// a snapshot doesn't wait for a broken pipeline longer
+static const GstClockTime SNAPSHOT_TIMEOUT = 5 * GST_SECOND;
+
+// the key frame of a running stream is decoded by the caps it was streamed with
+static const std::string KEY_FRAME_SNAPSHOT =
+	"appsrc name=src format=time ! decodebin ! videoconvert ! jpegenc snapshot=true ! appsink name=sink";
+
+namespace osrv::rtsp
+{
+	LatestKeyFrame::~LatestKeyFrame()
+	{
+		reset();
+	}
+
+	void LatestKeyFrame::update(GstBuffer* buffer, GstCaps* caps)
+	{
+		if (caps == nullptr || GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT))
+			return;
+
+		GstSample* sample = gst_sample_new(buffer, caps, nullptr, nullptr);
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::swap(sample_, sample);
+		if (sample != nullptr)
+			gst_sample_unref(sample);
+	}
+
+	void LatestKeyFrame::reset()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (sample_ != nullptr)
+		{
+			gst_sample_unref(sample_);
+			sample_ = nullptr;
+		}
+	}
+
+	GstSample* LatestKeyFrame::sample() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return sample_ != nullptr ? gst_sample_ref(sample_) : nullptr;
+	}
+
+	Snapshots::Snapshots(std::chrono::milliseconds interval, ILogger* logger)
+		: logger_(logger)
+		, cache_(interval)
+		, first_frames_(utility::SnapshotCache::PERMANENT)
+	{
+	}
+
+	void Snapshots::update(const std::vector<utility::rtsp::Mount>& mounts)
+	{
+		std::map<std::string, Source> sources;
+		for (const auto& mount : mounts)
+			sources[mount.profile_token] = Source{ mount.snapshot, !mount.clip.empty() };
+
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		for (const auto& sourced : sources_)
+		{
+			const auto it = sources.find(sourced.first);
+			if (it == sources.end() || it->second != sourced.second)
+			{
+				cache_.erase(sourced.first);
+				first_frames_.erase(sourced.first);
+			}
+		}
+
+		sources_ = std::move(sources);
+	}
+
+	void Snapshots::set_key_frames(KeyFrames key_frames)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		key_frames_ = std::move(key_frames);
+	}
+
+	utility::SnapshotCache::Frame Snapshots::take(const std::string& profile_token)
+	{
+		Source source;
+		KeyFrames key_frames;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+
+			const auto it = sources_.find(profile_token);
+			if (it == sources_.end())
+				return nullptr;
+
+			source = it->second;
+			key_frames = key_frames_;
+		}
+
+		return cache_.get(profile_token, [this, &profile_token, &source, &key_frames]() {
+				if (GstSample* key_frame = key_frames ? key_frames(profile_token) : nullptr)
+				{
+					try
+					{
+						logger_->Debug("Decoding the current key frame of " + profile_token);
+						auto result = encode(KEY_FRAME_SNAPSHOT, key_frame);
+						gst_sample_unref(key_frame);
+						return result;
+					}
+					catch (const std::exception& e)
+					{
+						gst_sample_unref(key_frame);
+						logger_->Warn("The current frame of " + profile_token + " could not be decoded: " + e.what());
+					}
+				}
+
+				auto encode_source = [this, &profile_token, &source]() {
+						logger_->Debug("Encoding the snapshot of " + profile_token + ": " + source.description);
+						return encode(source.description);
+					};
+
+				// the clip is always started from its first frame
+				if (source.clip)
+					return *first_frames_.get(profile_token, encode_source);
+
+				return encode_source();
+			});
+	}
+
+	std::string Snapshots::encode(const std::string& description, GstSample* key_frame)
+	{
+		GError* error = nullptr;
+		GstElement* pipeline = gst_parse_launch(description.c_str(), &error);
+		if (error != nullptr)
+		{
+			const std::string message = error->message;
+			g_error_free(error);
+			if (pipeline != nullptr)
+				gst_object_unref(pipeline);
+
+			throw std::runtime_error("Could not create the snapshot pipeline \"" + description + "\": " + message);
+		}
+
+		GstElement* appsink = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
+		if (appsink == nullptr)
+		{
+			gst_object_unref(pipeline);
+			throw std::runtime_error("The snapshot pipeline has no appsink \"sink\": " + description);
+		}
+
+		GstElement* appsrc = nullptr;
+		if (key_frame != nullptr)
+		{
+			appsrc = gst_bin_get_by_name(GST_BIN(pipeline), "src");
+			if (appsrc == nullptr)
+			{
+				gst_object_unref(appsink);
+				gst_object_unref(pipeline);
+				throw std::runtime_error("The snapshot pipeline has no appsrc \"src\": " + description);
+			}
+
+			// only the metadata is copied, the frame is the only one of the stream
+			GstBuffer* buffer = gst_buffer_copy(gst_sample_get_buffer(key_frame));
+			GST_BUFFER_PTS(buffer) = 0;
+			GST_BUFFER_DTS(buffer) = GST_CLOCK_TIME_NONE;
+			gst_app_src_set_caps(GST_APP_SRC(appsrc), gst_sample_get_caps(key_frame));
+			gst_app_src_push_buffer(GST_APP_SRC(appsrc), buffer);
+			gst_app_src_end_of_stream(GST_APP_SRC(appsrc));
+		}
+
+		std::string result;
+		if (gst_element_set_state(pipeline, GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE)
+		{
+			if (GstSample* sample = gst_app_sink_try_pull_sample(GST_APP_SINK(appsink), SNAPSHOT_TIMEOUT))
+			{
+				GstBuffer* buffer = gst_sample_get_buffer(sample);
+				GstMapInfo map;
+				if (buffer != nullptr && gst_buffer_map(buffer, &map, GST_MAP_READ))
+				{
+					result.assign(reinterpret_cast<const char*>(map.data), map.size);
+					gst_buffer_unmap(buffer, &map);
+				}
+				gst_sample_unref(sample);
+			}
+		}
+
+		gst_element_set_state(pipeline, GST_STATE_NULL);
+		if (appsrc != nullptr)
+			gst_object_unref(appsrc);
+		gst_object_unref(appsink);
+		gst_object_unref(pipeline);
+
+		if (result.empty())
+			throw std::runtime_error("The snapshot pipeline produced no frame: " + description);
+
+		return result;
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "utility/RtspMounts.h"
+#include "utility/SnapshotCache.h"
+
+#include <gst/gst.h>
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class ILogger;
+
+// JPEG snapshots of the mounted media profiles, served by HTTP on the URIs of GetSnapshotUri.
+// While a profile's stream is produced by a shared source with clients or by the AutoStart multicast,
+// its latest key frame is decoded, so the snapshot is the current frame. Otherwise nothing is streamed
+// and a snapshot is encoded by a short pipeline of the mount's source, see utility::rtsp::make_snapshot.
+// A profile's snapshot is taken at most once per interval, all the requests in between get the cached bytes,
+// the first frame of a clip doesn't change, so it's encoded only once.
+namespace osrv::rtsp
+{
+	// the latest key frame of a running stream with its caps, it's taken by the stream's thread
+	// and read by the snapshots' requests
+	class LatestKeyFrame
+	{
+	public:
+		LatestKeyFrame() = default;
+		~LatestKeyFrame();
+
+		LatestKeyFrame(const LatestKeyFrame&) = delete;
+		LatestKeyFrame& operator=(const LatestKeyFrame&) = delete;
+
+		// keeps a reference to @buffer, if it's a key frame and its caps are known
+		void update(GstBuffer* /*buffer*/, GstCaps* /*caps*/);
+		// the stream is stopped, so its frame isn't current anymore
+		void reset();
+
+		// a reference to the frame, nullptr if there is none
+		GstSample* sample() const;
+
+	private:
+		mutable std::mutex mutex_;
+		GstSample* sample_ = nullptr;
+	};
+
+	class Snapshots
+	{
+	public:
+		// a reference to the latest key frame of the profile's running stream or nullptr
+		using KeyFrames = std::function<GstSample*(const std::string& /*profile_token*/)>;
+
+		Snapshots(std::chrono::milliseconds interval, ILogger* logger);
+
+		Snapshots(const Snapshots&) = delete;
+		Snapshots& operator=(const Snapshots&) = delete;
+
+		// the snapshots of the mounts' profiles, the cached frame of a changed mount is dropped
+		void update(const std::vector<utility::rtsp::Mount>& /*mounts*/);
+		// the running streams, whose key frames are decoded instead of running the mounts' pipelines
+		void set_key_frames(KeyFrames /*key_frames*/);
+
+		// the JPEG of the profile, nullptr if the profile is not mounted,
+		// throws std::runtime_error if it could not be encoded
+		utility::SnapshotCache::Frame take(const std::string& /*profile_token*/);
+
+	private:
+		struct Source
+		{
+			// the description of the snapshot's pipeline
+			std::string description;
+			// it encodes the first frame of a clip
+			bool clip = false;
+
+			bool operator!=(const Source& other) const
+			{
+				return description != other.description || clip != other.clip;
+			}
+		};
+
+		// runs the pipeline until its appsink "sink" gets a frame, @key_frame is pushed into its appsrc "src"
+		static std::string encode(const std::string& /*description*/, GstSample* /*key_frame*/ = nullptr);
+
+		ILogger* logger_;
+		utility::SnapshotCache cache_;
+		// profile token -> the JPEG of the clip's first frame
+		utility::SnapshotCache first_frames_;
+
+		std::mutex mutex_;
+		// profile token -> the source of the snapshot, while nothing is streamed
+		std::map<std::string, Source> sources_;
+		KeyFrames key_frames_;
+	};
+}
@@ -9,6 +9,10 @@
 
 #include "utility/XmlParser.h"
 #include "utility/AuthHelper.h"
+#include "utility/HttpHelper.h"
+#include "utility/Metrics.h"
+#include "utility/ConfigWatcher.h"
+#include "utility/CompiledConfigs.h"
 #include "../onvif_services/physical_components/IDigitalInput.h"
 
 #include "Simple-Web-Server/server_http.hpp"
@@ -46,20 +50,17 @@ namespace osrv
 		};
 
 		configs_dir += "/";
-		// TODO: as now here we read configs, we can refactor @read_server_configs function and pass ptree 
-		std::ifstream configs_file(configs_dir + COMMON_CONFIGS_NAME);
-		if (configs_file.is_open())
-		{
-			namespace pt = boost::property_tree;
-			pt::ptree configs_tree;
-			pt::read_json(configs_file, configs_tree);
-			auto log_lvl = configs_tree.get<std::string>("loggingLevel", "");
-			if (!log_lvl.empty())
-				logger_.SetLogLevel(ILogger::to_lvl(log_lvl));
-		}
+		// the common configs are read once, for the logging level and for the server's settings
+		const auto configs_tree = utility::config::read_config(configs_dir, COMMON_CONFIGS_NAME);
+		auto log_lvl = configs_tree.get<std::string>("loggingLevel", "");
+		if (!log_lvl.empty())
+			logger_.SetLogLevel(ILogger::to_lvl(log_lvl));
 		logger_.Info("Logging level: " + logger_.GetLogLevel());
 
-		server_configs_ = read_server_configs(configs_dir + COMMON_CONFIGS_NAME);
+		if (auto compiled = utility::config::CompiledConfigs::instance(configs_dir))
+			logger_.Info("Compiled configs are used: " + configs_dir + utility::config::COMPILED_CONFIGS_FILE);
+
+		server_configs_ = read_server_configs(configs_tree);
 
 		if (server_configs_.enabled_http_port_forwarding)
 			logger_.Info("HTTP port forwarding simulated on port: " + std::to_string(server_configs_.forwarded_http_port));
@@ -71,21 +72,7 @@ namespace osrv
 		//TODO: here is the same list is copied into digest_session, although it's already stored in server_configs
 		server_configs_.digest_session_->set_users_list(server_configs_.system_users_);
 
-		device::init_service(*http_server_instance_, server_configs_, configs_dir, log);
-		media::init_service(*http_server_instance_, server_configs_, configs_dir, log);
-		media2::init_service(*http_server_instance_, server_configs_, configs_dir, log);
-		event::init_service(*http_server_instance_, server_configs_, configs_dir, log);
-		discovery::init_service(configs_dir, log);
-		imaging::init_service(*http_server_instance_, server_configs_, configs_dir, log);
-		ptz::init_service(*http_server_instance_, server_configs_, configs_dir, log);
-
-		rtspServer_ = new rtsp::Server(&log, server_configs_);
-
-		if (auto delay = server_configs_.network_delay_simulation_; delay > 0)
-		{
-			logger_.Info("Network delay simulation is enabled. Equals (ms): " + std::to_string(delay));
-		}
-
+		// the services' timers are created by their init
 		io_context_ = std::make_shared<boost::asio::io_context>();
 		io_context_work_ = std::make_shared<boost::asio::io_context::work>(*io_context_);
 		io_context_thread_ = std::make_shared<std::thread>(
@@ -97,11 +84,28 @@ namespace osrv
 		);
 
 		server_configs_.io_context_ = io_context_;
+
+		try
+		{
+			init_services(configs_dir);
+		}
+		catch (const std::exception&)
+		{
+			// the destructor isn't called, but the thread must be joined
+			ptz::stop();
+			io_context_work_.reset();
+			io_context_thread_->join();
+			throw;
+		}
 	}
 
 	Server::~Server()
 	{
+		if (configs_watcher_)
+			configs_watcher_->stop();
+
 		discovery::stop();
+		ptz::stop();
 
 		io_context_work_.reset();
 		try
@@ -116,7 +120,115 @@ namespace osrv
 		{
 		}
 
-		delete rtspServer_;
+		rtspServer_.reset();
+	}
+
+	void Server::init_services(const std::string& configs_dir)
+	{
+		device::init_service(*http_server_instance_, server_configs_, configs_dir, logger_);
+		media::init_service(*http_server_instance_, server_configs_, configs_dir, logger_);
+		media2::init_service(*http_server_instance_, server_configs_, configs_dir, logger_);
+		event::init_service(*http_server_instance_, server_configs_, configs_dir, logger_);
+		discovery::init_service(configs_dir, logger_);
+		imaging::init_service(*http_server_instance_, server_configs_, configs_dir, logger_);
+		ptz::init_service(*http_server_instance_, server_configs_, configs_dir, logger_);
+
+		if (server_configs_.configs_reload_enabled_)
+		{
+			configs_watcher_ = std::make_unique<utility::config::ConfigWatcher>(configs_dir, logger_);
+			device::watch_configs(*configs_watcher_);
+			media::watch_configs(*configs_watcher_);
+			media2::watch_configs(*configs_watcher_);
+			event::watch_configs(*configs_watcher_);
+			ptz::watch_configs(*configs_watcher_);
+			imaging::watch_configs(*configs_watcher_);
+			configs_watcher_->start();
+		}
+
+		if (server_configs_.metrics_enabled_)
+		{
+			http_server_instance_->resource["^" + server_configs_.metrics_path_ + "$"]["GET"] =
+				[](std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request)
+			{
+				auto content = utility::metrics::to_prometheus();
+				*response << "HTTP/1.1 200 OK\r\n"
+					<< "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+					<< "Content-Length: " << content.length() << "\r\n"
+					<< "Connection: close"
+					<< "\r\n\r\n"
+					<< content;
+			};
+
+			logger_.Info("Metrics are available on path: " + server_configs_.metrics_path_);
+		}
+
+		rtspServer_ = std::make_unique<rtsp::Server>(&logger_, server_configs_, configs_dir);
+
+		if (server_configs_.snapshots_enabled_)
+		{
+			http_server_instance_->resource["^" + server_configs_.snapshots_path_ + "/([^/]+)$"]["GET"] =
+				[this](std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request)
+			{
+				const std::string profile_token = request->path_match[1];
+
+				// the snapshot is the media, so it's protected the same as the SOAP requests of the media services
+				if (server_configs_.auth_scheme_ == AUTH_SCHEME::DIGEST)
+				{
+					const auto& digest_session = server_configs_.digest_session_;
+
+					auto current_user = osrv::auth::USER_TYPE::ANON;
+					auto auth_header_it = request->header.find(utility::http::HEADER_AUTHORIZATION);
+					if (auth_header_it != request->header.end())
+					{
+						auto da_from_request = utility::digest::extract_DA(auth_header_it->second);
+
+						bool isStaled;
+						if (digest_session->verifyDigest(da_from_request, isStaled))
+							current_user = osrv::auth::get_usertype_by_username(da_from_request.username, digest_session->get_users_list());
+					}
+
+					if (!osrv::auth::isUserHasAccess(current_user, osrv::auth::SECURITY_LEVELS::READ_MEDIA))
+					{
+						logger_.Error("The snapshot of " + profile_token + " is not authorized");
+						*response << utility::http::RESPONSE_UNAUTHORIZED << "\r\n"
+							<< "Content-Length: " << 0 << "\r\n"
+							<< utility::http::HEADER_WWW_AUTHORIZATION << ": " << digest_session->generateDigest().to_string() << "\r\n"
+							<< "\r\n";
+						return;
+					}
+				}
+
+				try
+				{
+					const auto snapshot = rtspServer_->snapshot(profile_token);
+					if (!snapshot)
+					{
+						response->write(SimpleWeb::StatusCode::client_error_not_found,
+							"No snapshot of the profile " + profile_token);
+						return;
+					}
+
+					*response << "HTTP/1.1 200 OK\r\n"
+						<< "Content-Type: image/jpeg\r\n"
+						<< "Content-Length: " << snapshot->length() << "\r\n"
+						<< "Cache-Control: no-cache"
+						<< "\r\n\r\n"
+						<< *snapshot;
+				}
+				catch (const std::exception& e)
+				{
+					logger_.Error("The snapshot of " + profile_token + " could not be taken: " + e.what());
+					response->write(SimpleWeb::StatusCode::server_error_internal_server_error, "No snapshot");
+				}
+			};
+
+			logger_.Info("Snapshots are available on path: " + server_configs_.snapshots_path_ + "/<profile token>");
+		}
+
+		if (auto delay = server_configs_.network_delay_simulation_; delay > 0)
+		{
+			logger_.Info("Network delay simulation is enabled. Equals (ms): " + std::to_string(delay));
+		}
 	}
 
 void Server::run()
@@ -160,7 +272,27 @@ ServerConfigs read_server_configs(const std::string& config_path)
 	namespace pt = boost::property_tree;
 	pt::ptree configs_tree;
 	pt::read_json(configs_file, configs_tree);
-	
+
+	return read_server_configs(configs_tree);
+}
+
+// the path is put into the regex of the HTTP route and into the URIs of the responses as is,
+// so it's only letters, digits, '-', '_' and the separators
+static std::string read_plain_path(const boost::property_tree::ptree& configs_tree, const std::string& name,
+	const std::string& default_value)
+{
+	const auto path = configs_tree.get<std::string>(name, default_value);
+	if (path.size() < 2 || path.front() != '/' || path.back() == '/' || path.find("//") != std::string::npos
+		|| path.find_first_not_of("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_/") != std::string::npos)
+	{
+		throw std::runtime_error("The " + name + " should be a plain path: " + path);
+	}
+
+	return path;
+}
+
+ServerConfigs read_server_configs(const boost::property_tree::ptree& configs_tree)
+{
 	ServerConfigs read_configs;
 
 	read_configs.ipv4_address_ = configs_tree.get<std::string>("addresses.ipv4");
@@ -178,11 +310,11 @@ ServerConfigs read_server_configs(const std::string& config_path)
 	auto auth_scheme = configs_tree.get<std::string>("authentication");
 	read_configs.auth_scheme_ = str_to_auth(auth_scheme);
 
-	auto users_node = configs_tree.get_child("users");
+	const auto& users_node = configs_tree.get_child("users");
 	if (users_node.empty())
 		throw std::runtime_error("Could not read Users list");
 
-	for (auto user : users_node)
+	for (const auto& user : users_node)
 	{
 		read_configs.system_users_.emplace_back(
 			osrv::auth::UserAccount{
@@ -194,6 +326,22 @@ ServerConfigs read_server_configs(const std::string& config_path)
 
 	read_configs.network_delay_simulation_ = configs_tree.get<unsigned short>("networkDelaySimulation.milliseconds");
 
+	read_configs.metrics_enabled_ = configs_tree.get<bool>("metrics.enabled", read_configs.metrics_enabled_);
+	read_configs.metrics_path_ = read_plain_path(configs_tree, "metrics.path", read_configs.metrics_path_);
+
+	read_configs.snapshots_enabled_ = configs_tree.get<bool>("snapshots.enabled", read_configs.snapshots_enabled_);
+	read_configs.snapshots_path_ = read_plain_path(configs_tree, "snapshots.path", read_configs.snapshots_path_);
+	read_configs.snapshots_interval_ = std::chrono::milliseconds(configs_tree.get<unsigned>("snapshots.interval",
+		static_cast<unsigned>(read_configs.snapshots_interval_.count())));
+
+	read_configs.configs_reload_enabled_ = configs_tree.get<bool>("configsReload.enabled", read_configs.configs_reload_enabled_);
+
+	if (const auto rtsp_configs = configs_tree.get_child_optional("rtsp"))
+	{
+		read_configs.rtsp_options_ = utility::rtsp::read_stream_options(*rtsp_configs);
+		read_configs.rtsp_sessions_ = utility::rtsp::read_session_options(*rtsp_configs);
+	}
+
 	return read_configs;
 }
 
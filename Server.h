@@ -4,9 +4,11 @@
 #include "Logger.h"
 #include "RtspServer.h"
 #include "utility/HttpDigestHelper.h"
+#include "utility/RtspMounts.h"
 #include "onvif_services\discovery_service.h"
 #include "onvif_services\physical_components\IDigitalInput.h"
 
+#include <chrono>
 #include <memory>
 
 namespace {
@@ -14,6 +16,11 @@ namespace {
 	const unsigned short MASTER_PORT = 8080;
 }
 
+namespace utility::config
+{
+	class ConfigWatcher;
+}
+
 namespace boost::asio
 {
 	class io_context;
@@ -52,6 +59,24 @@ namespace osrv
 
 		// milliseconds
 		unsigned short network_delay_simulation_ = 0;
+
+		// metrics are served in the Prometheus text format by GET request on this path
+		bool metrics_enabled_ = true;
+		std::string metrics_path_ = "/metrics";
+
+		// JPEG snapshots of the media profiles are served by GET request on "<path>/<profile token>",
+		// a profile's snapshot is encoded at most once per interval
+		bool snapshots_enabled_ = true;
+		std::string snapshots_path_ = "/snapshot";
+		std::chrono::milliseconds snapshots_interval_{ 1000 };
+
+		// the services' configs are re-read when their files are changed
+		bool configs_reload_enabled_ = false;
+
+		// how the RTSP streams are produced: the shared encoding, the clips and the encoders' presets
+		utility::rtsp::StreamOptions rtsp_options_;
+		// the limits of the RTSP sessions
+		utility::rtsp::SessionOptions rtsp_sessions_;
 	};
 
 	class Server
@@ -66,13 +91,18 @@ namespace osrv
 		void run();
 
 	private:
+		// creates the services, the RTSP server and the HTTP routes, it's called after the io_context is started
+		void init_services(const std::string& /*configs_dir*/);
+
 		ILogger& logger_;
 
 		std::shared_ptr<HttpServer> http_server_instance_ = nullptr;
 
 		ServerConfigs server_configs_;
 
-		rtsp::Server* rtspServer_;
+		std::unique_ptr<rtsp::Server> rtspServer_;
+
+		std::unique_ptr<utility::config::ConfigWatcher> configs_watcher_;
 
 		std::shared_ptr<boost::asio::io_context> io_context_;
 		std::shared_ptr<boost::asio::io_context::work> io_context_work_;
@@ -80,6 +110,7 @@ namespace osrv
 	};
 	
 	ServerConfigs read_server_configs(const std::string& /*config_path*/);
+	ServerConfigs read_server_configs(const boost::property_tree::ptree& /*configs_tree*/);
 
 	DigitalInputsList read_digital_inputs(const boost::property_tree::ptree& /*config_node*/);
 }
@@ -0,0 +1,608 @@
+// Load generator, which replays captured ONVIF requests against an in-process server over loopback.
+// Each request from @requests_dir is sent for @duration_ms by @concurrency clients
+// with the authentication disabled, with the digest authentication and as an anonymous user.
+// Results are printed as a table and written in JSON to compare them between versions,
+// see "--baseline" option.
+//
+// Usage: bench [--concurrency=8] [--duration_ms=1000] [--server_threads=N] [--pullpoint_polls=3]
+//	[--filter=media2] [--configs=DIR] [--requests=DIR] [--json=bench_results.json]
+//	[--baseline=previous_results.json] [--tolerance=10]
+
+#include "../Server.h"
+#include "../LoggerFactories.h"
+#include "../onvif_services/device_service.h"
+#include "../onvif_services/media_service.h"
+#include "../onvif_services/media2_service.h"
+#include "../onvif_services/event_service.h"
+#include "../onvif_services/imaging_service.h"
+#include "../onvif_services/ptz_service.h"
+#include "../utility/AuthHelper.h"
+#include "../utility/HttpDigestHelper.h"
+#include "../utility/HttpHelper.h"
+#include "../utility/Metrics.h"
+
+#include "../Simple-Web-Server/server_http.hpp"
+#include "../Simple-Web-Server/client_http.hpp"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#ifndef BENCH_REQUESTS_DIR
+#define BENCH_REQUESTS_DIR "../unit_tests/test_data/requests/"
+#endif
+
+#ifndef BENCH_CONFIGS_DIR
+#define BENCH_CONFIGS_DIR "../server_configs/"
+#endif
+
+// Only allocations made by the server's threads are counted,
+// the load generating threads reset this flag
+static std::atomic<std::uint64_t> server_allocations{ 0 };
+static thread_local bool is_server_thread = true;
+
+void* operator new(std::size_t size)
+{
+	if (is_server_thread)
+		server_allocations.fetch_add(1, std::memory_order_relaxed);
+
+	if (void* ptr = std::malloc(size ? size : 1))
+		return ptr;
+
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+namespace
+{
+	using HttpClient = SimpleWeb::Client<SimpleWeb::HTTP>;
+	using utility::metrics::LatencyHistogram;
+
+	const std::string PULLPOINT_DIR = "pullpoint";
+
+	struct BenchOptions
+	{
+		std::string configs_dir = BENCH_CONFIGS_DIR;
+		std::string requests_dir = BENCH_REQUESTS_DIR;
+		std::string json_output = "bench_results.json";
+		std::string baseline;
+		std::string filter;
+
+		int concurrency = 8;
+		int duration_ms = 1000;
+		int server_threads = std::max(1u, std::thread::hardware_concurrency());
+		int pullpoint_polls = 3;
+
+		// in percents
+		double tolerance = 10;
+	};
+
+	enum class AuthMode
+	{
+		NONE,
+		DIGEST,
+		DIGEST_ANONYMOUS // digest is required, but a client does not provide credentials
+	};
+
+	const char* to_string(AuthMode mode)
+	{
+		switch (mode)
+		{
+		case AuthMode::DIGEST: return "digest";
+		case AuthMode::DIGEST_ANONYMOUS: return "digest_anonymous";
+		default: return "none";
+		}
+	}
+
+	struct CapturedRequest
+	{
+		std::string service;
+		std::string method;
+		std::string path;
+		std::string body;
+	};
+
+	struct ScenarioResult
+	{
+		std::string service;
+		std::string method;
+		std::string auth;
+
+		std::uint64_t requests = 0;
+		std::uint64_t status_2xx = 0;
+		std::uint64_t status_4xx = 0;
+		std::uint64_t status_5xx = 0;
+		std::uint64_t failed = 0; // connection errors
+
+		double seconds = 0;
+		std::uint64_t allocations = 0;
+
+		// microseconds
+		LatencyHistogram latency;
+
+		double throughput() const
+		{
+			return seconds > 0 ? requests / seconds : 0;
+		}
+
+		double allocations_per_request() const
+		{
+			return requests ? static_cast<double>(allocations) / requests : 0;
+		}
+	};
+
+	BenchOptions parse_options(int argc, char** argv)
+	{
+		BenchOptions options;
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string arg = argv[i];
+			auto eq_pos = arg.find('=');
+			if (arg.rfind("--", 0) != 0 || eq_pos == std::string::npos)
+				throw std::runtime_error("Unexpected argument: " + arg);
+
+			auto name = arg.substr(2, eq_pos - 2);
+			auto value = arg.substr(eq_pos + 1);
+
+			if (name == "configs")
+				options.configs_dir = value + "/";
+			else if (name == "requests")
+				options.requests_dir = value + "/";
+			else if (name == "json")
+				options.json_output = value;
+			else if (name == "baseline")
+				options.baseline = value;
+			else if (name == "filter")
+				options.filter = value;
+			else if (name == "concurrency")
+				options.concurrency = std::stoi(value);
+			else if (name == "duration_ms")
+				options.duration_ms = std::stoi(value);
+			else if (name == "server_threads")
+				options.server_threads = std::stoi(value);
+			else if (name == "pullpoint_polls")
+				options.pullpoint_polls = std::stoi(value);
+			else if (name == "tolerance")
+				options.tolerance = std::stod(value);
+			else
+				throw std::runtime_error("Unknown option: " + name);
+		}
+
+		if (options.concurrency < 1 || options.duration_ms < 1 || options.server_threads < 1)
+			throw std::runtime_error("concurrency, duration_ms and server_threads should be positive");
+
+		return options;
+	}
+
+	std::string read_file(const std::filesystem::path& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open())
+			throw std::runtime_error("Could not read a file: " + path.string());
+
+		std::ostringstream os;
+		os << file.rdbuf();
+		return os.str();
+	}
+
+	// Requests are stored as "<requests_dir>/<service>/<Method>.xml",
+	// the directory "pullpoint" is used only for the long-polls scenario
+	std::vector<CapturedRequest> read_captured_requests(const std::string& requests_dir, const std::string& filter)
+	{
+		namespace fs = std::filesystem;
+
+		std::vector<CapturedRequest> result;
+		for (const auto& service_dir : fs::directory_iterator(requests_dir))
+		{
+			if (!service_dir.is_directory())
+				continue;
+
+			auto service = service_dir.path().filename().string();
+			if (service == PULLPOINT_DIR)
+				continue;
+
+			for (const auto& file : fs::directory_iterator(service_dir.path()))
+			{
+				if (file.path().extension() != ".xml")
+					continue;
+
+				CapturedRequest request;
+				request.service = service;
+				request.method = file.path().stem().string();
+				request.path = "/onvif/" + service + "_service";
+				request.body = read_file(file.path());
+
+				if ((request.service + "/" + request.method).find(filter) != std::string::npos)
+					result.push_back(std::move(request));
+			}
+		}
+
+		std::sort(result.begin(), result.end(), [](const CapturedRequest& lhs, const CapturedRequest& rhs) {
+				return std::tie(lhs.service, lhs.method) < std::tie(rhs.service, rhs.method);
+			});
+
+		return result;
+	}
+
+	// The server verifies only a username for now
+	std::string make_authorization_header(const std::string& username, const std::string& uri)
+	{
+		return "Digest username=\"" + username + "\", realm=\"Realm\", qop=\"auth\", algorithm=\"MD5\""
+			", uri=\"" + uri + "\", nonce=\"need_to_fix_nonce\", nc=00000001, cnonce=\"0a4f113b\""
+			", response=\"6629fae49393a05397450978507c4ef1\"";
+	}
+
+	void count_status(ScenarioResult& result, const std::string& status_code)
+	{
+		switch (status_code.empty() ? '0' : status_code.front())
+		{
+		case '2': ++result.status_2xx; break;
+		case '4': ++result.status_4xx; break;
+		case '5': ++result.status_5xx; break;
+		default: ++result.failed;
+		}
+	}
+
+	void merge(ScenarioResult& to, const ScenarioResult& from)
+	{
+		to.requests += from.requests;
+		to.status_2xx += from.status_2xx;
+		to.status_4xx += from.status_4xx;
+		to.status_5xx += from.status_5xx;
+		to.failed += from.failed;
+		to.latency.merge(from.latency);
+	}
+
+	// the server should be started with the authentication scheme of @mode
+	ScenarioResult run_scenario(unsigned short port, const CapturedRequest& request, AuthMode mode,
+		const std::string& username, const BenchOptions& options)
+	{
+		SimpleWeb::CaseInsensitiveMultimap header;
+		header.emplace("Content-Type", "application/soap+xml; charset=utf-8");
+		if (mode == AuthMode::DIGEST)
+			header.emplace(utility::http::HEADER_AUTHORIZATION, make_authorization_header(username, request.path));
+
+		std::vector<ScenarioResult> workers_results(options.concurrency);
+		std::vector<std::thread> workers;
+
+		const auto allocations_before = server_allocations.load();
+		const auto start = std::chrono::steady_clock::now();
+		const auto deadline = start + std::chrono::milliseconds(options.duration_ms);
+
+		for (auto& worker_result : workers_results)
+		{
+			workers.emplace_back([&worker_result, &request, &header, port, deadline]() {
+					is_server_thread = false;
+
+					HttpClient client("127.0.0.1:" + std::to_string(port));
+					while (std::chrono::steady_clock::now() < deadline)
+					{
+						const auto request_start = std::chrono::steady_clock::now();
+						try
+						{
+							auto response = client.request("POST", request.path, request.body, header);
+							response->content.string();
+							count_status(worker_result, response->status_code);
+						}
+						catch (const std::exception&)
+						{
+							++worker_result.failed;
+						}
+
+						++worker_result.requests;
+						worker_result.latency.record(std::chrono::duration_cast<std::chrono::microseconds>(
+							std::chrono::steady_clock::now() - request_start).count());
+					}
+				});
+		}
+
+		for (auto& w : workers)
+			w.join();
+
+		ScenarioResult result;
+		result.service = request.service;
+		result.method = request.method;
+		result.auth = to_string(mode);
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		result.allocations = server_allocations.load() - allocations_before;
+		for (const auto& worker_result : workers_results)
+			merge(result, worker_result);
+
+		return result;
+	}
+
+	// Only one subscription is supported by the server for now, so PullMessages are sent by one client.
+	// Latency of a long-poll includes the waiting of an event from the generators.
+	// The server should be started without the authentication
+	ScenarioResult run_pullpoint_scenario(unsigned short port, const BenchOptions& options)
+	{
+		namespace fs = std::filesystem;
+		const fs::path pullpoint_dir = fs::path(options.requests_dir) / PULLPOINT_DIR;
+		const auto create_request = read_file(pullpoint_dir / "CreatePullPointSubscription.xml");
+		const auto pull_request = read_file(pullpoint_dir / "PullMessages.xml");
+
+		ScenarioResult result;
+		result.service = PULLPOINT_DIR;
+		result.method = "PullMessages";
+		result.auth = to_string(AuthMode::NONE);
+
+		HttpClient client("127.0.0.1:" + std::to_string(port));
+		auto subscription = client.request("POST", "/onvif/event_service", create_request);
+		if (subscription->status_code.front() != '2')
+			throw std::runtime_error("Could not create a PullPoint subscription: " + subscription->status_code);
+
+		const auto allocations_before = server_allocations.load();
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < options.pullpoint_polls; ++i)
+		{
+			const auto request_start = std::chrono::steady_clock::now();
+			try
+			{
+				auto response = client.request("POST", "/onvif/event_service/s0", pull_request);
+				response->content.string();
+				count_status(result, response->status_code);
+			}
+			catch (const std::exception&)
+			{
+				++result.failed;
+			}
+
+			++result.requests;
+			result.latency.record(std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - request_start).count());
+		}
+
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		result.allocations = server_allocations.load() - allocations_before;
+
+		return result;
+	}
+
+	void print_results(std::ostream& os, const std::vector<ScenarioResult>& results)
+	{
+		os << std::left << std::setw(48) << "method" << std::setw(18) << "auth" << std::right
+			<< std::setw(10) << "req/s" << std::setw(10) << "p50,us" << std::setw(10) << "p99,us"
+			<< std::setw(10) << "p999,us" << std::setw(12) << "allocs/req"
+			<< std::setw(8) << "4xx" << std::setw(8) << "5xx" << std::setw(8) << "failed" << "\n";
+
+		for (const auto& r : results)
+		{
+			os << std::left << std::setw(48) << (r.service + "/" + r.method) << std::setw(18) << r.auth << std::right
+				<< std::fixed << std::setprecision(1)
+				<< std::setw(10) << r.throughput()
+				<< std::setw(10) << r.latency.percentile(50)
+				<< std::setw(10) << r.latency.percentile(99)
+				<< std::setw(10) << r.latency.percentile(99.9)
+				<< std::setw(12) << r.allocations_per_request()
+				<< std::setw(8) << r.status_4xx << std::setw(8) << r.status_5xx << std::setw(8) << r.failed << "\n";
+		}
+	}
+
+	void write_json(std::ostream& os, const std::vector<ScenarioResult>& results, const BenchOptions& options)
+	{
+		os << "{\n"
+			<< "  \"concurrency\": " << options.concurrency << ",\n"
+			<< "  \"duration_ms\": " << options.duration_ms << ",\n"
+			<< "  \"server_threads\": " << options.server_threads << ",\n"
+			<< "  \"results\": [\n";
+
+		for (std::size_t i = 0; i < results.size(); ++i)
+		{
+			const auto& r = results[i];
+			os << "    {"
+				<< "\"service\": \"" << r.service << "\", "
+				<< "\"method\": \"" << r.method << "\", "
+				<< "\"auth\": \"" << r.auth << "\", "
+				<< "\"requests\": " << r.requests << ", "
+				<< "\"status_2xx\": " << r.status_2xx << ", "
+				<< "\"status_4xx\": " << r.status_4xx << ", "
+				<< "\"status_5xx\": " << r.status_5xx << ", "
+				<< "\"failed\": " << r.failed << ", "
+				<< std::fixed << std::setprecision(2)
+				<< "\"throughput_rps\": " << r.throughput() << ", "
+				<< "\"latency_us\": {"
+				<< "\"p50\": " << r.latency.percentile(50) << ", "
+				<< "\"p99\": " << r.latency.percentile(99) << ", "
+				<< "\"p999\": " << r.latency.percentile(99.9) << ", "
+				<< "\"max\": " << r.latency.max() << "}, "
+				<< "\"allocations_per_request\": " << r.allocations_per_request()
+				<< "}" << (i + 1 < results.size() ? "," : "") << "\n";
+		}
+
+		os << "  ]\n}\n";
+	}
+
+	// Returns the number of regressions: throughput is decreased or p99 latency is increased
+	// more than on @tolerance percents
+	int compare_with_baseline(const std::string& baseline_path, const std::vector<ScenarioResult>& results,
+		double tolerance, std::ostream& os)
+	{
+		namespace pt = boost::property_tree;
+		pt::ptree baseline_tree;
+		pt::read_json(baseline_path, baseline_tree);
+
+		std::map<std::string, std::pair<double, double>> baseline; // { throughput, p99 }
+		for (const auto& [name, node] : baseline_tree.get_child("results"))
+		{
+			auto key = node.get<std::string>("service") + "/" + node.get<std::string>("method")
+				+ " " + node.get<std::string>("auth");
+			baseline[key] = { node.get<double>("throughput_rps"), node.get<double>("latency_us.p99") };
+		}
+
+		int regressions = 0;
+		for (const auto& r : results)
+		{
+			auto it = baseline.find(r.service + "/" + r.method + " " + r.auth);
+			if (it == baseline.end())
+				continue;
+
+			const auto [base_throughput, base_p99] = it->second;
+			const double throughput_change = base_throughput > 0 ? (r.throughput() / base_throughput - 1) * 100 : 0;
+			const double p99_change = base_p99 > 0 ? (r.latency.percentile(99) / base_p99 - 1) * 100 : 0;
+
+			if (throughput_change < -tolerance || p99_change > tolerance)
+			{
+				++regressions;
+				os << "REGRESSION " << it->first << std::fixed << std::setprecision(1)
+					<< ": throughput " << throughput_change << "%, p99 " << p99_change << "%\n";
+			}
+		}
+
+		return regressions;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	is_server_thread = false;
+
+	BenchOptions options;
+	try
+	{
+		options = parse_options(argc, argv);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+
+	// the services' logs should not affect the results
+	ILogger* logger = ConsoleLoggerFactory().GetLogger(ILogger::LVL_ERR);
+
+	auto server_configs = osrv::read_server_configs(options.configs_dir + "common.config");
+	server_configs.digest_session_ = std::make_shared<utility::digest::DigestSessionImpl>();
+	server_configs.digest_session_->set_users_list(server_configs.system_users_);
+	server_configs.network_delay_simulation_ = 0;
+
+	auto admin_it = std::find_if(server_configs.system_users_.begin(), server_configs.system_users_.end(),
+		[](const osrv::auth::UserAccount& user) { return user.type == osrv::auth::USER_TYPE::ADMIN; });
+	if (admin_it == server_configs.system_users_.end())
+	{
+		std::cerr << "An administrator account is required in common.config\n";
+		return 1;
+	}
+
+	server_configs.io_context_ = std::make_shared<boost::asio::io_context>();
+	auto io_context_work = std::make_shared<boost::asio::io_context::work>(*server_configs.io_context_);
+	std::thread io_context_thread([&server_configs]() {
+			server_configs.io_context_->run();
+		});
+
+	osrv::HttpServer http_server;
+	http_server.config.address = "127.0.0.1";
+	http_server.config.port = 0; // any free port
+	http_server.config.thread_pool_size = options.server_threads;
+
+	// the same services as in osrv::Server, but without RTSP and Discovery
+	osrv::device::init_service(http_server, server_configs, options.configs_dir, *logger);
+	osrv::media::init_service(http_server, server_configs, options.configs_dir, *logger);
+	osrv::media2::init_service(http_server, server_configs, options.configs_dir, *logger);
+	osrv::event::init_service(http_server, server_configs, options.configs_dir, *logger);
+	osrv::imaging::init_service(http_server, server_configs, options.configs_dir, *logger);
+	osrv::ptz::init_service(http_server, server_configs, options.configs_dir, *logger);
+
+	std::thread server_thread;
+	const auto start_server = [&http_server, &server_thread]() {
+			std::promise<unsigned short> server_port;
+			server_thread = std::thread([&http_server, &server_port]() {
+					http_server.start([&server_port](unsigned short port) {
+							server_port.set_value(port);
+						});
+				});
+			return server_port.get_future().get();
+		};
+	const auto stop_server = [&http_server, &server_thread]() {
+			if (!server_thread.joinable())
+				return;
+
+			http_server.stop();
+			server_thread.join();
+		};
+
+	std::vector<ScenarioResult> results;
+	int exit_code = 0;
+	try
+	{
+		const auto requests = read_captured_requests(options.requests_dir, options.filter);
+		std::vector<ScenarioResult> pullpoint_results;
+		for (auto mode : { AuthMode::NONE, AuthMode::DIGEST, AuthMode::DIGEST_ANONYMOUS })
+		{
+			// the server's threads read the authentication scheme on each request,
+			// so it's changed only while the server is stopped
+			server_configs.auth_scheme_ = mode == AuthMode::NONE ? osrv::AUTH_SCHEME::NONE : osrv::AUTH_SCHEME::DIGEST;
+			const auto port = start_server();
+
+			for (const auto& request : requests)
+				results.push_back(run_scenario(port, request, mode, admin_it->login, options));
+
+			if (mode == AuthMode::NONE && options.pullpoint_polls > 0
+				&& std::string(PULLPOINT_DIR).find(options.filter) != std::string::npos)
+			{
+				pullpoint_results.push_back(run_pullpoint_scenario(port, options));
+			}
+
+			stop_server();
+		}
+
+		// the modes of a method are listed together
+		std::stable_sort(results.begin(), results.end(), [](const ScenarioResult& lhs, const ScenarioResult& rhs) {
+				return std::tie(lhs.service, lhs.method) < std::tie(rhs.service, rhs.method);
+			});
+		results.insert(results.end(), pullpoint_results.begin(), pullpoint_results.end());
+
+		print_results(std::cout, results);
+
+		std::ofstream json_file(options.json_output);
+		write_json(json_file, results, options);
+		std::cout << "\nResults are written to " << options.json_output << "\n";
+
+		if (!options.baseline.empty())
+		{
+			auto regressions = compare_with_baseline(options.baseline, results, options.tolerance, std::cout);
+			std::cout << "Regressions comparing with " << options.baseline << ": " << regressions << "\n";
+			exit_code = regressions ? 2 : 0;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Benchmark failed: " << e.what() << "\n";
+		exit_code = 1;
+	}
+
+	stop_server();
+
+	io_context_work.reset();
+	io_context_thread.join();
+
+	std::cout.flush();
+
+	// The event service does not provide a way to stop its NotificationsManager's thread,
+	// so the process is terminated without destroying static objects
+	std::_Exit(exit_code);
+}
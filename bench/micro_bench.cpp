@@ -0,0 +1,236 @@
+// Micro benchmarks of the primitives used on the requests' hot path.
+// Payloads are read from unit_tests/test_data, so the numbers are comparable between versions.
+//
+// Usage: micro_bench [--benchmark_filter=to_ptree] [--benchmark_format=json]
+
+#include "../utility/XmlParser.h"
+#include "../utility/SoapHelper.h"
+#include "../utility/HttpDigestHelper.h"
+#include "../utility/DateTime.hpp"
+#include "../utility/Uuid.h"
+#include "../onvif_services/pullpoint/pull_point.h"
+
+#include <benchmark/benchmark.h>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef BENCH_TEST_DATA_DIR
+#define BENCH_TEST_DATA_DIR "../unit_tests/test_data/"
+#endif
+
+#ifndef BENCH_CONFIGS_DIR
+#define BENCH_CONFIGS_DIR "../server_configs/"
+#endif
+
+namespace
+{
+	namespace pt = boost::property_tree;
+
+	const std::string TEST_DATA_DIR = BENCH_TEST_DATA_DIR;
+
+	std::string read_file(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open())
+			throw std::runtime_error("Could not read a file: " + path);
+
+		std::ostringstream os;
+		os << file.rdbuf();
+		return os.str();
+	}
+
+	struct RequestPayload
+	{
+		std::string name;
+		std::string body;
+	};
+
+	// from a small request to a big one with the SOAP Header
+	const std::vector<RequestPayload>& request_payloads()
+	{
+		static const std::vector<RequestPayload> payloads = []() {
+			std::vector<RequestPayload> result;
+			for (const auto* name : { "device/GetSystemDateAndTime", "media/GetStreamUri", "pullpoint/PullMessages" })
+				result.push_back({ name, read_file(TEST_DATA_DIR + "requests/" + name + ".xml") });
+			return result;
+		}();
+
+		return payloads;
+	}
+
+	std::deque<osrv::event::NotificationMessage> read_notification_messages()
+	{
+		pt::ptree tree;
+		pt::read_json(TEST_DATA_DIR + "notification_messages.json", tree);
+
+		std::deque<osrv::event::NotificationMessage> result;
+		for (const auto& [name, node] : tree.get_child("NotificationMessages"))
+		{
+			osrv::event::NotificationMessage nm;
+			nm.topic = node.get<std::string>("Topic");
+			nm.utc_time = node.get<std::string>("UtcTime");
+			nm.property_operation = node.get<std::string>("PropertyOperation");
+			for (const auto& [n, item] : node.get_child("Source"))
+				nm.source_item_descriptions.push_back({ item.get<std::string>("Name"), item.get<std::string>("Value") });
+			nm.data_name = node.get<std::string>("DataName");
+			nm.data_value = node.get<std::string>("DataValue");
+
+			result.push_back(nm);
+		}
+
+		return result;
+	}
+
+	osrv::StringsMap read_namespaces()
+	{
+		pt::ptree tree;
+		pt::read_json(std::string(BENCH_CONFIGS_DIR) + "event.config", tree);
+
+		osrv::StringsMap result;
+		for (const auto& [name, node] : tree.get_child("Namespaces"))
+			result.insert({ name, node.get_value<std::string>() });
+
+		return result;
+	}
+}
+
+static void BM_to_ptree(benchmark::State& state)
+{
+	const auto& payload = request_payloads()[state.range(0)];
+	state.SetLabel(payload.name);
+
+	for (auto _ : state)
+		benchmark::DoNotOptimize(exns::to_ptree(payload.body));
+
+	state.SetBytesProcessed(state.iterations() * payload.body.size());
+}
+BENCHMARK(BM_to_ptree)->DenseRange(0, 2);
+
+static void BM_getMethod(benchmark::State& state)
+{
+	const auto& payload = request_payloads()[state.range(0)];
+	state.SetLabel(payload.name);
+
+	// the same way as the services do
+	exns::Parser parser;
+	std::istringstream is(payload.body);
+	pt::xml_parser::read_xml(is, static_cast<pt::ptree&>(parser));
+
+	for (auto _ : state)
+		benchmark::DoNotOptimize(parser.___getMethod());
+}
+BENCHMARK(BM_getMethod)->DenseRange(0, 2);
+
+static void BM_find_hierarchy(benchmark::State& state)
+{
+	const auto tree = exns::to_ptree(read_file(TEST_DATA_DIR + "requests/pullpoint/PullMessages.xml"));
+
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(exns::find_hierarchy("Envelope.Header.Action", tree));
+		benchmark::DoNotOptimize(exns::find_hierarchy("Envelope.Header.MessageID", tree));
+		benchmark::DoNotOptimize(exns::find_hierarchy("Envelope.Header.To", tree));
+		benchmark::DoNotOptimize(exns::find_hierarchy("Envelope.Body.PullMessages.MessageLimit", tree));
+	}
+
+	state.SetItemsProcessed(state.iterations() * 4);
+}
+BENCHMARK(BM_find_hierarchy);
+
+static void BM_jsonNodeToXml(benchmark::State& state)
+{
+	pt::ptree configs;
+	pt::read_json(TEST_DATA_DIR + "media2_service_test.config", configs);
+	const auto& json_node = configs.get_child("VideoEncoderConfigurations2");
+
+	for (auto _ : state)
+	{
+		pt::ptree xml_node;
+		utility::soap::jsonNodeToXml(json_node, xml_node, "tt");
+		benchmark::DoNotOptimize(xml_node);
+	}
+}
+BENCHMARK(BM_jsonNodeToXml);
+
+static void BM_getEnvelopeTree_write_xml(benchmark::State& state)
+{
+	const auto namespaces = read_namespaces();
+
+	for (auto _ : state)
+	{
+		auto envelope_tree = utility::soap::getEnvelopeTree(namespaces);
+		envelope_tree.add("s:Body.tds:GetSystemDateAndTimeResponse", "");
+
+		pt::ptree root_tree;
+		root_tree.put_child("s:Envelope", envelope_tree);
+
+		std::ostringstream os;
+		pt::write_xml(os, root_tree);
+		benchmark::DoNotOptimize(os.str());
+	}
+}
+BENCHMARK(BM_getEnvelopeTree_write_xml);
+
+static void BM_serialize_notification_messages(benchmark::State& state)
+{
+	const auto messages = read_notification_messages();
+
+	for (auto _ : state)
+	{
+		// messages are consumed by the serialization
+		state.PauseTiming();
+		auto copy = messages;
+		state.ResumeTiming();
+
+		benchmark::DoNotOptimize(osrv::event::serialize_notification_messages(copy, "onvif/event_service/s0"));
+	}
+
+	state.SetItemsProcessed(state.iterations() * messages.size());
+}
+BENCHMARK(BM_serialize_notification_messages);
+
+static void BM_extract_DA(benchmark::State& state)
+{
+	auto header = read_file(TEST_DATA_DIR + "digest_authorization.header");
+	header.erase(header.find_last_not_of("\r\n") + 1);
+
+	for (auto _ : state)
+		benchmark::DoNotOptimize(utility::digest::extract_DA(header));
+}
+BENCHMARK(BM_extract_DA);
+
+static void BM_search_value(benchmark::State& state)
+{
+	auto header = read_file(TEST_DATA_DIR + "digest_authorization.header");
+	header.erase(header.find_last_not_of("\r\n") + 1);
+
+	for (auto _ : state)
+		benchmark::DoNotOptimize(utility::string::search_value(header, "nonce"));
+}
+BENCHMARK(BM_search_value);
+
+static void BM_posix_datetime_to_utc(benchmark::State& state)
+{
+	const auto time = boost::posix_time::time_from_string("2020-10-27 11:20:42");
+
+	for (auto _ : state)
+		benchmark::DoNotOptimize(utility::datetime::posix_datetime_to_utc(time));
+}
+BENCHMARK(BM_posix_datetime_to_utc);
+
+static void BM_urn_v4(benchmark::State& state)
+{
+	for (auto _ : state)
+		benchmark::DoNotOptimize(utility::uuid::urn_v4());
+}
+BENCHMARK(BM_urn_v4)->ThreadRange(1, 8);
+
+BENCHMARK_MAIN();
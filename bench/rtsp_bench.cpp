@@ -0,0 +1,456 @@
+// Measures the cost of the RTSP streams for each encoder's preset of common.config.
+// For each preset @streams pipelines run in-process for @duration_ms: the source, the encoder and
+// the payloader of the mount's pipeline (see utility::rtsp::make_launch), then the depayloader
+// and the decoder of a client. The network is not included.
+// Reported values are the process CPU usage per stream and the glass-to-glass latency, i.e. the time
+// between a frame leaving the source and the same frame leaving the client's decoder.
+// The passthrough preset streams @clip (an elementary stream of the encoder's encoding) paced
+// in real time, it's skipped if @clip is not given.
+//
+// Usage: rtsp_bench [--streams=4] [--duration_ms=5000] [--warmup_ms=1000] [--profile=ProfileToken0]
+//	[--clip=FILE] [--configs=DIR] [--json=rtsp_bench_results.json]
+
+#include "../Server.h"
+#include "../LoggerFactories.h"
+#include "../utility/ConfigStore.h"
+#include "../utility/MediaProfiles.h"
+#include "../utility/Metrics.h"
+#include "../utility/RtspMounts.h"
+
+#include <gst/gst.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#ifndef BENCH_CONFIGS_DIR
+#define BENCH_CONFIGS_DIR "../server_configs/"
+#endif
+
+namespace
+{
+	using utility::metrics::LatencyHistogram;
+	using Clock = std::chrono::steady_clock;
+
+	struct BenchOptions
+	{
+		std::string configs_dir = BENCH_CONFIGS_DIR;
+		std::string json_output = "rtsp_bench_results.json";
+		std::string profile;
+		std::string clip;
+
+		int streams = 4;
+		int duration_ms = 5000;
+		int warmup_ms = 1000;
+	};
+
+	struct PresetResult
+	{
+		std::string preset;
+		std::string pipeline;
+
+		// in percents of one core
+		double cpu_per_stream = 0;
+		double frames_per_second = 0;
+		// microseconds
+		LatencyHistogram latency;
+		bool failed = false;
+	};
+
+	BenchOptions parse_options(int argc, char** argv)
+	{
+		BenchOptions options;
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string arg = argv[i];
+			auto eq_pos = arg.find('=');
+			if (arg.rfind("--", 0) != 0 || eq_pos == std::string::npos)
+				throw std::runtime_error("Unexpected argument: " + arg);
+
+			auto name = arg.substr(2, eq_pos - 2);
+			auto value = arg.substr(eq_pos + 1);
+
+			if (name == "configs")
+				options.configs_dir = value + "/";
+			else if (name == "json")
+				options.json_output = value;
+			else if (name == "profile")
+				options.profile = value;
+			else if (name == "clip")
+				options.clip = value;
+			else if (name == "streams")
+				options.streams = std::stoi(value);
+			else if (name == "duration_ms")
+				options.duration_ms = std::stoi(value);
+			else if (name == "warmup_ms")
+				options.warmup_ms = std::stoi(value);
+			else
+				throw std::runtime_error("Unknown option: " + name);
+		}
+
+		if (options.streams < 1 || options.duration_ms < 1 || options.warmup_ms < 0)
+			throw std::runtime_error("streams and duration_ms should be positive");
+
+		return options;
+	}
+
+	// the user and the kernel time of all the process' threads
+	std::chrono::microseconds process_cpu_time()
+	{
+#ifdef _WIN32
+		FILETIME creation, exit, kernel, user;
+		GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+		auto to_us = [](const FILETIME& time) {
+			return ((static_cast<std::uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime) / 10;
+		};
+		return std::chrono::microseconds(to_us(kernel) + to_us(user));
+#else
+		rusage usage{};
+		getrusage(RUSAGE_SELF, &usage);
+		auto to_us = [](const timeval& time) {
+			return static_cast<std::int64_t>(time.tv_sec) * 1000000 + time.tv_usec;
+		};
+		return std::chrono::microseconds(to_us(usage.ru_utime) + to_us(usage.ru_stime));
+#endif
+	}
+
+	// the frames are matched by PTS, which is kept by the encoder, the payloader and the decoder
+	class Stream
+	{
+	public:
+		explicit Stream(const std::string& description)
+		{
+			GError* error = nullptr;
+			pipeline_ = gst_parse_launch(description.c_str(), &error);
+			if (error != nullptr)
+			{
+				const std::string message = error->message;
+				g_error_free(error);
+				if (pipeline_ != nullptr)
+					gst_object_unref(pipeline_);
+				throw std::runtime_error("Could not create the pipeline: " + message);
+			}
+
+			try
+			{
+				add_probe("glass", on_captured);
+				add_probe("display", on_displayed);
+			}
+			catch (const std::exception&)
+			{
+				gst_object_unref(pipeline_);
+				throw;
+			}
+		}
+
+		~Stream()
+		{
+			gst_element_set_state(pipeline_, GST_STATE_NULL);
+			gst_object_unref(pipeline_);
+		}
+
+		Stream(const Stream&) = delete;
+		Stream& operator=(const Stream&) = delete;
+
+		bool play()
+		{
+			return gst_element_set_state(pipeline_, GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE;
+		}
+
+		// the warm-up frames are not counted
+		void reset()
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			latency_ = {};
+			frames_ = 0;
+		}
+
+		LatencyHistogram latency() const
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			return latency_;
+		}
+
+		std::uint64_t frames() const
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			return frames_;
+		}
+
+	private:
+		void add_probe(const char* name, GstPadProbeCallback callback)
+		{
+			GstElement* element = gst_bin_get_by_name(GST_BIN(pipeline_), name);
+			if (element == nullptr)
+				throw std::runtime_error(std::string("The pipeline has no element ") + name);
+
+			GstPad* pad = gst_element_get_static_pad(element, std::string(name) == "glass" ? "src" : "sink");
+			gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, callback, this, nullptr);
+			gst_object_unref(pad);
+			gst_object_unref(element);
+		}
+
+		static GstPadProbeReturn on_captured(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data)
+		{
+			auto& stream = *static_cast<Stream*>(user_data);
+			const auto pts = GST_BUFFER_PTS(GST_PAD_PROBE_INFO_BUFFER(info));
+
+			std::lock_guard<std::mutex> lock(stream.mutex_);
+			stream.captured_.emplace_back(pts, Clock::now());
+
+			// the frames dropped by the encoder are forgotten
+			if (stream.captured_.size() > 1000)
+				stream.captured_.pop_front();
+
+			return GST_PAD_PROBE_OK;
+		}
+
+		static GstPadProbeReturn on_displayed(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data)
+		{
+			auto& stream = *static_cast<Stream*>(user_data);
+			const auto pts = GST_BUFFER_PTS(GST_PAD_PROBE_INFO_BUFFER(info));
+			const auto now = Clock::now();
+
+			std::lock_guard<std::mutex> lock(stream.mutex_);
+			while (!stream.captured_.empty() && stream.captured_.front().first < pts)
+				stream.captured_.pop_front();
+
+			if (!stream.captured_.empty() && stream.captured_.front().first == pts)
+			{
+				stream.latency_.record(static_cast<std::uint64_t>(
+					std::chrono::duration_cast<std::chrono::microseconds>(now - stream.captured_.front().second).count()));
+				stream.captured_.pop_front();
+			}
+			++stream.frames_;
+
+			return GST_PAD_PROBE_OK;
+		}
+
+		GstElement* pipeline_ = nullptr;
+
+		mutable std::mutex mutex_;
+		std::deque<std::pair<GstClockTime, Clock::time_point>> captured_;
+		LatencyHistogram latency_;
+		std::uint64_t frames_ = 0;
+	};
+
+	std::string client_of(const utility::media::VideoEncoderConfiguration& encoder)
+	{
+		if (encoder.encoding == "JPEG")
+			return "rtpjpegdepay ! jpegdec";
+		if (encoder.encoding == "H265")
+			return "rtph265depay ! avdec_h265";
+
+		return "rtph264depay ! avdec_h264";
+	}
+
+	// the mount's pipeline with the client's part instead of the RTSP server's sink
+	std::string make_pipeline(const utility::media::VideoEncoderConfiguration& encoder,
+		const utility::rtsp::StreamOptions& options, bool passthrough, const std::string& clip)
+	{
+		auto launch = utility::rtsp::make_launch(encoder, options);
+		launch = launch.substr(2, launch.size() - 4);
+
+		if (passthrough)
+		{
+			// the appsrc is fed by the clip, which is paced by identity the same as ClipSource does
+			const auto parser = encoder.encoding == "H265" ? "h265parse ! video/x-h265" : "h264parse ! video/x-h264";
+			launch.replace(0, launch.find(" ! "), std::string("filesrc location=\"") + clip + "\" ! " + parser
+				+ ",stream-format=byte-stream,alignment=au ! identity name=glass sync=true");
+		}
+		else
+		{
+			const std::string source = "videotestsrc";
+			launch.replace(launch.find(source), source.size(), source + " name=glass");
+		}
+
+		return launch + " ! " + client_of(encoder) + " ! fakesink name=display sync=false";
+	}
+
+	PresetResult run_preset(const std::string& preset, const std::string& pipeline, const BenchOptions& options)
+	{
+		PresetResult result;
+		result.preset = preset;
+		result.pipeline = pipeline;
+
+		std::vector<std::unique_ptr<Stream>> streams;
+		try
+		{
+			for (int i = 0; i < options.streams; ++i)
+			{
+				streams.push_back(std::make_unique<Stream>(pipeline));
+				if (!streams.back()->play())
+					throw std::runtime_error("Could not start the pipeline");
+			}
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << "The preset " << preset << " failed: " << e.what() << "\n";
+			result.failed = true;
+			return result;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(options.warmup_ms));
+		for (auto& stream : streams)
+			stream->reset();
+
+		const auto cpu_start = process_cpu_time();
+		const auto start = Clock::now();
+		std::this_thread::sleep_for(std::chrono::milliseconds(options.duration_ms));
+		const auto cpu = process_cpu_time() - cpu_start;
+		const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start);
+
+		std::uint64_t frames = 0;
+		for (auto& stream : streams)
+		{
+			result.latency.merge(stream->latency());
+			frames += stream->frames();
+		}
+
+		result.cpu_per_stream = 100.0 * cpu.count() / elapsed.count() / options.streams;
+		result.frames_per_second = frames * 1000000.0 / elapsed.count() / options.streams;
+
+		return result;
+	}
+
+	void print_results(std::ostream& os, const std::vector<PresetResult>& results)
+	{
+		os << std::left << std::setw(20) << "preset" << std::right
+			<< std::setw(14) << "cpu/stream,%" << std::setw(12) << "fps/stream"
+			<< std::setw(10) << "p50,ms" << std::setw(10) << "p99,ms" << std::setw(10) << "max,ms" << "\n";
+
+		for (const auto& r : results)
+		{
+			os << std::left << std::setw(20) << r.preset << std::right << std::fixed << std::setprecision(1);
+			if (r.failed)
+			{
+				os << std::setw(14) << "failed" << "\n";
+				continue;
+			}
+
+			os << std::setw(14) << r.cpu_per_stream << std::setw(12) << r.frames_per_second
+				<< std::setw(10) << r.latency.percentile(50) / 1000.0
+				<< std::setw(10) << r.latency.percentile(99) / 1000.0
+				<< std::setw(10) << r.latency.max() / 1000.0 << "\n";
+		}
+	}
+
+	void write_json(std::ostream& os, const std::vector<PresetResult>& results, const BenchOptions& options)
+	{
+		os << "{\n"
+			<< "  \"streams\": " << options.streams << ",\n"
+			<< "  \"duration_ms\": " << options.duration_ms << ",\n"
+			<< "  \"results\": [\n";
+
+		for (std::size_t i = 0; i < results.size(); ++i)
+		{
+			const auto& r = results[i];
+			os << "    { \"preset\": \"" << r.preset << "\", \"failed\": " << (r.failed ? "true" : "false")
+				<< ", \"cpu_per_stream\": " << r.cpu_per_stream
+				<< ", \"fps_per_stream\": " << r.frames_per_second
+				<< ", \"latency_p50_us\": " << r.latency.percentile(50)
+				<< ", \"latency_p99_us\": " << r.latency.percentile(99)
+				<< ", \"latency_max_us\": " << r.latency.max() << " }"
+				<< (i + 1 < results.size() ? ",\n" : "\n");
+		}
+
+		os << "  ]\n}\n";
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchOptions options;
+	try
+	{
+		options = parse_options(argc, argv);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+
+	gst_init(nullptr, nullptr);
+
+	ILogger* logger = ConsoleLoggerFactory().GetLogger(ILogger::LVL_ERR);
+
+	std::vector<PresetResult> results;
+	try
+	{
+		const auto server_configs = osrv::read_server_configs(options.configs_dir + "common.config");
+
+		using utility::media::MediaProfiles;
+		const auto profiles = MediaProfiles::instance(MediaProfiles::store(options.configs_dir, *logger)->load());
+		const auto& all_profiles = profiles->profiles();
+		const auto profile = std::find_if(all_profiles.begin(), all_profiles.end(),
+			[&options](const utility::media::Profile& p) { return options.profile.empty() || p.token == options.profile; });
+		if (profile == all_profiles.end())
+			throw std::runtime_error("The profile is not found: " + options.profile);
+
+		const auto& encoder = profile->video_encoder2 != utility::media::NOT_FOUND ? profiles->video_encoder2_of(*profile)
+			: profiles->video_encoder_of(*profile);
+		std::cout << "Profile " << profile->token << ", encoder " << encoder.token << " (" << encoder.encoding << " "
+			<< encoder.resolution.width << "x" << encoder.resolution.height << "), " << options.streams << " streams\n\n";
+
+		// the encoders' defaults are measured too
+		auto presets = server_configs.rtsp_options_.presets;
+		presets.emplace("default", utility::rtsp::EncoderPreset{});
+
+		for (const auto& preset : presets)
+		{
+			auto stream_options = server_configs.rtsp_options_;
+			stream_options.shared_encoding = false;
+			stream_options.clips.clear();
+			stream_options.encoder_presets.clear();
+			stream_options.preset = preset.first == "default" ? "" : preset.first;
+			stream_options.presets = presets;
+
+			if (preset.second.passthrough)
+			{
+				if (options.clip.empty())
+				{
+					std::cout << "The preset " << preset.first << " is skipped, there is no --clip\n";
+					continue;
+				}
+				stream_options.clips[encoder.token] = options.clip;
+			}
+
+			const auto pipeline = make_pipeline(encoder, stream_options, preset.second.passthrough, options.clip);
+			std::cout << preset.first << ": " << pipeline << "\n";
+			results.push_back(run_preset(preset.first, pipeline, options));
+		}
+
+		std::cout << "\n";
+		print_results(std::cout, results);
+
+		std::ofstream json_file(options.json_output);
+		write_json(json_file, results, options);
+		std::cout << "\nResults are written to " << options.json_output << "\n";
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Benchmark failed: " << e.what() << "\n";
+		return 1;
+	}
+
+	return 0;
+}
@@ -6,6 +6,8 @@
 #include "../utility/HttpHelper.h"
 #include "../utility/SoapHelper.h"
 #include "../utility/HttpDigestHelper.h"
+#include "../utility/ConfigSnapshot.h"
+#include "../utility/ConfigWatcher.h"
 
 #include "../Simple-Web-Server/server_http.hpp"
 
@@ -30,7 +32,7 @@ const std::string GetScopes = "GetScopes";
 const std::string GetSystemDateAndTime = "GetSystemDateAndTime";
 
 namespace pt = boost::property_tree;
-static pt::ptree CONFIGS_TREE;
+static utility::config::Published<utility::config::ConfigSnapshot> CONFIGS;
 static osrv::StringsMap XML_NAMESPACES;
 
 static std::string CONFIGS_PATH; //will be init with the service initialization
@@ -44,6 +46,7 @@ namespace osrv
 
 		//TODO:: Need release
 		static std::vector<utility::http::HandlerSP> handlers;
+		static utility::metrics::method_id_t unknown_method_metrics_id = utility::metrics::MAX_METHODS;
 		
 		void do_handler_request(std::shared_ptr<HttpServer::Response> response,
 			std::shared_ptr<HttpServer::Request> request);
@@ -56,26 +59,12 @@ namespace osrv
 
 			OVERLOAD_REQUEST_HANDLER
 			{
-				auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
+				const auto configs = CONFIGS.load();
 
-				//this processor will add a full network address to service's paths from configs
-				struct XAddrProcessor
-				{
-					void operator()(const std::string& element, std::string& elData)
-					{
-						if (element == "XAddr")
-						{
-							elData = SERVER_ADDRESS + elData;
-						}
-					}
-				};
+				auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
 
-				auto capabilities_config = CONFIGS_TREE.get_child("GetCapabilities");
 				pt::ptree capabilities_node;
-				utility::soap::jsonNodeToXml(capabilities_config, capabilities_node, "tt", XAddrProcessor());
-				
-				// here cound of DI is overrided dynamically depending on the actually count of DI in the config file
-				capabilities_node.add("tt:Device.tt:IO.tt:InputConnectors", server_configs->digital_inputs_.size());
+				util::capabilities_to_soap(*configs, server_configs->digital_inputs_.size(), capabilities_node);
 
 				envelope_tree.add_child("s:Body.tds:GetCapabilitiesResponse.tds:Capabilities", capabilities_node);
 
@@ -97,12 +86,14 @@ namespace osrv
 
 			OVERLOAD_REQUEST_HANDLER
 			{
+				const auto configs = CONFIGS.load();
+
 				auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
 
-				auto device_info_config = CONFIGS_TREE.get_child("GetDeviceInformation");
+				const auto device_info_config = configs->get_child("GetDeviceInformation");
 				pt::ptree device_info_node;
 
-				utility::soap::jsonNodeToXml(device_info_config, device_info_node, "tds");
+				utility::soap::jsonNodeToXml(device_info_config.tree(), device_info_node, "tds");
 
 				envelope_tree.add_child("s:Body.tds:GetDeviceInformationResponse", device_info_node);
 
@@ -124,9 +115,11 @@ namespace osrv
 
 			OVERLOAD_REQUEST_HANDLER
 			{
+				const auto configs = CONFIGS.load();
+
 				auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
 
-				auto network_interfaces_config = CONFIGS_TREE.get_child("GetNetworkInterfaces");
+				const auto network_interfaces_config = configs->get_child("GetNetworkInterfaces");
 				pt::ptree network_interfaces_node;
 
 				//this processor will add a xml ns depending on element
@@ -146,7 +139,7 @@ namespace osrv
 					}
 				};
 
-				utility::soap::jsonNodeToXml(network_interfaces_config, network_interfaces_node, "", NsProcessor());
+				utility::soap::jsonNodeToXml(network_interfaces_config.tree(), network_interfaces_node, "", NsProcessor());
 
 				envelope_tree.add_child("s:Body.tds:GetNetworkInterfacesResponse", network_interfaces_node);
 
@@ -191,13 +184,15 @@ namespace osrv
 
 			OVERLOAD_REQUEST_HANDLER
 			{
+				const auto configs = CONFIGS.load();
+
 				auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
 
-				auto services_config = CONFIGS_TREE.get_child(GetServices);
+				const auto services_config = configs->get_child(GetServices);
 				pt::ptree services_node;
 
 				//here's Services are enumerates as array, so handle them manualy
-				for (auto elements : services_config)
+				for (const auto& elements : services_config)
 				{
 					if (!elements.second.get<bool>("Enabled", true))
 						continue;
@@ -232,10 +227,12 @@ namespace osrv
 
 			OVERLOAD_REQUEST_HANDLER
 			{
+				const auto configs = CONFIGS.load();
+
 				auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
 
-				static const auto SCOPES_TREE = CONFIGS_TREE.get_child("GetScopes");
-				for (const auto& it : SCOPES_TREE)
+				const auto scopes_config = configs->get_child("GetScopes");
+				for (const auto& it : scopes_config)
 				{
 					pt::ptree scopes_tree;
 					scopes_tree.put("tt:ScopeDef", "Fixed");
@@ -306,6 +303,8 @@ namespace osrv
 		void do_handler_request(std::shared_ptr<HttpServer::Response> response,
 			std::shared_ptr<HttpServer::Request> request)
 		{
+			const auto start = std::chrono::steady_clock::now();
+
 			//extract requested method
 			std::string method;
 			auto content = request->content.string();
@@ -364,9 +363,14 @@ namespace osrv
 					}
 
 					(*handler_ptr)(response, request);
+					utility::metrics::record_request(handler_ptr->get_metrics_id(),
+						utility::metrics::Outcome::OK, std::chrono::steady_clock::now() - start);
 				}
 				catch (const osrv::auth::digest_failed& e)
 				{
+					utility::metrics::record_request((*handler_it)->get_metrics_id(),
+						utility::metrics::Outcome::AUTH_FAILED, std::chrono::steady_clock::now() - start);
+
 					logger_->Error(e.what());
 					
 					*response << utility::http::RESPONSE_UNAUTHORIZED << "\r\n"
@@ -377,6 +381,9 @@ namespace osrv
 				}
 				catch (const std::exception& e)
 				{
+					utility::metrics::record_request((*handler_it)->get_metrics_id(),
+						utility::metrics::Outcome::SERVER_ERROR, std::chrono::steady_clock::now() - start);
+
 					logger_->Error("A server's error occured in DeviceService while processing: " + method
 						+ ". Info: " + e.what());
 					
@@ -387,10 +394,21 @@ namespace osrv
 			{
 				logger_->Error("Not found an appropriate handler in DeviceService for: " + method);
 				*response << "HTTP/1.1 400 Bad request\r\nContent-Length: " << 0 << "\r\n\r\n";
+
+				utility::metrics::record_request(unknown_method_metrics_id,
+					utility::metrics::Outcome::CLIENT_ERROR, std::chrono::steady_clock::now() - start);
 			}
 
 		}
 
+		// the sections read by the handlers must be in a reloaded config
+		static utility::config::ConfigSnapshotSP read_configs()
+		{
+			auto configs = utility::config::ConfigSnapshot::read(CONFIGS_PATH, CONFIGS_FILE);
+			configs->require({ GetCapabilities, GetDeviceInformation, GetNetworkInterfaces, GetServices, GetScopes });
+			return configs;
+		}
+
 		void init_service(HttpServer& srv, osrv::ServerConfigs& server_configs_instance, const std::string& configs_path, ILogger& logger)
 		{
 			if (logger_ != nullptr)
@@ -405,13 +423,14 @@ namespace osrv
 			CONFIGS_PATH = configs_path;
 
 			//getting service's configs
-			pt::read_json(configs_path + CONFIGS_FILE, CONFIGS_TREE);
+			const auto configs = read_configs();
+			CONFIGS.store(configs);
 
-			auto namespaces_tree = CONFIGS_TREE.get_child("Namespaces");
+			const auto namespaces_tree = configs->get_child("Namespaces");
 			for (const auto& n : namespaces_tree)
 				XML_NAMESPACES.insert({ n.first, n.second.get_value<std::string>() });
 
-			server_configs->digital_inputs_ = read_digital_inputs(CONFIGS_TREE.get_child("DigitalInputs"));
+			server_configs->digital_inputs_ = read_digital_inputs(configs->get_child("DigitalInputs").tree());
 
 			handlers.emplace_back(new GetCapabilitiesHandler());
 			handlers.emplace_back(new GetDeviceInformationHandler());
@@ -422,6 +441,10 @@ namespace osrv
 			handlers.emplace_back(new GetSystemDateAndTimeHandler());
 
 			// set default handler
+			for (auto& handler : handlers)
+				handler->set_metrics_id(utility::metrics::register_method("device", handler->get_name()));
+			unknown_method_metrics_id = utility::metrics::register_method("device", "unknown");
+
 			srv.resource["/onvif/device_service"]["POST"] = DeviceServiceHandler;
 
 			SERVER_ADDRESS = "http://";
@@ -434,9 +457,40 @@ namespace osrv
 			logger_->Info("ONVIF Device service is working on " + SERVER_ADDRESS + "onvif/device_service");
 		}
 
+		// NOTE: the namespaces and the digital inputs are read only once by init_service
+		void watch_configs(utility::config::ConfigWatcher& watcher)
+		{
+			watcher.watch(CONFIGS_FILE, []() { CONFIGS.store(read_configs()); });
+		}
+
 		const boost::property_tree::ptree& get_configs_tree_instance()
 		{
-			return CONFIGS_TREE;
+			return CONFIGS.load()->tree();
+		}
+
+		namespace util
+		{
+			void capabilities_to_soap(const utility::config::ConfigSnapshot& configs, std::size_t inputs_count,
+				pt::ptree& result)
+			{
+				//this processor will add a full network address to service's paths from configs
+				struct XAddrProcessor
+				{
+					void operator()(const std::string& element, std::string& elData)
+					{
+						if (element == "XAddr")
+						{
+							elData = SERVER_ADDRESS + elData;
+						}
+					}
+				};
+
+				const auto capabilities_config = configs.get_child("GetCapabilities");
+				utility::soap::jsonNodeToXml(capabilities_config.tree(), result, "tt", XAddrProcessor());
+
+				// here cound of DI is overrided dynamically depending on the actually count of DI in the config file
+				result.add("tt:Device.tt:IO.tt:InputConnectors", inputs_count);
+			}
 		}
 
 	} //device ns
@@ -4,8 +4,16 @@
 
 #include <boost/property_tree/ptree_fwd.hpp>
 
+#include <cstddef>
+
 class ILogger;
 
+namespace utility::config
+{
+	class ConfigSnapshot;
+	class ConfigWatcher;
+}
+
 
 namespace osrv
 {
@@ -18,7 +26,18 @@ namespace osrv
 		void init_service(HttpServer& srv, osrv::ServerConfigs& /*configs*/,
 			const std::string& /*configs_path*/, ILogger& /*logger*/);
 
+		// the changed configs are used by the next requests
+		void watch_configs(utility::config::ConfigWatcher& /*watcher*/);
+
 		// NOTE: this may not be safe, if this service was not initialized before invocation
+		// or the configs are reloaded
 		const boost::property_tree::ptree& get_configs_tree_instance();
+
+		namespace util
+		{
+			// the Capabilities of GetCapabilities, the config is read without copies
+			void capabilities_to_soap(const utility::config::ConfigSnapshot& /*configs*/, std::size_t /*inputs_count*/,
+				boost::property_tree::ptree& /*result*/);
+		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,103 @@
+#include "announcements.h"
+
+#include "device_table.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace osrv
+{
+	namespace discovery
+	{
+		// returns the range of the attribute's value in the quotes
+		static std::pair<std::size_t, std::size_t> find_attribute_value(const std::string& xml, std::string_view name)
+		{
+			const auto attribute = std::string(name) + "=\"";
+			auto pos = xml.find(attribute);
+			if (pos == std::string::npos)
+				throw std::runtime_error("Not found an attribute " + std::string(name) + " in the announcement template");
+
+			const auto value_begin = pos + attribute.size();
+			const auto value_end = xml.find('"', value_begin);
+			if (value_end == std::string::npos)
+				throw std::runtime_error("Not found the end of an attribute " + std::string(name) + " in the announcement template");
+
+			return { value_begin, value_end };
+		}
+
+		static std::string replace_attribute_value(std::string xml, std::string_view name, std::string_view value)
+		{
+			const auto [begin, end] = find_attribute_value(xml, name);
+			return xml.replace(begin, end - begin, value);
+		}
+
+		Announcement::Announcement(std::string message)
+			: message_(std::move(message))
+		{
+			auto [msg_id_begin, msg_id_end] = utility::find_element_value(message_, "MessageID");
+			auto [number_begin, number_end] = find_attribute_value(message_, "MessageNumber");
+
+			splices_[0] = { msg_id_begin, msg_id_end, true };
+			splices_[1] = { number_begin, number_end, false };
+			if (splices_[0].begin > splices_[1].begin)
+				std::swap(splices_[0], splices_[1]);
+		}
+
+		void Announcement::render(std::string_view messageID, std::uint64_t message_number, std::string& out) const
+		{
+			// the longest number is 20 digits, so it's formatted on the stack
+			char number_buffer[20];
+			auto number_end = number_buffer + sizeof(number_buffer);
+			auto number_begin = number_end;
+			do
+			{
+				*--number_begin = static_cast<char>('0' + message_number % 10);
+				message_number /= 10;
+			} while (message_number);
+			const std::string_view number(number_begin, number_end - number_begin);
+
+			const auto& [first, second] = splices_;
+			const auto& first_value = first.is_message_id ? messageID : number;
+			const auto& second_value = second.is_message_id ? messageID : number;
+
+			out.clear();
+			out.append(message_, 0, first.begin);
+			out.append(first_value);
+			out.append(message_, first.end, second.begin - first.end);
+			out.append(second_value);
+			out.append(message_, second.end, std::string::npos);
+		}
+
+		Announcements::Announcements(const std::string& hello, const std::string& bye, const DeviceTable& devices,
+			std::uint64_t instance_id)
+		{
+			const auto instance = std::to_string(instance_id);
+			const auto hello_template = replace_attribute_value(hello, "InstanceId", instance);
+			const auto bye_template = replace_attribute_value(bye, "InstanceId", instance);
+
+			hello_.reserve(devices.size());
+			bye_.reserve(devices.size());
+			for (std::size_t i = 0; i < devices.size(); ++i)
+			{
+				// the device's values are taken from its ProbeMatch, so they're the same in all the messages
+				const std::string probe_match(devices.fragment(i));
+				auto value_of = [&probe_match](std::string_view name) {
+					const auto [begin, end] = utility::find_element_value(probe_match, name);
+					return probe_match.substr(begin, end - begin);
+				};
+
+				const auto address = value_of("Address");
+
+				hello_.emplace_back(fill_elements(hello_template, {
+						{ "Address", address },
+						{ "Types", value_of("Types") },
+						{ "Scopes", value_of("Scopes") },
+						{ "XAddrs", value_of("XAddrs") },
+						{ "MetadataVersion", value_of("MetadataVersion") }
+					}, false));
+
+				bye_.emplace_back(fill_elements(bye_template, { { "Address", address } }, false));
+			}
+		}
+	}
+}
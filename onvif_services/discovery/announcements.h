@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Hello and Bye messages of the emulated devices.
+// They are rendered for each device once, when a message is sent only its MessageID and
+// the MessageNumber of AppSequence are filled.
+namespace osrv
+{
+	namespace discovery
+	{
+		class DeviceTable;
+
+		class Announcement
+		{
+		public:
+			/**
+			* will throw an exception if the message has no MessageID or AppSequence's MessageNumber
+			*/
+			explicit Announcement(std::string message);
+
+			// @out is overwritten, so a caller's buffer may be reused without reallocations
+			void render(std::string_view /*messageID*/, std::uint64_t /*message_number*/, std::string& /*out*/) const;
+
+		private:
+			struct Splice
+			{
+				std::size_t begin;
+				std::size_t end;
+				bool is_message_id; // otherwise, it is MessageNumber
+			};
+
+			std::string message_;
+			std::array<Splice, 2> splices_; // in the order of appearance
+		};
+
+		class Announcements
+		{
+		public:
+			/**
+			* @hello and @bye are the messages of a single device, which are used as templates for all the @devices.
+			* @instance_id is the AppSequence's InstanceId, it must be increased each time the service is restarted
+			* will throw an exception if the templates have no required elements
+			*/
+			Announcements(const std::string& /*hello*/, const std::string& /*bye*/, const DeviceTable& /*devices*/,
+				std::uint64_t /*instance_id*/);
+
+			std::size_t size() const { return hello_.size(); }
+
+			const Announcement& hello(std::size_t device) const { return hello_.at(device); }
+			const Announcement& bye(std::size_t device) const { return bye_.at(device); }
+
+		private:
+			std::vector<Announcement> hello_;
+			std::vector<Announcement> bye_;
+		};
+	}
+}
@@ -0,0 +1,231 @@
+#include "device_table.h"
+
+#include "probe_scanner.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace osrv
+{
+	namespace discovery
+	{
+		// returns the range of the whole element with the passed local name, including its tags
+		static std::pair<std::size_t, std::size_t> find_element(const std::string& xml, std::string_view name)
+		{
+			const auto value_begin = utility::find_element_value(xml, name).first;
+			const auto tag_begin = xml.rfind('<', value_begin);
+
+			auto qname_end = xml.find_first_of(" \t\r\n>", tag_begin);
+			const auto closing_tag = "</" + xml.substr(tag_begin + 1, qname_end - tag_begin - 1) + ">";
+
+			const auto closing_pos = xml.find(closing_tag, value_begin);
+			if (closing_pos == std::string::npos)
+				throw std::runtime_error("Not found the end of an element " + std::string(name) + " in the response template");
+
+			return { tag_begin, closing_pos + closing_tag.size() };
+		}
+
+		static std::string escape_xml(std::string_view value)
+		{
+			std::string result;
+			result.reserve(value.size());
+			for (auto c : value)
+			{
+				switch (c)
+				{
+				case '&': result += "&amp;"; break;
+				case '<': result += "&lt;"; break;
+				case '>': result += "&gt;"; break;
+				default: result += c;
+				}
+			}
+
+			return result;
+		}
+
+		// a scope is compared without a trailing slash, so "onvif://www.onvif.org/location/" matches ".../location/city"
+		static std::string_view normalize_scope(std::string_view scope)
+		{
+			while (scope.size() > 1 && scope.back() == '/')
+				scope.remove_suffix(1);
+
+			return scope;
+		}
+
+		std::string fill_elements(const std::string& fragment,
+			const std::vector<std::pair<std::string_view, std::string>>& values, bool escape)
+		{
+			std::vector<std::pair<std::pair<std::size_t, std::size_t>, const std::string*>> splices;
+			for (const auto& [name, value] : values)
+			{
+				if (!value.empty())
+					splices.push_back({ utility::find_element_value(fragment, name), &value });
+			}
+
+			std::sort(splices.begin(), splices.end());
+
+			std::string result;
+			std::size_t pos = 0;
+			for (const auto& [range, value] : splices)
+			{
+				result.append(fragment, pos, range.first - pos);
+				result.append(escape ? escape_xml(*value) : *value);
+				pos = range.second;
+			}
+			result.append(fragment, pos, std::string::npos);
+
+			return result;
+		}
+
+		static std::pair<std::size_t, std::size_t> find_probe_match(const std::string& response)
+		{
+			return find_element(response, "ProbeMatch");
+		}
+
+		DeviceTable::DeviceTable(std::string response, const std::vector<DeviceIdentity>& devices)
+			: DeviceTable(response, find_probe_match(response), devices)
+		{
+		}
+
+		DeviceTable::DeviceTable(const std::string& response, std::pair<std::size_t, std::size_t> probe_match,
+			const std::vector<DeviceIdentity>& devices)
+			: head_(response.substr(0, probe_match.first))
+			, tail_(response.substr(probe_match.second))
+		{
+			const auto probe_match_template = response.substr(probe_match.first, probe_match.second - probe_match.first);
+
+			// the template's device is used when there are no configured ones
+			const std::vector<DeviceIdentity> template_device(devices.empty() ? 1 : 0);
+			const auto& identities = devices.empty() ? template_device : devices;
+
+			std::vector<std::string> fragments;
+			fragments.reserve(identities.size());
+			scopes_.resize(identities.size());
+			for (std::size_t i = 0; i < identities.size(); ++i)
+			{
+				const auto& device = identities[i];
+
+				std::string scopes;
+				for (const auto& scope : device.scopes)
+					scopes += (scopes.empty() ? "" : " ") + scope;
+
+				fragments.push_back(fill_elements(probe_match_template, {
+						{ "Address", device.endpoint_reference },
+						{ "Types", device.types },
+						{ "Scopes", scopes },
+						{ "XAddrs", device.xaddrs },
+						{ "MetadataVersion", device.metadata_version }
+					}));
+
+				if (!device.scopes.empty())
+				{
+					scopes_[i] = device.scopes;
+				}
+				else
+				{
+					const auto [begin, end] = utility::find_element_value(probe_match_template, "Scopes");
+					for_each_item(std::string_view(probe_match_template).substr(begin, end - begin),
+						[this, i](std::string_view scope) { scopes_[i].emplace_back(scope); });
+				}
+			}
+
+			std::size_t total_size = 0;
+			for (const auto& f : fragments)
+				total_size += f.size();
+
+			fragments_buffer_.reserve(total_size);
+			for (const auto& f : fragments)
+			{
+				fragments_.emplace_back(fragments_buffer_.size(), f.size());
+				fragments_buffer_ += f;
+			}
+
+			// the strings are not changed anymore, so the index may refer to them
+			for (std::size_t i = 0; i < scopes_.size(); ++i)
+				index_scopes(static_cast<std::uint32_t>(i), scopes_[i]);
+		}
+
+		void DeviceTable::index_scopes(std::uint32_t device, const std::vector<std::string>& scopes)
+		{
+			auto add = [this, device](std::string_view key) {
+				auto& devices = scope_index_[key];
+				// the devices are indexed in order, so the lists stay sorted
+				if (devices.empty() || devices.back() != device)
+					devices.push_back(device);
+			};
+
+			for (const auto& s : scopes)
+			{
+				const auto scope = normalize_scope(s);
+				add(scope);
+
+				// every path prefix, e.g. onvif://www.onvif.org/location for onvif://www.onvif.org/location/city/nalchik
+				auto authority = scope.find("://");
+				if (authority == std::string_view::npos)
+					continue;
+
+				for (auto slash = scope.find('/', authority + 3); slash != std::string_view::npos; slash = scope.find('/', slash + 1))
+					add(scope.substr(0, slash));
+			}
+		}
+
+		std::string_view DeviceTable::fragment(std::size_t index) const
+		{
+			const auto [offset, size] = fragments_.at(index);
+			return std::string_view(fragments_buffer_).substr(offset, size);
+		}
+
+		void DeviceTable::match(std::string_view scopes, std::vector<std::uint32_t>& out) const
+		{
+			out.clear();
+
+			bool first_scope = true;
+			for_each_item(scopes, [this, &out, &first_scope](std::string_view scope) {
+					auto it = scope_index_.find(normalize_scope(scope));
+					if (it == scope_index_.end())
+					{
+						out.clear();
+					}
+					else if (first_scope)
+					{
+						out = it->second;
+					}
+					else
+					{
+						const auto& devices = it->second;
+						out.erase(std::remove_if(out.begin(), out.end(), [&devices](std::uint32_t d) {
+								return !std::binary_search(devices.begin(), devices.end(), d);
+							}), out.end());
+					}
+
+					first_scope = false;
+				});
+
+			if (first_scope)
+			{
+				for (std::uint32_t i = 0; i < fragments_.size(); ++i)
+					out.push_back(i);
+			}
+		}
+
+		std::size_t DeviceTable::render(std::string_view messageID, std::string_view relatesTo,
+			const std::vector<std::uint32_t>& devices, std::size_t first, std::size_t max_size, std::string& out) const
+		{
+			head_.render(messageID, relatesTo, out);
+
+			auto next = first;
+			for (; next < devices.size(); ++next)
+			{
+				const auto probe_match = fragment(devices[next]);
+				if (next != first && out.size() + probe_match.size() + tail_.size() > max_size)
+					break;
+
+				out.append(probe_match);
+			}
+
+			out.append(tail_);
+
+			return next;
+		}
+	}
+}
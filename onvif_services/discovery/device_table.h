@@ -0,0 +1,94 @@
+#pragma once
+
+#include "../discovery_service.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// The devices announced by the discovery when a process emulates several cameras.
+// All of them are answered through the same socket, each device has its own
+// ProbeMatch, which is rendered once when the table is created.
+namespace osrv
+{
+	namespace discovery
+	{
+		// an empty field means that the value is taken from the response template
+		struct DeviceIdentity
+		{
+			std::string endpoint_reference; // e.g. urn:uuid:10101010-1010-1010-1010-000000000001
+			std::string types;
+			std::vector<std::string> scopes;
+			std::string xaddrs;
+			std::string metadata_version;
+		};
+
+		/**
+		* replaces the values of the listed elements (by a local name), an empty value leaves the @xml's one.
+		* The values taken from another XML message are already escaped, so @escape should be false for them
+		* will throw an exception if there is no such element
+		*/
+		std::string fill_elements(const std::string& /*xml*/, const std::vector<std::pair<std::string_view, std::string>>& /*values*/,
+			bool escape = true);
+
+		class DeviceTable
+		{
+		public:
+			/**
+			* @response is a ProbeMatches message with a single ProbeMatch, which is used as a template of
+			* the devices' ProbeMatch elements. If @devices is empty, the template's device is the only one.
+			* will throw an exception if the response has no MessageID, RelatesTo or ProbeMatch elements
+			*/
+			DeviceTable(std::string response, const std::vector<DeviceIdentity>& /*devices*/);
+
+			// the index refers to the devices' strings
+			DeviceTable(const DeviceTable&) = delete;
+			DeviceTable& operator=(const DeviceTable&) = delete;
+
+			std::size_t size() const { return fragments_.size(); }
+
+			// the device's pre-rendered ProbeMatch element
+			std::string_view fragment(std::size_t index) const;
+
+			/**
+			* collects the devices which have all the scopes of a Probe into @out.
+			* Scopes are matched by RFC 3986 rule of WS-Discovery: a probe's scope matches a device's scope
+			* which is equal to it or continues it with more path segments. All devices match empty @scopes
+			*/
+			void match(std::string_view scopes, std::vector<std::uint32_t>& out) const;
+
+			/**
+			* renders a ProbeMatches message starting from the device @devices[first] into @out,
+			* the ProbeMatch elements are added while the message fits into @max_size (but at least one is added).
+			* returns the index of the first device which is not rendered
+			*/
+			std::size_t render(std::string_view /*messageID*/, std::string_view /*relatesTo*/,
+				const std::vector<std::uint32_t>& /*devices*/, std::size_t /*first*/, std::size_t /*max_size*/,
+				std::string& /*out*/) const;
+
+		private:
+			DeviceTable(const std::string& /*response*/, std::pair<std::size_t, std::size_t> /*probe_match*/,
+				const std::vector<DeviceIdentity>& /*devices*/);
+
+			void index_scopes(std::uint32_t device, const std::vector<std::string>& /*scopes*/);
+
+			// the message's parts before and after the ProbeMatch elements
+			utility::ResponseTemplate head_;
+			std::string tail_;
+
+			// all the fragments in a single buffer, the devices refer to them by offsets
+			std::string fragments_buffer_;
+			std::vector<std::pair<std::size_t, std::size_t>> fragments_;
+
+			// the devices' scopes and their path prefixes refer to these strings
+			std::vector<std::vector<std::string>> scopes_;
+
+			// a scope or its prefix -> the sorted indices of the devices which have it
+			std::unordered_map<std::string_view, std::vector<std::uint32_t>> scope_index_;
+		};
+	}
+}
@@ -0,0 +1,87 @@
+#include "probe_filters.h"
+
+#include <algorithm>
+
+namespace osrv
+{
+	namespace discovery
+	{
+		RateLimiter::RateLimiter(unsigned probes_per_second, std::size_t max_sources)
+			: rate_(probes_per_second)
+			, max_sources_(std::max<std::size_t>(max_sources, 1))
+		{
+		}
+
+		bool RateLimiter::allow(std::uint32_t source, clock::time_point now)
+		{
+			if (rate_ == 0)
+				return true;
+
+			auto it = buckets_.find(source);
+			if (it == buckets_.end())
+			{
+				if (buckets_.size() >= max_sources_)
+					purge(now);
+
+				// a new source starts with a full bucket
+				buckets_.emplace(source, Bucket{ rate_ - 1, now });
+				return true;
+			}
+
+			auto& bucket = it->second;
+			const std::chrono::duration<double> elapsed = now - bucket.updated;
+			bucket.tokens = std::min(rate_, bucket.tokens + elapsed.count() * rate_);
+			bucket.updated = now;
+
+			if (bucket.tokens < 1)
+				return false;
+
+			bucket.tokens -= 1;
+			return true;
+		}
+
+		void RateLimiter::purge(clock::time_point now)
+		{
+			// the sources which have already refilled their buckets are not different from new ones
+			for (auto it = buckets_.begin(); it != buckets_.end();)
+			{
+				const std::chrono::duration<double> elapsed = now - it->second.updated;
+				if (it->second.tokens + elapsed.count() * rate_ >= rate_)
+					it = buckets_.erase(it);
+				else
+					++it;
+			}
+
+			// all the sources are active, so just start over
+			if (buckets_.size() >= max_sources_)
+				buckets_.clear();
+		}
+
+		MessageIdCache::MessageIdCache(std::size_t capacity)
+			: ring_(std::max<std::size_t>(capacity, 1))
+		{
+			// "urn:uuid:" + 36 symbols of uuid, so usually the ids are not reallocated
+			for (auto& id : ring_)
+				id.reserve(64);
+
+			ids_.reserve(ring_.size());
+		}
+
+		bool MessageIdCache::insert(std::string_view message_id)
+		{
+			if (ids_.count(message_id))
+				return false;
+
+			auto& slot = ring_[next_];
+			if (!slot.empty())
+				ids_.erase(slot);
+
+			slot.assign(message_id);
+			ids_.insert(slot);
+
+			next_ = (next_ + 1) % ring_.size();
+
+			return true;
+		}
+	}
+}
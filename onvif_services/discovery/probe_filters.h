@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Filters applied to the received probes before any reply is prepared.
+// NOTE: they are not thread-safe, they are used only by the discovery's IO thread
+namespace osrv
+{
+	namespace discovery
+	{
+		// A token bucket per source address.
+		// A source may send a burst of @probes_per_second probes, and then it's limited to that rate.
+		class RateLimiter
+		{
+		public:
+			using clock = std::chrono::steady_clock;
+
+			// @probes_per_second equals 0 disables the limiting
+			// @max_sources limits the memory used by the table, the idle sources are purged when it's reached
+			explicit RateLimiter(unsigned probes_per_second, std::size_t max_sources = 4096);
+
+			// takes a token of the source, returns false if there are no tokens
+			bool allow(std::uint32_t source, clock::time_point now);
+
+			std::size_t sources_count() const { return buckets_.size(); }
+
+		private:
+			struct Bucket
+			{
+				double tokens;
+				clock::time_point updated;
+			};
+
+			void purge(clock::time_point now);
+
+			const double rate_;
+			const std::size_t max_sources_;
+			std::unordered_map<std::uint32_t, Bucket> buckets_;
+		};
+
+		// Remembers the last @capacity MessageIDs.
+		// A client repeats a multicast probe with the same MessageID (see SOAP-over-UDP retransmission),
+		// it's enough to reply only once
+		class MessageIdCache
+		{
+		public:
+			explicit MessageIdCache(std::size_t capacity);
+
+			// returns false if the id is already in the cache
+			bool insert(std::string_view /*message_id*/);
+
+		private:
+			// the ids are stored in the ring, and the set refers to them
+			std::vector<std::string> ring_;
+			std::size_t next_ = 0;
+			std::unordered_set<std::string_view> ids_;
+		};
+	}
+}
@@ -0,0 +1,263 @@
+#include "probe_scanner.h"
+
+#include <array>
+#include <cstddef>
+
+namespace osrv
+{
+	namespace discovery
+	{
+		// the elements which the scanner is interested in, all others are just skipped
+		enum class Element : unsigned char
+		{
+			Other,
+			Envelope,
+			Header,
+			Body,
+			MessageID,
+			Probe,
+			Types,
+			Scopes
+		};
+
+		// a Probe is rather flat, deeper documents are not expected from a real client
+		static const std::size_t MAX_DEPTH = 16;
+
+		static const std::string_view SPACES = " \t\r\n";
+
+		static bool is_name_end(char c)
+		{
+			return c == '>' || c == '/' || SPACES.find(c) != std::string_view::npos;
+		}
+
+		static std::string_view local_name(std::string_view qname)
+		{
+			auto colon = qname.find(':');
+			return colon == std::string_view::npos ? qname : qname.substr(colon + 1);
+		}
+
+		static std::string_view trim(std::string_view str)
+		{
+			auto begin = str.find_first_not_of(SPACES);
+			if (begin == std::string_view::npos)
+				return {};
+
+			auto end = str.find_last_not_of(SPACES);
+			return str.substr(begin, end - begin + 1);
+		}
+
+		// the meaning of an element depends on its parent, e.g. Types is expected only inside Body/Probe
+		static Element classify(std::string_view name, Element parent, std::size_t depth)
+		{
+			switch (parent)
+			{
+			case Element::Other:
+				if (depth == 0 && name == "Envelope")
+					return Element::Envelope;
+				break;
+			case Element::Envelope:
+				if (name == "Header")
+					return Element::Header;
+				if (name == "Body")
+					return Element::Body;
+				break;
+			case Element::Header:
+				if (name == "MessageID")
+					return Element::MessageID;
+				break;
+			case Element::Body:
+				if (name == "Probe")
+					return Element::Probe;
+				break;
+			case Element::Probe:
+				if (name == "Types")
+					return Element::Types;
+				if (name == "Scopes")
+					return Element::Scopes;
+				break;
+			default:
+				break;
+			}
+
+			return Element::Other;
+		}
+
+		// returns the position of the tag's closing '>', the quoted attributes' values are skipped
+		static std::size_t find_tag_end(std::string_view xml, std::size_t pos)
+		{
+			for (char quote = 0; pos < xml.size(); ++pos)
+			{
+				const char c = xml[pos];
+				if (quote)
+				{
+					if (c == quote)
+						quote = 0;
+				}
+				else if (c == '"' || c == '\'')
+				{
+					quote = c;
+				}
+				else if (c == '>')
+				{
+					return pos;
+				}
+			}
+
+			return std::string_view::npos;
+		}
+
+		bool scan_probe(std::string_view xml, ProbeInfo& result)
+		{
+			result = ProbeInfo{};
+
+			struct Open
+			{
+				std::string_view qname;
+				Element element;
+				std::size_t value_begin;
+			};
+			std::array<Open, MAX_DEPTH> stack;
+			std::size_t depth = 0;
+
+			bool has_envelope = false;
+			bool has_probe = false;
+
+			// UTF-8 BOM
+			std::size_t pos = xml.substr(0, 3) == "\xEF\xBB\xBF" ? 3 : 0;
+			for (auto text_begin = pos; (pos = xml.find('<', pos)) != std::string_view::npos; text_begin = pos)
+			{
+				// a text outside of the root element is not allowed
+				if (depth == 0 && !trim(xml.substr(text_begin, pos - text_begin)).empty())
+					return false;
+
+				auto rest = xml.substr(pos);
+
+				// the XML declaration and processing instructions
+				if (rest.substr(0, 2) == "<?")
+				{
+					auto end = xml.find("?>", pos + 2);
+					if (end == std::string_view::npos)
+						return false;
+					pos = end + 2;
+					continue;
+				}
+
+				if (rest.substr(0, 4) == "<!--")
+				{
+					auto end = xml.find("-->", pos + 4);
+					if (end == std::string_view::npos)
+						return false;
+					pos = end + 3;
+					continue;
+				}
+
+				// neither DTD nor CDATA are expected in a Probe
+				if (rest.substr(0, 2) == "<!")
+					return false;
+
+				const bool closing = rest.size() > 1 && rest[1] == '/';
+				const auto name_begin = pos + (closing ? 2 : 1);
+				auto name_end = name_begin;
+				while (name_end < xml.size() && !is_name_end(xml[name_end]))
+					++name_end;
+
+				const auto tag_end = find_tag_end(xml, name_end);
+				if (tag_end == std::string_view::npos || name_end == name_begin)
+					return false;
+
+				const auto qname = xml.substr(name_begin, name_end - name_begin);
+
+				if (closing)
+				{
+					if (depth == 0 || stack[depth - 1].qname != qname)
+						return false;
+
+					const auto& open = stack[--depth];
+					const auto value = trim(xml.substr(open.value_begin, pos - open.value_begin));
+					switch (open.element)
+					{
+					case Element::MessageID:
+						result.message_id = value;
+						break;
+					case Element::Types:
+						result.types = value;
+						result.has_types = true;
+						break;
+					case Element::Scopes:
+						result.scopes = value;
+						result.has_scopes = true;
+						break;
+					default:
+						break;
+					}
+
+					pos = tag_end + 1;
+					continue;
+				}
+
+				// only one root element is allowed
+				if (depth == 0 && has_envelope)
+					return false;
+
+				const auto parent = depth ? stack[depth - 1].element : Element::Other;
+				const auto element = classify(local_name(qname), parent, depth);
+
+				if (depth == 0)
+				{
+					if (element != Element::Envelope)
+						return false;
+					has_envelope = true;
+				}
+
+				if (element == Element::Probe)
+					has_probe = true;
+
+				const bool self_closing = xml[tag_end - 1] == '/';
+				if (self_closing)
+				{
+					if (element == Element::Types)
+						result.has_types = true;
+					else if (element == Element::Scopes)
+						result.has_scopes = true;
+
+					// <Envelope/> is not a SOAP message anyway
+					if (depth == 0)
+						return false;
+				}
+				else
+				{
+					if (depth == MAX_DEPTH)
+						return false;
+
+					stack[depth++] = Open{ qname, element, tag_end + 1 };
+				}
+
+				pos = tag_end + 1;
+			}
+
+			if (depth != 0 || !has_envelope || !has_probe)
+				return false;
+
+			// the text after the root element
+			return xml.find_first_not_of(SPACES, xml.rfind('>') + 1) == std::string_view::npos;
+		}
+
+		bool is_onvif_probe(const ProbeInfo& probe)
+		{
+			static const std::array<std::string_view, 3> ONVIF_TYPES = {
+				"NetworkVideoTransmitter",
+				"NetworkVideoDisplay",
+				"Device"
+			};
+
+			bool matched = probe.types.empty();
+			for_each_item(probe.types, [&matched](std::string_view type) {
+					const auto name = local_name(type);
+					for (const auto& t : ONVIF_TYPES)
+						matched = matched || name == t;
+				});
+
+			return matched;
+		}
+	}
+}
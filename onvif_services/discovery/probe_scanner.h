@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string_view>
+
+// A single-pass scanner of WS-Discovery Probe messages.
+// It doesn't build any tree and doesn't allocate memory,
+// the extracted values refer to the scanned datagram.
+namespace osrv
+{
+	namespace discovery
+	{
+		struct ProbeInfo
+		{
+			std::string_view message_id;
+
+			// a whitespace separated list of QNames, e.g. "dn:NetworkVideoTransmitter tds:Device"
+			std::string_view types;
+			bool has_types = false;
+
+			// a whitespace separated list of URIs
+			std::string_view scopes;
+			bool has_scopes = false;
+		};
+
+		// returns false if the datagram is not a well-formed SOAP Envelope with a Probe in its Body
+		bool scan_probe(std::string_view /*datagram*/, ProbeInfo& /*result*/);
+
+		// Matches the Types of a Probe against the types of an ONVIF device.
+		// Only the local names are compared, a namespace prefix depends on a client.
+		// According to WS-Discovery, a Probe without Types matches any device
+		bool is_onvif_probe(const ProbeInfo& /*probe*/);
+
+		// calls @func for each whitespace separated item of @list
+		template<typename Func>
+		void for_each_item(std::string_view list, Func&& func)
+		{
+			const std::string_view spaces = " \t\r\n";
+			for (auto begin = list.find_first_not_of(spaces); begin != std::string_view::npos;)
+			{
+				auto end = list.find_first_of(spaces, begin);
+				func(list.substr(begin, end == std::string_view::npos ? std::string_view::npos : end - begin));
+
+				if (end == std::string_view::npos)
+					break;
+				begin = list.find_first_not_of(spaces, end);
+			}
+		}
+	}
+}
@@ -1,13 +1,26 @@
 #include "discovery_service.h"
+#include "discovery/probe_filters.h"
+#include "discovery/probe_scanner.h"
+#include "discovery/device_table.h"
+#include "discovery/announcements.h"
 
 #include "../Logger.h"
 #include "../utility/XmlParser.h"
+#include "../utility/Metrics.h"
+#include "../utility/ConfigSnapshot.h"
+#include "../utility/Uuid.h"
 
 #include <thread>
 #include <memory>
 #include <fstream>
 #include <algorithm>
-#include <regex>
+#include <array>
+#include <chrono>
+#include <cctype>
+#include <cstring>
+#include <queue>
+#include <random>
+#include <vector>
 
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/ip/udp.hpp>
@@ -16,24 +29,87 @@
 #include <boost/property_tree/xml_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
 
+#ifdef __linux__
+#include <sys/socket.h>
+#endif
+
 static const ILogger* logger_ = nullptr;
 
 static std::string CONFIGS_PATH; //will be init with the service initialization
+static const std::string DISCOVERY_CONFIGS_FILE = "discovery.config";
 static const std::string DISCOVERY_RESPONSE_FILE = "responses/ProbeMatch.response";
+static const std::string DISCOVERY_HELLO_FILE = "responses/Hello.response";
+static const std::string DISCOVERY_BYE_FILE = "responses/Bye.response";
 
 
 namespace ba = boost::asio;
 
+struct DiscoverySettings
+{
+	// per a source address, 0 - unlimited
+	unsigned probes_per_second = 50;
+
+	// how many last MessageIDs are remembered to ignore the repeated probes
+	std::size_t duplicates_cache_size = 1024;
+
+	// the replies which are not sent yet, the probes are dropped when there are no free buffers
+	std::size_t max_pending_replies = 256;
+
+	// the ProbeMatches of many devices are split into several datagrams of this size
+	std::size_t max_datagram_size = 4096;
+
+	// Hello is sent for each device after a random delay up to this value (APP_MAX_DELAY of WS-Discovery),
+	// so the devices started together don't burst the multicast group
+	std::chrono::milliseconds hello_max_delay{ 500 };
+
+	// 0 - Hello is sent only on start, otherwise it's repeated for each device with the random deviation
+	std::chrono::seconds reannounce_interval{ 0 };
+	std::chrono::seconds reannounce_jitter{ 0 };
+};
+
 class DiscoveryManager
 {
 public:
-	DiscoveryManager(ILogger& logger, std::string&& response)
+	// Hello and Bye are not sent if their templates are empty
+	DiscoveryManager(ILogger& logger, std::string&& response, const std::vector<osrv::discovery::DeviceIdentity>& devices,
+		const std::string& hello, const std::string& bye, const DiscoverySettings& settings)
 		:logger_(&logger),
-		response_(std::move(response)),
+		devices_(std::move(response), devices),
+		max_datagram_size_(settings.max_datagram_size),
+		max_pending_replies_(std::max<std::size_t>(settings.max_pending_replies, 1)),
+		hello_max_delay_(settings.hello_max_delay),
+		reannounce_interval_(settings.reannounce_interval),
+		reannounce_jitter_(std::min(settings.reannounce_jitter, settings.reannounce_interval)),
+		rate_limiter_(settings.probes_per_second),
+		message_ids_(settings.duplicates_cache_size),
 		remote_endpoint_()
 	{
 		io_ = std::make_shared<ba::io_context>();
 		io_work_ = std::make_shared<ba::io_context::work>(*io_);
+
+		const std::string name = "onvif_discovery_probes_total";
+		const std::string help = "Received WS-Discovery probes by the processing result.";
+		answered_probes_ = utility::metrics::make_counter(name, help, { {"result", "answered"} });
+		ignored_probes_ = utility::metrics::make_counter(name, help, { {"result", "ignored"} });
+		duplicated_probes_ = utility::metrics::make_counter(name, help, { {"result", "duplicate"} });
+		rate_limited_probes_ = utility::metrics::make_counter(name, help, { {"result", "rate_limited"} });
+		dropped_probes_ = utility::metrics::make_counter(name, help, { {"result", "dropped"} });
+
+		matched_devices_.reserve(devices_.size());
+		pending_replies_.reserve(max_pending_replies_);
+
+		if (!hello.empty() && !bye.empty())
+		{
+			// must be increased when the service is restarted, so the clients don't take the messages for old ones
+			const auto instance_id = std::chrono::duration_cast<std::chrono::seconds>(
+				std::chrono::system_clock::now().time_since_epoch()).count();
+			announcements_ = std::make_unique<osrv::discovery::Announcements>(hello, bye, devices_, instance_id);
+
+			const std::string name = "onvif_discovery_announcements_total";
+			const std::string help = "Sent WS-Discovery announcements by the type.";
+			sent_hello_ = utility::metrics::make_counter(name, help, { {"type", "hello"} });
+			sent_bye_ = utility::metrics::make_counter(name, help, { {"type", "bye"} });
+		}
 	}
 
 	void Start()
@@ -58,6 +134,14 @@ public:
 				do_receive();
 			});
 
+		if (announcements_)
+		{
+			announce_timer_ = std::make_shared<ba::steady_timer>(*io_);
+			io_->post([this]() {
+					schedule_hello();
+				});
+		}
+
 		worker_ = std::make_shared<std::thread>([this]() {io_->run(); });
 	}
 
@@ -66,11 +150,25 @@ public:
 		if (!io_work_)
 			return;
 
+		// the pending operations are cancelled, otherwise the IO context never runs out of work
+		io_->post([this]() {
+				if (announce_timer_)
+				{
+					announce_timer_->cancel();
+					send_bye();
+				}
+
+				boost::system::error_code ec;
+				if (socket_)
+					socket_->close(ec);
+			});
+
 		io_work_.reset();
 
 		try
 		{
-			worker_->join();
+			if (worker_)
+				worker_->join();
 		}
 		catch (const std::exception&)
 		{
@@ -78,90 +176,399 @@ public:
 	}
 
 private:
+	// a reply's buffer with its destination, the buffers are reused between the sends
+	struct Reply
+	{
+		std::string data;
+		ba::ip::udp::endpoint endpoint;
+	};
+
+	Reply* acquire_reply()
+	{
+		if (!free_replies_.empty())
+		{
+			auto reply = free_replies_.back();
+			free_replies_.pop_back();
+			return reply;
+		}
+
+		if (replies_.size() >= max_pending_replies_)
+			return nullptr;
+
+		replies_.push_back(std::make_unique<Reply>());
+		return replies_.back().get();
+	}
+
+	void release_reply(Reply* reply)
+	{
+		free_replies_.push_back(reply);
+	}
+
+	// the replies to the probe are added to @pending_replies_, nothing is added if the probe should not be answered
+	void handle_probe(const char* data, std::size_t length, const ba::ip::udp::endpoint& from)
+	{
+		if (from.address().is_v4()
+			&& !rate_limiter_.allow(from.address().to_v4().to_ulong(), std::chrono::steady_clock::now()))
+		{
+			rate_limited_probes_->inc();
+			return;
+		}
+
+		const std::string_view probe_msg(data, length);
+		if (logger_->IsEnabled(ILogger::LVL_TRACE))
+			logger_->Trace("Probe message from " + from.address().to_string() + ": " + std::string(probe_msg));
+
+		// the datagram is only scanned, nothing is allocated for the probes which are not answered
+		osrv::discovery::ProbeInfo probe;
+		if (!osrv::discovery::scan_probe(probe_msg, probe))
+		{
+			if (logger_->IsEnabled(ILogger::LVL_DEBUG))
+				logger_->Debug("Ignoring a malformed Probe from " + from.address().to_string());
+			ignored_probes_->inc();
+			return;
+		}
+
+		if (!osrv::discovery::is_onvif_probe(probe))
+		{
+			if (logger_->IsEnabled(ILogger::LVL_TRACE))
+				logger_->Trace("Ignoring a Probe with Types: " + std::string(probe.types));
+			ignored_probes_->inc();
+			return;
+		}
+
+		const auto relatesTo = probe.message_id;
+		if (relatesTo.empty())
+		{
+			logger_->Debug("Probe's messageID is empty! Probe match dropped!");
+			ignored_probes_->inc();
+			return;
+		}
+
+		if (!message_ids_.insert(relatesTo))
+		{
+			duplicated_probes_->inc();
+			return;
+		}
+
+		devices_.match(probe.scopes, matched_devices_);
+		if (matched_devices_.empty())
+		{
+			ignored_probes_->inc();
+			return;
+		}
+
+		// the devices are answered by as few datagrams as possible
+		const auto first_reply = pending_replies_.size();
+		for (std::size_t next = 0; next < matched_devices_.size();)
+		{
+			auto reply = acquire_reply();
+			if (!reply)
+			{
+				// the probe is dropped as a whole rather than answered by a part of the devices,
+				// its retransmissions are dropped as the duplicates
+				for (auto i = first_reply; i < pending_replies_.size(); ++i)
+					release_reply(pending_replies_[i]);
+				pending_replies_.resize(first_reply);
+
+				dropped_probes_->inc();
+				return;
+			}
+
+			next = devices_.render(utility::uuid::urn_v4().view(), relatesTo,
+				matched_devices_, next, max_datagram_size_, reply->data);
+			reply->endpoint = from;
+
+			pending_replies_.push_back(reply);
+		}
+
+		answered_probes_->inc();
+	}
+
+	ba::ip::udp::endpoint multicast_endpoint() const
+	{
+		return ba::ip::udp::endpoint(ba::ip::address::from_string("239.255.255.250"), 3702);
+	}
+
+	std::chrono::steady_clock::duration random_delay(std::chrono::steady_clock::duration max)
+	{
+		std::uniform_int_distribution<std::chrono::steady_clock::rep> distribution(0, max.count());
+		return std::chrono::steady_clock::duration(distribution(random_));
+	}
+
+	void schedule_hello()
+	{
+		const auto now = std::chrono::steady_clock::now();
+		for (std::uint32_t i = 0; i < announcements_->size(); ++i)
+			announce_queue_.push({ now + random_delay(hello_max_delay_), i, true });
+
+		wait_announcements();
+	}
+
+	void wait_announcements()
+	{
+		if (announce_queue_.empty())
+			return;
+
+		announce_timer_->expires_at(announce_queue_.top().time);
+		announce_timer_->async_wait([this](const boost::system::error_code& ec) {
+				if (ec == ba::error::operation_aborted)
+					return;
+
+				send_hello();
+				wait_announcements();
+			});
+	}
+
+	// sends Hello of the devices which time has come
+	void send_hello()
+	{
+		const auto now = std::chrono::steady_clock::now();
+		while (!announce_queue_.empty() && announce_queue_.top().time <= now)
+		{
+			auto reply = acquire_reply();
+			if (!reply)
+			{
+				// the rest wait for the free buffers
+				auto announce = announce_queue_.top();
+				announce_queue_.pop();
+				announce.time = now + std::chrono::milliseconds(10);
+				announce_queue_.push(announce);
+				break;
+			}
+
+			const auto announce = announce_queue_.top();
+			announce_queue_.pop();
+
+			announcements_->hello(announce.device).render(
+				utility::uuid::urn_v4().view(), ++message_number_, reply->data);
+			reply->endpoint = multicast_endpoint();
+			pending_replies_.push_back(reply);
+			sent_hello_->inc();
+
+			if (reannounce_interval_.count())
+			{
+				// the first repetition is spread over the whole interval, so the devices started
+				// together are announced evenly, then the interval is kept with a deviation
+				const auto next = announce.startup
+					? now + random_delay(reannounce_interval_)
+					: now + reannounce_interval_ - reannounce_jitter_ + random_delay(2 * reannounce_jitter_);
+				announce_queue_.push({ next, announce.device, false });
+			}
+		}
+
+		send_pending();
+	}
+
+	// it's sent synchronously on stopping, the clients need no more than one attempt
+	void send_bye()
+	{
+		std::string message;
+		for (std::size_t i = 0; i < announcements_->size(); ++i)
+		{
+			announcements_->bye(i).render(utility::uuid::urn_v4().view(), ++message_number_, message);
+
+			boost::system::error_code ec;
+			socket_->send_to(ba::buffer(message), multicast_endpoint(), 0, ec);
+			if (ec)
+			{
+				logger_->Error("Something went wrong while sending Bye: " + ec.message());
+				break;
+			}
+
+			sent_bye_->inc();
+		}
+	}
+
+	void send_pending()
+	{
+#ifdef __linux__
+		for (std::size_t i = 0; i < pending_replies_.size(); i += BATCH_SIZE)
+			send_batch(pending_replies_.data() + i, std::min(BATCH_SIZE, pending_replies_.size() - i));
+#else
+		for (auto reply : pending_replies_)
+			send_reply(reply);
+#endif
+		pending_replies_.clear();
+	}
+
 	void do_receive()
 	{
-		socket_->async_receive_from(ba::buffer(data_, max_length), remote_endpoint_,
-			[this](boost::system::error_code ec, std::size_t bytes_recvd) {
-				logger_->Info("Received a probe from: "
-					+ remote_endpoint_.address().to_string() + ":" + std::to_string(remote_endpoint_.port()));
+#ifdef __linux__
+		// the datagrams are read by batches when the socket is ready
+		socket_->async_wait(ba::ip::udp::socket::wait_read,
+			[this](const boost::system::error_code& ec) {
+				if (ec == ba::error::operation_aborted)
+					return;
+
+				if (!ec)
+					receive_batch();
+
+				do_receive();
+			});
+#else
+		socket_->async_receive_from(ba::buffer(data_[0]), remote_endpoint_,
+			[this](const boost::system::error_code& ec, std::size_t bytes_recvd) {
+				if (ec == ba::error::operation_aborted)
+					return;
 
 				if (!ec && bytes_recvd > 0)
 				{
-					return do_send(bytes_recvd);
+					handle_probe(data_[0].data(), bytes_recvd, remote_endpoint_);
+					send_pending();
 				}
 
 				do_receive();
 			});
+#endif
 	}
 
-	void do_send(std::size_t length)
+	void send_reply(Reply* reply)
 	{
-		std::string probe_msg(std::begin(data_), std::begin(data_) + length);
-		logger_->Trace("Probe message: " + probe_msg);
-
-		auto probe_tree = exns::to_ptree(probe_msg);
-
-		const std::vector ONVIF_TYPES = {
-			"NetworkVideoTransmitter",
-			"NetworkVideoDisplay",
-			"Device"
-		};
-		auto types = osrv::discovery::utility::extract_types(probe_tree);
-		if (std::any_of(ONVIF_TYPES.begin(), ONVIF_TYPES.end(),
-			[&types](const auto& t) {
-				// here is very poor logic, but I think it's should be enough 
-				// and it's supposed to reply only for ONVIF devices and ignoring others
-				return types.find(t) != std::string::npos;
-			}))
+		socket_->async_send_to(ba::buffer(reply->data), reply->endpoint,
+			[this, reply](const boost::system::error_code& ec, std::size_t bytes_transferred) {
+				if (ec)
+				{
+					logger_->Error("Something went wrong while sending a response to the Probe: " + ec.message());
+				}
+				else if (bytes_transferred != reply->data.size())
+				{
+					logger_->Warn("Sending message length on the Probe not match actual required size Probe!");
+				}
+				else
+				{
+					logger_->Trace("Response a probe match to: "
+						+ reply->endpoint.address().to_string() + ":" + std::to_string(reply->endpoint.port()));
+				}
+
+				release_reply(reply);
+			});
+	}
+
+#ifdef __linux__
+	void receive_batch()
+	{
+		std::array<mmsghdr, BATCH_SIZE> msgs{};
+		std::array<iovec, BATCH_SIZE> iovs{};
+		std::array<sockaddr_storage, BATCH_SIZE> addresses{};
+		for (std::size_t i = 0; i < BATCH_SIZE; ++i)
 		{
-			const auto relatesTo = osrv::discovery::utility::extract_message_id(probe_tree);
+			iovs[i].iov_base = data_[i].data();
+			iovs[i].iov_len = data_[i].size();
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			msgs[i].msg_hdr.msg_name = &addresses[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(addresses[i]);
+		}
 
-			if (relatesTo.empty())
-			{
-				logger_->Error("Probe's messageID is empty! Probe match dropped!");
-			}
-			else
-			{
-				response_ = osrv::discovery::utility::prepare_response(osrv::discovery::utility::generate_uuid(),
-					relatesTo, std::move(response_));
+		const int received = ::recvmmsg(socket_->native_handle(), msgs.data(), BATCH_SIZE, MSG_DONTWAIT, nullptr);
+		if (received <= 0)
+			return;
 
-				socket_->async_send_to(ba::buffer(response_), remote_endpoint_,
-					[this](const boost::system::error_code& ec, std::size_t bytes_transferred) {
-						if (ec)
-						{
-							logger_->Error("Something went wrong while sending a response to the Probe: " + ec.message());
-						}
-						else if (bytes_transferred != response_.size())
-						{
-							logger_->Warn("Sending message length on the Probe not match actual required size Probe!");
-						}
+		for (int i = 0; i < received; ++i)
+		{
+			ba::ip::udp::endpoint from;
+			const auto address_length = std::min<std::size_t>(msgs[i].msg_hdr.msg_namelen, from.capacity());
+			std::memcpy(from.data(), &addresses[i], address_length);
+			from.resize(address_length);
 
-						logger_->Info("Response a probe match to: "
-							+ remote_endpoint_.address().to_string() + ":" + std::to_string(remote_endpoint_.port()));
-					});
-			}
+			handle_probe(data_[i].data(), msgs[i].msg_len, from);
 		}
-		else
+
+		// a probe may be answered by several datagrams
+		send_pending();
+	}
+
+	void send_batch(Reply** replies, std::size_t count)
+	{
+		if (count == 0)
+			return;
+
+		std::array<mmsghdr, BATCH_SIZE> msgs{};
+		std::array<iovec, BATCH_SIZE> iovs{};
+		for (std::size_t i = 0; i < count; ++i)
 		{
-			logger_->Debug("Ignoring a Probe with Types: " + types);
+			iovs[i].iov_base = replies[i]->data.data();
+			iovs[i].iov_len = replies[i]->data.size();
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			msgs[i].msg_hdr.msg_name = replies[i]->endpoint.data();
+			msgs[i].msg_hdr.msg_namelen = static_cast<socklen_t>(replies[i]->endpoint.size());
 		}
-		
-		io_->post([this]() { do_receive(); });
+
+		int sent = ::sendmmsg(socket_->native_handle(), msgs.data(), static_cast<unsigned>(count), MSG_DONTWAIT);
+		if (sent < 0)
+			sent = 0;
+
+		for (std::size_t i = 0; i < static_cast<std::size_t>(sent); ++i)
+			release_reply(replies[i]);
+
+		// the socket's buffer is full, so the rest are sent when it's possible
+		for (std::size_t i = sent; i < count; ++i)
+			send_reply(replies[i]);
 	}
+#endif
 
 private:
 ILogger* logger_ = nullptr;
 
-std::string response_;
+const osrv::discovery::DeviceTable devices_;
+const std::size_t max_datagram_size_;
 
 std::shared_ptr<std::thread> worker_;
 std::shared_ptr<ba::io_context> io_;
 std::shared_ptr<ba::io_context::work> io_work_;
 
 std::shared_ptr<ba::ip::udp::socket> socket_;
+
+// all the replies' buffers are owned here, the free ones are also listed in @free_replies_
+const std::size_t max_pending_replies_;
+std::vector<std::unique_ptr<Reply>> replies_;
+std::vector<Reply*> free_replies_;
+
+// the replies prepared for the received probes, which are to be sent
+std::vector<Reply*> pending_replies_;
+std::vector<std::uint32_t> matched_devices_;
+
+// the devices' Hello messages ordered by the time to send
+struct Announce
+{
+	std::chrono::steady_clock::time_point time;
+	std::uint32_t device;
+	bool startup;
+
+	bool operator>(const Announce& other) const { return time > other.time; }
+};
+
+std::unique_ptr<osrv::discovery::Announcements> announcements_;
+const std::chrono::steady_clock::duration hello_max_delay_;
+const std::chrono::steady_clock::duration reannounce_interval_;
+const std::chrono::steady_clock::duration reannounce_jitter_;
+std::shared_ptr<ba::steady_timer> announce_timer_;
+std::priority_queue<Announce, std::vector<Announce>, std::greater<Announce>> announce_queue_;
+std::mt19937 random_{ std::random_device{}() };
+std::uint64_t message_number_ = 0;
+
+std::shared_ptr<utility::metrics::Counter> sent_hello_;
+std::shared_ptr<utility::metrics::Counter> sent_bye_;
+
+osrv::discovery::RateLimiter rate_limiter_;
+osrv::discovery::MessageIdCache message_ids_;
+
+std::shared_ptr<utility::metrics::Counter> answered_probes_;
+std::shared_ptr<utility::metrics::Counter> ignored_probes_;
+std::shared_ptr<utility::metrics::Counter> duplicated_probes_;
+std::shared_ptr<utility::metrics::Counter> rate_limited_probes_;
+std::shared_ptr<utility::metrics::Counter> dropped_probes_;
+
+// only one receiving is in progress at a time, so the receive buffers are shared
+#ifdef __linux__
+static constexpr std::size_t BATCH_SIZE = 32;
+#else
+static constexpr std::size_t BATCH_SIZE = 1;
+#endif
 ba::ip::udp::endpoint remote_endpoint_;
 enum { max_length = 4096};
-char data_[max_length];
+std::array<std::array<char, max_length>, BATCH_SIZE> data_;
 };
 
 std::shared_ptr<DiscoveryManager> discovery_manager_;
@@ -170,6 +577,19 @@ namespace osrv
 {
 	namespace discovery
 	{
+		static std::string read_response(const std::string& file)
+		{
+			std::ifstream ifs(CONFIGS_PATH + file);
+			if (!ifs.is_open())
+			{
+				throw std::runtime_error("Can't open: " + file);
+			}
+
+			std::string response;
+			response.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+			return response;
+		}
+
 		void init_service(const std::string& configs_path, ILogger& logger)
 		{
 			logger_ = &logger;
@@ -178,16 +598,64 @@ namespace osrv
 
 			CONFIGS_PATH = configs_path;
 
-			std::ifstream ifs(CONFIGS_PATH + DISCOVERY_RESPONSE_FILE);
-			if (!ifs.is_open())
+			std::string response = read_response(DISCOVERY_RESPONSE_FILE);
+
+			DiscoverySettings settings;
+			std::vector<DeviceIdentity> devices;
+			std::string hello;
+			std::string bye;
+			std::ifstream configs_file(CONFIGS_PATH + DISCOVERY_CONFIGS_FILE);
+			if (configs_file.is_open())
 			{
-				throw std::runtime_error("Can't open: " + DISCOVERY_RESPONSE_FILE);
+				configs_file.close();
+
+				auto configs = ::utility::config::ConfigSnapshot::read(CONFIGS_PATH, DISCOVERY_CONFIGS_FILE);
+				settings.probes_per_second = configs->get<unsigned>("ProbesPerSecondPerSource", settings.probes_per_second);
+				settings.duplicates_cache_size = configs->get<std::size_t>("DuplicatesCacheSize", settings.duplicates_cache_size);
+				settings.max_pending_replies = configs->get<std::size_t>("MaxPendingReplies", settings.max_pending_replies);
+				settings.max_datagram_size = configs->get<std::size_t>("MaxDatagramSize", settings.max_datagram_size);
+				settings.hello_max_delay = std::chrono::milliseconds(
+					configs->get<unsigned>("HelloMaxDelay", static_cast<unsigned>(settings.hello_max_delay.count())));
+				settings.reannounce_interval = std::chrono::seconds(configs->get<unsigned>("ReannounceInterval", 0));
+				settings.reannounce_jitter = std::chrono::seconds(configs->get<unsigned>("ReannounceJitter", 0));
+
+				if (configs->get<bool>("SendHelloBye", false))
+				{
+					hello = read_response(DISCOVERY_HELLO_FILE);
+					bye = read_response(DISCOVERY_BYE_FILE);
+				}
+
+				if (auto devices_config = configs->get_child_optional("Devices"))
+				{
+					for (const auto& [key, device_config] : *devices_config)
+					{
+						DeviceIdentity device;
+						device.endpoint_reference = device_config.get("EndpointReference", "");
+						if (device.endpoint_reference.empty())
+						{
+							// the devices must differ, but the address is changed with each start,
+							// so it's better to put the generated one into the config
+							device.endpoint_reference = ::utility::uuid::urn_v4().str();
+							logger_->Warn("Discovery device without EndpointReference got: " + device.endpoint_reference);
+						}
+
+						device.types = device_config.get("Types", "");
+						device.xaddrs = device_config.get("XAddrs", "");
+						device.metadata_version = device_config.get("MetadataVersion", "");
+						if (auto scopes = device_config.get_child_optional("Scopes"))
+						{
+							for (const auto& [k, scope] : *scopes)
+								device.scopes.push_back(scope.get_value<std::string>());
+						}
+
+						devices.push_back(std::move(device));
+					}
+				}
 			}
-	
-			std::string response;
-			response.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
 
-			discovery_manager_ = std::make_shared<DiscoveryManager>(logger, std::move(response));
+			logger_->Info("Discovery Service emulates devices: " + std::to_string(std::max<std::size_t>(devices.size(), 1)));
+
+			discovery_manager_ = std::make_shared<DiscoveryManager>(logger, std::move(response), devices, hello, bye, settings);
 		}
 
 		void start()
@@ -225,33 +693,75 @@ namespace osrv
 				return exns::find_hierarchy("Envelope.Header.MessageID", tree);
 			}
 
-			std::string prepare_response(const std::string& messageID, const std::string& relatesTo, std::string&& response)
+			std::pair<std::size_t, std::size_t> find_element_value(const std::string& xml, std::string_view name)
 			{
-				//TODO: replace MessageID
-				std::regex re_msg_id("(<.*MessageID>)(.*)(</.*MessageID>)");
-				response = std::regex_replace(response, re_msg_id, "$1" + messageID + "$3");
+				for (auto pos = xml.find(name); pos != std::string::npos; pos = xml.find(name, pos + name.size()))
+				{
+					// skip the names which are only a part of another name or a closing tag
+					auto tag_begin = xml.rfind('<', pos);
+					if (tag_begin == std::string::npos || xml[tag_begin + 1] == '/')
+						continue;
+					if (xml[pos - 1] != '<' && xml[pos - 1] != ':')
+						continue;
+
+					const auto name_end = pos + name.size();
+					if (name_end >= xml.size() || (xml[name_end] != '>' && !std::isspace(static_cast<unsigned char>(xml[name_end]))))
+						continue;
+
+					auto value_begin = xml.find('>', name_end);
+					if (value_begin == std::string::npos)
+						break;
+					++value_begin;
+
+					auto value_end = xml.find('<', value_begin);
+					if (value_end == std::string::npos)
+						break;
+
+					return { value_begin, value_end };
+				}
 
-				// replace RelatesTo uuid
-				std::regex re_rel_to("(<.*RelatesTo>)(.*)(</.*RelatesTo>)");
-				return std::regex_replace(response, re_rel_to, "$1" + relatesTo + "$3");
+				throw std::runtime_error("Not found an element " + std::string(name) + " in the response template");
 			}
-			
-			std::string generate_uuid(std::string uuid)
+
+			ResponseTemplate::ResponseTemplate(std::string response)
+				: response_(std::move(response))
 			{
-				if (uuid.empty())
-					return uuid;
+				auto [msg_id_begin, msg_id_end] = find_element_value(response_, "MessageID");
+				auto [rel_to_begin, rel_to_end] = find_element_value(response_, "RelatesTo");
+
+				splices_[0] = { msg_id_begin, msg_id_end, true };
+				splices_[1] = { rel_to_begin, rel_to_end, false };
+				if (splices_[0].begin > splices_[1].begin)
+					std::swap(splices_[0], splices_[1]);
+			}
 
-				// beginning part will be fixed, we just will increment the counter from 0 and will be
-				// replace the last characters in the ending
-				//std::string uuid = "urn:uuid:1419d68a-1dd2-11b2-a105-000000000000";
+			void ResponseTemplate::render(std::string_view messageID, std::string_view relatesTo, std::string& out) const
+			{
+				const auto& [first, second] = splices_;
+				const auto& first_value = first.is_message_id ? messageID : relatesTo;
+				const auto& second_value = second.is_message_id ? messageID : relatesTo;
+
+				out.clear();
+				out.reserve(response_.size() - (first.end - first.begin) - (second.end - second.begin)
+					+ first_value.size() + second_value.size());
+
+				out.append(response_, 0, first.begin);
+				out.append(first_value);
+				out.append(response_, first.end, second.begin - first.end);
+				out.append(second_value);
+				out.append(response_, second.end, std::string::npos);
+			}
 
-				static int ID = 0;
-				std::string str_id = std::to_string(ID++);
-				uuid.replace(uuid.length() - str_id.length(), //start pos
-					str_id.length(), //num of symbols to replace
-					str_id); //new value
+			std::string ResponseTemplate::render(std::string_view messageID, std::string_view relatesTo) const
+			{
+				std::string result;
+				render(messageID, relatesTo, result);
+				return result;
+			}
 
-				return uuid;
+			std::string prepare_response(const std::string& messageID, const std::string& relatesTo, std::string&& response)
+			{
+				return ResponseTemplate(std::move(response)).render(messageID, relatesTo);
 			}
 		}
 		
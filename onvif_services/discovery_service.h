@@ -1,6 +1,9 @@
 #pragma once
 
+#include <array>
 #include <string>
+#include <string_view>
+#include <utility>
 
 #include <boost/property_tree/ptree.hpp>
 
@@ -26,18 +29,48 @@ namespace osrv
 
 			std::string extract_message_id(const boost::property_tree::ptree& /*probe_msg*/);
 
+			/**
+			* returns the range of the first element's value with the passed local name (a namespace prefix is ignored)
+			* will throw an exception if there is no such element
+			*/
+			std::pair<std::size_t, std::size_t> find_element_value(const std::string& /*xml*/, std::string_view /*name*/);
+
+			/**
+			* A static response message read from a file, which is split at the values of
+			* MessageID and RelatesTo elements once, so a reply is assembled only by
+			* copying the parts into a buffer instead of searching the whole message each time.
+			*/
+			class ResponseTemplate
+			{
+			public:
+				/**
+				* will throw an exception if the response has no MessageID or RelatesTo elements
+				*/
+				explicit ResponseTemplate(std::string response);
+
+				// @out is overwritten, so a caller's buffer may be reused without reallocations
+				void render(std::string_view /*messageID*/, std::string_view /*relatesTo*/, std::string& /*out*/) const;
+
+				std::string render(std::string_view /*messageID*/, std::string_view /*relatesTo*/) const;
+
+			private:
+				struct Splice
+				{
+					std::size_t begin; // the value's position in the response
+					std::size_t end;
+					bool is_message_id; // otherwise, it is RelatesTo
+				};
+
+				std::string response_;
+				std::array<Splice, 2> splices_; // in the order of appearance
+			};
+
 			/**
 			* used when a static response message read from a file
 			* to change MessageID and RelatesTo values
 			*/
 			std::string prepare_response(const std::string& /*messageID*/, const std::string& /*relatesTo*/,
 				std::string&& /*response*/);
-
-			/**
-			* user should pass corrected uuid
-			* there is no checks is complete on correctness of the passed uuid
-			*/
-			std::string generate_uuid(std::string uuid = "urn:uuid:1419d68a-1dd2-11b2-a105-000000000000");
 		}
 	}
 }
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include "../utility/XmlParser.h"
 #include "../utility/HttpHelper.h"
 #include "../utility/SoapHelper.h"
+#include "../utility/ConfigSnapshot.h"
+#include "../utility/ConfigWatcher.h"
 #include "pullpoint/pull_point.h"
 #include "device_service.h"
 
@@ -29,7 +31,7 @@ static DigestSessionSP digest_session;
 static std::unique_ptr<osrv::event::NotificationsManager> notifications_manager;
 
 namespace pt = boost::property_tree;
-static pt::ptree EVENT_CONFIGS_TREE;
+static utility::config::Published<utility::config::ConfigSnapshot> EVENT_CONFIGS;
 
 static osrv::StringsMap XML_NAMESPACES;
 
@@ -44,6 +46,17 @@ namespace osrv
 	namespace event
 	{
 		static std::vector<utility::http::HandlerSP> handlers;
+		static utility::metrics::method_id_t unknown_method_metrics_id = utility::metrics::MAX_METHODS;
+
+		// PullPoint requests are not dispatched via @handlers, so they have their own ids
+		static struct PullPointMetricsIds
+		{
+			utility::metrics::method_id_t pull_messages = utility::metrics::MAX_METHODS;
+			utility::metrics::method_id_t renew = utility::metrics::MAX_METHODS;
+			utility::metrics::method_id_t set_synchronization_point = utility::metrics::MAX_METHODS;
+			utility::metrics::method_id_t unsubscribe = utility::metrics::MAX_METHODS;
+			utility::metrics::method_id_t unknown = utility::metrics::MAX_METHODS;
+		} pullpoint_metrics_ids;
 
 		void do_handler_request(std::shared_ptr<HttpServer::Response> response,
 			std::shared_ptr<HttpServer::Request> request);
@@ -94,6 +107,8 @@ namespace osrv
 			std::shared_ptr<HttpServer::Request> request)
 		{
 			//osrv::auth::SECURITY_LEVELS::READ_MEDIA
+			const auto start = std::chrono::steady_clock::now();
+
 			auto request_tree = exns::to_ptree(request->content.string());
 
 			auto header_action = exns::find_hierarchy("Envelope.Header.Action", request_tree);
@@ -116,16 +131,22 @@ namespace osrv
 				// NOTE: current implementation reads a timeout from the configuration and ignores a value in the request
 				notifications_manager->PullMessages(response, header_to,
 					header_message_id,
-					EVENT_CONFIGS_TREE.get<int>("PullPoint.Timeout"),
+					EVENT_CONFIGS.load()->get<int>("PullPoint.Timeout"),
 					messages_limit);
 			
-				// If there was no error, a response will be send asynchronously
+				// If there was no error, a response will be send asynchronously,
+				// so only the dispatching time is measured here, the waiting time of a long-poll is not included
+				utility::metrics::record_request(pullpoint_metrics_ids.pull_messages,
+					utility::metrics::Outcome::OK, std::chrono::steady_clock::now() - start);
 			}
 			else if (header_action == ACTION_RENEWREQUEST)
 			{
 				// it's not need now
 				// auto termination_time = exns::find_hierarchy("Envelope.Body.PullMessages.TerminationTime", request_tree);
 				notifications_manager->Renew(response, header_to, header_message_id);
+
+				utility::metrics::record_request(pullpoint_metrics_ids.renew,
+					utility::metrics::Outcome::OK, std::chrono::steady_clock::now() - start);
 			}
 			else if (header_action == ACTION_SETSYNCHRONIZATIONPOINT)
 			{
@@ -134,7 +155,7 @@ namespace osrv
 
 					namespace pt = boost::property_tree;
 					auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
-					envelope_tree.add("s:Header.wsa:MessageID", header_message_id);
+					utility::soap::addResponseMessageId(envelope_tree, header_message_id);
 					envelope_tree.add("s:Header.wsa:To", "http://www.w3.org/2005/08/addressing/anonymous");
 					envelope_tree.add("s:Header.wsa:Action", "http://www.onvif.org/ver10/events/wsdl/PullPointSubscription/SetSynchronizationPointResponse");
 
@@ -147,11 +168,17 @@ namespace osrv
 					pt::write_xml(os, root_tree);
 
 					utility::http::fillResponseWithHeaders(*response, os.str());
+
+					utility::metrics::record_request(pullpoint_metrics_ids.set_synchronization_point,
+						utility::metrics::Outcome::OK, std::chrono::steady_clock::now() - start);
 				}
 				catch (const std::exception& e)
 				{
 					utility::http::fillResponseWithHeaders(*response,
 						e.what(), utility::http::ClientErrorDefaultWriter);
+
+					utility::metrics::record_request(pullpoint_metrics_ids.set_synchronization_point,
+						utility::metrics::Outcome::CLIENT_ERROR, std::chrono::steady_clock::now() - start);
 				}
 			}
 			else if(header_action == ACTION_UNSUBSCRIBE)
@@ -160,7 +187,7 @@ namespace osrv
 
 				namespace pt = boost::property_tree;
 				auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
-				envelope_tree.add("s:Header.wsa:MessageID", header_message_id);
+				utility::soap::addResponseMessageId(envelope_tree, header_message_id);
 				envelope_tree.add("s:Header.wsa:To", "http://www.w3.org/2005/08/addressing/anonymous");
 				envelope_tree.add("s:Header.wsa:Action", "http://docs.oasis-open.org/wsn/bw-2/SubscriptionManager/UnsubscribeResponse");
 
@@ -173,11 +200,16 @@ namespace osrv
 				pt::write_xml(os, root_tree);
 
 				utility::http::fillResponseWithHeaders(*response, os.str());
+
+				utility::metrics::record_request(pullpoint_metrics_ids.unsubscribe,
+					utility::metrics::Outcome::OK, std::chrono::steady_clock::now() - start);
 			}
 			else
 			{
 				// TODO: send something
 				// *response << "HTTP/1.1 400 Bad request\r\n" << "Content-Length: 0\r\n" << "Connection: close\r\n" << "\r\n";
+				utility::metrics::record_request(pullpoint_metrics_ids.unknown,
+					utility::metrics::Outcome::CLIENT_ERROR, std::chrono::steady_clock::now() - start);
 			}
 		}
 		
@@ -190,7 +222,9 @@ namespace osrv
 
 			OVERLOAD_REQUEST_HANDLER
 			{
-				auto configs_node = EVENT_CONFIGS_TREE.get_child(GetEventProperties);
+				const auto configs = EVENT_CONFIGS.load();
+
+				const auto configs_node = configs->get_child(GetEventProperties);
 
 				std::string response_body;
 				auto isStaticResponse = configs_node.get<bool>("ReadResponseFromFile");
@@ -217,66 +251,7 @@ namespace osrv
 					envelope_tree.add("s:Header.wsa:Action", "http://www.onvif.org/ver10/events/wsdl/EventPortType/GetEventPropertiesResponse");
 
 					pt::ptree response_tree;
-					response_tree.add("tet:TopicNamespaceLocation", "http://www.onvif.org/onvif/ver10/topics/topicns.xml");
-					response_tree.add("wsnt:FixedTopicSet", "true");
-					
-					{ // DI properties
-						StringPairsList_t source_props = { {"InputToken", "tt:ReferenceToken"} };
-						StringPairsList_t data_props = { {"LogicalState", "xs:boolean"} };
-						EventPropertiesSerializer serializer(EVENT_CONFIGS_TREE.get<std::string>("DigitalInputsAlarm.Topic"),
-							source_props, data_props);
-
-						response_tree.add_child("wstop:TopicSet." + serializer.Path(),
-							serializer.Ptree());
-					}
-
-					{ // Motion alarm
-						StringPairsList_t source_props = { {"Source", "tt:ReferenceToken"} };
-						StringPairsList_t data_props = { {"State", "xs:boolean"} };
-						EventPropertiesSerializer serializer(EVENT_CONFIGS_TREE.get<std::string>("MotionAlarm.Topic"),
-							source_props, data_props);
-
-						response_tree.add_child("wstop:TopicSet." + serializer.Path(),
-							serializer.Ptree());
-					}
-
-					{
-						// Cell motion
-						StringPairsList_t source_props;
-						source_props.push_back(std::make_pair(EVENT_CONFIGS_TREE.get<std::string>("CellMotion.VideoSourceConfigurationToken"),
-							"tt:ReferenceToken"));
-						source_props.push_back(std::make_pair(EVENT_CONFIGS_TREE.get<std::string>("CellMotion.VideoAnalyticsConfigurationToken"),
-							"tt:ReferenceToken"));
-						source_props.push_back(std::make_pair(EVENT_CONFIGS_TREE.get<std::string>("CellMotion.Rule"), "xs:string"));
-
-						StringPairsList_t data_props;
-						data_props.push_back(std::make_pair(EVENT_CONFIGS_TREE.get<std::string>("CellMotion.DataItemName"), "xs:boolean"));
-
-						EventPropertiesSerializer serializer(EVENT_CONFIGS_TREE.get<std::string>("CellMotion.Topic"),
-							source_props, data_props);
-
-						response_tree.add_child("wstop:TopicSet." + serializer.Path(),
-							serializer.Ptree());
-					}
-
-					{
-						//Audio detection
-						StringPairsList_t source_props;
-						source_props.push_back(std::make_pair(EVENT_CONFIGS_TREE.get<std::string>("AudioDetection.SourceConfigurationToken"),
-							"tt:ReferenceToken"));
-						source_props.push_back(std::make_pair(EVENT_CONFIGS_TREE.get<std::string>("AudioDetection.AnalyticsConfigurationToken"),
-							"tt:ReferenceToken"));
-						source_props.push_back(std::make_pair(EVENT_CONFIGS_TREE.get<std::string>("AudioDetection.Rule"), "xs:string"));
-
-						StringPairsList_t data_props;
-						data_props.push_back(std::make_pair(EVENT_CONFIGS_TREE.get<std::string>("AudioDetection.DataItemName"), "xs:boolean"));
-
-						EventPropertiesSerializer serializer(EVENT_CONFIGS_TREE.get<std::string>("AudioDetection.Topic"),
-							source_props, data_props);
-
-						response_tree.add_child("wstop:TopicSet." + serializer.Path(),
-							serializer.Ptree());
-					}
+					util::event_properties_to_soap(*configs, response_tree);
 
 					envelope_tree.add_child("s:Body.tet:GetEventPropertiesResponse", response_tree);
 
@@ -319,6 +294,8 @@ namespace osrv
 		void do_handler_request(std::shared_ptr<HttpServer::Response> response,
 			std::shared_ptr<HttpServer::Request> request)
 		{
+			const auto start = std::chrono::steady_clock::now();
+
 			//extract requested method
 			std::string method;
 			auto content = request->content.string();
@@ -376,9 +353,14 @@ namespace osrv
 					}
 
 					(*handler_ptr)(response, request);
+					utility::metrics::record_request(handler_ptr->get_metrics_id(),
+						utility::metrics::Outcome::OK, std::chrono::steady_clock::now() - start);
 				}
 				catch (const osrv::auth::digest_failed & e)
 				{
+					utility::metrics::record_request((*handler_it)->get_metrics_id(),
+						utility::metrics::Outcome::AUTH_FAILED, std::chrono::steady_clock::now() - start);
+
 					log_->Error(e.what());
 
 					*response << utility::http::RESPONSE_UNAUTHORIZED << "\r\n"
@@ -389,6 +371,9 @@ namespace osrv
 				}
 				catch (const std::exception & e)
 				{
+					utility::metrics::record_request((*handler_it)->get_metrics_id(),
+						utility::metrics::Outcome::SERVER_ERROR, std::chrono::steady_clock::now() - start);
+
 					log_->Error("A server's error occured in DeviceService while processing: " + method
 						+ ". Info: " + e.what());
 
@@ -399,9 +384,25 @@ namespace osrv
 			{
 				log_->Error("Not found an appropriate handler in DeviceService for: " + method);
 				*response << "HTTP/1.1 400 Bad request\r\nContent-Length: " << 0 << "\r\n\r\n";
+
+				utility::metrics::record_request(unknown_method_metrics_id,
+					utility::metrics::Outcome::CLIENT_ERROR, std::chrono::steady_clock::now() - start);
 			}
 		};
 
+		// the sections read by the handlers must be in a reloaded config
+		static utility::config::ConfigSnapshotSP read_configs()
+		{
+			auto configs = utility::config::ConfigSnapshot::read(CONFIGS_PATH, EVENT_CONFIGS_FILE);
+			configs->require({ GetEventProperties, "PullPoint", "DigitalInputsAlarm", "MotionAlarm", "CellMotion", "AudioDetection" });
+			return configs;
+		}
+
+		void watch_configs(utility::config::ConfigWatcher& watcher)
+		{
+			watcher.watch(EVENT_CONFIGS_FILE, []() { EVENT_CONFIGS.store(read_configs()); });
+		}
+
 		void init_service(HttpServer& srv, const osrv::ServerConfigs& server_configs_instance,
 			const std::string& configs_path, ILogger& logger)
 		{
@@ -419,9 +420,10 @@ namespace osrv
 			CONFIGS_PATH = configs_path;
 
 			//getting service's configs
-			pt::read_json(configs_path + EVENT_CONFIGS_FILE, EVENT_CONFIGS_TREE);
+			const auto configs = read_configs();
+			EVENT_CONFIGS.store(configs);
 
-			auto namespaces_tree = EVENT_CONFIGS_TREE.get_child("Namespaces");
+			const auto namespaces_tree = configs->get_child("Namespaces");
 			for (const auto& n : namespaces_tree)
 				XML_NAMESPACES.insert({ n.first, n.second.get_value<std::string>() });
 
@@ -431,49 +433,49 @@ namespace osrv
 			// TODO: reading events generating interval from configs
 			// add event generators
 			auto di_event_generator = std::shared_ptr<osrv::event::DInputEventGenerator>(
-				new event::DInputEventGenerator(EVENT_CONFIGS_TREE.get<int>("DigitalInputsAlarm.EventGenerationTimeout"),
-					EVENT_CONFIGS_TREE.get<std::string>("DigitalInputsAlarm.Topic"),
+				new event::DInputEventGenerator(configs->get<int>("DigitalInputsAlarm.EventGenerationTimeout"),
+					configs->get<std::string>("DigitalInputsAlarm.Topic"),
 					notifications_manager->GetIoContext(), *log_));
 			di_event_generator->SetDigitalInputsList(server_configs->digital_inputs_);
 			notifications_manager->AddGenerator(di_event_generator);
 
 			// add motion alarms generator
-			if (EVENT_CONFIGS_TREE.get<bool>("MotionAlarm.GenerateEvents"))
+			if (configs->get<bool>("MotionAlarm.GenerateEvents"))
 			{
 				auto ma_event_generator = std::make_shared<osrv::event::MotionAlarmEventGenerator>(
-					EVENT_CONFIGS_TREE.get<std::string>("MotionAlarm.Source"),
-					EVENT_CONFIGS_TREE.get<int>("MotionAlarm.EventGenerationTimeout"),
-					EVENT_CONFIGS_TREE.get<std::string>("MotionAlarm.Topic"),
+					configs->get<std::string>("MotionAlarm.Source"),
+					configs->get<int>("MotionAlarm.EventGenerationTimeout"),
+					configs->get<std::string>("MotionAlarm.Topic"),
 					notifications_manager->GetIoContext(), *log_);
 
 				notifications_manager->AddGenerator(ma_event_generator);
 			}
 
 			// add cell motion alarms generator
-			if (EVENT_CONFIGS_TREE.get<bool>("CellMotion.GenerateEvents"))
+			if (configs->get<bool>("CellMotion.GenerateEvents"))
 			{
 				auto cellmotion_generator = std::make_shared<osrv::event::CellMotionEventGenerator>(
-					EVENT_CONFIGS_TREE.get<std::string>("CellMotion.VideoSourceConfigurationToken"),
-					EVENT_CONFIGS_TREE.get<std::string>("CellMotion.VideoAnalyticsConfigurationToken"),
-					EVENT_CONFIGS_TREE.get<std::string>("CellMotion.Rule"),
-					EVENT_CONFIGS_TREE.get<std::string>("CellMotion.DataItemName"),
-					EVENT_CONFIGS_TREE.get<int>("CellMotion.EventGenerationTimeout"),
-					EVENT_CONFIGS_TREE.get<std::string>("CellMotion.Topic"),
+					configs->get<std::string>("CellMotion.VideoSourceConfigurationToken"),
+					configs->get<std::string>("CellMotion.VideoAnalyticsConfigurationToken"),
+					configs->get<std::string>("CellMotion.Rule"),
+					configs->get<std::string>("CellMotion.DataItemName"),
+					configs->get<int>("CellMotion.EventGenerationTimeout"),
+					configs->get<std::string>("CellMotion.Topic"),
 					notifications_manager->GetIoContext(), *log_);
 
 				notifications_manager->AddGenerator(cellmotion_generator);
 			}
 
 			// add audio detection alarms generator
-			if (EVENT_CONFIGS_TREE.get<bool>("AudioDetection.GenerateEvents"))
+			if (configs->get<bool>("AudioDetection.GenerateEvents"))
 			{
 				auto audio_generator = std::make_shared<osrv::event::AudioDetectectionEventGenerator>(
-					EVENT_CONFIGS_TREE.get<std::string>("AudioDetection.SourceConfigurationToken"),
-					EVENT_CONFIGS_TREE.get<std::string>("AudioDetection.AnalyticsConfigurationToken"),
-					EVENT_CONFIGS_TREE.get<std::string>("AudioDetection.Rule"),
-					EVENT_CONFIGS_TREE.get<std::string>("AudioDetection.DataItemName"),
-					EVENT_CONFIGS_TREE.get<int>("AudioDetection.EventGenerationTimeout"),
-					EVENT_CONFIGS_TREE.get<std::string>("AudioDetection.Topic"),
+					configs->get<std::string>("AudioDetection.SourceConfigurationToken"),
+					configs->get<std::string>("AudioDetection.AnalyticsConfigurationToken"),
+					configs->get<std::string>("AudioDetection.Rule"),
+					configs->get<std::string>("AudioDetection.DataItemName"),
+					configs->get<int>("AudioDetection.EventGenerationTimeout"),
+					configs->get<std::string>("AudioDetection.Topic"),
 					notifications_manager->GetIoContext(), *log_);
 
 				notifications_manager->AddGenerator(audio_generator);
@@ -487,6 +489,16 @@ namespace osrv
 			//PullPoint handlers
 			handlers.emplace_back(new CreatePullPointSubscriptionHandler{});
 
+			for (auto& handler : handlers)
+				handler->set_metrics_id(utility::metrics::register_method("event", handler->get_name()));
+			unknown_method_metrics_id = utility::metrics::register_method("event", "unknown");
+
+			pullpoint_metrics_ids.pull_messages = utility::metrics::register_method("pullpoint", "PullMessages");
+			pullpoint_metrics_ids.renew = utility::metrics::register_method("pullpoint", "Renew");
+			pullpoint_metrics_ids.set_synchronization_point = utility::metrics::register_method("pullpoint", "SetSynchronizationPoint");
+			pullpoint_metrics_ids.unsubscribe = utility::metrics::register_method("pullpoint", "Unsubscribe");
+			pullpoint_metrics_ids.unknown = utility::metrics::register_method("pullpoint", "unknown");
+
 			srv.resource["/onvif/event_service"]["POST"] = EventServiceHandler;
 
 			//register a default handler for the Pullpoint requests
@@ -496,5 +508,72 @@ namespace osrv
 
 		} //init service
 
+		namespace util
+		{
+			void event_properties_to_soap(const utility::config::ConfigSnapshot& configs, pt::ptree& result)
+			{
+				result.add("tet:TopicNamespaceLocation", "http://www.onvif.org/onvif/ver10/topics/topicns.xml");
+				result.add("wsnt:FixedTopicSet", "true");
+
+				{ // DI properties
+					StringPairsList_t source_props = { {"InputToken", "tt:ReferenceToken"} };
+					StringPairsList_t data_props = { {"LogicalState", "xs:boolean"} };
+					EventPropertiesSerializer serializer(configs.get<std::string>("DigitalInputsAlarm.Topic"),
+						source_props, data_props);
+
+					result.add_child("wstop:TopicSet." + serializer.Path(),
+						serializer.Ptree());
+				}
+
+				{ // Motion alarm
+					StringPairsList_t source_props = { {"Source", "tt:ReferenceToken"} };
+					StringPairsList_t data_props = { {"State", "xs:boolean"} };
+					EventPropertiesSerializer serializer(configs.get<std::string>("MotionAlarm.Topic"),
+						source_props, data_props);
+
+					result.add_child("wstop:TopicSet." + serializer.Path(),
+						serializer.Ptree());
+				}
+
+				{
+					// Cell motion
+					StringPairsList_t source_props;
+					source_props.push_back(std::make_pair(configs.get<std::string>("CellMotion.VideoSourceConfigurationToken"),
+						"tt:ReferenceToken"));
+					source_props.push_back(std::make_pair(configs.get<std::string>("CellMotion.VideoAnalyticsConfigurationToken"),
+						"tt:ReferenceToken"));
+					source_props.push_back(std::make_pair(configs.get<std::string>("CellMotion.Rule"), "xs:string"));
+
+					StringPairsList_t data_props;
+					data_props.push_back(std::make_pair(configs.get<std::string>("CellMotion.DataItemName"), "xs:boolean"));
+
+					EventPropertiesSerializer serializer(configs.get<std::string>("CellMotion.Topic"),
+						source_props, data_props);
+
+					result.add_child("wstop:TopicSet." + serializer.Path(),
+						serializer.Ptree());
+				}
+
+				{
+					//Audio detection
+					StringPairsList_t source_props;
+					source_props.push_back(std::make_pair(configs.get<std::string>("AudioDetection.SourceConfigurationToken"),
+						"tt:ReferenceToken"));
+					source_props.push_back(std::make_pair(configs.get<std::string>("AudioDetection.AnalyticsConfigurationToken"),
+						"tt:ReferenceToken"));
+					source_props.push_back(std::make_pair(configs.get<std::string>("AudioDetection.Rule"), "xs:string"));
+
+					StringPairsList_t data_props;
+					data_props.push_back(std::make_pair(configs.get<std::string>("AudioDetection.DataItemName"), "xs:boolean"));
+
+					EventPropertiesSerializer serializer(configs.get<std::string>("AudioDetection.Topic"),
+						source_props, data_props);
+
+					result.add_child("wstop:TopicSet." + serializer.Path(),
+						serializer.Ptree());
+				}
+			}
+		}
+
 	} // event
 } // osrv
\ No newline at end of file
@@ -2,8 +2,16 @@
 
 #include "../Types.inl"
 
+#include <boost/property_tree/ptree_fwd.hpp>
+
 class ILogger;
 
+namespace utility::config
+{
+	class ConfigSnapshot;
+	class ConfigWatcher;
+}
+
 namespace osrv
 {
 	struct ServerConfigs;
@@ -12,5 +20,17 @@ namespace osrv
 	{
 		void init_service(HttpServer& /*srv*/, const osrv::ServerConfigs& /*configs*/,
 			const std::string& /*configs_path*/, ILogger& /*logger*/);
+
+		// the changed configs are used by the next requests
+		// NOTE: the event generators are created only once by init_service
+		void watch_configs(utility::config::ConfigWatcher& /*watcher*/);
+
+		namespace util
+		{
+			// the TopicNamespaceLocation, FixedTopicSet and TopicSet of GetEventProperties,
+			// the config is read without copies
+			void event_properties_to_soap(const utility::config::ConfigSnapshot& /*configs*/,
+				boost::property_tree::ptree& /*result*/);
+		}
 	}
 }
\ No newline at end of file
@@ -5,6 +5,8 @@
 
 #include "../utility/HttpHelper.h"
 #include "../utility/SoapHelper.h"
+#include "../utility/ConfigSnapshot.h"
+#include "../utility/ConfigStore.h"
 #include "../utility/XmlParser.h"
 
 #include <boost/property_tree/xml_parser.hpp>
@@ -20,7 +22,8 @@ static DigestSessionSP digest_session;
 static std::string CONFIGS_PATH; //will be init with the service initialization
 
 namespace pt = boost::property_tree;
-static pt::ptree CONFIGS_TREE;
+// the imaging settings are changed by SetImagingSettings
+static utility::config::ConfigStoreSP CONFIGS;
 static osrv::StringsMap XML_NAMESPACES;
 
 namespace osrv::imaging
@@ -33,7 +36,11 @@ namespace osrv::imaging
 		
 	const std::string CONFIGS_FILE = "imaging.config";
 
+	// the settings' values, which are numbers, the rest of them are strings
+	static const std::vector<std::string> IMAGING_LEVELS = { "Brightness", "ColorSaturation", "Contrast", "Sharpness" };
+
 	static std::vector<utility::http::HandlerSP> handlers;
+	static utility::metrics::method_id_t unknown_method_metrics_id = utility::metrics::MAX_METHODS;
 
 	void do_handle_request(std::shared_ptr<HttpServer::Response> response,
 		std::shared_ptr<HttpServer::Request> request);
@@ -47,9 +54,25 @@ namespace osrv::imaging
 			
 		OVERLOAD_REQUEST_HANDLER
 		{
+			pt::ptree request_xml;
+			pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
+			const auto token = exns::find_hierarchy("Envelope.Body.GetImagingSettings.VideoSourceToken", request_xml);
+
+			const auto configs = CONFIGS->load();
+			const auto& settings = utility::config::find_item(configs->tree(), "ImagingSettings", "VideoSourceToken", token);
+
+			pt::ptree settings_node;
+			for (const auto& level : IMAGING_LEVELS)
+			{
+				if (auto value = settings.get_optional<float>(level))
+					settings_node.add("tt:" + level, *value);
+			}
+			if (auto ir_cut_filter = settings.get_optional<std::string>("IrCutFilter"))
+				settings_node.add("tt:IrCutFilter", *ir_cut_filter);
+
 			auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
 
-			envelope_tree.add("s:Body.timg:GetImagingSettingsResponse.timg:ImagingSettings", "");
+			envelope_tree.add_child("s:Body.timg:GetImagingSettingsResponse.timg:ImagingSettings", settings_node);
 
 			pt::ptree root_tree;
 			root_tree.put_child("s:Envelope", envelope_tree);
@@ -117,6 +140,24 @@ namespace osrv::imaging
 			
 		OVERLOAD_REQUEST_HANDLER
 		{
+			pt::ptree request_xml;
+			pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
+
+			const auto set_request = exns::find_path("Envelope.Body.SetImagingSettings", request_xml);
+			const auto new_settings = set_request ? exns::find_path("ImagingSettings", *set_request) : nullptr;
+			if (new_settings == nullptr)
+				throw std::runtime_error("Client error: the request has no ImagingSettings");
+			const auto token = exns::find_hierarchy("VideoSourceToken", *set_request);
+
+			// the settings, which are absent in the request, keep their values
+			CONFIGS->commit("ImagingSettings", "VideoSourceToken", token,
+				[&new_settings](pt::ptree& settings)
+				{
+					for (const auto& level : IMAGING_LEVELS)
+						exns::copy_value<float>(level, *new_settings, settings, level);
+					exns::copy_value<std::string>("IrCutFilter", *new_settings, settings, "IrCutFilter");
+				});
+
 			auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
 
 			envelope_tree.add("s:Body.timg:SetImagingSettingsResponse", "");
@@ -158,6 +199,8 @@ namespace osrv::imaging
 	void do_handle_request(std::shared_ptr<HttpServer::Response> response,
 		std::shared_ptr<HttpServer::Request> request)
 	{
+		const auto start = std::chrono::steady_clock::now();
+
 		//extract requested method
 		std::string method;
 		auto content = request->content.string();
@@ -218,9 +261,14 @@ namespace osrv::imaging
 				}
 
 				(*handler_ptr)(response, request);
+				utility::metrics::record_request(handler_ptr->get_metrics_id(),
+					utility::metrics::Outcome::OK, std::chrono::steady_clock::now() - start);
 			}
 			catch (const osrv::auth::digest_failed& e)
 			{
+				utility::metrics::record_request((*handler_it)->get_metrics_id(),
+					utility::metrics::Outcome::AUTH_FAILED, std::chrono::steady_clock::now() - start);
+
 				logger_->Error(e.what());
 
 				*response << utility::http::RESPONSE_UNAUTHORIZED << "\r\n"
@@ -231,6 +279,9 @@ namespace osrv::imaging
 			}
 			catch (const std::exception& e)
 			{
+				utility::metrics::record_request((*handler_it)->get_metrics_id(),
+					utility::metrics::Outcome::SERVER_ERROR, std::chrono::steady_clock::now() - start);
+
 				logger_->Error("A server's error occured in PtzService while processing: " + method
 					+ ". Info: " + e.what());
 
@@ -241,6 +292,9 @@ namespace osrv::imaging
 		{
 			logger_->Error("Not found an appropriate handler in PtzService for: " + method);
 			*response << "HTTP/1.1 400 Bad request\r\nContent-Length: " << 0 << "\r\n\r\n";
+
+			utility::metrics::record_request(unknown_method_metrics_id,
+				utility::metrics::Outcome::CLIENT_ERROR, std::chrono::steady_clock::now() - start);
 		}
 	}
 
@@ -258,9 +312,10 @@ namespace osrv::imaging
 		CONFIGS_PATH = configs_path;
 
 		//getting service's configs
-		pt::read_json(configs_path + CONFIGS_FILE, CONFIGS_TREE);
+		CONFIGS = utility::config::ConfigStore::instance(configs_path, CONFIGS_FILE, { "Namespaces", "ImagingSettings" }, logger);
 
-		auto namespaces_tree = CONFIGS_TREE.get_child("Namespaces");
+		const auto configs = CONFIGS->load();
+		const auto namespaces_tree = configs->get_child("Namespaces");
 		for (const auto& n : namespaces_tree)
 			XML_NAMESPACES.insert({ n.first, n.second.get_value<std::string>() });
 		
@@ -269,6 +324,15 @@ namespace osrv::imaging
 		handlers.emplace_back(new GetOptionsHandler());
 		handlers.emplace_back(new SetImagingSettingsHandler());
 
+		for (auto& handler : handlers)
+			handler->set_metrics_id(utility::metrics::register_method("imaging", handler->get_name()));
+		unknown_method_metrics_id = utility::metrics::register_method("imaging", "unknown");
+
 		srv.resource["/onvif/imaging_service"]["POST"] = ImagingServiceDefaultHandler;
 	}
+
+	void watch_configs(utility::config::ConfigWatcher& watcher)
+	{
+		CONFIGS->watch(watcher);
+	}
 }
\ No newline at end of file
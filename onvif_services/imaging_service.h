@@ -5,6 +5,11 @@
 
 class ILogger;
 
+namespace utility::config
+{
+	class ConfigWatcher;
+}
+
 namespace osrv
 {
 	struct ServerConfigs;
@@ -15,5 +20,8 @@ namespace osrv
 
 		void init_service(HttpServer& srv, osrv::ServerConfigs& /*configs*/,
 			const std::string& /*configs_path*/, ILogger& /*logger*/);
+
+		// the changed configs are used by the next requests
+		void watch_configs(utility::config::ConfigWatcher& /*watcher*/);
 	}
 }
\ No newline at end of file
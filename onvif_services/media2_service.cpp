@@ -5,6 +5,10 @@
 #include "../utility/XmlParser.h"
 #include "../utility/HttpHelper.h"
 #include "../utility/SoapHelper.h"
+#include "../utility/MediaProfiles.h"
+#include "../utility/ConfigSnapshot.h"
+#include "../utility/ConfigStore.h"
+#include "../utility/ConfigWatcher.h"
 #include "../Server.h"
 
 #include "../Simple-Web-Server/server_http.hpp"
@@ -18,12 +22,24 @@ static ILogger* logger_ = nullptr;
 static const osrv::ServerConfigs* server_configs;
 static DigestSessionSP digest_session;
 
-static const std::string PROFILES_CONFIGS_PATH = "media_profiles.config";
 static const std::string MEDIA_SERVICE_CONFIGS_PATH = "media2.config";
 
 namespace pt = boost::property_tree;
-static pt::ptree CONFIGS_TREE;
-static pt::ptree PROFILES_CONFIGS_TREE;
+// the configs, profiles and URIs are replaced together when one of the files is reloaded
+struct Media2State
+{
+	utility::config::ConfigSnapshotSP configs;
+	// only the configurations' options are read from here, everything else is in profiles
+	utility::config::ConfigSnapshotSP profiles_configs;
+	std::shared_ptr<const utility::media::MediaProfiles> profiles;
+	// indexed the same as the media profiles, URIs are already generated with the server's address
+	std::vector<std::optional<utility::media::StreamUri>> stream_uris;
+};
+static utility::config::Published<Media2State> STATE;
+// serializes the rebuilds of STATE, the readers don't take it
+static std::mutex state_mutex;
+static utility::config::ConfigStoreSP PROFILES_STORE;
+static std::string configs_path_;
 static osrv::StringsMap XML_NAMESPACES;
 
 //the list of implemented methods
@@ -36,6 +52,7 @@ static const std::string GetVideoSourceConfigurations = "GetVideoSourceConfigura
 static const std::string GetVideoSourceConfigurationOptions = "GetVideoSourceConfigurationOptions";
 static const std::string GetServiceCapabilities = "GetServiceCapabilities";
 static const std::string GetStreamUri = "GetStreamUri";
+static const std::string GetSnapshotUri = "GetSnapshotUri";
 static const std::string SetVideoEncoderConfiguration = "SetVideoEncoderConfiguration";
 static const std::string SetVideoSourceConfiguration = "SetVideoSourceConfiguration";
 
@@ -48,11 +65,12 @@ namespace osrv
 		//static std::map<std::string, handler_t*> handlers;
 
 		static std::vector<utility::http::HandlerSP> handlers;
+		static utility::metrics::method_id_t unknown_method_metrics_id = utility::metrics::MAX_METHODS;
 		
 		
 		const boost::property_tree::ptree& config_instance()
 		{
-			return CONFIGS_TREE;
+			return STATE.load()->configs->tree();
 		}
 
 		void do_handler_request(std::shared_ptr<HttpServer::Response> response,
@@ -119,9 +137,9 @@ namespace osrv
 
 			OVERLOAD_REQUEST_HANDLER
 			{
-				auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
+				const auto state = STATE.load();
 
-				auto profiles_configs_list = PROFILES_CONFIGS_TREE.get_child("MediaProfiles");
+				auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
 
 				// extract requested profile token (if there it is) 
 				std::string profile_token;
@@ -137,28 +155,22 @@ namespace osrv
 				if (profile_token.empty())
 				{
 					// response all media profiles' configs
-					for (auto elements : profiles_configs_list)
+					for (const auto& profile : state->profiles->profiles())
 					{
 						pt::ptree profile_node;
-						util::profile_to_soap(elements.second, PROFILES_CONFIGS_TREE, profile_node);
+						util::profile_to_soap(*state->profiles, profile, profile_node);
 						response_node.add_child("tr2:Profiles", profile_node);
 					}
 				}
 				else
 				{
 					// response only one profile's configs
-					auto profiles_config_it = std::find_if(profiles_configs_list.begin(),
-						profiles_configs_list.end(),
-						[&profile_token](const pt::ptree::value_type& i)
-						{
-							return i.second.get<std::string>("token") == profile_token;
-						});
-
-					if (profiles_config_it == profiles_configs_list.end())
+					auto profile = state->profiles->find_profile(profile_token);
+					if (profile == nullptr)
 						throw std::runtime_error("Not found a profile with token: " + profile_token);
 
 					pt::ptree profile_node;
-					util::profile_to_soap(profiles_config_it->second, PROFILES_CONFIGS_TREE, profile_node);
+					util::profile_to_soap(*state->profiles, *profile, profile_node);
 					response_node.add_child("tr2:Profiles", profile_node);
 				}
 
@@ -182,12 +194,13 @@ namespace osrv
 
 			OVERLOAD_REQUEST_HANDLER
 			{
-				const auto ve_config_list = PROFILES_CONFIGS_TREE.get_child("VideoEncoderConfigurations2");
+				const auto state = STATE.load();
+
 				pt::ptree ve_configs_node;
-				for (const auto& ve_config : ve_config_list)
+				for (const auto& ve_config : state->profiles->video_encoders2())
 				{
 					pt::ptree videoencoder_configuration;
-					osrv::media2::util::fill_video_encoder(ve_config.second, videoencoder_configuration);
+					osrv::media2::util::fill_video_encoder(ve_config, videoencoder_configuration);
 					ve_configs_node.add_child("tr2:Configurations", videoencoder_configuration);
 				}
 
@@ -211,6 +224,8 @@ namespace osrv
 
 			OVERLOAD_REQUEST_HANDLER
 			{
+				const auto state = STATE.load();
+
 
 
 				// a request may contain specific config token or profile token,
@@ -247,7 +262,7 @@ namespace osrv
 
 
 
-				const auto enc_config_options_list = PROFILES_CONFIGS_TREE.get_child("VideoEncoderConfigurationOptions2");
+				const auto enc_config_options_list = state->profiles_configs->get_child("VideoEncoderConfigurationOptions2");
 
 				pt::ptree response_node;
 				for (const auto& ec : enc_config_options_list)
@@ -261,8 +276,8 @@ namespace osrv
 					{ //FrameRatesSupported 
 
 						std::vector<float> framerates;
-						auto fps_list = ec.second.get_child("FrameRatesSupported");
-						for (auto n : fps_list)
+						const auto fps_list = ec.second.get_child("FrameRatesSupported");
+						for (const auto& n : fps_list)
 						{
 							framerates.push_back(n.second.get_value<float>());
 						}
@@ -272,8 +287,8 @@ namespace osrv
 					{ //ProfilesSupported 
 
 						std::vector<std::string> profiles;
-						auto fps_list = ec.second.get_child("ProfilesSupported");
-						for (auto n : fps_list)
+						const auto fps_list = ec.second.get_child("ProfilesSupported");
+						for (const auto& n : fps_list)
 						{
 							profiles.push_back(n.second.get_value<std::string>());
 						}
@@ -319,12 +334,13 @@ namespace osrv
 
 			OVERLOAD_REQUEST_HANDLER
 			{
-				auto vs_config_list = PROFILES_CONFIGS_TREE.get_child("VideoSourceConfigurations");
+				const auto state = STATE.load();
+
 				pt::ptree vs_configs_node;
-				for (const auto& vs_config : vs_config_list)
+				for (const auto& vs_config : state->profiles->video_sources())
 				{
 					pt::ptree videosource_configuration;
-					osrv::media::util::fill_soap_videosource_configuration(vs_config.second, videosource_configuration);
+					osrv::media::util::fill_soap_videosource_configuration(vs_config, videosource_configuration);
 					vs_configs_node.put_child("tr2:Configurations", videosource_configuration);
 				}
 				auto env_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
@@ -347,39 +363,14 @@ namespace osrv
 
 			OVERLOAD_REQUEST_HANDLER
 			{
+				const auto state = STATE.load();
+
 				// TODO:
 				// Here we should parse request and generate a response depends on required profile token and videosource
 				// configuration token, but for now it's ignored
 
-				auto vs_config_list = PROFILES_CONFIGS_TREE.get_child("VideoSourceConfigurations");
 				pt::ptree options_node;
-				for (const auto& vs_config : vs_config_list)
-				{
-					pt::ptree option;
-					option.add("<xmlattr>.MaximumNumberOfProfiles", vs_config.second.get<int>("Options.MaximumNumberOfProfiles"));
-
-					option.add("tt:BoundsRange.tt:XRange.tt:Min",
-						vs_config.second.get<int>("Options.BoundsRange.XRange.Min"));
-					option.add("tt:BoundsRange.tt:XRange.tt:Max",
-						vs_config.second.get<int>("Options.BoundsRange.XRange.Max"));
-
-					option.add("tt:BoundsRange.tt:YRange.tt:Min",
-						vs_config.second.get<int>("Options.BoundsRange.YRange.Min"));
-					option.add("tt:BoundsRange.tt:YRange.tt:Max",
-						vs_config.second.get<int>("Options.BoundsRange.YRange.Max"));
-
-					option.add("tt:BoundsRange.tt:WidthRange.tt:Min",
-						vs_config.second.get<int>("Options.BoundsRange.WidthRange.Min"));
-					option.add("tt:BoundsRange.tt:WidthRange.tt:Max",
-						vs_config.second.get<int>("Options.BoundsRange.WidthRange.Max"));
-
-					option.add("tt:BoundsRange.tt:HeightRange.tt:Min",
-						vs_config.second.get<int>("Options.BoundsRange.HeightRange.Min"));
-					option.add("tt:BoundsRange.tt:HeightRange.tt:Max",
-						vs_config.second.get<int>("Options.BoundsRange.HeightRange.Max"));
-
-					options_node.put_child("tr2:Options", option);
-				}
+				util::video_source_options_to_soap(*state->profiles_configs, options_node);
 
 				auto env_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
 				env_tree.put_child("s:Body.tr2:GetVideoSourceConfigurationOptionsResponse", options_node);
@@ -401,7 +392,9 @@ namespace osrv
 
 			OVERLOAD_REQUEST_HANDLER
 			{
-				auto capabilities_config = CONFIGS_TREE.get_child("GetServiceCapabilities2");
+				const auto state = STATE.load();
+
+				const auto capabilities_config = state->configs->get_child("GetServiceCapabilities2");
 				pt::ptree capabilities_node;
 				capabilities_node.add("<xmlattr>.SnapshotUri", capabilities_config.get<bool>("SnapshotUri"));
 				capabilities_node.add("<xmlattr>.Rotation", capabilities_config.get<bool>("Rotation"));
@@ -441,6 +434,8 @@ namespace osrv
 
 			OVERLOAD_REQUEST_HANDLER
 			{
+				const auto state = STATE.load();
+
 				pt::ptree request_xml;
 				pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
 
@@ -451,30 +446,16 @@ namespace osrv
 					logger_->Debug("Requested token to get URI=" + requested_token);
 				}
 
-				auto profiles_config_list = PROFILES_CONFIGS_TREE.get_child("MediaProfiles");
-
-				auto profile_config = std::find_if(profiles_config_list.begin(), profiles_config_list.end(),
-					[requested_token](const pt::ptree::value_type& vs_obj)
-					{
-						return vs_obj.second.get<std::string>("token") == requested_token;
-					});
-
-				if (profile_config == profiles_config_list.end())
+				auto profile_index = state->profiles->profile_index(requested_token);
+				if (profile_index == utility::media::NOT_FOUND)
 					throw std::runtime_error("Can't find a proper URI: the media profile does not exist. token=" + requested_token);
 
-				auto encoder_token = profile_config->second.get<std::string>("VideoEncoderConfiguration");
-
-				auto stream_configs_list = CONFIGS_TREE.get_child("GetStreamUri");
-				auto stream_config_it = std::find_if(stream_configs_list.begin(), stream_configs_list.end(),
-					[encoder_token](const pt::ptree::value_type& el)
-					{return el.second.get<std::string>("VideoEncoderToken") == encoder_token; });
-
-				if (stream_config_it == stream_configs_list.end())
+				const auto& stream = state->stream_uris[profile_index];
+				if (!stream)
 					throw std::runtime_error("Could not find a stream for the requested Media Profile token=" + requested_token);
 
 				pt::ptree response_node;
-				auto rtsp_url = media::util::generate_rtsp_url(*server_configs, stream_config_it->second.get<std::string>("Uri"));
-				response_node.put("tr2:Uri", rtsp_url);
+				response_node.add("tr2:Uri", stream->uri);
 
 				auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
 				envelope_tree.put_child("s:Body.tr2:GetStreamUriResponse", response_node);
@@ -489,6 +470,45 @@ namespace osrv
 			}
 		};
 		
+		struct GetSnapshotUriHandler : public utility::http::RequestHandlerBase
+		{
+			GetSnapshotUriHandler() : utility::http::RequestHandlerBase(GetSnapshotUri,
+				osrv::auth::SECURITY_LEVELS::READ_MEDIA)
+			{
+			}
+
+			OVERLOAD_REQUEST_HANDLER
+			{
+				const auto state = STATE.load();
+
+				pt::ptree request_xml;
+				pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
+
+				const auto requested_token = exns::find_hierarchy("Envelope.Body.GetSnapshotUri.ProfileToken", request_xml);
+				logger_->Debug("Requested token to get snapshot URI=" + requested_token);
+
+				if (!server_configs->snapshots_enabled_)
+					throw std::runtime_error("Can't get a snapshot URI: the snapshots are disabled");
+
+				if (state->profiles->profile_index(requested_token) == utility::media::NOT_FOUND)
+					throw std::runtime_error("Can't get a snapshot URI: the media profile does not exist. token=" + requested_token);
+
+				pt::ptree response_node;
+				response_node.add("tr2:Uri", media::util::generate_snapshot_url(*server_configs, requested_token));
+
+				auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
+				envelope_tree.put_child("s:Body.tr2:GetSnapshotUriResponse", response_node);
+
+				pt::ptree root_tree;
+				root_tree.put_child("s:Envelope", envelope_tree);
+
+				std::ostringstream os;
+				pt::write_xml(os, root_tree);
+
+				utility::http::fillResponseWithHeaders(*response, os.str());
+			}
+		};
+
 		struct SetVideoEncoderConfigurationHandler : public utility::http::RequestHandlerBase
 		{
 			SetVideoEncoderConfigurationHandler() : utility::http::RequestHandlerBase(SetVideoEncoderConfiguration,
@@ -501,7 +521,30 @@ namespace osrv
 				pt::ptree request_xml;
 				pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
 
-				// TODO: add impmlementation
+				auto configuration = exns::find_path("Envelope.Body.SetVideoEncoderConfiguration.Configuration", request_xml);
+				if (configuration == nullptr)
+					throw std::runtime_error("Client error: the request has no Configuration");
+				const auto token = configuration->get<std::string>("<xmlattr>.token");
+
+				// the fields, which are absent in the request, keep their values
+				PROFILES_STORE->commit("VideoEncoderConfigurations2", "token", token,
+					[&configuration](pt::ptree& item)
+					{
+						exns::copy_value<std::string>("Name", *configuration, item, "Name");
+						exns::copy_value<int>("UseCount", *configuration, item, "UseCount");
+						exns::copy_value<std::string>("Encoding", *configuration, item, "Encoding");
+						exns::copy_value<int>("Resolution.Width", *configuration, item, "Resolution.Width");
+						exns::copy_value<int>("Resolution.Height", *configuration, item, "Resolution.Height");
+						exns::copy_value<float>("Quality", *configuration, item, "Quality");
+						exns::copy_value<int>("<xmlattr>.GovLength", *configuration, item, "GovLength");
+						exns::copy_value<std::string>("<xmlattr>.Profile", *configuration, item, "Profile");
+						exns::copy_value<bool>("<xmlattr>.GuaranteedFrameRate", *configuration, item, "GuaranteedFrameRate");
+						// ONVIF puts it into the attribute, GetVideoEncoderConfigurations returns it as an element
+						if (!exns::copy_value<bool>("RateControl.<xmlattr>.ConstantBitRate", *configuration, item, "RateControl.ConstantBitRate"))
+							exns::copy_value<bool>("RateControl.ConstantBitRate", *configuration, item, "RateControl.ConstantBitRate");
+						exns::copy_value<float>("RateControl.FrameRateLimit", *configuration, item, "RateControl.FrameRateLimit");
+						exns::copy_value<int>("RateControl.BitrateLimit", *configuration, item, "RateControl.BitrateLimit");
+					});
 
 				auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
 				envelope_tree.put("s:Body.tr2:SetVideoEncoderConfigurationResponse", "");
@@ -528,7 +571,22 @@ namespace osrv
 				pt::ptree request_xml;
 				pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
 
-				// TODO: add implementation
+				auto configuration = exns::find_path("Envelope.Body.SetVideoSourceConfiguration.Configuration", request_xml);
+				if (configuration == nullptr)
+					throw std::runtime_error("Client error: the request has no Configuration");
+				const auto token = configuration->get<std::string>("<xmlattr>.token");
+
+				// the fields, which are absent in the request, keep their values
+				PROFILES_STORE->commit("VideoSourceConfigurations", "token", token,
+					[&configuration](pt::ptree& item)
+					{
+						exns::copy_value<std::string>("Name", *configuration, item, "Name");
+						exns::copy_value<int>("UseCount", *configuration, item, "UseCount");
+						exns::copy_value<std::string>("SourceToken", *configuration, item, "SourceToken");
+						exns::copy_value<std::string>("<xmlattr>.ViewMode", *configuration, item, "ViewMode");
+						for (const auto& bound : { "x", "y", "width", "height" })
+							exns::copy_value<int>(std::string("Bounds.<xmlattr>.") + bound, *configuration, item, std::string("Bounds.") + bound);
+					});
 
 				auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
 				envelope_tree.put("s:Body.tr2:SetVideoSourceConfigurationResponse", "");
@@ -571,6 +629,8 @@ namespace osrv
 		void do_handler_request(std::shared_ptr<HttpServer::Response> response,
             std::shared_ptr<HttpServer::Request> request)
 		{
+			const auto start = std::chrono::steady_clock::now();
+
 			//extract requested method
 			std::string method;
 			auto content = request->content.string();
@@ -628,9 +688,14 @@ namespace osrv
 					}
 
 					(*handler_ptr)(response, request);
+					utility::metrics::record_request(handler_ptr->get_metrics_id(),
+						utility::metrics::Outcome::OK, std::chrono::steady_clock::now() - start);
 				}
 				catch (const osrv::auth::digest_failed& e)
 				{
+					utility::metrics::record_request((*handler_it)->get_metrics_id(),
+						utility::metrics::Outcome::AUTH_FAILED, std::chrono::steady_clock::now() - start);
+
 					logger_->Error(e.what());
 					
 					*response << utility::http::RESPONSE_UNAUTHORIZED << "\r\n"
@@ -641,6 +706,9 @@ namespace osrv
 				}
 				catch (const std::exception& e)
 				{
+					utility::metrics::record_request((*handler_it)->get_metrics_id(),
+						utility::metrics::Outcome::SERVER_ERROR, std::chrono::steady_clock::now() - start);
+
 					logger_->Error("A server's error occured in Media2Service while processing: " + method
 						+ ". Info: " + e.what());
 					
@@ -651,7 +719,35 @@ namespace osrv
 			{
 				logger_->Error("Not found an appropriate handler in Media2Service for: " + method);
 				*response << "HTTP/1.1 400 Bad request\r\nContent-Length: " << 0 << "\r\n\r\n";
+
+				utility::metrics::record_request(unknown_method_metrics_id,
+					utility::metrics::Outcome::CLIENT_ERROR, std::chrono::steady_clock::now() - start);
+			}
+		}
+
+		static utility::config::ConfigSnapshotSP read_configs()
+		{
+			auto configs = utility::config::ConfigSnapshot::read(configs_path_, MEDIA_SERVICE_CONFIGS_PATH);
+			configs->require({ "GetServiceCapabilities2", GetStreamUri, "Namespaces" });
+			return configs;
+		}
+
+		static std::shared_ptr<const Media2State> make_state(utility::config::ConfigSnapshotSP configs,
+			utility::config::ConfigSnapshotSP profiles_configs)
+		{
+			auto state = std::make_shared<Media2State>();
+			state->configs = std::move(configs);
+			state->profiles = utility::media::MediaProfiles::instance(profiles_configs);
+			state->profiles_configs = std::move(profiles_configs);
+
+			state->stream_uris = state->profiles->resolve_stream_uris(state->configs->get_child(GetStreamUri).tree());
+			for (auto& stream : state->stream_uris)
+			{
+				if (stream)
+					stream->uri = media::util::generate_rtsp_url(*server_configs, stream->uri);
 			}
+
+			return state;
 		}
 
         void init_service(HttpServer& srv, const osrv::ServerConfigs& server_configs_ptr,
@@ -667,10 +763,18 @@ namespace osrv
 			server_configs = &server_configs_ptr;
 			digest_session = server_configs_ptr.digest_session_;
 
-            pt::read_json(configs_path + MEDIA_SERVICE_CONFIGS_PATH, CONFIGS_TREE);
-            pt::read_json(configs_path + PROFILES_CONFIGS_PATH, PROFILES_CONFIGS_TREE);
+			configs_path_ = configs_path;
+			PROFILES_STORE = utility::media::MediaProfiles::store(configs_path, logger);
+
+			const auto state = make_state(read_configs(), PROFILES_STORE->load());
+			STATE.store(state);
+
+			PROFILES_STORE->subscribe([](const utility::config::ConfigSnapshotSP& profiles_configs) {
+					std::lock_guard<std::mutex> lock(state_mutex);
+					STATE.store(make_state(STATE.load()->configs, profiles_configs));
+				});
 
-            auto namespaces_tree = CONFIGS_TREE.get_child("Namespaces");
+            const auto namespaces_tree = state->configs->get_child("Namespaces");
             for (const auto& n : namespaces_tree)
                 XML_NAMESPACES.insert({ n.first, n.second.get_value<std::string>() });
 
@@ -683,56 +787,65 @@ namespace osrv
 			handlers.emplace_back(new GetVideoSourceConfigurationsHandler());
 			handlers.emplace_back(new GetVideoSourceConfigurationOptionsHandler());
 			handlers.emplace_back(new GetStreamUriHandler());
+			handlers.emplace_back(new GetSnapshotUriHandler());
 			handlers.emplace_back(new SetVideoEncoderConfigurationHandler());
 			handlers.emplace_back(new SetVideoSourceConfigurationHandler());
 
+			for (auto& handler : handlers)
+				handler->set_metrics_id(utility::metrics::register_method("media2", handler->get_name()));
+			unknown_method_metrics_id = utility::metrics::register_method("media2", "unknown");
+
             srv.resource["/onvif/media2_service"]["POST"] = Media2ServiceHandler;
         }
 
+		void watch_configs(utility::config::ConfigWatcher& watcher)
+		{
+			watcher.watch(MEDIA_SERVICE_CONFIGS_PATH, []() {
+					auto configs = read_configs();
+					std::lock_guard<std::mutex> lock(state_mutex);
+					STATE.store(make_state(std::move(configs), PROFILES_STORE->load()));
+				});
+			PROFILES_STORE->watch(watcher);
+		}
+
 
 		namespace util
 		{
 			using ptree = boost::property_tree::ptree;
 			void profile_to_soap(const ptree& profile_config, const ptree& configs_file, ptree& result)
 			{
-				result.add("<xmlattr>.token", profile_config.get<std::string>("token"));
-				result.add("<xmlattr>.fixed", profile_config.get<std::string>("fixed"));
-				result.add("Name", profile_config.get<std::string>("Name"));
+				const utility::media::MediaProfiles media_profiles(configs_file);
 
-				//Videosource
-				{
-					const std::string vs_token = profile_config.get<std::string>("VideoSourceConfiguration");
-					auto vs_configs_list = configs_file.get_child("VideoSourceConfigurations");
-					auto vs_config = std::find_if(vs_configs_list.begin(), vs_configs_list.end(),
-						[vs_token](pt::ptree::value_type vs_obj)
-						{
-							return vs_obj.second.get<std::string>("token") == vs_token;
-						});
+				const auto token = profile_config.get<std::string>("token");
+				auto profile = media_profiles.find_profile(token);
+				if (profile == nullptr)
+					throw std::runtime_error("Can't find a profile with token '" + token + "'");
 
-					if (vs_config == vs_configs_list.end())
-						throw std::runtime_error("Can't find VideoSourceConfiguration with token '" + vs_token + "'");
+				profile_to_soap(media_profiles, *profile, result);
+			}
 
+			void profile_to_soap(const utility::media::MediaProfiles& media_profiles,
+				const utility::media::Profile& profile, ptree& result)
+			{
+				result.add("<xmlattr>.token", profile.token);
+				result.add("<xmlattr>.fixed", profile.fixed);
+				result.add("Name", profile.name);
+
+				//Videosource
+				{
 					pt::ptree videosource_configuration;
-					osrv::media::util::fill_soap_videosource_configuration(vs_config->second, videosource_configuration);
-					result.put_child("tr2:Configurations.tr2:VideoSource", videosource_configuration);
+					osrv::media::util::fill_soap_videosource_configuration(media_profiles.video_source_of(profile),
+						videosource_configuration);
+					result.add_child("tr2:Configurations.tr2:VideoSource", videosource_configuration);
 				}
 
 				// videoencoder
 				{
-					const std::string ve_token = profile_config.get<std::string>("VideoEncoderConfiguration");
-					//TODO: use the same configuartion structure with Media1  --->get_child("VideoEncoderConfigurations2")
-					auto vs_configs_list = configs_file.get_child("VideoEncoderConfigurations2");
-					auto vs_config = std::find_if(vs_configs_list.begin(), vs_configs_list.end(),
-						[ve_token](pt::ptree::value_type vs_obj)
-						{
-							return vs_obj.second.get<std::string>("token") == ve_token;
-						});
-
-					if (vs_config == vs_configs_list.end())
-						throw std::runtime_error("Can't find VideoEncoderConfiguration with token '" + ve_token + "'");
+					//TODO: use the same configuartion structure with Media1
 					pt::ptree videoencoder_configuration;
-					osrv::media2::util::fill_video_encoder(vs_config->second, videoencoder_configuration);
-					result.put_child("tr2:Configurations.tr2:VideoEncoder", videoencoder_configuration);
+					osrv::media2::util::fill_video_encoder(media_profiles.video_encoder2_of(profile),
+						videoencoder_configuration);
+					result.add_child("tr2:Configurations.tr2:VideoEncoder", videoencoder_configuration);
 				}
 
 				{ // Videoanalytics
@@ -761,21 +874,59 @@ namespace osrv
 				}
 			}
 			
-			void fill_video_encoder(const pt::ptree& config_node, pt::ptree& videoencoder_node)
-			{
-				videoencoder_node.add("<xmlattr>.token", config_node.get<std::string>("token"));
-				videoencoder_node.add("tt:Name", config_node.get<std::string>("Name"));
-				videoencoder_node.add("tt:UseCount", config_node.get<int>("UseCount"));
-				videoencoder_node.add("<xmlattr>.GovLength", config_node.get<int>("GovLength"));
-				videoencoder_node.add("<xmlattr>.Profile", config_node.get<std::string>("Profile"));
-				videoencoder_node.add("<xmlattr>.GuaranteedFrameRate", config_node.get<bool>("GuaranteedFrameRate"));
-				videoencoder_node.add("tt:Encoding", config_node.get<std::string>("Encoding"));
-				videoencoder_node.add("tt:Resolution.tt:Width", config_node.get<int>("Resolution.Width"));
-				videoencoder_node.add("tt:Resolution.tt:Height", config_node.get<int>("Resolution.Height"));
-				videoencoder_node.add("tt:Quality", config_node.get<float>("Quality"));
-				videoencoder_node.add("tt:RateControl.tt:ConstantBitRate", config_node.get<bool>("RateControl.ConstantBitRate"));
-				videoencoder_node.add("tt:RateControl.tt:FrameRateLimit", config_node.get<float>("RateControl.FrameRateLimit"));
-				videoencoder_node.add("tt:RateControl.tt:BitrateLimit", config_node.get<int>("RateControl.BitrateLimit"));
+			void video_source_options_to_soap(const utility::config::ConfigSnapshot& profiles_configs, ptree& result)
+			{
+				const auto vs_config_list = profiles_configs.get_child("VideoSourceConfigurations");
+				for (const auto& vs_config : vs_config_list)
+				{
+					pt::ptree option;
+					option.add("<xmlattr>.MaximumNumberOfProfiles", vs_config.second.get<int>("Options.MaximumNumberOfProfiles"));
+
+					option.add("tt:BoundsRange.tt:XRange.tt:Min",
+						vs_config.second.get<int>("Options.BoundsRange.XRange.Min"));
+					option.add("tt:BoundsRange.tt:XRange.tt:Max",
+						vs_config.second.get<int>("Options.BoundsRange.XRange.Max"));
+
+					option.add("tt:BoundsRange.tt:YRange.tt:Min",
+						vs_config.second.get<int>("Options.BoundsRange.YRange.Min"));
+					option.add("tt:BoundsRange.tt:YRange.tt:Max",
+						vs_config.second.get<int>("Options.BoundsRange.YRange.Max"));
+
+					option.add("tt:BoundsRange.tt:WidthRange.tt:Min",
+						vs_config.second.get<int>("Options.BoundsRange.WidthRange.Min"));
+					option.add("tt:BoundsRange.tt:WidthRange.tt:Max",
+						vs_config.second.get<int>("Options.BoundsRange.WidthRange.Max"));
+
+					option.add("tt:BoundsRange.tt:HeightRange.tt:Min",
+						vs_config.second.get<int>("Options.BoundsRange.HeightRange.Min"));
+					option.add("tt:BoundsRange.tt:HeightRange.tt:Max",
+						vs_config.second.get<int>("Options.BoundsRange.HeightRange.Max"));
+
+					result.put_child("tr2:Options", option);
+				}
+			}
+
+			void fill_video_encoder(const utility::media::VideoEncoderConfiguration& config, pt::ptree& videoencoder_node)
+			{
+				videoencoder_node.add("<xmlattr>.token", config.token);
+				if (config.h264)
+				{
+					videoencoder_node.add("<xmlattr>.GovLength", config.h264->gov_length);
+					videoencoder_node.add("<xmlattr>.Profile", config.h264->profile);
+				}
+				videoencoder_node.add("tt:Name", config.name);
+				videoencoder_node.add("tt:UseCount", config.use_count);
+				videoencoder_node.add("tt:Encoding", config.encoding);
+				videoencoder_node.add("tt:Resolution.tt:Width", config.resolution.width);
+				videoencoder_node.add("tt:Resolution.tt:Height", config.resolution.height);
+				videoencoder_node.add("tt:Quality", config.quality);
+				if (const auto& rc = config.rate_control)
+				{
+					videoencoder_node.add("<xmlattr>.GuaranteedFrameRate", rc->guaranteed_frame_rate);
+					videoencoder_node.add("tt:RateControl.tt:ConstantBitRate", rc->constant_bitrate);
+					videoencoder_node.add("tt:RateControl.tt:FrameRateLimit", rc->frame_rate_limit);
+					videoencoder_node.add("tt:RateControl.tt:BitrateLimit", rc->bitrate_limit);
+				}
 			}
 			
 		}
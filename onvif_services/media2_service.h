@@ -6,6 +6,19 @@ class ILogger;
 
 #include <string>
 
+namespace utility::media
+{
+	class MediaProfiles;
+	struct Profile;
+	struct VideoEncoderConfiguration;
+}
+
+namespace utility::config
+{
+	class ConfigWatcher;
+	class ConfigSnapshot;
+}
+
 #include <boost/property_tree/ptree_fwd.hpp>
 
 namespace osrv
@@ -15,17 +28,25 @@ namespace osrv
 	namespace media2
 
 	{
+		// NOTE: the returned tree may be released when the configs are reloaded
 		const boost::property_tree::ptree& config_instance();
 		
 		void init_service(HttpServer& srv, const ServerConfigs& server_configs_ptr,
 			const std::string& configs_path, ILogger& logger);
 
+		// the changed configs and profiles are used by the next requests
+		void watch_configs(utility::config::ConfigWatcher& watcher);
+
 		namespace util
 		{
 			using ptree = boost::property_tree::ptree;
 			// functions throw an exception if error occured
 			void profile_to_soap(const ptree& profile_config, const ptree& configs_file, ptree& result);
-			void fill_video_encoder(const ptree& config_node, ptree& videoencoder_node);
+			void profile_to_soap(const utility::media::MediaProfiles& media_profiles,
+				const utility::media::Profile& profile, ptree& result);
+			void fill_video_encoder(const utility::media::VideoEncoderConfiguration& config, ptree& videoencoder_node);
+			// the options of all the video source configurations of the profiles configs
+			void video_source_options_to_soap(const utility::config::ConfigSnapshot& profiles_configs, ptree& result);
 
 			template <typename T>
 			std::string to_value_list(const std::vector<T>& list)
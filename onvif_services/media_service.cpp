@@ -4,6 +4,10 @@
 #include "../utility/XmlParser.h"
 #include "../utility/HttpHelper.h"
 #include "../utility/SoapHelper.h"
+#include "../utility/MediaProfiles.h"
+#include "../utility/ConfigSnapshot.h"
+#include "../utility/ConfigWatcher.h"
+#include "../utility/ConfigStore.h"
 #include "../Server.h"
 
 #include "../Simple-Web-Server/server_http.hpp"
@@ -18,12 +22,22 @@ static DigestSessionSP digest_session;
 static ILogger* logger_ = nullptr;
 
 
-static const std::string PROFILES_CONFIGS_PATH = "media_profiles.config";
 static const std::string MEDIA_SERVICE_CONFIGS_PATH = "media.config";
 
 namespace pt = boost::property_tree;
-static pt::ptree CONFIGS_TREE;
-static pt::ptree PROFILES_CONFIGS_TREE;
+// the configs, profiles and URIs are replaced together when one of the files is reloaded
+struct MediaState
+{
+	utility::config::ConfigSnapshotSP configs;
+	std::shared_ptr<const utility::media::MediaProfiles> profiles;
+	// indexed the same as the media profiles, URIs are already generated with the server's address
+	std::vector<std::optional<utility::media::StreamUri>> stream_uris;
+};
+static utility::config::Published<MediaState> STATE;
+// the state is rebuilt by the configs' reloading and by the changes of the profiles
+static std::mutex state_mutex;
+static utility::config::ConfigStoreSP PROFILES_STORE;
+static std::string configs_path_;
 static osrv::StringsMap XML_NAMESPACES;
 
 //the list of implemented methods
@@ -38,10 +52,11 @@ static const std::string GetVideoSourceConfiguration = "GetVideoSourceConfigurat
 static const std::string GetVideoSourceConfigurations = "GetVideoSourceConfigurations";
 static const std::string GetVideoSources = "GetVideoSources";
 static const std::string GetStreamUri = "GetStreamUri";
+static const std::string GetSnapshotUri = "GetSnapshotUri";
 
 //soap helper functions
-void fill_soap_media_profile(const pt::ptree& /*in_json_config*/, pt::ptree& /*out_profile_node*/,
-	const std::string& /*root_node_value*/);
+void fill_soap_media_profile(const utility::media::MediaProfiles& /*profiles*/, const utility::media::Profile& /*profile*/,
+	pt::ptree& /*out_profile_node*/);
 
 namespace osrv
 {
@@ -49,6 +64,7 @@ namespace osrv
     {
 		//TODO:: Need release
 		static std::vector<utility::http::HandlerSP> handlers;
+		static utility::metrics::method_id_t unknown_method_metrics_id = utility::metrics::MAX_METHODS;
 
 		void do_handler_request(std::shared_ptr<HttpServer::Response> response,
 			std::shared_ptr<HttpServer::Request> request);
@@ -153,6 +169,8 @@ namespace osrv
 
 			OVERLOAD_REQUEST_HANDLER
 			{
+				const auto state = STATE.load();
+
 				pt::ptree request_xml;
 				pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
 
@@ -166,24 +184,15 @@ namespace osrv
 					requested_token = profile_token->second.get_value<std::string>();
 				}
 
-				auto profiles_config_list = PROFILES_CONFIGS_TREE.get_child("MediaProfiles");
-
-				auto profile_config = std::find_if(profiles_config_list.begin(), profiles_config_list.end(),
-					[requested_token](pt::ptree::value_type vs_obj)
-					{
-						return vs_obj.second.get<std::string>("token") == requested_token;
-					});
-
-				if (profile_config == profiles_config_list.end())
+				auto profile = state->profiles->find_profile(requested_token);
+				if (profile == nullptr)
 					throw std::runtime_error("The requested profile token ProfileToken does not exist");
 
 				pt::ptree profile_node;
-				fill_soap_media_profile(profile_config->second, profile_node, "trt:Profile");
+				fill_soap_media_profile(*state->profiles, *profile, profile_node);
 
 				pt::ptree response_node;
-				response_node.insert(response_node.end(),
-					profile_node.begin(),
-					profile_node.end());
+				response_node.add_child("trt:Profile", profile_node);
 				
 				auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
 				envelope_tree.put_child("s:Body.trt:GetProfileResponse", response_node);
@@ -207,19 +216,16 @@ namespace osrv
 
 			OVERLOAD_REQUEST_HANDLER
 			{
+				const auto state = STATE.load();
+
 				auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
 
-				auto profiles_config = PROFILES_CONFIGS_TREE.get_child("MediaProfiles");
 				pt::ptree response_node;
-				profiles_config.begin();
-				for (auto elements : profiles_config)
+				for (const auto& profile : state->profiles->profiles())
 				{
 					pt::ptree profile_node;
-					fill_soap_media_profile(elements.second, profile_node, "trt:Profiles");
-
-					response_node.insert(response_node.end(),
-						profile_node.begin(),
-						profile_node.end());
+					fill_soap_media_profile(*state->profiles, profile, profile_node);
+					response_node.add_child("trt:Profiles", profile_node);
 				}
 			
 				envelope_tree.put_child("s:Body.trt:GetProfilesResponse", response_node);
@@ -266,6 +272,8 @@ namespace osrv
 
 			OVERLOAD_REQUEST_HANDLER
 			{
+				const auto state = STATE.load();
+
 				pt::ptree request_xml;
 				pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
 
@@ -279,19 +287,12 @@ namespace osrv
 					requested_token = profile_token->second.get_value<std::string>();
 				}
 
-				auto vs_config_list = PROFILES_CONFIGS_TREE.get_child("VideoSourceConfigurations");
-
-				auto vs_config = std::find_if(vs_config_list.begin(), vs_config_list.end(),
-					[requested_token](pt::ptree::value_type vs_obj)
-					{
-						return vs_obj.second.get<std::string>("token") == requested_token;
-					});
-
-				if (vs_config == vs_config_list.end())
+				auto vs_config = state->profiles->find_video_source(requested_token);
+				if (vs_config == nullptr)
 					throw std::runtime_error("The requested configuration indicated with ConfigurationToken does not exist.");
 				
 				pt::ptree videosource_configuration_node;
-				util::fill_soap_videosource_configuration(vs_config->second, videosource_configuration_node);
+				util::fill_soap_videosource_configuration(*vs_config, videosource_configuration_node);
 
 				auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
 				envelope_tree.add_child("s:Body.trt:GetVideoSourceConfigurationResponse.trt:Configuration", videosource_configuration_node);
@@ -315,13 +316,13 @@ namespace osrv
 
 			OVERLOAD_REQUEST_HANDLER
 			{
-				auto vs_config_list = PROFILES_CONFIGS_TREE.get_child("VideoSourceConfigurations");
+				const auto state = STATE.load();
 
 				pt::ptree vs_configs_node;
-				for (const auto& vs_config : vs_config_list)
+				for (const auto& vs_config : state->profiles->video_sources())
 				{
 					pt::ptree vs_config_node;
-					util::fill_soap_videosource_configuration(vs_config.second, vs_config_node);
+					util::fill_soap_videosource_configuration(vs_config, vs_config_node);
 					vs_configs_node.add_child("trt:Configurations", vs_config_node);
 				}
 
@@ -347,13 +348,15 @@ namespace osrv
 
 			OVERLOAD_REQUEST_HANDLER
 			{
+				const auto state = STATE.load();
+
 				auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
 
-				auto videosources_config = CONFIGS_TREE.get_child(GetVideoSources);
+				const auto videosources_config = state->configs->get_child(GetVideoSources);
 				pt::ptree response_node;
 
 				//here's Services are enumerates as array, so handle them manualy
-				for (auto elements : videosources_config)
+				for (const auto& elements : videosources_config)
 				{
 					pt::ptree videosource_node;
 					videosource_node.put("trt:VideoSources.<xmlattr>.token",
@@ -390,6 +393,8 @@ namespace osrv
 
 			OVERLOAD_REQUEST_HANDLER
 			{
+				const auto state = STATE.load();
+
 				pt::ptree request_xml;
 				pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
 
@@ -405,38 +410,22 @@ namespace osrv
 					logger_->Debug("Requested token to get URI: " + requested_token);
 				}
 
-				auto profiles_config_list = PROFILES_CONFIGS_TREE.get_child("MediaProfiles");
-
-				auto profile_config = std::find_if(profiles_config_list.begin(), profiles_config_list.end(),
-					[requested_token](pt::ptree::value_type vs_obj)
-					{
-						return vs_obj.second.get<std::string>("token") == requested_token;
-					});
-
-				if (profile_config == profiles_config_list.end())
+				auto profile_index = state->profiles->profile_index(requested_token);
+				if (profile_index == utility::media::NOT_FOUND)
 					throw std::runtime_error("The media profile does not exist.");
-				
-				auto encoder_token = profile_config->second.get<std::string>("VideoEncoderConfiguration");
-
-				auto stream_configs_list = CONFIGS_TREE.get_child("GetStreamUri");
-				auto stream_config_it = std::find_if(stream_configs_list.begin(), stream_configs_list.end(),
-					[encoder_token](const pt::ptree::value_type& el)
-					{return el.second.get<std::string>("VideoEncoderToken") == encoder_token; });
 
-				if (stream_config_it == stream_configs_list.end())
+				const auto& stream = state->stream_uris[profile_index];
+				if (!stream)
 					throw std::runtime_error("Could not find a stream for the requested Media Profile.");
 
-				pt::ptree response_node;
+				pt::ptree media_uri_node;
+				media_uri_node.add("tt:Uri", stream->uri);
+				media_uri_node.add("tt:InvalidAfterConnect", stream->invalid_after_connect);
+				media_uri_node.add("tt:InvalidAfterReboot", stream->invalid_after_reboot);
+				media_uri_node.add("tt:Timeout", stream->timeout);
 
-				auto rtsp_url = util::generate_rtsp_url(*server_configs, stream_config_it->second.get<std::string>("Uri"));
-				response_node.put("trt:MediaUri.tt:Uri",
-					rtsp_url);
-				response_node.put("trt:MediaUri.tt:InvalidAfterConnect",
-					stream_config_it->second.get<std::string>("InvalidAfterConnect"));
-				response_node.put("trt:MediaUri.tt:InvalidAfterReboot",
-					stream_config_it->second.get<std::string>("InvalidAfterReboot"));
-				response_node.put("trt:MediaUri.tt:Timeout",
-					stream_config_it->second.get<std::string>("Timeout"));
+				pt::ptree response_node;
+				response_node.add_child("trt:MediaUri", media_uri_node);
 
 				auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
 				envelope_tree.put_child("s:Body.trt:GetStreamUriResponse", response_node);
@@ -451,6 +440,51 @@ namespace osrv
 			}
 		};
 
+		struct GetSnapshotUriHandler : public utility::http::RequestHandlerBase
+		{
+			GetSnapshotUriHandler() : utility::http::RequestHandlerBase(GetSnapshotUri,
+				osrv::auth::SECURITY_LEVELS::READ_MEDIA)
+			{
+			}
+
+			OVERLOAD_REQUEST_HANDLER
+			{
+				const auto state = STATE.load();
+
+				pt::ptree request_xml;
+				pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
+
+				const auto requested_token = exns::find_hierarchy("Envelope.Body.GetSnapshotUri.ProfileToken", request_xml);
+				logger_->Debug("Requested token to get snapshot URI: " + requested_token);
+
+				if (!server_configs->snapshots_enabled_)
+					throw std::runtime_error("The snapshots are disabled.");
+
+				if (state->profiles->profile_index(requested_token) == utility::media::NOT_FOUND)
+					throw std::runtime_error("The media profile does not exist.");
+
+				pt::ptree media_uri_node;
+				media_uri_node.add("tt:Uri", util::generate_snapshot_url(*server_configs, requested_token));
+				media_uri_node.add("tt:InvalidAfterConnect", false);
+				media_uri_node.add("tt:InvalidAfterReboot", false);
+				media_uri_node.add("tt:Timeout", "PT0S");
+
+				pt::ptree response_node;
+				response_node.add_child("trt:MediaUri", media_uri_node);
+
+				auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
+				envelope_tree.put_child("s:Body.trt:GetSnapshotUriResponse", response_node);
+
+				pt::ptree root_tree;
+				root_tree.put_child("s:Envelope", envelope_tree);
+
+				std::ostringstream os;
+				pt::write_xml(os, root_tree);
+
+				utility::http::fillResponseWithHeaders(*response, os.str());
+			}
+		};
+
 		//DEFAULT HANDLER
 		void MediaServiceHandler(std::shared_ptr<HttpServer::Response> response,
 			std::shared_ptr<HttpServer::Request> request)
@@ -479,6 +513,8 @@ namespace osrv
 		void do_handler_request(std::shared_ptr<HttpServer::Response> response,
 			std::shared_ptr<HttpServer::Request> request)
 		{
+			const auto start = std::chrono::steady_clock::now();
+
 			//extract requested method
 			std::string method;
 			auto content = request->content.string();
@@ -537,9 +573,14 @@ namespace osrv
 					}
 
 					(*handler_ptr)(response, request);
+					utility::metrics::record_request(handler_ptr->get_metrics_id(),
+						utility::metrics::Outcome::OK, std::chrono::steady_clock::now() - start);
 				}
 				catch (const osrv::auth::digest_failed& e)
 				{
+					utility::metrics::record_request((*handler_it)->get_metrics_id(),
+						utility::metrics::Outcome::AUTH_FAILED, std::chrono::steady_clock::now() - start);
+
 					logger_->Error(e.what());
 					
 					*response << utility::http::RESPONSE_UNAUTHORIZED << "\r\n"
@@ -550,6 +591,9 @@ namespace osrv
 				}
 				catch (const std::exception& e)
 				{
+					utility::metrics::record_request((*handler_it)->get_metrics_id(),
+						utility::metrics::Outcome::SERVER_ERROR, std::chrono::steady_clock::now() - start);
+
 					logger_->Error("A server's error occured in DeviceService while processing: " + method
 						+ ". Info: " + e.what());
 					
@@ -560,7 +604,34 @@ namespace osrv
 			{
 				logger_->Error("Not found an appropriate handler in DeviceService for: " + method);
 				*response << "HTTP/1.1 400 Bad request\r\nContent-Length: " << 0 << "\r\n\r\n";
+
+				utility::metrics::record_request(unknown_method_metrics_id,
+					utility::metrics::Outcome::CLIENT_ERROR, std::chrono::steady_clock::now() - start);
+			}
+		}
+
+		static utility::config::ConfigSnapshotSP read_configs()
+		{
+			auto configs = utility::config::ConfigSnapshot::read(configs_path_, MEDIA_SERVICE_CONFIGS_PATH);
+			configs->require({ GetVideoSources, GetStreamUri, "Namespaces" });
+			return configs;
+		}
+
+		static std::shared_ptr<const MediaState> make_state(utility::config::ConfigSnapshotSP configs,
+			const utility::config::ConfigSnapshotSP& profiles_configs)
+		{
+			auto state = std::make_shared<MediaState>();
+			state->configs = std::move(configs);
+			state->profiles = utility::media::MediaProfiles::instance(profiles_configs);
+
+			state->stream_uris = state->profiles->resolve_stream_uris(state->configs->get_child(GetStreamUri).tree());
+			for (auto& stream : state->stream_uris)
+			{
+				if (stream)
+					stream->uri = util::generate_rtsp_url(*server_configs, stream->uri);
 			}
+
+			return state;
 		}
 
 		void init_service(HttpServer& srv, const osrv::ServerConfigs& server_configs_ptr, const std::string& configs_path, ILogger& logger)
@@ -575,10 +646,18 @@ namespace osrv
 			server_configs = &server_configs_ptr;
 			digest_session = server_configs_ptr.digest_session_;
 
-            pt::read_json(configs_path + MEDIA_SERVICE_CONFIGS_PATH, CONFIGS_TREE);
-            pt::read_json(configs_path + PROFILES_CONFIGS_PATH, PROFILES_CONFIGS_TREE);
+			configs_path_ = configs_path;
+			PROFILES_STORE = utility::media::MediaProfiles::store(configs_path, logger);
+
+			const auto state = make_state(read_configs(), PROFILES_STORE->load());
+			STATE.store(state);
+
+			PROFILES_STORE->subscribe([](const utility::config::ConfigSnapshotSP& profiles_configs) {
+					std::lock_guard<std::mutex> lock(state_mutex);
+					STATE.store(make_state(STATE.load()->configs, profiles_configs));
+				});
 
-            auto namespaces_tree = CONFIGS_TREE.get_child("Namespaces");
+            const auto namespaces_tree = state->configs->get_child("Namespaces");
 			for (const auto& n : namespaces_tree)
 				XML_NAMESPACES.insert({ n.first, n.second.get_value<std::string>() });
 
@@ -593,134 +672,110 @@ namespace osrv
 			handlers.emplace_back(new GetVideoSourceConfigurationsHandler);
 			handlers.emplace_back(new GetVideoSourcesHandler);
 			handlers.emplace_back(new GetStreamUriHandler);
+			handlers.emplace_back(new GetSnapshotUriHandler);
+
+			for (auto& handler : handlers)
+				handler->set_metrics_id(utility::metrics::register_method("media", handler->get_name()));
+			unknown_method_metrics_id = utility::metrics::register_method("media", "unknown");
 
             srv.resource["/onvif/media_service"]["POST"] = MediaServiceHandler;
         }
+
+		void watch_configs(utility::config::ConfigWatcher& watcher)
+		{
+			watcher.watch(MEDIA_SERVICE_CONFIGS_PATH, []() {
+					auto configs = read_configs();
+					std::lock_guard<std::mutex> lock(state_mutex);
+					STATE.store(make_state(std::move(configs), PROFILES_STORE->load()));
+				});
+			PROFILES_STORE->watch(watcher);
+		}
     }
 }
 
-void fill_soap_media_profile(const pt::ptree& json_config, pt::ptree& profile_node,
-	const std::string& root_node_value)
+void fill_soap_media_profile(const utility::media::MediaProfiles& profiles, const utility::media::Profile& profile,
+	pt::ptree& profile_node)
 {
-	profile_node.put(root_node_value + ".<xmlattr>.token", json_config.get<std::string>("token"));
-	profile_node.put(root_node_value + ".<xmlattr>.fixed", json_config.get<std::string>("fixed"));
-	profile_node.put(root_node_value + ".tt:Name", json_config.get<std::string>("Name"));
+	profile_node.add("<xmlattr>.token", profile.token);
+	profile_node.add("<xmlattr>.fixed", profile.fixed);
+	profile_node.add("tt:Name", profile.name);
 
 	//Videosource
 	{
-		const std::string vs_token = json_config.get<std::string>("VideoSourceConfiguration");
-		auto vs_configs_list = PROFILES_CONFIGS_TREE.get_child("VideoSourceConfigurations");
-		auto vs_config = std::find_if(vs_configs_list.begin(), vs_configs_list.end(),
-			[vs_token](pt::ptree::value_type vs_obj)
-			{
-				return vs_obj.second.get<std::string>("token") == vs_token;
-			});
-
-		if (vs_config == vs_configs_list.end())
-			throw std::runtime_error("Can't find VideoSourceConfiguration with token '" + vs_token + "'");
-
 		pt::ptree videosource_configuration;
-		osrv::media::util::fill_soap_videosource_configuration(vs_config->second, videosource_configuration);
-		profile_node.put_child(root_node_value + ".tt:VideoSourceConfiguration", videosource_configuration);
+		osrv::media::util::fill_soap_videosource_configuration(profiles.video_source_of(profile),
+			videosource_configuration);
+		profile_node.add_child("tt:VideoSourceConfiguration", videosource_configuration);
 	}
 
 	//VideoEncoder
 	{
-		auto ve_configs_list = PROFILES_CONFIGS_TREE.get_child("VideoEncoderConfigurations");
-		std::string ve_token = json_config.get<std::string>("VideoEncoderConfiguration");
-		auto ve_config = std::find_if(ve_configs_list.begin(), ve_configs_list.end(),
-			[ve_token](pt::ptree::value_type ve_obj)
-			{
-				return ve_obj.second.get<std::string>("token") == ve_token;
-			});
-
-		if (ve_config == ve_configs_list.end())
-			throw std::runtime_error("Can't find VideoEncoderConfiguration with token '" + ve_token + "'");
-
-		profile_node.put(root_node_value + ".tt:VideoEncoderConfiguration.<xmlattr>.token",
-			ve_config->second.get<std::string>("token"));
-		profile_node.put(root_node_value + ".tt:VideoEncoderConfiguration.tt:Name",
-			ve_config->second.get<std::string>("Name"));
-		profile_node.put(root_node_value + ".tt:VideoEncoderConfiguration.tt:UseCount",
-			ve_config->second.get<std::string>("UseCount"));
-		profile_node.put(root_node_value + ".tt:VideoEncoderConfiguration.tt:Encoding",
-			ve_config->second.get<std::string>("Encoding"));
-		profile_node.put(root_node_value + ".tt:VideoEncoderConfiguration.tt:Resolution.tt:Width",
-			ve_config->second.get<std::string>("Resolution.Width"));
-		profile_node.put(root_node_value + ".tt:VideoEncoderConfiguration.tt:Resolution.tt:Height",
-			ve_config->second.get<std::string>("Resolution.Height"));
-		profile_node.put(root_node_value + ".tt:VideoEncoderConfiguration.tt:Quality",
-			ve_config->second.get<std::string>("Quality"));
+		const auto& ve_config = profiles.video_encoder_of(profile);
+
+		pt::ptree ve_node;
+		ve_node.add("<xmlattr>.token", ve_config.token);
+		ve_node.add("tt:Name", ve_config.name);
+		ve_node.add("tt:UseCount", ve_config.use_count);
+		ve_node.add("tt:Encoding", ve_config.encoding);
+		ve_node.add("tt:Resolution.tt:Width", ve_config.resolution.width);
+		ve_node.add("tt:Resolution.tt:Height", ve_config.resolution.height);
+		ve_node.add("tt:Quality", ve_config.quality);
 
 		//ratecontrol is optional
-		auto ratecontrol_config_it = ve_config->second.find("RateControl");
-		if (ratecontrol_config_it != ve_config->second.not_found())
+		if (const auto& rc = ve_config.rate_control)
 		{
-			profile_node.put(root_node_value + ".tt:VideoEncoderConfiguration.tt:RateControl.<xmlattr>.GuaranteedFrameRate",
-				ratecontrol_config_it->second.get<std::string>("GuaranteedFrameRate"));
-			profile_node.put(root_node_value + ".tt:VideoEncoderConfiguration.tt:RateControl.tt:FrameRateLimit",
-				ratecontrol_config_it->second.get<std::string>("FrameRateLimit"));
-			profile_node.put(root_node_value + ".tt:VideoEncoderConfiguration.tt:RateControl.tt:EncodingInterval",
-				ratecontrol_config_it->second.get<std::string>("EncodingInterval"));
-			profile_node.put(root_node_value + ".tt:VideoEncoderConfiguration.tt:RateControl.tt:BitrateLimit",
-				ratecontrol_config_it->second.get<std::string>("BitrateLimit"));
+			pt::ptree rc_node;
+			rc_node.add("<xmlattr>.GuaranteedFrameRate", rc->guaranteed_frame_rate);
+			rc_node.add("tt:FrameRateLimit", rc->frame_rate_limit);
+			rc_node.add("tt:EncodingInterval", rc->encoding_interval);
+			rc_node.add("tt:BitrateLimit", rc->bitrate_limit);
+			ve_node.add_child("tt:RateControl", rc_node);
 		}
 
-		const auto& codec = ve_config->second.get<std::string>("Encoding");
-		if ("H264" == codec)
+		if ("H264" == ve_config.encoding)
 		{
 			//codecs info is optional
-			auto h264_config_it = ve_config->second.find("H264");
-			if (h264_config_it != ve_config->second.not_found())
+			if (const auto& h264 = ve_config.h264)
 			{
-				profile_node.put(root_node_value + ".tt:VideoEncoderConfiguration.tt:H264.tt:GovLength",
-					h264_config_it->second.get<std::string>("GovLength"));
-				profile_node.put(root_node_value + ".tt:VideoEncoderConfiguration.tt:H264.tt:H264Profile",
-					h264_config_it->second.get<std::string>("H264Profile"));
+				ve_node.add("tt:H264.tt:GovLength", h264->gov_length);
+				ve_node.add("tt:H264.tt:H264Profile", h264->profile);
 			}
 		}
-		else if ("MPEG4" == codec)
+		else if ("MPEG4" == ve_config.encoding)
 		{
 			//TODO
 		}
 
 		//Multicast
-		profile_node.put(root_node_value + ".tt:VideoEncoderConfiguration.tt:Multicast.tt:Address.tt:Type",
-			ve_config->second.get<std::string>("Multicast.Address.Type"));
-		profile_node.put(root_node_value + ".tt:VideoEncoderConfiguration.tt:Multicast.tt:Address.tt:IPv4Address",
-			ve_config->second.get<std::string>("Multicast.Address.IPv4Address"));
-		profile_node.put(root_node_value + ".tt:VideoEncoderConfiguration.tt:Multicast.tt:Port",
-			ve_config->second.get<std::string>("Multicast.Port"));
-		profile_node.put(root_node_value + ".tt:VideoEncoderConfiguration.tt:Multicast.tt:TTL",
-			ve_config->second.get<std::string>("Multicast.TTL"));
-		profile_node.put(root_node_value + ".tt:VideoEncoderConfiguration.tt:Multicast.tt:AutoStart",
-			ve_config->second.get<std::string>("Multicast.AutoStart"));
-
-		profile_node.put(root_node_value + ".tt:VideoEncoderConfiguration.tt:SessionTimeout",
-			ve_config->second.get<std::string>("SessionTimeout"));
+		if (const auto& multicast = ve_config.multicast)
+		{
+			pt::ptree multicast_node;
+			multicast_node.add("tt:Address.tt:Type", multicast->address_type);
+			multicast_node.add("tt:Address.tt:IPv4Address", multicast->ipv4_address);
+			multicast_node.add("tt:Port", multicast->port);
+			multicast_node.add("tt:TTL", multicast->ttl);
+			multicast_node.add("tt:AutoStart", multicast->auto_start);
+			ve_node.add_child("tt:Multicast", multicast_node);
+		}
+
+		ve_node.add("tt:SessionTimeout", ve_config.session_timeout);
+
+		profile_node.add_child("tt:VideoEncoderConfiguration", ve_node);
 	}
 }
 
-void osrv::media::util::fill_soap_videosource_configuration(const pt::ptree& config_node, pt::ptree& videosource_node)
+void osrv::media::util::fill_soap_videosource_configuration(const utility::media::VideoSourceConfiguration& config,
+	pt::ptree& videosource_node)
 {
-	videosource_node.put("<xmlattr>.token",
-		config_node.get<std::string>("token"));
-	videosource_node.put("tt:Name",
-		config_node.get<std::string>("Name"));
-	videosource_node.put("tt:UseCount",
-		config_node.get<std::string>("UseCount"));
-	videosource_node.put("<xmlattr>.ViewMode",
-		config_node.get<std::string>("ViewMode"));
-	videosource_node.put("tt:SourceToken",
-		config_node.get<std::string>("SourceToken"));
-	videosource_node.put("tt:Bounds.<xmlattr>.x",
-		config_node.get<std::string>("Bounds.x"));
-	videosource_node.put("tt:Bounds.<xmlattr>.y",
-		config_node.get<std::string>("Bounds.y"));
-	videosource_node.put("tt:Bounds.<xmlattr>.width",
-		config_node.get<std::string>("Bounds.width"));
-	videosource_node.put("tt:Bounds.<xmlattr>.height",
-		config_node.get<std::string>("Bounds.height"));
+	videosource_node.add("<xmlattr>.token", config.token);
+	videosource_node.add("<xmlattr>.ViewMode", config.view_mode);
+	videosource_node.add("tt:Name", config.name);
+	videosource_node.add("tt:UseCount", config.use_count);
+	videosource_node.add("tt:SourceToken", config.source_token);
+	videosource_node.add("tt:Bounds.<xmlattr>.x", config.bounds.x);
+	videosource_node.add("tt:Bounds.<xmlattr>.y", config.bounds.y);
+	videosource_node.add("tt:Bounds.<xmlattr>.width", config.bounds.width);
+	videosource_node.add("tt:Bounds.<xmlattr>.height", config.bounds.height);
 }
 
 void osrv::media::util::fill_analytics_configuration(pt::ptree& result)
@@ -742,3 +797,14 @@ std::string osrv::media::util::generate_rtsp_url(const ServerConfigs& server_con
 
 	return rtsp_url.str();
 }
+
+std::string osrv::media::util::generate_snapshot_url(const ServerConfigs& server_configs, const std::string& profile_token)
+{
+	std::stringstream snapshot_url;
+	snapshot_url << "http://" << server_configs.ipv4_address_ << ":"
+		<< (server_configs.enabled_http_port_forwarding ? std::to_string(server_configs.forwarded_http_port)
+			: server_configs.http_port_)
+		<< server_configs.snapshots_path_ << "/" << profile_token;
+
+	return snapshot_url.str();
+}
@@ -6,6 +6,16 @@
 
 class ILogger;
 
+namespace utility::media
+{
+	struct VideoSourceConfiguration;
+}
+
+namespace utility::config
+{
+	class ConfigWatcher;
+}
+
 namespace osrv
 {
 	struct ServerConfigs;
@@ -15,14 +25,21 @@ namespace osrv
 		void init_service(HttpServer& /*srv*/, const osrv::ServerConfigs& /*configs*/,
 			const std::string& /*configs_path*/, ILogger& /*logger*/);
 
+		// the changed configs and profiles are used by the next requests
+		void watch_configs(utility::config::ConfigWatcher& /*watcher*/);
+
 		namespace util
 		{
 			namespace pt = boost::property_tree;
-			void fill_soap_videosource_configuration(const pt::ptree& config_node, pt::ptree& videosource_node);
+			void fill_soap_videosource_configuration(const utility::media::VideoSourceConfiguration& config,
+				pt::ptree& videosource_node);
 
 			void fill_analytics_configuration(/*const pt::ptree& config_node,*/ pt::ptree& result);
 
 			std::string generate_rtsp_url(const ServerConfigs& /*server_configs*/, const std::string& /*profile_stream_url*/);
+
+			// the HTTP URL of the profile's JPEG snapshot
+			std::string generate_snapshot_url(const ServerConfigs& /*server_configs*/, const std::string& /*profile_token*/);
 		}
 	}
 }
\ No newline at end of file
@@ -5,12 +5,22 @@
 
 #include "../utility/HttpHelper.h"
 #include "../utility/SoapHelper.h"
+#include "../utility/ConfigSnapshot.h"
+#include "../utility/ConfigStore.h"
+#include "../utility/ConfigWatcher.h"
+#include "../utility/DateTime.hpp"
+#include "../utility/MediaProfiles.h"
+#include "../utility/PtzMotion.h"
+#include "../utility/PtzPresets.h"
+#include "../utility/PtzTours.h"
 #include "../utility/XmlParser.h"
 
 #include <boost/property_tree/xml_parser.hpp>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
 
+#include <iomanip>
+
 static ILogger* logger_ = nullptr;
 static osrv::ServerConfigs* server_configs;
 static DigestSessionSP digest_session;
@@ -18,9 +28,21 @@ static DigestSessionSP digest_session;
 static std::string CONFIGS_PATH; //will be init with the service initialization
 
 namespace pt = boost::property_tree;
-static pt::ptree CONFIGS_TREE;
+// the PTZ configurations are changed by SetConfiguration
+static utility::config::ConfigStoreSP CONFIGS;
+// a profile's PTZConfiguration selects the configuration, which is moved by the requests with the profile's token
+static utility::config::ConfigStoreSP PROFILES_STORE;
 static osrv::StringsMap XML_NAMESPACES;
 
+// the simulated heads by the nodes' tokens, they're created by the first request to a node
+// and keep their positions while the server is running
+static std::mutex heads_mutex;
+static std::unordered_map<std::string, std::shared_ptr<utility::ptz::Head>> heads;
+
+// the tours of all the nodes are driven by one timer of the io_context, which waits for the earliest step
+static std::unique_ptr<utility::ptz::TourScheduler> tours;
+static std::shared_ptr<utility::ptz::TourTimer> tours_timer;
+
 // a list of implemented methods
 const std::string GetCompatibleConfigurations = "GetCompatibleConfigurations";
 const std::string GetConfiguration = "GetConfiguration";
@@ -28,9 +50,22 @@ const std::string GetConfigurations = "GetConfigurations";
 const std::string GetNodes = "GetNodes";
 const std::string GetNode = "GetNode";
 const std::string SetConfiguration = "SetConfiguration";
+const std::string ContinuousMove = "ContinuousMove";
+const std::string AbsoluteMove = "AbsoluteMove";
+const std::string RelativeMove = "RelativeMove";
+const std::string Stop = "Stop";
+const std::string GetStatus = "GetStatus";
+const std::string SetPreset = "SetPreset";
+const std::string GetPresets = "GetPresets";
+const std::string GotoPreset = "GotoPreset";
+const std::string RemovePreset = "RemovePreset";
+const std::string GetPresetTours = "GetPresetTours";
+const std::string GetPresetTour = "GetPresetTour";
+const std::string OperatePresetTour = "OperatePresetTour";
 
 
 static std::vector<utility::http::HandlerSP> handlers;
+static utility::metrics::method_id_t unknown_method_metrics_id = utility::metrics::MAX_METHODS;
 
 namespace osrv::ptz
 {
@@ -39,6 +74,236 @@ namespace osrv::ptz
 	void do_handle_request(std::shared_ptr<HttpServer::Response> response,
 		std::shared_ptr<HttpServer::Request> request);
 
+	// an item of "Configurations" to tt:PTZConfiguration
+	static pt::ptree configuration_to_soap(const pt::ptree& configuration)
+	{
+		pt::ptree ptz_node;
+		ptz_node.add("<xmlattr>.token", configuration.get<std::string>("token"));
+		ptz_node.add("tt:Name", configuration.get<std::string>("Name"));
+		ptz_node.add("tt:UseCount", configuration.get<int>("UseCount"));
+		ptz_node.add("tt:NodeToken", configuration.get<std::string>("NodeToken"));
+		if (auto space = configuration.get_optional<std::string>("DefaultContinuousPanTiltVelocitySpace"))
+			ptz_node.add("tt:DefaultContinuousPanTiltVelocitySpace", *space);
+		if (auto space = configuration.get_optional<std::string>("DefaultContinuousZoomVelocitySpace"))
+			ptz_node.add("tt:DefaultContinuousZoomVelocitySpace", *space);
+		if (auto timeout = configuration.get_optional<std::string>("DefaultPTZTimeout"))
+			ptz_node.add("tt:DefaultPTZTimeout", *timeout);
+
+		return ptz_node;
+	}
+
+	// an item of "SupportedPTZSpaces" to tt:Space1DDescription or tt:Space2DDescription, the zoom's spaces have no YRange
+	static pt::ptree space_to_soap(const pt::ptree& space)
+	{
+		pt::ptree space_node;
+		space_node.add("tt:URI", space.get<std::string>("URI"));
+		space_node.add("tt:XRange.tt:Min", space.get<std::string>("XRange.Min"));
+		space_node.add("tt:XRange.tt:Max", space.get<std::string>("XRange.Max"));
+		if (const auto y_range = space.get_child_optional("YRange"))
+		{
+			space_node.add("tt:YRange.tt:Min", y_range->get<std::string>("Min"));
+			space_node.add("tt:YRange.tt:Max", y_range->get<std::string>("Max"));
+		}
+
+		return space_node;
+	}
+
+	// the head of the node, the node's spaces or speeds may be changed by the reloading of ptz.config
+	static std::shared_ptr<utility::ptz::Head> head_of(const pt::ptree& configs, const std::string& node_token)
+	{
+		const auto limits = utility::ptz::read_limits(utility::config::find_item(configs, "Nodes", "token", node_token));
+
+		std::lock_guard<std::mutex> lock(heads_mutex);
+		auto& head = heads[node_token];
+		if (!head)
+			head = std::make_shared<utility::ptz::Head>(limits);
+		else if (head->limits() != limits)
+			head->set_limits(limits);
+
+		return head;
+	}
+
+	// the configuration moved by a profile and the head of its node
+	struct Target
+	{
+		pt::ptree configuration;
+		std::string node_token;
+		std::shared_ptr<utility::ptz::Head> head;
+	};
+
+	static Target find_target(const std::string& profile_token)
+	{
+		const auto profiles = utility::media::MediaProfiles::instance(PROFILES_STORE->load());
+		const auto* profile = profiles->find_profile(profile_token);
+		if (profile == nullptr)
+			throw std::runtime_error("Client error: the media profile is not found: " + profile_token);
+
+		const auto configs = CONFIGS->load();
+
+		Target result;
+		// a profile without its own configuration uses the first one, as media2 reports it for all the profiles
+		if (profile->ptz_configuration_token.empty())
+		{
+			const auto& configurations = configs->tree().get_child("Configurations");
+			if (configurations.empty())
+				throw std::runtime_error("There are no PTZ configurations");
+			result.configuration = configurations.front().second;
+		}
+		else
+		{
+			result.configuration = utility::config::find_item(configs->tree(), "Configurations", "token",
+				profile->ptz_configuration_token);
+		}
+
+		result.node_token = result.configuration.get<std::string>("NodeToken");
+		result.head = head_of(configs->tree(), result.node_token);
+		return result;
+	}
+
+	// the presets of the target's node, throws if the node has no item in "NodePresets"
+	static const utility::ptz::NodePresets& presets_of(const utility::ptz::Presets& presets, const Target& target)
+	{
+		const auto* node = presets.find_node(target.node_token);
+		if (node == nullptr)
+			throw std::runtime_error("The PTZ node has no presets in NodePresets: " + target.node_token);
+
+		return *node;
+	}
+
+	// a command of the operator stops the tours of the head
+	static void stop_tours(const std::string& node_token)
+	{
+		tours->stop_node(node_token);
+		tours_timer->schedule();
+	}
+
+	// moves the head to the spot of a tour
+	static std::optional<utility::ptz::Clock::time_point> move_to_spot(const std::string& node_token,
+		const utility::ptz::TourSpot& spot, utility::ptz::Clock::time_point now)
+	{
+		try
+		{
+			const auto configs = CONFIGS->load();
+			const auto* node = utility::ptz::Presets::instance(configs)->find_node(node_token);
+			const auto* preset = node != nullptr ? node->find_preset(spot.preset_token) : nullptr;
+			if (preset == nullptr)
+				return std::nullopt;
+
+			const auto head = head_of(configs->tree(), node_token);
+			head->absolute_move(preset->position, { spot.speed, spot.speed, spot.speed }, now);
+			return head->idle_at(now);
+		}
+		catch (const std::exception& e)
+		{
+			logger_->Error("Could not move to the preset " + spot.preset_token + " of the tour: " + e.what());
+			return std::nullopt;
+		}
+	}
+
+	static std::string tour_state_to_string(utility::ptz::TourState state)
+	{
+		switch (state)
+		{
+		case utility::ptz::TourState::TOURING:
+			return "Touring";
+		case utility::ptz::TourState::PAUSED:
+			return "Paused";
+		default:
+			return "Idle";
+		}
+	}
+
+	// xs:duration in seconds, e.g. "PT2.5S"
+	static std::string to_duration(std::chrono::milliseconds duration)
+	{
+		std::ostringstream os;
+		os << "PT" << duration.count() / 1000;
+		if (const auto milliseconds = duration.count() % 1000)
+			os << '.' << std::setw(3) << std::setfill('0') << milliseconds;
+		os << 'S';
+
+		return os.str();
+	}
+
+	static void fill_position(const utility::ptz::Vector& position, pt::ptree& position_node)
+	{
+		position_node.add("tt:PanTilt.<xmlattr>.x", position.pan);
+		position_node.add("tt:PanTilt.<xmlattr>.y", position.tilt);
+		position_node.add("tt:PanTilt.<xmlattr>.space",
+			"http://www.onvif.org/ver10/tptz/PanTiltSpaces/PositionGenericSpace");
+		position_node.add("tt:Zoom.<xmlattr>.x", position.zoom);
+		position_node.add("tt:Zoom.<xmlattr>.space",
+			"http://www.onvif.org/ver10/tptz/ZoomSpaces/PositionGenericSpace");
+	}
+
+	// a tour to tt:PresetTour
+	static pt::ptree tour_to_soap(const utility::ptz::PresetTour& tour, utility::ptz::TourState state)
+	{
+		pt::ptree tour_node;
+		tour_node.add("<xmlattr>.token", tour.token);
+		tour_node.add("tt:Name", tour.name);
+		tour_node.add("tt:Status.tt:State", tour_state_to_string(state));
+		tour_node.add("tt:AutoStart", tour.auto_start);
+		tour_node.add("tt:StartingCondition.<xmlattr>.RandomPresetOrder", false);
+		if (tour.recurring_time != 0)
+			tour_node.add("tt:StartingCondition.tt:RecurringTime", tour.recurring_time);
+		tour_node.add("tt:StartingCondition.tt:Direction", "Forward");
+
+		for (const auto& spot : tour.spots)
+		{
+			pt::ptree spot_node;
+			spot_node.add("tt:PresetDetail.tt:PresetToken", spot.preset_token);
+			if (spot.speed > 0)
+			{
+				spot_node.add("tt:Speed.tt:PanTilt.<xmlattr>.x", spot.speed);
+				spot_node.add("tt:Speed.tt:PanTilt.<xmlattr>.y", spot.speed);
+				spot_node.add("tt:Speed.tt:Zoom.<xmlattr>.x", spot.speed);
+			}
+			spot_node.add("tt:StayTime", to_duration(spot.stay_time));
+
+			tour_node.add_child("tt:TourSpot", spot_node);
+		}
+
+		return tour_node;
+	}
+
+	// the PanTilt and the Zoom of tt:PTZVector or tt:PTZSpeed, the missing ones are taken from @defaults
+	static utility::ptz::Vector read_vector(const std::string& path, const pt::ptree& request_xml,
+		const utility::ptz::Vector& defaults = {})
+	{
+		auto result = defaults;
+		if (const auto* pan_tilt = exns::find_path(path + ".PanTilt", request_xml))
+		{
+			result.pan = pan_tilt->get<float>("<xmlattr>.x");
+			result.tilt = pan_tilt->get<float>("<xmlattr>.y");
+		}
+		if (const auto* zoom = exns::find_path(path + ".Zoom", request_xml))
+			result.zoom = zoom->get<float>("<xmlattr>.x");
+
+		return result;
+	}
+
+	static std::string move_status_to_string(utility::ptz::MoveStatus status)
+	{
+		return status == utility::ptz::MoveStatus::MOVING ? "MOVING" : "IDLE";
+	}
+
+	// writes an empty response of a move's method
+	static void fill_empty_response(HttpServer::Response& response, const std::string& method)
+	{
+		auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
+
+		envelope_tree.add("s:Body.tptz:" + method + "Response", "");
+
+		pt::ptree root_tree;
+		root_tree.put_child("s:Envelope", envelope_tree);
+
+		std::ostringstream os;
+		pt::write_xml(os, root_tree);
+
+		utility::http::fillResponseWithHeaders(response, os.str());
+	}
+
 	struct GetCompatibleConfigurationsHandler : public utility::http::RequestHandlerBase
 	{
 
@@ -48,24 +313,13 @@ namespace osrv::ptz
 
 		OVERLOAD_REQUEST_HANDLER
 		{
-			auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
+			const auto configs = CONFIGS->load();
 
-			// TODO: impl. reading configs from a file
 			pt::ptree response_node;
+			for (const auto& configuration : configs->get_child("Configurations"))
+				response_node.add_child("PTZConfiguration", configuration_to_soap(configuration.second.tree()));
 
-			{
-				pt::ptree ptz_node;
-				ptz_node.add("<xmlattr>.token", "PtzConfigToken0");
-				ptz_node.add("tt:Name", "PtzConfig0");
-				ptz_node.add("tt:UseCount", 3);
-				ptz_node.add("tt:NodeToken", "PTZNODE_1");
-				ptz_node.add("tt:DefaultContinuousPanTiltVelocitySpace",
-					"http://www.onvif.org/ver10/tptz/PanTiltSpaces/VelocityGenericSpace");
-				ptz_node.add("tt:DefaultContinuousZoomVelocitySpace",
-					"http://www.onvif.org/ver10/tptz/ZoomSpaces/VelocityGenericSpace");
-
-				response_node.add_child("PTZConfiguration", ptz_node);
-			}
+			auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
 
 			envelope_tree.add_child("s:Body.tptz:GetCompatibleConfigurationsResponse", response_node);
 
@@ -88,24 +342,17 @@ namespace osrv::ptz
 
 		OVERLOAD_REQUEST_HANDLER
 		{
-			auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
+			pt::ptree request_xml;
+			pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
+			const auto token = exns::find_hierarchy("Envelope.Body.GetConfiguration.PTZConfigurationToken", request_xml);
+
+			const auto configs = CONFIGS->load();
+			const auto& configuration = utility::config::find_item(configs->tree(), "Configurations", "token", token);
 
-			// TODO: impl. reading configs from a file
 			pt::ptree response_node;
+			response_node.add_child("PTZConfiguration", configuration_to_soap(configuration));
 
-			{
-				pt::ptree ptz_node;
-				ptz_node.add("<xmlattr>.token", "PtzConfigToken0");
-				ptz_node.add("tt:Name", "PtzConfig0");
-				ptz_node.add("tt:UseCount", 3);
-				ptz_node.add("tt:NodeToken", "PTZNODE_1");
-				ptz_node.add("tt:DefaultContinuousPanTiltVelocitySpace",
-					"http://www.onvif.org/ver10/tptz/PanTiltSpaces/VelocityGenericSpace");
-				ptz_node.add("tt:DefaultContinuousZoomVelocitySpace",
-					"http://www.onvif.org/ver10/tptz/ZoomSpaces/VelocityGenericSpace");
-
-				response_node.add_child("PTZConfiguration", ptz_node);
-			}
+			auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
 
 			envelope_tree.add_child("s:Body.tptz:GetConfigurationResponse", response_node);
 
@@ -128,24 +375,13 @@ namespace osrv::ptz
 
 		OVERLOAD_REQUEST_HANDLER
 		{
-			auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
+			const auto configs = CONFIGS->load();
 
-			// TODO: impl. reading configs from a file
 			pt::ptree response_node;
+			for (const auto& configuration : configs->get_child("Configurations"))
+				response_node.add_child("PTZConfiguration", configuration_to_soap(configuration.second.tree()));
 
-			{
-				pt::ptree ptz_node;
-				ptz_node.add("<xmlattr>.token", "PtzConfigToken0");
-				ptz_node.add("tt:Name", "PtzConfig0");
-				ptz_node.add("tt:UseCount", 3);
-				ptz_node.add("tt:NodeToken", "PTZNODE_1");
-				ptz_node.add("tt:DefaultContinuousPanTiltVelocitySpace",
-					"http://www.onvif.org/ver10/tptz/PanTiltSpaces/VelocityGenericSpace");
-				ptz_node.add("tt:DefaultContinuousZoomVelocitySpace",
-					"http://www.onvif.org/ver10/tptz/ZoomSpaces/VelocityGenericSpace");
-
-				response_node.add_child("PTZConfiguration", ptz_node);
-			}
+			auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
 
 			envelope_tree.add_child("s:Body.tptz:GetConfigurationsResponse", response_node);
 
@@ -168,33 +404,18 @@ namespace osrv::ptz
 
 		OVERLOAD_REQUEST_HANDLER
 		{
+			const auto configs = CONFIGS->load();
+
 			auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
 
 			pt::ptree nodes_tree;
 
-			auto nodes_config = CONFIGS_TREE.get_child("Nodes");
+			const auto nodes_config = configs->get_child("Nodes");
 
 			for (const auto& node : nodes_config)
 			{
 				pt::ptree node_tree;
-				node_tree.add("<xmlattr>.token", node.second.get<std::string>("token"));
-				node_tree.add("<xmlattr>.FixedHomePosition", node.second.get<bool>("FixedHomePosition"));
-				node_tree.add("<xmlattr>.GeoMove", node.second.get<bool>("GeoMove"));
-				node_tree.add("tt:Name", node.second.get<std::string>("Name"));
-
-				for (const auto& space_node : node.second.get_child("SupportedPTZSpaces"))
-				{
-					const auto& space_name = space_node.second.get<std::string>("space");
-					const auto item_path = "tt:SupportedPTZSpaces." + space_name;
-					node_tree.add(item_path + "URI", space_node.second.get<std::string>("URI"));
-					node_tree.add(item_path + "XRange.Min", space_node.second.get<std::string>("XRange.Min"));
-					node_tree.add(item_path + "XRange.Max", space_node.second.get<std::string>("XRange.Max"));
-					node_tree.add(item_path + "YRange.Min", space_node.second.get<std::string>("YRange.Min"));
-					node_tree.add(item_path + "YRange.Max", space_node.second.get<std::string>("YRange.Max"));
-				}
-
-				node_tree.add("tt:MaximumNumberOfPresets", node.second.get<int>("MaximumNumberOfPresets"));
-				node_tree.add("tt:HomeSupported", node.second.get<bool>("HomeSupported"));
+				util::node_to_soap(node.second, node_tree);
 
 				nodes_tree.add_child("tptz:PTZNode", node_tree);
 			}
@@ -220,34 +441,19 @@ namespace osrv::ptz
 
 		OVERLOAD_REQUEST_HANDLER
 		{
+			const auto configs = CONFIGS->load();
+
 			auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
 
 			pt::ptree nodes_tree;
 
-			auto nodes_config = CONFIGS_TREE.get_child("Nodes");
+			const auto nodes_config = configs->get_child("Nodes");
 
 			// TODO: read only configs for required token
 			for (const auto& node : nodes_config)
 			{
 				pt::ptree node_tree;
-				node_tree.add("<xmlattr>.token", node.second.get<std::string>("token"));
-				node_tree.add("<xmlattr>.FixedHomePosition", node.second.get<bool>("FixedHomePosition"));
-				node_tree.add("<xmlattr>.GeoMove", node.second.get<bool>("GeoMove"));
-				node_tree.add("tt:Name", node.second.get<std::string>("Name"));
-
-				for (const auto& space_node : node.second.get_child("SupportedPTZSpaces"))
-				{
-					const auto& space_name = space_node.second.get<std::string>("space");
-					const auto item_path = "tt:SupportedPTZSpaces." + space_name;
-					node_tree.add(item_path + "URI", space_node.second.get<std::string>("URI"));
-					node_tree.add(item_path + "XRange.Min", space_node.second.get<std::string>("XRange.Min"));
-					node_tree.add(item_path + "XRange.Max", space_node.second.get<std::string>("XRange.Max"));
-					node_tree.add(item_path + "YRange.Min", space_node.second.get<std::string>("YRange.Min"));
-					node_tree.add(item_path + "YRange.Max", space_node.second.get<std::string>("YRange.Max"));
-				}
-
-				node_tree.add("tt:MaximumNumberOfPresets", node.second.get<int>("MaximumNumberOfPresets"));
-				node_tree.add("tt:HomeSupported", node.second.get<bool>("HomeSupported"));
+				util::node_to_soap(node.second, node_tree);
 
 				nodes_tree.add_child("tptz:PTZNode", node_tree);
 			}
@@ -273,6 +479,28 @@ namespace osrv::ptz
 
 		OVERLOAD_REQUEST_HANDLER
 		{
+			pt::ptree request_xml;
+			pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
+
+			auto ptz_configuration = exns::find_path("Envelope.Body.SetConfiguration.PTZConfiguration", request_xml);
+			if (ptz_configuration == nullptr)
+				throw std::runtime_error("Client error: the request has no PTZConfiguration");
+			const auto token = ptz_configuration->get<std::string>("<xmlattr>.token");
+
+			// the fields, which are absent in the request, keep their values
+			CONFIGS->commit("Configurations", "token", token,
+				[&ptz_configuration](pt::ptree& configuration)
+				{
+					exns::copy_value<std::string>("Name", *ptz_configuration, configuration, "Name");
+					exns::copy_value<int>("UseCount", *ptz_configuration, configuration, "UseCount");
+					exns::copy_value<std::string>("NodeToken", *ptz_configuration, configuration, "NodeToken");
+					exns::copy_value<std::string>("DefaultContinuousPanTiltVelocitySpace", *ptz_configuration, configuration,
+						"DefaultContinuousPanTiltVelocitySpace");
+					exns::copy_value<std::string>("DefaultContinuousZoomVelocitySpace", *ptz_configuration, configuration,
+						"DefaultContinuousZoomVelocitySpace");
+					exns::copy_value<std::string>("DefaultPTZTimeout", *ptz_configuration, configuration, "DefaultPTZTimeout");
+				});
+
 			auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
 
 			envelope_tree.add("s:Body.tptz:SetConfigurationResponse", "");
@@ -288,6 +516,427 @@ namespace osrv::ptz
 	};
 
 
+	struct ContinuousMoveHandler : public utility::http::RequestHandlerBase
+	{
+
+		ContinuousMoveHandler() : utility::http::RequestHandlerBase(ContinuousMove, osrv::auth::SECURITY_LEVELS::ACTUATE)
+		{
+		}
+
+		OVERLOAD_REQUEST_HANDLER
+		{
+			pt::ptree request_xml;
+			pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
+			const auto target = find_target(exns::find_hierarchy("Envelope.Body.ContinuousMove.ProfileToken", request_xml));
+			stop_tours(target.node_token);
+
+			const auto velocity = read_vector("Envelope.Body.ContinuousMove.Velocity", request_xml);
+
+			// without a timeout in the request and in the configuration the head moves until the next command
+			auto timeout = target.configuration.get<std::string>("DefaultPTZTimeout", "");
+			if (const auto* timeout_node = exns::find_path("Envelope.Body.ContinuousMove.Timeout", request_xml))
+				timeout = timeout_node->get_value<std::string>();
+
+			std::chrono::milliseconds duration = std::chrono::milliseconds::zero();
+			if (!timeout.empty())
+			{
+				const auto parsed = utility::datetime::parse_duration(timeout);
+				if (!parsed)
+					throw std::runtime_error("Client error: the timeout is not a duration: " + timeout);
+				duration = *parsed;
+			}
+
+			target.head->continuous_move(velocity, duration);
+
+			fill_empty_response(*response, ContinuousMove);
+		}
+	};
+
+	struct AbsoluteMoveHandler : public utility::http::RequestHandlerBase
+	{
+
+		AbsoluteMoveHandler() : utility::http::RequestHandlerBase(AbsoluteMove, osrv::auth::SECURITY_LEVELS::ACTUATE)
+		{
+		}
+
+		OVERLOAD_REQUEST_HANDLER
+		{
+			pt::ptree request_xml;
+			pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
+			const auto target = find_target(exns::find_hierarchy("Envelope.Body.AbsoluteMove.ProfileToken", request_xml));
+			stop_tours(target.node_token);
+
+			// the axes absent in the request stay where they are
+			const auto position = read_vector("Envelope.Body.AbsoluteMove.Position", request_xml,
+				target.head->status().position);
+			const auto speed = read_vector("Envelope.Body.AbsoluteMove.Speed", request_xml);
+
+			target.head->absolute_move(position, speed);
+
+			fill_empty_response(*response, AbsoluteMove);
+		}
+	};
+
+	struct RelativeMoveHandler : public utility::http::RequestHandlerBase
+	{
+
+		RelativeMoveHandler() : utility::http::RequestHandlerBase(RelativeMove, osrv::auth::SECURITY_LEVELS::ACTUATE)
+		{
+		}
+
+		OVERLOAD_REQUEST_HANDLER
+		{
+			pt::ptree request_xml;
+			pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
+			const auto target = find_target(exns::find_hierarchy("Envelope.Body.RelativeMove.ProfileToken", request_xml));
+			stop_tours(target.node_token);
+
+			const auto translation = read_vector("Envelope.Body.RelativeMove.Translation", request_xml);
+			const auto speed = read_vector("Envelope.Body.RelativeMove.Speed", request_xml);
+
+			target.head->relative_move(translation, speed);
+
+			fill_empty_response(*response, RelativeMove);
+		}
+	};
+
+	struct StopHandler : public utility::http::RequestHandlerBase
+	{
+
+		StopHandler() : utility::http::RequestHandlerBase(Stop, osrv::auth::SECURITY_LEVELS::ACTUATE)
+		{
+		}
+
+		OVERLOAD_REQUEST_HANDLER
+		{
+			pt::ptree request_xml;
+			pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
+			const auto target = find_target(exns::find_hierarchy("Envelope.Body.Stop.ProfileToken", request_xml));
+			stop_tours(target.node_token);
+
+			// both are stopped if the request doesn't tell
+			bool pan_tilt = true;
+			if (const auto* node = exns::find_path("Envelope.Body.Stop.PanTilt", request_xml))
+				pan_tilt = node->get_value<bool>();
+			bool zoom = true;
+			if (const auto* node = exns::find_path("Envelope.Body.Stop.Zoom", request_xml))
+				zoom = node->get_value<bool>();
+
+			target.head->stop(pan_tilt, zoom);
+
+			fill_empty_response(*response, Stop);
+		}
+	};
+
+	struct GetStatusHandler : public utility::http::RequestHandlerBase
+	{
+
+		GetStatusHandler() : utility::http::RequestHandlerBase(GetStatus, osrv::auth::SECURITY_LEVELS::READ_MEDIA)
+		{
+		}
+
+		OVERLOAD_REQUEST_HANDLER
+		{
+			pt::ptree request_xml;
+			pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
+			const auto target = find_target(exns::find_hierarchy("Envelope.Body.GetStatus.ProfileToken", request_xml));
+
+			const auto status = target.head->status();
+
+			pt::ptree position_node;
+			fill_position(status.position, position_node);
+
+			pt::ptree status_node;
+			status_node.add_child("tt:Position", position_node);
+			status_node.add("tt:MoveStatus.tt:PanTilt", move_status_to_string(status.pan_tilt));
+			status_node.add("tt:MoveStatus.tt:Zoom", move_status_to_string(status.zoom));
+			status_node.add("tt:UtcTime", utility::datetime::system_utc_datetime());
+
+			auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
+
+			envelope_tree.add_child("s:Body.tptz:GetStatusResponse.tptz:PTZStatus", status_node);
+
+			pt::ptree root_tree;
+			root_tree.put_child("s:Envelope", envelope_tree);
+
+			std::ostringstream os;
+			pt::write_xml(os, root_tree);
+
+			utility::http::fillResponseWithHeaders(*response, os.str());
+		}
+	};
+
+
+	struct SetPresetHandler : public utility::http::RequestHandlerBase
+	{
+
+		SetPresetHandler() : utility::http::RequestHandlerBase(SetPreset, osrv::auth::SECURITY_LEVELS::ACTUATE)
+		{
+		}
+
+		OVERLOAD_REQUEST_HANDLER
+		{
+			pt::ptree request_xml;
+			pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
+			const auto target = find_target(exns::find_hierarchy("Envelope.Body.SetPreset.ProfileToken", request_xml));
+
+			const auto configs = CONFIGS->load();
+			const auto max_presets = utility::config::find_item(configs->tree(), "Nodes", "token", target.node_token)
+				.get<std::size_t>("MaximumNumberOfPresets");
+
+			const auto* token_node = exns::find_path("Envelope.Body.SetPreset.PresetToken", request_xml);
+			const auto* name_node = exns::find_path("Envelope.Body.SetPreset.PresetName", request_xml);
+			const auto position = target.head->status().position;
+
+			// the token of a new preset is chosen from the presets of the current config,
+			// throws if the node has no item in "NodePresets"
+			utility::ptz::Preset preset;
+			CONFIGS->commit("NodePresets", "NodeToken", target.node_token,
+				[&](pt::ptree& node_configs)
+				{
+					const utility::ptz::NodePresets node(node_configs);
+
+					// an existing preset is overwritten, otherwise a new one is created
+					if (token_node != nullptr)
+					{
+						const auto* existing = node.find_preset(token_node->get_value<std::string>());
+						if (existing == nullptr)
+							throw std::runtime_error("Client error: the preset is not found: " + token_node->get_value<std::string>());
+						preset = *existing;
+					}
+					else
+					{
+						if (node.presets().size() >= max_presets)
+							throw std::runtime_error("Client error: the max number of presets is reached: " + target.node_token);
+
+						preset.token = node.new_preset_token();
+						preset.name = preset.token;
+					}
+
+					if (name_node != nullptr)
+						preset.name = name_node->get_value<std::string>();
+					preset.position = position;
+
+					node_configs = utility::ptz::set_preset(node_configs, preset);
+				});
+
+			auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
+
+			envelope_tree.add("s:Body.tptz:SetPresetResponse.tptz:PresetToken", preset.token);
+
+			pt::ptree root_tree;
+			root_tree.put_child("s:Envelope", envelope_tree);
+
+			std::ostringstream os;
+			pt::write_xml(os, root_tree);
+
+			utility::http::fillResponseWithHeaders(*response, os.str());
+		}
+	};
+
+	struct GetPresetsHandler : public utility::http::RequestHandlerBase
+	{
+
+		GetPresetsHandler() : utility::http::RequestHandlerBase(GetPresets, osrv::auth::SECURITY_LEVELS::READ_MEDIA)
+		{
+		}
+
+		OVERLOAD_REQUEST_HANDLER
+		{
+			pt::ptree request_xml;
+			pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
+			const auto target = find_target(exns::find_hierarchy("Envelope.Body.GetPresets.ProfileToken", request_xml));
+
+			const auto presets = utility::ptz::Presets::instance(CONFIGS->load());
+
+			pt::ptree presets_node;
+			for (const auto& preset : presets_of(*presets, target).presets())
+			{
+				pt::ptree position_node;
+				fill_position(preset.position, position_node);
+
+				pt::ptree preset_node;
+				preset_node.add("<xmlattr>.token", preset.token);
+				preset_node.add("tt:Name", preset.name);
+				preset_node.add_child("tt:PTZPosition", position_node);
+
+				presets_node.add_child("tptz:Preset", preset_node);
+			}
+
+			auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
+
+			envelope_tree.add_child("s:Body.tptz:GetPresetsResponse", presets_node);
+
+			pt::ptree root_tree;
+			root_tree.put_child("s:Envelope", envelope_tree);
+
+			std::ostringstream os;
+			pt::write_xml(os, root_tree);
+
+			utility::http::fillResponseWithHeaders(*response, os.str());
+		}
+	};
+
+	struct GotoPresetHandler : public utility::http::RequestHandlerBase
+	{
+
+		GotoPresetHandler() : utility::http::RequestHandlerBase(GotoPreset, osrv::auth::SECURITY_LEVELS::ACTUATE)
+		{
+		}
+
+		OVERLOAD_REQUEST_HANDLER
+		{
+			pt::ptree request_xml;
+			pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
+			const auto target = find_target(exns::find_hierarchy("Envelope.Body.GotoPreset.ProfileToken", request_xml));
+			const auto preset_token = exns::find_hierarchy("Envelope.Body.GotoPreset.PresetToken", request_xml);
+
+			const auto presets = utility::ptz::Presets::instance(CONFIGS->load());
+			const auto* preset = presets_of(*presets, target).find_preset(preset_token);
+			if (preset == nullptr)
+				throw std::runtime_error("Client error: the preset is not found: " + preset_token);
+
+			stop_tours(target.node_token);
+			target.head->absolute_move(preset->position, read_vector("Envelope.Body.GotoPreset.Speed", request_xml));
+
+			fill_empty_response(*response, GotoPreset);
+		}
+	};
+
+	struct RemovePresetHandler : public utility::http::RequestHandlerBase
+	{
+
+		RemovePresetHandler() : utility::http::RequestHandlerBase(RemovePreset, osrv::auth::SECURITY_LEVELS::ACTUATE)
+		{
+		}
+
+		OVERLOAD_REQUEST_HANDLER
+		{
+			pt::ptree request_xml;
+			pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
+			const auto target = find_target(exns::find_hierarchy("Envelope.Body.RemovePreset.ProfileToken", request_xml));
+			const auto preset_token = exns::find_hierarchy("Envelope.Body.RemovePreset.PresetToken", request_xml);
+
+			// throws if the node has no item in "NodePresets"
+			CONFIGS->commit("NodePresets", "NodeToken", target.node_token,
+				[&preset_token](pt::ptree& node_configs)
+				{
+					if (utility::ptz::NodePresets(node_configs).find_preset(preset_token) == nullptr)
+						throw std::runtime_error("Client error: the preset is not found: " + preset_token);
+
+					node_configs = utility::ptz::remove_preset(node_configs, preset_token);
+				});
+
+			fill_empty_response(*response, RemovePreset);
+		}
+	};
+
+	struct GetPresetToursHandler : public utility::http::RequestHandlerBase
+	{
+
+		GetPresetToursHandler() : utility::http::RequestHandlerBase(GetPresetTours, osrv::auth::SECURITY_LEVELS::READ_MEDIA)
+		{
+		}
+
+		OVERLOAD_REQUEST_HANDLER
+		{
+			pt::ptree request_xml;
+			pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
+			const auto target = find_target(exns::find_hierarchy("Envelope.Body.GetPresetTours.ProfileToken", request_xml));
+
+			const auto presets = utility::ptz::Presets::instance(CONFIGS->load());
+
+			pt::ptree tours_node;
+			for (const auto& tour : presets_of(*presets, target).tours())
+			{
+				tours_node.add_child("tptz:PresetTour",
+					tour_to_soap(tour, tours->state(target.node_token, tour.token)));
+			}
+
+			auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
+
+			envelope_tree.add_child("s:Body.tptz:GetPresetToursResponse", tours_node);
+
+			pt::ptree root_tree;
+			root_tree.put_child("s:Envelope", envelope_tree);
+
+			std::ostringstream os;
+			pt::write_xml(os, root_tree);
+
+			utility::http::fillResponseWithHeaders(*response, os.str());
+		}
+	};
+
+	struct GetPresetTourHandler : public utility::http::RequestHandlerBase
+	{
+
+		GetPresetTourHandler() : utility::http::RequestHandlerBase(GetPresetTour, osrv::auth::SECURITY_LEVELS::READ_MEDIA)
+		{
+		}
+
+		OVERLOAD_REQUEST_HANDLER
+		{
+			pt::ptree request_xml;
+			pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
+			const auto target = find_target(exns::find_hierarchy("Envelope.Body.GetPresetTour.ProfileToken", request_xml));
+			const auto tour_token = exns::find_hierarchy("Envelope.Body.GetPresetTour.PresetTourToken", request_xml);
+
+			const auto presets = utility::ptz::Presets::instance(CONFIGS->load());
+			const auto* tour = presets_of(*presets, target).find_tour(tour_token);
+			if (tour == nullptr)
+				throw std::runtime_error("Client error: the preset tour is not found: " + tour_token);
+
+			auto envelope_tree = utility::soap::getEnvelopeTree(XML_NAMESPACES);
+
+			envelope_tree.add_child("s:Body.tptz:GetPresetTourResponse.tptz:PresetTour",
+				tour_to_soap(*tour, tours->state(target.node_token, tour->token)));
+
+			pt::ptree root_tree;
+			root_tree.put_child("s:Envelope", envelope_tree);
+
+			std::ostringstream os;
+			pt::write_xml(os, root_tree);
+
+			utility::http::fillResponseWithHeaders(*response, os.str());
+		}
+	};
+
+	struct OperatePresetTourHandler : public utility::http::RequestHandlerBase
+	{
+
+		OperatePresetTourHandler() : utility::http::RequestHandlerBase(OperatePresetTour, osrv::auth::SECURITY_LEVELS::ACTUATE)
+		{
+		}
+
+		OVERLOAD_REQUEST_HANDLER
+		{
+			pt::ptree request_xml;
+			pt::xml_parser::read_xml(std::istringstream{ request->content.string() }, request_xml);
+			const auto target = find_target(exns::find_hierarchy("Envelope.Body.OperatePresetTour.ProfileToken", request_xml));
+			const auto tour_token = exns::find_hierarchy("Envelope.Body.OperatePresetTour.PresetTourToken", request_xml);
+			const auto operation = exns::find_hierarchy("Envelope.Body.OperatePresetTour.Operation", request_xml);
+
+			const auto presets = utility::ptz::Presets::instance(CONFIGS->load());
+			const auto* tour = presets_of(*presets, target).find_tour(tour_token);
+			if (tour == nullptr)
+				throw std::runtime_error("Client error: the preset tour is not found: " + tour_token);
+
+			if (operation == "Start")
+				tours->start(target.node_token, *tour);
+			else if (operation == "Stop")
+				tours->stop(target.node_token, tour_token);
+			else if (operation == "Pause")
+				tours->pause(target.node_token, tour_token);
+			else
+				throw std::runtime_error("Client error: the operation of the preset tour is not supported: " + operation);
+
+			tours_timer->schedule();
+
+			fill_empty_response(*response, OperatePresetTour);
+		}
+	};
+
+
 	void PtzServiceDefaultHandler(std::shared_ptr<HttpServer::Response> response,
 		std::shared_ptr<HttpServer::Request> request)
 	{
@@ -315,6 +964,8 @@ namespace osrv::ptz
 	void do_handle_request(std::shared_ptr<HttpServer::Response> response,
 		std::shared_ptr<HttpServer::Request> request)
 	{
+		const auto start = std::chrono::steady_clock::now();
+
 		//extract requested method
 		std::string method;
 		auto content = request->content.string();
@@ -375,9 +1026,14 @@ namespace osrv::ptz
 				}
 
 				(*handler_ptr)(response, request);
+				utility::metrics::record_request(handler_ptr->get_metrics_id(),
+					utility::metrics::Outcome::OK, std::chrono::steady_clock::now() - start);
 			}
 			catch (const osrv::auth::digest_failed& e)
 			{
+				utility::metrics::record_request((*handler_it)->get_metrics_id(),
+					utility::metrics::Outcome::AUTH_FAILED, std::chrono::steady_clock::now() - start);
+
 				logger_->Error(e.what());
 
 				*response << utility::http::RESPONSE_UNAUTHORIZED << "\r\n"
@@ -388,6 +1044,9 @@ namespace osrv::ptz
 			}
 			catch (const std::exception& e)
 			{
+				utility::metrics::record_request((*handler_it)->get_metrics_id(),
+					utility::metrics::Outcome::SERVER_ERROR, std::chrono::steady_clock::now() - start);
+
 				logger_->Error("A server's error occured in PtzService while processing: " + method
 					+ ". Info: " + e.what());
 
@@ -398,6 +1057,9 @@ namespace osrv::ptz
 		{
 			logger_->Error("Not found an appropriate handler in PtzService for: " + method);
 			*response << "HTTP/1.1 400 Bad request\r\nContent-Length: " << 0 << "\r\n\r\n";
+
+			utility::metrics::record_request(unknown_method_metrics_id,
+				utility::metrics::Outcome::CLIENT_ERROR, std::chrono::steady_clock::now() - start);
 		}
 	}
 
@@ -415,9 +1077,13 @@ namespace osrv::ptz
 		CONFIGS_PATH = configs_path;
 
 		//getting service's configs
-		pt::read_json(configs_path + CONFIGS_FILE, CONFIGS_TREE);
+		// the sections read by the handlers must be in a reloaded config
+		CONFIGS = utility::config::ConfigStore::instance(configs_path, CONFIGS_FILE, { "Nodes", "Configurations", "NodePresets" },
+			logger);
+		PROFILES_STORE = utility::media::MediaProfiles::store(configs_path, logger);
 
-		auto namespaces_tree = CONFIGS_TREE.get_child("Namespaces");
+		const auto configs = CONFIGS->load();
+		const auto namespaces_tree = configs->get_child("Namespaces");
 		for (const auto& n : namespaces_tree)
 			XML_NAMESPACES.insert({ n.first, n.second.get_value<std::string>() });
 
@@ -427,7 +1093,86 @@ namespace osrv::ptz
 		handlers.emplace_back(new GetNodeHandler());
 		handlers.emplace_back(new GetNodesHandler());
 		handlers.emplace_back(new SetConfigurationHandler());
+		handlers.emplace_back(new ContinuousMoveHandler());
+		handlers.emplace_back(new AbsoluteMoveHandler());
+		handlers.emplace_back(new RelativeMoveHandler());
+		handlers.emplace_back(new StopHandler());
+		handlers.emplace_back(new GetStatusHandler());
+		handlers.emplace_back(new SetPresetHandler());
+		handlers.emplace_back(new GetPresetsHandler());
+		handlers.emplace_back(new GotoPresetHandler());
+		handlers.emplace_back(new RemovePresetHandler());
+		handlers.emplace_back(new GetPresetToursHandler());
+		handlers.emplace_back(new GetPresetTourHandler());
+		handlers.emplace_back(new OperatePresetTourHandler());
+
+		for (auto& handler : handlers)
+			handler->set_metrics_id(utility::metrics::register_method("ptz", handler->get_name()));
+
+		tours = std::make_unique<utility::ptz::TourScheduler>(move_to_spot);
+		tours_timer = std::make_shared<utility::ptz::TourTimer>(*server_configs->io_context_, *tours);
+		for (const auto& node : utility::ptz::Presets::instance(CONFIGS->load())->nodes())
+		{
+			for (const auto& tour : node.second.tours())
+			{
+				if (!tour.auto_start)
+					continue;
+
+				try
+				{
+					tours->start(node.first, tour);
+				}
+				catch (const std::exception& e)
+				{
+					logger_->Error(std::string("Could not start the preset tour: ") + e.what());
+				}
+			}
+		}
+		tours_timer->schedule();
+		unknown_method_metrics_id = utility::metrics::register_method("ptz", "unknown");
 
 		srv.resource["/onvif/ptz_service"]["POST"] = PtzServiceDefaultHandler;
 	}
+
+	void watch_configs(utility::config::ConfigWatcher& watcher)
+	{
+		CONFIGS->watch(watcher);
+	}
+
+	void stop()
+	{
+		if (!tours_timer)
+			return;
+
+		// the cancelled handler keeps the timer until the io_context runs it
+		tours_timer->stop();
+		tours_timer.reset();
+		tours.reset();
+	}
+
+	namespace util
+	{
+		void node_to_soap(const utility::config::ConfigView& node_config, pt::ptree& result)
+		{
+			result.add("<xmlattr>.token", node_config.get<std::string>("token"));
+			result.add("<xmlattr>.FixedHomePosition", node_config.get<bool>("FixedHomePosition"));
+			result.add("<xmlattr>.GeoMove", node_config.get<bool>("GeoMove"));
+			result.add("tt:Name", node_config.get<std::string>("Name"));
+
+			for (const auto& space_node : node_config.get_child("SupportedPTZSpaces"))
+			{
+				result.add_child("tt:SupportedPTZSpaces.tt:" + space_node.second.get<std::string>("space"),
+					space_to_soap(space_node.second.tree()));
+			}
+
+			result.add("tt:MaximumNumberOfPresets", node_config.get<int>("MaximumNumberOfPresets"));
+			result.add("tt:HomeSupported", node_config.get<bool>("HomeSupported"));
+			if (const auto max_tours = node_config.tree().get_optional<int>("MaximumNumberOfPresetTours"))
+			{
+				result.add("tt:Extension.tt:SupportedPresetTour.tt:MaximumNumberOfPresetTours", *max_tours);
+				for (const auto& operation : { "Start", "Stop", "Pause" })
+					result.add("tt:Extension.tt:SupportedPresetTour.tt:PTZPresetTourOperation", operation);
+			}
+		}
+	}
 } // ptz
\ No newline at end of file
@@ -3,8 +3,16 @@
 #include "../Types.inl"
 #include <string>
 
+#include <boost/property_tree/ptree_fwd.hpp>
+
 class ILogger;
 
+namespace utility::config
+{
+	class ConfigWatcher;
+	class ConfigView;
+}
+
 namespace osrv
 {
 	struct ServerConfigs;
@@ -15,5 +23,17 @@ namespace osrv
 
 		void init_service(HttpServer& srv, osrv::ServerConfigs& /*configs*/,
 			const std::string& /*configs_path*/, ILogger& /*logger*/);
+
+		// the changed configs are used by the next requests
+		void watch_configs(utility::config::ConfigWatcher& /*watcher*/);
+
+		// the preset tours are stopped, it's called before the io_context of ServerConfigs is finished
+		void stop();
+
+		namespace util
+		{
+			// an item of "Nodes" to tt:PTZNode, throws an exception if the node isn't complete
+			void node_to_soap(const utility::config::ConfigView& node_config, boost::property_tree::ptree& result);
+		}
 	}
 }
\ No newline at end of file
@@ -8,6 +8,11 @@ namespace osrv
 {
 	namespace event
 	{
+		void IEventGenerator::notify(const NotificationMessage& nm)
+		{
+			emitted_events_->inc();
+			event_signal_(nm);
+		}
 
 		DInputEventGenerator::DInputEventGenerator(int interval, const std::string& topic, boost::asio::io_context& io_context, const ILogger& logger_)
 			: IEventGenerator(interval, topic, io_context, logger_)
@@ -65,7 +70,7 @@ namespace osrv
 				// each time invert state
 				nm.data_value = di->InvertState() ? "true" : "false";
 
-				event_signal_(nm);
+				notify(nm);
 			}
 		}
 
@@ -105,7 +110,7 @@ namespace osrv
 			// each time invert state
 			nm.data_value = InvertState() ? "true" : "false";
 
-			event_signal_(nm);
+			notify(nm);
 		}
 
 		CellMotionEventGenerator::CellMotionEventGenerator(const std::string& vsc_token, const std::string& vac_token,
@@ -153,7 +158,7 @@ namespace osrv
 			// each time invert state
 			nm.data_value = InvertState() ? "true" : "false";
 
-			event_signal_(nm);
+			notify(nm);
 		}
 
 		AudioDetectectionEventGenerator::AudioDetectectionEventGenerator(const std::string& sct,
@@ -202,7 +207,7 @@ namespace osrv
 			// each time invert state
 			nm.data_value = InvertState() ? "true" : "false";
 
-			event_signal_(nm);
+			notify(nm);
 		}
 }
 }
\ No newline at end of file
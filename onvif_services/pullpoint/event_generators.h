@@ -2,6 +2,7 @@
 
 #include "../Logger.h"
 #include "../onvif_services/physical_components/IDigitalInput.h"
+#include "../utility/Metrics.h"
 
 #include <functional>
 #include <deque>
@@ -26,6 +27,8 @@ namespace osrv
 				,io_context_(io_context)
 				,alarm_timer_(io_context_)
 				,logger_(logger)
+				,emitted_events_(utility::metrics::make_counter("onvif_generated_events_total",
+					"Events emitted by the event generators.", { {"topic", topic} }))
 			{
 			}
 
@@ -53,14 +56,17 @@ namespace osrv
 
 		protected:
 			// This method is should be overrided by implementors.
-			// Implementors should fill a NotificationMessage and emit the signal with it
+			// Implementors should fill a NotificationMessage and emit it with @notify
 			virtual void generate_event()
 			{
 				//	NotificationMessage event_description;
 				// /*do somehow filling event_description...*/
-				// event_signal_(NotificationMessage);
+				// notify(NotificationMessage);
 			}
 
+			// emits the signal and counts the emitted event
+			void notify(const NotificationMessage& /*nm*/);
+
 			void schedule_next_alarm()
 			{
 				alarm_timer_.expires_after(std::chrono::seconds(event_interval_));
@@ -86,6 +92,9 @@ namespace osrv
 			boost::asio::steady_timer alarm_timer_;
 
 			const ILogger& logger_;
+
+		private:
+			std::shared_ptr<utility::metrics::Counter> emitted_events_;
 		};
 
 		class DInputEventGenerator : public IEventGenerator
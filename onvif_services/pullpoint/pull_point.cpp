@@ -4,7 +4,7 @@
 #include "../utility/SoapHelper.h"
 #include "../utility/HttpHelper.h"
 #include "../utility/DateTime.hpp"
-
+#include "../utility/Metrics.h"
 
 #include <sstream>
 #include <algorithm>
@@ -17,6 +17,22 @@ namespace osrv
 
 	namespace event {
 
+		// all PullPoints share the same gauge, each one adds its own queue's size
+		static std::shared_ptr<utility::metrics::Gauge> queued_events_gauge()
+		{
+			static auto gauge = utility::metrics::make_gauge("onvif_pullpoint_queued_events",
+				"Events waiting to be pulled by the subscribers.");
+			return gauge;
+		}
+
+		PullPoint::~PullPoint()
+		{
+			logger_->Debug("Destroying PullPoint: " + subscription_ref_);
+
+			events_.clear();
+			update_queue_depth();
+		}
+
 		void PullPoint::PullMessages(pull_messages_handler_t handler, std::shared_ptr<HttpServer::Response> response)
 		{
 			is_client_waiting_ = true;
@@ -44,6 +60,7 @@ namespace osrv
 		void PullPoint::Notify(NotificationMessage&& event)
 		{
 			events_.push_back(std::move(event));
+			update_queue_depth();
 
 			response_to_pullmessages();
 		}
@@ -59,6 +76,7 @@ namespace osrv
 			// FIX: in current implementation all events is copied
 			std::deque<NotificationMessage> copied_events;
 			copied_events.swap(events_);
+			update_queue_depth();
 			handler_(subscription_ref_, std::move(copied_events), response_writer_);
 			response_writer_.reset(); // it's required to reset writer ptr, otherwise response will not be written in time
 			is_client_waiting_ = false;
@@ -75,6 +93,14 @@ namespace osrv
 				auto gen_ev = eg->GenerateSynchronizationEvent();
 				events_.insert(events_.end(), gen_ev.begin(), gen_ev.end());
 			}
+
+			update_queue_depth();
+		}
+
+		void PullPoint::update_queue_depth()
+		{
+			queued_events_gauge()->add(static_cast<std::int64_t>(events_.size()) - static_cast<std::int64_t>(reported_queue_depth_));
+			reported_queue_depth_ = events_.size();
 		}
 		
 		std::shared_ptr<PullPoint> NotificationsManager::CreatePullPoint()
@@ -164,7 +190,7 @@ namespace osrv
 			pt::ptree analytics_configs;
 			auto envelope_tree = utility::soap::getEnvelopeTree(*xml_namespaces_);
 
-			envelope_tree.add("s:Header.wsa:MessageID", header_msg_id);
+			utility::soap::addResponseMessageId(envelope_tree, header_msg_id);
 			envelope_tree.add("s:Header.wsa:To", "http://www.w3.org/2005/08/addressing/anonymous");
 			envelope_tree.add("s:Header.wsa:Action", "http://www.onvif.org/ver10/events/wsdl/PullPointSubscription/PullMessagesResponse");
 
@@ -222,7 +248,7 @@ namespace osrv
 			pt::ptree analytics_configs;
 			auto envelope_tree = utility::soap::getEnvelopeTree(*xml_namespaces_);
 
-			envelope_tree.add("s:Header.wsa:MessageID", msg_id);
+			utility::soap::addResponseMessageId(envelope_tree, msg_id);
 			envelope_tree.add("s:Header.wsa:To", "http://www.w3.org/2005/08/addressing/anonymous");
 			envelope_tree.add("s:Header.wsa:Action", "http://www.onvif.org/ver10/events/wsdl/PullPointSubscription/PullMessagesResponse");
 
@@ -301,7 +327,7 @@ namespace osrv
 		PullPoints_t::const_iterator find_pullpoint(const PullPoints_t& pullpoints, const std::string& subscription_reference)
 		{
 			return std::find_if(pullpoints.begin(), pullpoints.end(),
-				[subscription_reference](PullPoints_t::value_type pp) {
+				[&subscription_reference](const PullPoints_t::value_type& pp) {
 
 					return compare_subscription_references(subscription_reference,
 						pp->GetSubscriptionReference());
@@ -53,10 +53,7 @@ namespace osrv
 				current_time_ = boost::posix_time::microsec_clock::universal_time();
 			}
 
-			~PullPoint()
-			{
-				logger_->Debug("Destroying PullPoint: " + subscription_ref_);
-			}
+			~PullPoint();
 
 			// Link a connected generator and set a related connection
 			// NOTE: if this action is not done during initialization,
@@ -114,6 +111,9 @@ namespace osrv
 			// 3. by timeout timer, if there are no events were generated (response with an empty message)
 			void response_to_pullmessages();
 
+			// reports the changes of the queue's size to the metrics
+			void update_queue_depth();
+
 		private:
 			const ILogger* logger_;
 			boost::asio::io_context& io_context_;
@@ -127,6 +127,7 @@ namespace osrv
 			int max_messages_;
 
 			std::deque<NotificationMessage> events_;
+			std::size_t reported_queue_depth_ = 0;
 
 			pull_messages_handler_t handler_;
 			std::shared_ptr<HttpServer::Response> response_writer_;
@@ -0,0 +1,43 @@
+// Compiles all the configs of a directory into one binary file, which the server maps at start
+// instead of parsing each JSON file. The file is written into the same directory by default.
+// A config, which is modified after the compilation, is read by the server from JSON again,
+// so the tool should be run again after the configs are edited.
+//
+// Usage: compile_configs [configs_dir] [output_file]
+
+#include "../utility/CompiledConfigs.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+static const std::string DEFAULT_CONFIGS_DIR = "./server_configs";
+
+int main(int argc, char** argv)
+{
+	std::string configs_dir = argc > 1 ? argv[1] : DEFAULT_CONFIGS_DIR;
+	if (configs_dir.back() != '/' && configs_dir.back() != '\\')
+		configs_dir += "/";
+
+	const std::string output_path = argc > 2 ? argv[2] : configs_dir + utility::config::COMPILED_CONFIGS_FILE;
+
+	try
+	{
+		const auto start = std::chrono::steady_clock::now();
+		const auto files = utility::config::compile_dir(configs_dir, output_path);
+		const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - start);
+
+		for (const auto& file : files)
+			std::cout << "Compiled: " << file << "\n";
+		std::cout << files.size() << " configs are written to " << output_path
+			<< " in " << elapsed.count() << " ms" << std::endl;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Could not compile the configs: " << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
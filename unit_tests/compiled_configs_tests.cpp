@@ -0,0 +1,91 @@
+#include <boost/test/unit_test.hpp>
+
+#include "../utility/CompiledConfigs.h"
+
+#include <boost/property_tree/json_parser.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+namespace pt = boost::property_tree;
+
+static const std::string TEST_CONFIG = "../../unit_tests/test_data/media2_service_test.config";
+
+static fs::path make_configs_dir(const std::string& name)
+{
+	const auto dir = fs::temp_directory_path() / name;
+	fs::remove_all(dir);
+	fs::create_directories(dir);
+	fs::copy_file(TEST_CONFIG, dir / "media2.config");
+
+	return dir;
+}
+
+BOOST_AUTO_TEST_CASE(compiled_configs_func)
+{
+	using namespace utility::config;
+
+	const auto dir = make_configs_dir("osrv_compiled_configs_test");
+	const auto dir_str = dir.string() + "/";
+
+	const auto files = compile_dir(dir_str, dir_str + COMPILED_CONFIGS_FILE);
+	BOOST_TEST(files.size() == 1);
+	BOOST_TEST(files.front() == "media2.config");
+
+	pt::ptree expected;
+	pt::read_json(TEST_CONFIG, expected);
+
+	const CompiledConfigs compiled(dir_str, dir_str + COMPILED_CONFIGS_FILE);
+	BOOST_TEST(compiled.size() == 1);
+	BOOST_TEST(!compiled.read("media.config"));
+
+	auto tree = compiled.read("media2.config");
+	BOOST_REQUIRE(tree);
+	BOOST_TEST((*tree == expected));
+
+	// the children keep their order, as the arrays depend on it
+	auto expected_profile = expected.get_child("MediaProfiles").begin();
+	for (const auto& profile : tree->get_child("MediaProfiles"))
+	{
+		BOOST_TEST(profile.second.get<std::string>("token") == expected_profile->second.get<std::string>("token"));
+		++expected_profile;
+	}
+
+	// a modified JSON file is not hidden by the compiled one
+	fs::last_write_time(dir / "media2.config", fs::file_time_type::clock::now() + std::chrono::seconds(5));
+	BOOST_TEST(!compiled.read("media2.config"));
+
+	fs::remove(dir / "media2.config");
+	BOOST_TEST(compiled.read("media2.config").has_value());
+
+	fs::remove_all(dir);
+}
+
+BOOST_AUTO_TEST_CASE(compiled_configs_broken_func)
+{
+	using namespace utility::config;
+
+	const auto dir = make_configs_dir("osrv_compiled_configs_broken_test");
+	const auto dir_str = dir.string() + "/";
+	const auto path = dir_str + COMPILED_CONFIGS_FILE;
+
+	compile_dir(dir_str, path);
+
+	// truncated
+	const auto size = fs::file_size(path);
+	fs::resize_file(path, size - 1);
+	BOOST_CHECK_THROW(CompiledConfigs(dir_str, path), std::runtime_error);
+
+	// not a compiled file
+	std::ofstream(path, std::ios::trunc) << "{ \"loggingLevel\":\"DEBUG\" }";
+	BOOST_CHECK_THROW(CompiledConfigs(dir_str, path), std::runtime_error);
+
+	// without the compiled file the JSON one is read
+	fs::remove(path);
+	BOOST_TEST(!CompiledConfigs::instance(dir_str));
+	BOOST_TEST(read_config(dir_str, "media2.config").get_child("MediaProfiles").size() > 0);
+
+	fs::remove_all(dir);
+}
@@ -0,0 +1,229 @@
+// The allocations are counted by the replaced operator new, so these tests are built into their own executable,
+// the other suites are run with the default one
+#define BOOST_TEST_MODULE allocations_tests
+#include <boost/test/unit_test.hpp>
+
+#include "../utility/ConfigSnapshot.h"
+#include "../utility/MediaProfiles.h"
+#include "../onvif_services/media2_service.h"
+#include "../onvif_services/device_service.h"
+#include "../onvif_services/event_service.h"
+#include "../onvif_services/ptz_service.h"
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <type_traits>
+
+namespace pt = boost::property_tree;
+
+// Allocations are counted only while the flag is set by the test of the current thread
+static thread_local bool count_allocations = false;
+static thread_local std::size_t allocations_count = 0;
+
+void* operator new(std::size_t size)
+{
+	if (count_allocations)
+		++allocations_count;
+
+	if (void* ptr = std::malloc(size ? size : 1))
+		return ptr;
+
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+template<typename Func>
+static std::size_t allocations_of(Func&& func)
+{
+	allocations_count = 0;
+	count_allocations = true;
+	func();
+	count_allocations = false;
+
+	return allocations_count;
+}
+
+static const std::string TEST_CONFIG = "../../unit_tests/test_data/media2_service_test.config";
+
+BOOST_AUTO_TEST_CASE(config_snapshot_no_copies_func)
+{
+	using utility::config::ConfigSnapshot;
+
+	static_assert(!std::is_copy_constructible_v<ConfigSnapshot>, "a snapshot must be shared only by pointer");
+
+	auto snapshot = ConfigSnapshot::read_json(TEST_CONFIG);
+
+	// NOTE: the paths are short enough to fit into std::string without allocations,
+	// so only copies of the config nodes are counted
+	std::size_t items_count = 0;
+	auto view_allocations = allocations_of([&]()
+		{
+			auto profiles = snapshot->get_child("MediaProfiles");
+			for (auto profile : profiles)
+				items_count += profile.second.size();
+
+			auto vs_list = snapshot->root().get_child_optional("NotExisting");
+			items_count += vs_list ? 1 : 0;
+		});
+
+	BOOST_TEST(view_allocations == 0);
+	BOOST_TEST(items_count == 16);
+
+	// the former way of access copies the whole subtree
+	auto copy_allocations = allocations_of([&]()
+		{
+			auto profiles = snapshot->tree().get_child("MediaProfiles");
+			for (auto profile : profiles)
+				items_count += profile.second.size();
+		});
+
+	BOOST_TEST(copy_allocations > 0);
+}
+
+// the allocations of the GetProfiles response of Media2 built from the snapshot
+static std::size_t get_profiles_allocations(const utility::config::ConfigSnapshotSP& snapshot)
+{
+	// the model is built by the first request of the snapshot
+	utility::media::MediaProfiles::instance(snapshot);
+
+	return allocations_of([&]()
+		{
+			const auto profiles = utility::media::MediaProfiles::instance(snapshot);
+
+			pt::ptree response_node;
+			for (const auto& profile : profiles->profiles())
+			{
+				pt::ptree profile_node;
+				osrv::media2::util::profile_to_soap(*profiles, profile, profile_node);
+				response_node.add_child("tr2:Profiles", profile_node);
+			}
+		});
+}
+
+BOOST_AUTO_TEST_CASE(media2_profiles_response_func)
+{
+	using utility::config::ConfigSnapshot;
+
+	pt::ptree configs;
+	pt::json_parser::read_json(TEST_CONFIG, configs);
+	const auto snapshot = std::make_shared<const ConfigSnapshot>(pt::ptree(configs));
+
+	const auto allocations = get_profiles_allocations(snapshot);
+	BOOST_TEST(allocations > 0);
+
+	// the cached model is shared by the requests of the same snapshot
+	BOOST_TEST(allocations_of([&]() { utility::media::MediaProfiles::instance(snapshot); }) == 0);
+
+	// the configurations not referred by the profiles and the unrelated items don't cost the response anything,
+	// so neither the config nor its lists are copied by the read path
+	auto& encoders = configs.get_child("VideoEncoderConfigurations2");
+	const auto encoder = encoders.front().second;
+	pt::ptree unrelated;
+	for (int i = 0; i < 100; ++i)
+	{
+		auto item = encoder;
+		item.put("token", "UnusedEncoderToken" + std::to_string(i));
+		encoders.push_back({ "", item });
+		unrelated.push_back({ "", item });
+	}
+	configs.put_child("Unrelated", unrelated);
+
+	const auto padded_snapshot = std::make_shared<const ConfigSnapshot>(std::move(configs));
+	BOOST_TEST(get_profiles_allocations(padded_snapshot) == allocations);
+}
+
+// The data of the nodes having children is never read by the handlers, so it's padded with a string which can't fit
+// into std::string without allocations: a copy of any list or object of the config costs extra allocations
+static void pad_branches(pt::ptree& node)
+{
+	if (node.empty())
+		return;
+
+	node.data() = std::string(256, '#');
+	for (auto& child : node)
+		pad_branches(child.second);
+}
+
+// the read path costs the same allocations for the config and for its padded copy, if nothing of the config is copied
+template<typename ReadPath>
+static void check_no_config_copies(const std::string& config_path, ReadPath&& read_path)
+{
+	using utility::config::ConfigSnapshot;
+
+	pt::ptree configs;
+	pt::json_parser::read_json(config_path, configs);
+	const auto snapshot = std::make_shared<const ConfigSnapshot>(pt::ptree(configs));
+
+	pad_branches(configs);
+	const auto padded_snapshot = std::make_shared<const ConfigSnapshot>(std::move(configs));
+
+	// the results are allocated by the read path too
+	const auto allocations = allocations_of([&]() { read_path(*snapshot); });
+	BOOST_TEST(allocations > 0);
+	BOOST_TEST(allocations_of([&]() { read_path(*padded_snapshot); }) == allocations);
+
+	// the padding is visible for a copy of the config
+	const auto copy_allocations = allocations_of([&]() { pt::ptree copy(snapshot->tree()); });
+	BOOST_TEST(allocations_of([&]() { pt::ptree copy(padded_snapshot->tree()); }) > copy_allocations);
+}
+
+static const std::string SERVER_CONFIGS_DIR = "../../server_configs/";
+
+BOOST_AUTO_TEST_CASE(device_capabilities_response_func)
+{
+	check_no_config_copies(SERVER_CONFIGS_DIR + "device.config",
+		[](const utility::config::ConfigSnapshot& configs)
+		{
+			pt::ptree capabilities_node;
+			osrv::device::util::capabilities_to_soap(configs, 2, capabilities_node);
+		});
+}
+
+BOOST_AUTO_TEST_CASE(event_properties_response_func)
+{
+	check_no_config_copies(SERVER_CONFIGS_DIR + "event.config",
+		[](const utility::config::ConfigSnapshot& configs)
+		{
+			pt::ptree response_node;
+			osrv::event::util::event_properties_to_soap(configs, response_node);
+		});
+}
+
+BOOST_AUTO_TEST_CASE(media2_video_source_options_response_func)
+{
+	check_no_config_copies(SERVER_CONFIGS_DIR + "media_profiles.config",
+		[](const utility::config::ConfigSnapshot& configs)
+		{
+			pt::ptree options_node;
+			osrv::media2::util::video_source_options_to_soap(configs, options_node);
+		});
+}
+
+BOOST_AUTO_TEST_CASE(ptz_nodes_response_func)
+{
+	// GetNodes and GetNode build their nodes by the same function
+	check_no_config_copies(SERVER_CONFIGS_DIR + "ptz.config",
+		[](const utility::config::ConfigSnapshot& configs)
+		{
+			pt::ptree nodes_node;
+			for (const auto& node : configs.get_child("Nodes"))
+			{
+				pt::ptree node_node;
+				osrv::ptz::util::node_to_soap(node.second, node_node);
+				nodes_node.add_child("tptz:PTZNode", node_node);
+			}
+		});
+}
@@ -0,0 +1,99 @@
+#include <boost/test/unit_test.hpp>
+
+#include "../utility/ConfigSnapshot.h"
+#include "../utility/ConfigWatcher.h"
+#include "../ConsoleLogger.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+BOOST_AUTO_TEST_CASE(config_view_access_func)
+{
+	using utility::config::ConfigSnapshot;
+
+	auto snapshot = ConfigSnapshot::read_json("../../unit_tests/test_data/media2_service_test.config");
+
+	auto profile = *snapshot->get_child("MediaProfiles").begin();
+	BOOST_TEST(profile.first.empty());
+	BOOST_TEST(profile.second.get<std::string>("token") == "ProfileToken0");
+	BOOST_TEST(profile.second.get<bool>("fixed"));
+	BOOST_TEST(profile.second.get<std::string>("NotExisting", "default") == "default");
+
+	BOOST_CHECK_THROW(snapshot->get_child("NotExisting"), boost::property_tree::ptree_bad_path);
+	BOOST_TEST(!snapshot->get_child_optional("NotExisting"));
+}
+
+
+BOOST_AUTO_TEST_CASE(config_published_func)
+{
+	using namespace utility::config;
+
+	auto snapshot = ConfigSnapshot::read_json("../../unit_tests/test_data/media2_service_test.config");
+	BOOST_CHECK_NO_THROW(snapshot->require({ "MediaProfiles" }));
+	BOOST_CHECK_THROW(snapshot->require({ "MediaProfiles", "NotExisting" }), boost::property_tree::ptree_bad_path);
+
+	Published<ConfigSnapshot> published;
+	BOOST_TEST(!published);
+
+	published.store(snapshot);
+	auto in_use = published.load();
+
+	// the previous snapshot stays valid while it's used
+	published.store(std::make_shared<const ConfigSnapshot>(boost::property_tree::ptree{}));
+	BOOST_TEST(in_use == snapshot);
+	BOOST_TEST(in_use->get_child("MediaProfiles").size() > 0);
+	BOOST_TEST(!published.load()->get_child_optional("MediaProfiles"));
+}
+
+BOOST_AUTO_TEST_CASE(config_watcher_func)
+{
+	namespace fs = std::filesystem;
+	using namespace utility::config;
+
+	const auto dir = fs::temp_directory_path() / "osrv_config_watcher_test";
+	fs::remove_all(dir);
+	fs::create_directories(dir);
+
+	auto write = [&](const std::string& content) {
+		std::ofstream(dir / "test.config") << content;
+	};
+	write(R"({"value":1})");
+
+	ConsoleLogger logger(ILogger::LVL_ERR);
+	Published<ConfigSnapshot> published;
+	published.store(ConfigSnapshot::read_json((dir / "test.config").string()));
+
+	std::atomic<int> reloads_count{ 0 };
+	ConfigWatcher watcher(dir.string(), logger);
+	watcher.watch("test.config", [&]() {
+			auto snapshot = ConfigSnapshot::read_json((dir / "test.config").string());
+			snapshot->require({ "value" });
+			published.store(snapshot);
+			++reloads_count;
+		});
+	watcher.start();
+
+	auto wait_reload = [&](int count) {
+		for (int i = 0; i < 50 && reloads_count < count; ++i)
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	};
+
+	// the polling implementation needs a different modification time
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	write(R"({"value":2})");
+	fs::last_write_time(dir / "test.config", fs::file_time_type::clock::now() + std::chrono::seconds(1));
+	wait_reload(1);
+	BOOST_TEST(published.load()->tree().get<int>("value") == 2);
+
+	// an incorrect config is not applied
+	write(R"({"value":)");
+	fs::last_write_time(dir / "test.config", fs::file_time_type::clock::now() + std::chrono::seconds(2));
+	std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+	BOOST_TEST(published.load()->tree().get<int>("value") == 2);
+
+	watcher.stop();
+	fs::remove_all(dir);
+}
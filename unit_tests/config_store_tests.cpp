@@ -0,0 +1,187 @@
+#include <boost/test/unit_test.hpp>
+
+#include "../utility/ConfigStore.h"
+#include "../ConsoleLogger.h"
+
+#include <boost/property_tree/json_parser.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace fs = std::filesystem;
+namespace pt = boost::property_tree;
+
+static const std::string STORE_CONFIG = "store_test.config";
+
+static std::string make_store_dir(const std::string& name)
+{
+	const auto dir = fs::temp_directory_path() / name;
+	fs::remove_all(dir);
+	fs::create_directories(dir);
+
+	std::ofstream(dir / STORE_CONFIG) << R"({
+		"Items": [
+			{ "token": "Item0", "Value": 1, "Enabled": false },
+			{ "token": "Item1", "Value": 2, "Enabled": false }
+		]
+	})";
+
+	return dir.string() + "/";
+}
+
+static utility::config::Change make_change(const std::string& key, int value)
+{
+	pt::ptree item;
+	item.put("token", key);
+	item.put("Value", value);
+	item.put("Enabled", true);
+
+	return { "Items", "token", key, item };
+}
+
+BOOST_AUTO_TEST_CASE(config_store_journal_func)
+{
+	using namespace utility::config;
+
+	const auto dir = make_store_dir("osrv_config_store_journal_test");
+	ConsoleLogger logger(ILogger::LVL_ERR);
+
+	{
+		ConfigStore store(dir, STORE_CONFIG, { "Items" }, logger);
+		const auto before = store.load();
+
+		const auto after = store.commit({ make_change("Item1", 20) });
+		BOOST_TEST(store.load() == after);
+		BOOST_TEST(find_item(after->tree(), "Items", "token", "Item1").get<int>("Value") == 20);
+
+		// a reader keeps its snapshot
+		BOOST_TEST(find_item(before->tree(), "Items", "token", "Item1").get<int>("Value") == 2);
+	}
+
+	// the store is destroyed before the compaction, the change is only in the journal
+	BOOST_TEST(fs::exists(dir + STORE_CONFIG + ".journal"));
+	pt::ptree json;
+	pt::read_json(dir + STORE_CONFIG, json);
+	BOOST_TEST(find_item(json, "Items", "token", "Item1").get<int>("Value") == 2);
+
+	// a line cut by a crash is skipped
+	std::ofstream(dir + STORE_CONFIG + ".journal", std::ios::app) << R"({"changes":[{"array":"Ite)";
+
+	ConfigStore store(dir, STORE_CONFIG, { "Items" }, logger);
+	const auto& item = find_item(store.load()->tree(), "Items", "token", "Item1");
+	BOOST_TEST(item.get<int>("Value") == 20);
+	BOOST_TEST(item.get<bool>("Enabled"));
+}
+
+BOOST_AUTO_TEST_CASE(config_store_transaction_func)
+{
+	using namespace utility::config;
+
+	const auto dir = make_store_dir("osrv_config_store_transaction_test");
+	ConsoleLogger logger(ILogger::LVL_ERR);
+
+	{
+		ConfigStore store(dir, STORE_CONFIG, { "Items" }, logger);
+		const auto before = store.load();
+
+		BOOST_CHECK_THROW(store.commit({ make_change("Item0", 10), make_change("Item2", 30) }), std::out_of_range);
+		BOOST_TEST(store.load() == before);
+	}
+
+	ConfigStore store(dir, STORE_CONFIG, { "Items" }, logger);
+	BOOST_TEST(find_item(store.load()->tree(), "Items", "token", "Item0").get<int>("Value") == 1);
+
+	BOOST_CHECK_THROW(ConfigStore(dir, STORE_CONFIG, { "Items", "Missing" }, logger), std::exception);
+}
+
+BOOST_AUTO_TEST_CASE(config_store_concurrent_func)
+{
+	using namespace utility::config;
+
+	const auto dir = make_store_dir("osrv_config_store_concurrent_test");
+	ConsoleLogger logger(ILogger::LVL_ERR);
+
+	ConfigStore store(dir, STORE_CONFIG, { "Items" }, logger);
+
+	// each thread increments its own field of the same item, so a lost update is seen in the result
+	const int commits = 200;
+	const auto increment = [&store](const std::string& field) {
+		for (int i = 0; i < commits; ++i)
+		{
+			store.commit("Items", "token", "Item0",
+				[&field](pt::ptree& item) { item.put(field, item.get<int>(field, 0) + 1); });
+		}
+	};
+
+	std::thread values(increment, "Value");
+	std::thread counts(increment, "Count");
+	values.join();
+	counts.join();
+
+	const auto& item = find_item(store.load()->tree(), "Items", "token", "Item0");
+	BOOST_TEST(item.get<int>("Value") == 1 + commits);
+	BOOST_TEST(item.get<int>("Count") == commits);
+
+	// nothing is committed if the item is not found or the mutator throws
+	const auto before = store.load();
+	BOOST_CHECK_THROW(store.commit("Items", "token", "Item2", [](pt::ptree&) {}), std::out_of_range);
+	BOOST_CHECK_THROW(store.commit("Items", "token", "Item0",
+		[](pt::ptree&) { throw std::runtime_error("rejected"); }), std::runtime_error);
+	BOOST_TEST(store.load() == before);
+}
+
+BOOST_AUTO_TEST_CASE(config_store_compaction_func)
+{
+	using namespace utility::config;
+
+	const auto dir = make_store_dir("osrv_config_store_compaction_test");
+	ConsoleLogger logger(ILogger::LVL_ERR);
+
+	{
+		ConfigStore store(dir, STORE_CONFIG, { "Items" }, logger);
+		store.commit({ make_change("Item0", 10) });
+		store.commit({ make_change("Item1", 20) });
+		store.compact();
+
+		BOOST_TEST(fs::file_size(dir + STORE_CONFIG + ".journal") == 0u);
+		BOOST_TEST(!fs::exists(dir + STORE_CONFIG + ".journal.compacting"));
+	}
+
+	pt::ptree json;
+	pt::read_json(dir + STORE_CONFIG, json);
+	BOOST_TEST(find_item(json, "Items", "token", "Item0").get<int>("Value") == 10);
+	BOOST_TEST(find_item(json, "Items", "token", "Item1").get<int>("Value") == 20);
+
+	// the compacted config is read as a hand-written one
+	std::ifstream file(dir + STORE_CONFIG);
+	const std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	BOOST_TEST(content.find(R"("Value": 10)") != std::string::npos);
+	BOOST_TEST(content.find(R"("Enabled": true)") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(to_config_json_func)
+{
+	using utility::config::to_config_json;
+
+	pt::ptree tree;
+	tree.put("Name", "Config \"0\"");
+	tree.put("Count", 3);
+	tree.put("Rate", -1.5);
+	tree.put("Enabled", false);
+	tree.put("Version", "1.0.2");
+	pt::ptree list;
+	list.push_back({ "", pt::ptree("1") });
+	list.push_back({ "", pt::ptree("x") });
+	tree.add_child("List", list);
+
+	BOOST_TEST(to_config_json(tree, false)
+		== R"({"Name":"Config \"0\"","Count":3,"Rate":-1.5,"Enabled":false,"Version":"1.0.2","List":[1,"x"]})");
+
+	pt::ptree parsed;
+	std::istringstream is(to_config_json(tree));
+	pt::read_json(is, parsed);
+	BOOST_TEST((parsed == tree));
+}
@@ -17,4 +17,24 @@ BOOST_AUTO_TEST_CASE(system_utc_datetime_func)
 	auto actual2 = posix_time_to_utc(pt::time_from_string(test_date));
 	std::string expected2 = "11:20:42.000000Z";
 	BOOST_TEST(expected2 == actual2);
-}
\ No newline at end of file
+}
+
+BOOST_AUTO_TEST_CASE(parse_duration_func)
+{
+	using namespace utility::datetime;
+
+	BOOST_TEST(parse_duration("PT30S").value().count() == 30000);
+	BOOST_TEST(parse_duration("PT1M").value().count() == 60000);
+	BOOST_TEST(parse_duration("P1DT2H").value().count() == (24 + 2) * 3600 * 1000);
+	BOOST_TEST(parse_duration("PT0.5S").value().count() == 500);
+	BOOST_TEST(parse_duration("PT0S").value().count() == 0);
+
+	BOOST_TEST(!parse_duration(""));
+	BOOST_TEST(!parse_duration("30"));
+	BOOST_TEST(!parse_duration("P"));
+	BOOST_TEST(!parse_duration("PT"));
+	BOOST_TEST(!parse_duration("P1D T"));
+	BOOST_TEST(!parse_duration("P1M")); // months
+	BOOST_TEST(!parse_duration("PT5"));
+	BOOST_TEST(!parse_duration("PT1.2.3S"));
+}
@@ -1,6 +1,11 @@
 #include <boost/test/unit_test.hpp>
 
 #include "../onvif_services/discovery_service.h"
+#include "../onvif_services/discovery/probe_filters.h"
+#include "../onvif_services/discovery/probe_scanner.h"
+#include "../onvif_services/discovery/device_table.h"
+#include "../onvif_services/discovery/announcements.h"
+#include "../utility/Uuid.h"
 #include "../utility/XmlParser.h"
 
 #include <fstream>
@@ -19,16 +24,14 @@ BOOST_AUTO_TEST_CASE(extract_message_id_func)
 	BOOST_TEST("urn:uuid:4ff5ff0e-8478-4491-a547-e8917023ad90" == result);
 }
 
-BOOST_AUTO_TEST_CASE(generate_uuid_func)
+BOOST_AUTO_TEST_CASE(message_id_func)
 {
-	auto res1 = osrv::discovery::utility::generate_uuid("urn:uuid:1419d68a-1dd2-11b2-a105-000000000000");
-	BOOST_TEST(res1 == "urn:uuid:1419d68a-1dd2-11b2-a105-000000000000");
-	
-	auto res2 = osrv::discovery::utility::generate_uuid("urn:uuid:1419d68a-1dd2-11b2-a105-000000000000");
-	BOOST_TEST(res2 == "urn:uuid:1419d68a-1dd2-11b2-a105-000000000001");
-	
-	auto res3 = osrv::discovery::utility::generate_uuid("urn:uuid:1419d68a-1dd2-11b2-a105-000000000000");
-	BOOST_TEST(res3 == "urn:uuid:1419d68a-1dd2-11b2-a105-000000000002");
+	// the ids of the messages aren't repeated
+	const auto res1 = utility::uuid::urn_v4().str();
+	const auto res2 = utility::uuid::urn_v4().str();
+	BOOST_TEST(res1.size() == utility::uuid::URN_LENGTH);
+	BOOST_TEST(res1.compare(0, 9, "urn:uuid:") == 0);
+	BOOST_TEST(res1 != res2);
 }
 
 BOOST_AUTO_TEST_CASE(prepare_resposne_func)
@@ -40,7 +43,7 @@ BOOST_AUTO_TEST_CASE(prepare_resposne_func)
 	std::string response;
 	response.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
 
-	const std::string expected_message_id = osrv::discovery::utility::generate_uuid();
+	const std::string expected_message_id = utility::uuid::urn_v4().str();
 	const std::string expected_relatesTo_id = "urn:uuid:4ff5ff0e-8478-4491-a547-e8917023ad90";
 
 	// this function should replace RelatesTo value in the response
@@ -56,4 +59,244 @@ BOOST_AUTO_TEST_CASE(prepare_resposne_func)
 
 	auto actual_related_to = exns::find_hierarchy("Envelope.Header.RelatesTo", response_tree);
 	BOOST_TEST(actual_related_to == expected_relatesTo_id);
-}
\ No newline at end of file
+}
+BOOST_AUTO_TEST_CASE(response_template_func)
+{
+	const std::string response = "<?xml version=\"1.0\"?><s:Envelope><s:Header>"
+		"<wsa:RelatesTo>uuid:old-relates-to</wsa:RelatesTo>"
+		"<wsa:MessageID SomeAttr=\"1\">uuid:old-message-id</wsa:MessageID>"
+		"</s:Header><s:Body><d:ProbeMatches/></s:Body></s:Envelope>";
+
+	osrv::discovery::utility::ResponseTemplate probe_match(response);
+
+	auto first = probe_match.render("uuid:msg-1", "uuid:probe-1");
+	BOOST_TEST(first == "<?xml version=\"1.0\"?><s:Envelope><s:Header>"
+		"<wsa:RelatesTo>uuid:probe-1</wsa:RelatesTo>"
+		"<wsa:MessageID SomeAttr=\"1\">uuid:msg-1</wsa:MessageID>"
+		"</s:Header><s:Body><d:ProbeMatches/></s:Body></s:Envelope>");
+
+	// every reply is made from the template, not from the previous reply
+	std::string buffer;
+	probe_match.render("uuid:message-id-2", "uuid:2", buffer);
+	auto tree = exns::to_ptree(buffer);
+	BOOST_TEST(exns::find_hierarchy("Envelope.Header.MessageID", tree) == "uuid:message-id-2");
+	BOOST_TEST(exns::find_hierarchy("Envelope.Header.RelatesTo", tree) == "uuid:2");
+	BOOST_TEST(buffer.find("msg-1") == std::string::npos);
+
+	BOOST_CHECK_THROW(osrv::discovery::utility::ResponseTemplate("<s:Envelope/>"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(probes_rate_limiter_func)
+{
+	using osrv::discovery::RateLimiter;
+	using namespace std::chrono_literals;
+
+	RateLimiter limiter(2, 2);
+	auto now = RateLimiter::clock::now();
+
+	// a burst is allowed, then the source waits for new tokens
+	BOOST_TEST(limiter.allow(1, now));
+	BOOST_TEST(limiter.allow(1, now));
+	BOOST_TEST(!limiter.allow(1, now));
+	BOOST_TEST(limiter.allow(1, now + 500ms));
+	BOOST_TEST(!limiter.allow(1, now + 500ms));
+
+	// the sources are limited independently
+	BOOST_TEST(limiter.allow(2, now));
+
+	// when the table is full, only the idle sources are purged
+	BOOST_TEST(limiter.allow(3, now + 10s));
+	BOOST_TEST(limiter.sources_count() <= 2);
+
+	RateLimiter unlimited(0);
+	for (int i = 0; i < 100; ++i)
+		BOOST_TEST(unlimited.allow(1, now));
+}
+
+BOOST_AUTO_TEST_CASE(message_id_cache_func)
+{
+	osrv::discovery::MessageIdCache cache(2);
+
+	BOOST_TEST(cache.insert("urn:uuid:1"));
+	BOOST_TEST(!cache.insert("urn:uuid:1"));
+	BOOST_TEST(cache.insert("urn:uuid:2"));
+
+	// the oldest id is forgotten
+	BOOST_TEST(cache.insert("urn:uuid:3"));
+	BOOST_TEST(cache.insert("urn:uuid:1"));
+	BOOST_TEST(!cache.insert("urn:uuid:3"));
+}
+
+BOOST_AUTO_TEST_CASE(scan_probe_func)
+{
+	using osrv::discovery::ProbeInfo;
+	using osrv::discovery::scan_probe;
+	using osrv::discovery::is_onvif_probe;
+
+	const std::string probe_msg = "<?xml version=\"1.0\" encoding=\"utf-8\"?><soap:Envelope xmlns:soap=\"http://www.w3.org/2003/05/soap-envelope\" xmlns:wsa=\"http://schemas.xmlsoap.org/ws/2004/08/addressing\" xmlns:wsd=\"http://schemas.xmlsoap.org/ws/2005/04/discovery\" xmlns:dn=\"http://www.onvif.org/ver10/network/wsdl\"><soap:Header><wsa:To>urn:schemas-xmlsoap-org:ws:2005:04:discovery</wsa:To><wsa:Action>http://schemas.xmlsoap.org/ws/2005/04/discovery/Probe</wsa:Action><wsa:MessageID> urn:uuid:4ff5ff0e-8478-4491-a547-e8917023ad90 </wsa:MessageID></soap:Header><soap:Body><wsd:Probe><wsd:Types>wsdp:Printer\n dn:NetworkVideoTransmitter</wsd:Types><wsd:Scopes/></wsd:Probe></soap:Body></soap:Envelope>\n";
+
+	ProbeInfo probe;
+	BOOST_TEST(scan_probe(probe_msg, probe));
+	BOOST_TEST(probe.message_id == "urn:uuid:4ff5ff0e-8478-4491-a547-e8917023ad90");
+	BOOST_TEST(probe.has_types);
+	BOOST_TEST(probe.types == "wsdp:Printer\n dn:NetworkVideoTransmitter");
+	BOOST_TEST(probe.has_scopes);
+	BOOST_TEST(probe.scopes.empty());
+	BOOST_TEST(is_onvif_probe(probe));
+
+	// only the local names of the types are compared
+	const std::string printer_probe = "<s:Envelope xmlns:s=\"http://www.w3.org/2003/05/soap-envelope\"><s:Header><a:MessageID>urn:uuid:1</a:MessageID></s:Header><s:Body><d:Probe><d:Types>p:Printer p:DeviceX</d:Types></d:Probe></s:Body></s:Envelope>";
+	BOOST_TEST(scan_probe(printer_probe, probe));
+	BOOST_TEST(!is_onvif_probe(probe));
+
+	// a probe without types matches any device
+	const std::string any_probe = "<Envelope><Header><MessageID>urn:uuid:2</MessageID></Header><Body><Probe/></Body></Envelope>";
+	BOOST_TEST(scan_probe(any_probe, probe));
+	BOOST_TEST(!probe.has_types);
+	BOOST_TEST(is_onvif_probe(probe));
+
+	// MessageID is taken only from the Header
+	const std::string body_id = "<Envelope><Body><Probe><MessageID>urn:uuid:3</MessageID></Probe></Body></Envelope>";
+	BOOST_TEST(scan_probe(body_id, probe));
+	BOOST_TEST(probe.message_id.empty());
+
+	// malformed and other messages
+	const std::vector<std::string> rejected = {
+		"",
+		"garbage",
+		"<Envelope><Body><Probe></Body></Envelope>",
+		"<Envelope><Body><Probe></Probe></Body>",
+		"<Envelope><Body><Resolve/></Body></Envelope>",
+		"<Envelope><Body><Probe/></Body></Envelope><Envelope/>",
+		"<Envelope><Body><Probe/></Body></Envelope>trailing",
+		"text<Envelope><Body><Probe/></Body></Envelope>",
+		"<!DOCTYPE x><Envelope><Body><Probe/></Body></Envelope>",
+		"<Envelope><Body><Probe attr=\"unterminated></Probe></Body></Envelope>",
+		"<Body><Probe/></Body>",
+	};
+	for (const auto& msg : rejected)
+		BOOST_TEST(!scan_probe(msg, probe), msg);
+}
+
+BOOST_AUTO_TEST_CASE(device_table_func)
+{
+	using osrv::discovery::DeviceIdentity;
+	using osrv::discovery::DeviceTable;
+
+	const std::string response_test_file = "../../unit_tests/test_data/discovery_service_test.responses";
+	std::ifstream ifs(response_test_file);
+	BOOST_TEST(true == ifs.is_open());
+
+	std::string response;
+	response.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+
+	// the template's device is used when nothing is configured
+	DeviceTable single(response, {});
+	BOOST_TEST(single.size() == 1);
+	BOOST_TEST(single.fragment(0).find("urn:uuid:1419d68a-1dd2-11b2-a105-0011350303D6") != std::string_view::npos);
+
+	std::vector<std::uint32_t> matched;
+	single.match("onvif://www.onvif.org/name/Evolution12", matched);
+	BOOST_TEST(matched.size() == 1);
+
+	std::vector<DeviceIdentity> devices(3);
+	for (std::size_t i = 0; i < devices.size(); ++i)
+	{
+		devices[i].endpoint_reference = "urn:uuid:00000000-0000-0000-0000-00000000000" + std::to_string(i);
+		devices[i].xaddrs = "http://127.0.0.1:808" + std::to_string(i) + "/onvif/device_service";
+		devices[i].scopes = { "onvif://www.onvif.org/name/Camera" + std::to_string(i),
+			i % 2 ? "onvif://www.onvif.org/location/city/nalchik" : "onvif://www.onvif.org/location/city/moscow/" };
+	}
+	DeviceTable table(response, devices);
+	BOOST_TEST(table.size() == 3);
+	BOOST_TEST(table.fragment(1).find("http://127.0.0.1:8081/onvif/device_service") != std::string_view::npos);
+	BOOST_TEST(table.fragment(1).find("onvif://www.onvif.org/name/Camera1 onvif://www.onvif.org/location/city/nalchik") != std::string_view::npos);
+	// the values which are not configured are taken from the template
+	BOOST_TEST(table.fragment(2).find("tds:Device dn:NetworkVideoTransmitter") != std::string_view::npos);
+
+	table.match("", matched);
+	BOOST_TEST(matched == std::vector<std::uint32_t>({ 0, 1, 2 }));
+
+	// a scope matches the longer ones with the same path prefix
+	table.match("onvif://www.onvif.org/location/city/", matched);
+	BOOST_TEST(matched == std::vector<std::uint32_t>({ 0, 1, 2 }));
+
+	table.match("onvif://www.onvif.org/location/city/moscow onvif://www.onvif.org/name", matched);
+	BOOST_TEST(matched == std::vector<std::uint32_t>({ 0, 2 }));
+
+	table.match("onvif://www.onvif.org/location/city/nalchik onvif://www.onvif.org/name/Camera0", matched);
+	BOOST_TEST(matched.empty());
+
+	// only a part of a path segment doesn't match
+	table.match("onvif://www.onvif.org/name/Cam", matched);
+	BOOST_TEST(matched.empty());
+
+	// the devices are split into datagrams, each of them is a complete message
+	std::vector<std::uint32_t> all = { 0, 1, 2 };
+	std::string reply;
+	auto next = table.render("urn:uuid:1", "urn:uuid:2", all, 0, 0, reply);
+	BOOST_TEST(next == 1);
+
+	const auto one_device_size = reply.size();
+	next = table.render("urn:uuid:1", "urn:uuid:2", all, 0, one_device_size + table.fragment(1).size(), reply);
+	BOOST_TEST(next == 2);
+
+	namespace pt = boost::property_tree;
+	std::istringstream is(reply);
+	pt::ptree reply_tree;
+	pt::xml_parser::read_xml(is, reply_tree);
+
+	BOOST_TEST(exns::find_hierarchy("Envelope.Header.RelatesTo", reply_tree) == "urn:uuid:2");
+	BOOST_TEST(reply_tree.get_child("SOAP-ENV:Envelope.SOAP-ENV:Body.d:ProbeMatches").count("d:ProbeMatch") == 2);
+
+	next = table.render("urn:uuid:1", "urn:uuid:2", all, next, 65536, reply);
+	BOOST_TEST(next == 3);
+}
+
+BOOST_AUTO_TEST_CASE(announcements_func)
+{
+	using osrv::discovery::Announcements;
+	using osrv::discovery::DeviceIdentity;
+	using osrv::discovery::DeviceTable;
+
+	auto read_file = [](const std::string& path) {
+		std::ifstream ifs(path);
+		BOOST_TEST(true == ifs.is_open());
+		return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+	};
+
+	std::vector<DeviceIdentity> devices(2);
+	devices[0].endpoint_reference = "urn:uuid:00000000-0000-0000-0000-000000000000";
+	devices[1].endpoint_reference = "urn:uuid:00000000-0000-0000-0000-000000000001";
+	devices[1].xaddrs = "http://127.0.0.1:8081/onvif/device_service?a=1&b=2";
+	DeviceTable table(read_file("../../unit_tests/test_data/discovery_service_test.responses"), devices);
+
+	Announcements announcements(read_file("../../server_configs/responses/Hello.response"),
+		read_file("../../server_configs/responses/Bye.response"), table, 42);
+	BOOST_TEST(announcements.size() == 2);
+
+	namespace pt = boost::property_tree;
+	auto parse = [](const std::string& msg) {
+		std::istringstream is(msg);
+		pt::ptree tree;
+		pt::xml_parser::read_xml(is, tree);
+		return tree;
+	};
+
+	std::string message;
+	announcements.hello(1).render("urn:uuid:1", 18446744073709551615ull, message);
+	auto hello = parse(message);
+	BOOST_TEST(exns::find_hierarchy("Envelope.Header.MessageID", hello) == "urn:uuid:1");
+	BOOST_TEST(hello.get<std::string>("s:Envelope.s:Header.d:AppSequence.<xmlattr>.InstanceId") == "42");
+	BOOST_TEST(hello.get<std::string>("s:Envelope.s:Header.d:AppSequence.<xmlattr>.MessageNumber") == "18446744073709551615");
+	BOOST_TEST(exns::find_hierarchy("Envelope.Body.Hello.EndpointReference.Address", hello) == devices[1].endpoint_reference);
+	BOOST_TEST(exns::find_hierarchy("Envelope.Body.Hello.XAddrs", hello) == devices[1].xaddrs);
+	// the values which are not configured are the same as in ProbeMatch
+	BOOST_TEST(exns::find_hierarchy("Envelope.Body.Hello.Types", hello) == "tds:Device dn:NetworkVideoTransmitter");
+
+	announcements.bye(0).render("urn:uuid:2", 0, message);
+	auto bye = parse(message);
+	BOOST_TEST(exns::find_hierarchy("Envelope.Header.Action", bye) == "http://schemas.xmlsoap.org/ws/2005/04/discovery/Bye");
+	BOOST_TEST(bye.get<std::string>("s:Envelope.s:Header.d:AppSequence.<xmlattr>.MessageNumber") == "0");
+	BOOST_TEST(exns::find_hierarchy("Envelope.Body.Bye.EndpointReference.Address", bye) == devices[0].endpoint_reference);
+}
@@ -0,0 +1,59 @@
+#include <boost/test/unit_test.hpp>
+
+#include "../utility/MediaProfiles.h"
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+BOOST_AUTO_TEST_CASE(media_profiles_model_func)
+{
+	using namespace utility::media;
+
+	namespace pt = boost::property_tree;
+	pt::ptree configs_file;
+	pt::json_parser::read_json("../../unit_tests/test_data/media2_service_test.config", configs_file);
+
+	MediaProfiles media_profiles(configs_file);
+
+	BOOST_TEST(media_profiles.profiles().size() == 2);
+	BOOST_TEST(media_profiles.video_sources().size() == 1);
+	BOOST_TEST(media_profiles.video_encoders().empty());
+	BOOST_TEST(media_profiles.video_encoders2().size() == 2);
+
+	BOOST_TEST(media_profiles.profile_index("ProfileToken1") == 1);
+	BOOST_TEST(media_profiles.find_profile("NotExistingToken") == nullptr);
+	BOOST_TEST(media_profiles.find_video_source("NotExistingToken") == nullptr);
+
+	auto profile = media_profiles.find_profile("ProfileToken0");
+	BOOST_REQUIRE(profile != nullptr);
+	BOOST_TEST(profile->name == "MainProfile");
+	BOOST_TEST(profile->fixed);
+
+	const auto& vs = media_profiles.video_source_of(*profile);
+	BOOST_TEST(vs.token == "VideoSrcConfigToken0");
+	BOOST_TEST(vs.bounds.width == 1280);
+
+	const auto& ve = media_profiles.video_encoder2_of(*profile);
+	BOOST_TEST(ve.token == "VideoEncoderToken0");
+	BOOST_TEST(ve.h264.has_value());
+	BOOST_TEST(ve.rate_control.has_value());
+
+	// there are no Media1 encoders in the test config
+	BOOST_CHECK_THROW(media_profiles.video_encoder_of(*profile), std::runtime_error);
+
+	// only the first profile has a stream
+	pt::ptree stream_configs;
+	{
+		pt::ptree stream;
+		stream.put("VideoEncoderToken", "VideoEncoderToken0");
+		stream.put("Uri", "Live&HighStream");
+		stream.put("Timeout", "PT0S");
+		stream_configs.push_back({ "", stream });
+	}
+
+	auto streams = media_profiles.resolve_stream_uris(stream_configs);
+	BOOST_TEST(streams.size() == 2);
+	BOOST_TEST(streams[0].has_value());
+	BOOST_TEST(streams[0]->uri == "Live&HighStream");
+	BOOST_TEST(!streams[1].has_value());
+}
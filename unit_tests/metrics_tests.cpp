@@ -0,0 +1,97 @@
+#include <boost/test/unit_test.hpp>
+
+#include "../utility/Metrics.h"
+
+#include <thread>
+
+BOOST_AUTO_TEST_CASE(latency_histogram_buckets_func)
+{
+	using utility::metrics::LatencyHistogram;
+
+	// small values have their own buckets
+	for (std::uint64_t v = 0; v < LatencyHistogram::SUB_BUCKETS_COUNT; ++v)
+	{
+		BOOST_TEST(LatencyHistogram::bucket_index(v) == v);
+		BOOST_TEST(LatencyHistogram::bucket_upper_bound(v) == v + 1);
+	}
+
+	// each value must be less than its bucket's upper bound and not less than the previous one
+	for (std::uint64_t v : { 8ull, 9ull, 15ull, 16ull, 17ull, 100ull, 1000ull, 123456ull, 1ull << 30 })
+	{
+		auto index = LatencyHistogram::bucket_index(v);
+		BOOST_TEST(v < LatencyHistogram::bucket_upper_bound(index));
+		BOOST_TEST(v >= LatencyHistogram::bucket_upper_bound(index - 1));
+	}
+
+	// powers of two are always the bounds of the buckets
+	BOOST_TEST(LatencyHistogram::bucket_upper_bound(LatencyHistogram::bucket_index(1023)) == 1024);
+
+	// too big values are clamped
+	BOOST_TEST(LatencyHistogram::bucket_index(~0ull) == LatencyHistogram::BUCKETS_COUNT - 1);
+}
+
+BOOST_AUTO_TEST_CASE(latency_histogram_percentiles_func)
+{
+	utility::metrics::LatencyHistogram h;
+	BOOST_TEST(h.percentile(50) == 0);
+
+	for (std::uint64_t v = 1; v <= 1000; ++v)
+		h.record(v);
+
+	BOOST_TEST(h.count() == 1000);
+	BOOST_TEST(h.sum() == 500500);
+	BOOST_TEST(h.count_below(512) == 511);
+
+	// relative error should be less than 12.5%
+	auto p50 = h.percentile(50);
+	BOOST_TEST(p50 >= 500);
+	BOOST_TEST(p50 <= 500 * 1.125);
+
+	auto p99 = h.percentile(99);
+	BOOST_TEST(p99 >= 990);
+	BOOST_TEST(p99 <= 990 * 1.125);
+
+	BOOST_TEST(h.max() >= 1000);
+
+	utility::metrics::LatencyHistogram other;
+	other.record(5);
+	h.merge(other);
+	BOOST_TEST(h.count() == 1001);
+	BOOST_TEST(h.percentile(0) == 2);
+}
+
+BOOST_AUTO_TEST_CASE(metrics_to_prometheus_func)
+{
+	using namespace utility::metrics;
+
+	auto id = register_method("test", "Method");
+	BOOST_TEST(register_method("test", "Method") == id);
+	BOOST_TEST(register_method("test", "Other") != id);
+
+	record_request(id, Outcome::OK, std::chrono::microseconds(100));
+	std::thread([id]() {
+		record_request(id, Outcome::AUTH_FAILED, std::chrono::microseconds(20));
+		record_request(id, Outcome::SERVER_ERROR, std::chrono::milliseconds(5));
+	}).join();
+
+	BOOST_TEST(method_latency(id).count() == 3);
+
+	auto queue = make_gauge("test_queue", "Test gauge.", { {"name", "a\"b"} });
+	queue->set(7);
+
+	auto prometheus = to_prometheus();
+
+	const std::string labels = "{service=\"test\",method=\"Method\"}";
+	BOOST_TEST(prometheus.find("onvif_requests_total" + labels + " 3\n") != std::string::npos);
+	BOOST_TEST(prometheus.find("onvif_requests_client_errors_total" + labels + " 1\n") != std::string::npos);
+	BOOST_TEST(prometheus.find("onvif_requests_server_errors_total" + labels + " 1\n") != std::string::npos);
+	BOOST_TEST(prometheus.find("onvif_auth_failures_total" + labels + " 1\n") != std::string::npos);
+	BOOST_TEST(prometheus.find("onvif_request_duration_seconds_bucket{service=\"test\",method=\"Method\",le=\"+Inf\"} 3\n")
+		!= std::string::npos);
+	BOOST_TEST(prometheus.find("# TYPE test_queue gauge\n") != std::string::npos);
+	BOOST_TEST(prometheus.find("test_queue{name=\"a\\\"b\"} 7\n") != std::string::npos);
+
+	// a released metric is not exported anymore
+	queue.reset();
+	BOOST_TEST(to_prometheus().find("test_queue") == std::string::npos);
+}
@@ -0,0 +1,117 @@
+#include <boost/test/unit_test.hpp>
+
+#include "../utility/PtzMotion.h"
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+
+namespace pt = boost::property_tree;
+
+using namespace std::chrono_literals;
+
+BOOST_AUTO_TEST_CASE(ptz_continuous_move_func)
+{
+	using namespace utility::ptz;
+
+	const auto start = Clock::now();
+	Head head(Limits{});
+
+	// a half of the max speed during 4 seconds
+	head.continuous_move({ 0.5f, -0.25f, 1 }, 4s, start);
+	auto status = head.status(start + 1s);
+	BOOST_TEST(status.position.pan == 0.5f, boost::test_tools::tolerance(0.001f));
+	BOOST_TEST(status.position.tilt == -0.25f, boost::test_tools::tolerance(0.001f));
+	BOOST_TEST(status.position.zoom == 0.5f, boost::test_tools::tolerance(0.001f));
+	BOOST_TEST((status.pan_tilt == MoveStatus::MOVING));
+	// the zoom has reached its bound before the timeout
+	status = head.status(start + 3s);
+	BOOST_TEST((status.zoom == MoveStatus::IDLE));
+	BOOST_TEST((status.pan_tilt == MoveStatus::MOVING));
+
+	status = head.status(start + 10s);
+	BOOST_TEST(status.position.pan == 1.0f, boost::test_tools::tolerance(0.001f));
+	BOOST_TEST(status.position.tilt == -1.0f, boost::test_tools::tolerance(0.001f));
+	BOOST_TEST(status.position.zoom == 1.0f, boost::test_tools::tolerance(0.001f));
+	BOOST_TEST((status.pan_tilt == MoveStatus::IDLE));
+
+	// without a timeout it moves until it's stopped
+	head.continuous_move({ -1, 0, 0 }, Clock::duration::zero(), start + 10s);
+	head.stop(true, true, start + 11s);
+	status = head.status(start + 20s);
+	BOOST_TEST(status.position.pan == 0.0f, boost::test_tools::tolerance(0.001f));
+	BOOST_TEST((status.pan_tilt == MoveStatus::IDLE));
+}
+
+BOOST_AUTO_TEST_CASE(ptz_absolute_move_func)
+{
+	using namespace utility::ptz;
+
+	const auto start = Clock::now();
+	Head head(Limits{});
+
+	// the max speed by default
+	head.absolute_move({ 0.5f, 2, 0.25f }, {}, start);
+	// the tilt moves the longest
+	BOOST_TEST(std::chrono::duration<float>(head.idle_at(start) - start).count() == 1.0f,
+		boost::test_tools::tolerance(0.001f));
+	auto status = head.status(start + 250ms);
+	BOOST_TEST(status.position.pan == 0.25f, boost::test_tools::tolerance(0.001f));
+	BOOST_TEST((status.pan_tilt == MoveStatus::MOVING));
+
+	// the target is clamped to the limits
+	status = head.status(start + 5s);
+	BOOST_TEST(status.position.pan == 0.5f, boost::test_tools::tolerance(0.001f));
+	BOOST_TEST(status.position.tilt == 1.0f, boost::test_tools::tolerance(0.001f));
+	BOOST_TEST(status.position.zoom == 0.25f, boost::test_tools::tolerance(0.001f));
+	BOOST_TEST((status.pan_tilt == MoveStatus::IDLE));
+	BOOST_TEST((status.zoom == MoveStatus::IDLE));
+
+	head.relative_move({ -1, -0.5f, 0 }, { 0.5f, 0.5f, 0 }, start + 5s);
+	BOOST_TEST((head.status(start + 6s).pan_tilt == MoveStatus::MOVING));
+	status = head.status(start + 8s);
+	BOOST_TEST(status.position.pan == -0.5f, boost::test_tools::tolerance(0.001f));
+	BOOST_TEST(status.position.tilt == 0.5f, boost::test_tools::tolerance(0.001f));
+	BOOST_TEST((status.pan_tilt == MoveStatus::IDLE));
+}
+
+BOOST_AUTO_TEST_CASE(ptz_limits_func)
+{
+	using namespace utility::ptz;
+
+	pt::ptree node_configs;
+	std::istringstream is(R"({
+		"SupportedPTZSpaces": [
+			{ "space": "AbsolutePanTiltPositionSpace", "XRange": { "Min": -180, "Max": 180 }, "YRange": { "Min": -90, "Max": 0 } },
+			{ "space": "AbsoluteZoomPositionSpace", "XRange": { "Min": 1, "Max": 30 }, "YRange": { "Min": 0, "Max": 0 } }
+		],
+		"MaxPanTiltSpeed": 90,
+		"MaxZoomSpeed": 10
+	})");
+	pt::read_json(is, node_configs);
+
+	const auto limits = read_limits(node_configs);
+	BOOST_TEST(limits.pan.max == 180.0f);
+	BOOST_TEST(limits.tilt.min == -90.0f);
+	BOOST_TEST(limits.zoom.min == 1.0f);
+	BOOST_TEST(limits.pan_tilt_speed == 90.0f);
+
+	const auto start = Clock::now();
+	Head head(limits);
+	BOOST_TEST(head.status(start).position.zoom == 1.0f);
+	head.continuous_move({ 1, 1, 1 }, 1s, start);
+	const auto status = head.status(start + 1s);
+	BOOST_TEST(status.position.pan == 90.0f, boost::test_tools::tolerance(0.001f));
+	BOOST_TEST(status.position.tilt == 0.0f, boost::test_tools::tolerance(0.001f));
+	BOOST_TEST(status.position.zoom == 11.0f, boost::test_tools::tolerance(0.001f));
+
+	// the head is kept within the new limits
+	head.set_limits(Limits{}, start + 1s);
+	BOOST_TEST(head.status(start + 2s).position.pan == 1.0f);
+
+	node_configs.put("MaxZoomSpeed", 0);
+	BOOST_CHECK_THROW(read_limits(node_configs), std::runtime_error);
+}
@@ -0,0 +1,236 @@
+#include <boost/test/unit_test.hpp>
+
+#include "../utility/PtzPresets.h"
+#include "../utility/PtzTours.h"
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pt = boost::property_tree;
+
+using namespace std::chrono_literals;
+
+static pt::ptree read_configs(const std::string& json)
+{
+	pt::ptree result;
+	std::istringstream is(json);
+	pt::read_json(is, result);
+	return result;
+}
+
+static const std::string PRESETS_CONFIG = R"({
+	"NodePresets": [
+		{
+			"NodeToken": "PTZNODE_1",
+			"Presets": [
+				{ "token": "Preset2", "Name": "Gate", "Pan": 0.5, "Tilt": -0.5, "Zoom": 0.25 },
+				{ "token": "Preset1", "Name": "Yard", "Pan": -0.5, "Tilt": 0, "Zoom": 0 }
+			],
+			"PresetTours": [
+				{
+					"token": "Tour1",
+					"RecurringTime": 1,
+					"Spots": [
+						{ "PresetToken": "Preset1", "StayTime": "PT2S" },
+						{ "PresetToken": "Preset2", "Speed": 0.5, "StayTime": "PT1S" }
+					]
+				}
+			]
+		}
+	]
+})";
+
+BOOST_AUTO_TEST_CASE(ptz_presets_func)
+{
+	using namespace utility::ptz;
+
+	const Presets presets(read_configs(PRESETS_CONFIG));
+	BOOST_TEST(presets.find_node("PTZNODE_2") == nullptr);
+
+	const auto* node = presets.find_node("PTZNODE_1");
+	BOOST_REQUIRE(node != nullptr);
+
+	// the order of the config is kept
+	BOOST_REQUIRE(node->presets().size() == 2);
+	BOOST_TEST(node->presets()[0].token == "Preset2");
+	BOOST_TEST(node->presets()[1].token == "Preset1");
+
+	const auto* preset = node->find_preset("Preset2");
+	BOOST_REQUIRE(preset != nullptr);
+	BOOST_TEST(preset->name == "Gate");
+	BOOST_TEST(preset->position.pan == 0.5f);
+	BOOST_TEST(preset->position.zoom == 0.25f);
+	BOOST_TEST(node->find_preset("Preset3") == nullptr);
+	BOOST_TEST(node->new_preset_token() == "Preset3");
+
+	const auto* tour = node->find_tour("Tour1");
+	BOOST_REQUIRE(tour != nullptr);
+	BOOST_TEST(tour->name == "Tour1");
+	BOOST_REQUIRE(tour->spots.size() == 2);
+	BOOST_TEST(tour->spots[0].stay_time.count() == 2000);
+	BOOST_TEST(tour->spots[1].speed == 0.5f);
+
+	// a preset is replaced in its place and a new one is appended
+	const auto configs = read_configs(PRESETS_CONFIG);
+	const auto& node_configs = configs.get_child("NodePresets").front().second;
+	auto changed = set_preset(node_configs, Preset{ "Preset2", "Gate", { 1, 1, 1 } });
+	changed = set_preset(changed, Preset{ "Preset3", "Road", { 0, 0, 0 } });
+	changed = remove_preset(changed, "Preset1");
+
+	const NodePresets changed_node(changed);
+	BOOST_REQUIRE(changed_node.presets().size() == 2);
+	BOOST_TEST(changed_node.presets()[0].token == "Preset2");
+	BOOST_TEST(changed_node.presets()[0].position.pan == 1.0f);
+	BOOST_TEST(changed_node.presets()[1].token == "Preset3");
+	BOOST_TEST(changed_node.find_preset("Preset1") == nullptr);
+
+	// the presets of a node without them
+	const NodePresets empty_node(set_preset(read_configs(R"({ "NodeToken": "PTZNODE_2" })"),
+		Preset{ "Preset1", "Yard", {} }));
+	BOOST_TEST(empty_node.presets().size() == 1);
+
+	BOOST_CHECK_THROW(NodePresets(read_configs(
+		R"({ "Presets": [ { "token": "Preset1" }, { "token": "Preset1" } ] })")), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(ptz_tours_func)
+{
+	using namespace utility::ptz;
+
+	const Presets presets(read_configs(PRESETS_CONFIG));
+	const auto& tour = *presets.find_node("PTZNODE_1")->find_tour("Tour1");
+
+	// each move takes a second
+	std::vector<std::string> moves;
+	TourScheduler scheduler([&moves](const std::string& node_token, const TourSpot& spot, Clock::time_point now)
+		-> std::optional<Clock::time_point> {
+			if (spot.preset_token == "Removed")
+				return std::nullopt;
+
+			moves.push_back(node_token + "/" + spot.preset_token);
+			return now + 1s;
+		});
+
+	const auto start = Clock::now();
+	BOOST_TEST((scheduler.next() == Clock::time_point::max()));
+
+	scheduler.start("PTZNODE_1", tour, start);
+	BOOST_TEST((scheduler.state("PTZNODE_1", "Tour1") == TourState::TOURING));
+	BOOST_TEST((scheduler.next() == start));
+
+	scheduler.run(start);
+	BOOST_TEST(moves == std::vector<std::string>{ "PTZNODE_1/Preset1" });
+	// the move and the stay time
+	BOOST_TEST((scheduler.next() == start + 3s));
+
+	// nothing is due yet
+	scheduler.run(start + 2s);
+	BOOST_TEST(moves.size() == 1);
+
+	scheduler.run(start + 3s);
+	BOOST_TEST(moves.back() == "PTZNODE_1/Preset2");
+	BOOST_TEST((scheduler.next() == start + 5s));
+
+	// it's passed once
+	scheduler.run(start + 5s);
+	BOOST_TEST(moves.size() == 2);
+	BOOST_TEST((scheduler.state("PTZNODE_1", "Tour1") == TourState::IDLE));
+	BOOST_TEST((scheduler.next() == Clock::time_point::max()));
+
+	// the paused tour continues from the next spot
+	moves.clear();
+	scheduler.start("PTZNODE_1", tour, start + 10s);
+	scheduler.run(start + 10s);
+	scheduler.pause("PTZNODE_1", "Tour1");
+	BOOST_TEST((scheduler.state("PTZNODE_1", "Tour1") == TourState::PAUSED));
+	BOOST_TEST((scheduler.next() == Clock::time_point::max()));
+	scheduler.run(start + 20s);
+	BOOST_TEST(moves.size() == 1);
+
+	scheduler.start("PTZNODE_1", tour, start + 30s);
+	scheduler.run(start + 30s);
+	BOOST_TEST(moves.back() == "PTZNODE_1/Preset2");
+
+	// the tours of the other nodes keep running
+	scheduler.start("PTZNODE_2", tour, start + 30s);
+	scheduler.stop_node("PTZNODE_1");
+	BOOST_TEST((scheduler.state("PTZNODE_1", "Tour1") == TourState::IDLE));
+	BOOST_TEST((scheduler.state("PTZNODE_2", "Tour1") == TourState::TOURING));
+	BOOST_TEST((scheduler.next() == start + 30s));
+	scheduler.stop("PTZNODE_2", "Tour1");
+	BOOST_TEST((scheduler.next() == Clock::time_point::max()));
+
+	// the spots with the removed presets are skipped, a tour without any is stopped
+	PresetTour removed;
+	removed.token = "Tour2";
+	removed.spots = { TourSpot{ "Removed", 0, 1s } };
+	scheduler.start("PTZNODE_1", removed, start + 40s);
+	scheduler.run(start + 40s);
+	BOOST_TEST((scheduler.state("PTZNODE_1", "Tour2") == TourState::IDLE));
+
+	BOOST_CHECK_THROW(scheduler.start("PTZNODE_1", PresetTour{}, start), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(ptz_tour_timer_func)
+{
+	using namespace utility::ptz;
+
+	// each tour moves once and stops, the tours are started while the timer runs the earlier ones
+	const int nodes = 50;
+	std::atomic<int> moves{ 0 };
+	TourScheduler scheduler([&moves](const std::string&, const TourSpot&, Clock::time_point now)
+		-> std::optional<Clock::time_point> {
+			++moves;
+			return now;
+		});
+
+	PresetTour tour;
+	tour.token = "Tour1";
+	tour.recurring_time = 1;
+	tour.spots = { TourSpot{ "Preset1", 0, 0ms } };
+
+	boost::asio::io_context io_context;
+	auto work = boost::asio::make_work_guard(io_context);
+	std::thread io_thread([&io_context]() { io_context.run(); });
+
+	const auto timer = std::make_shared<TourTimer>(io_context, scheduler);
+	std::vector<std::thread> starters;
+	for (int i = 0; i < 2; ++i)
+	{
+		starters.emplace_back([&, i]() {
+			for (int node = i; node < nodes; node += 2)
+			{
+				scheduler.start("PTZNODE_" + std::to_string(node), tour);
+				timer->schedule();
+			}
+		});
+	}
+	for (auto& starter : starters)
+		starter.join();
+
+	const auto deadline = Clock::now() + 5s;
+	while (moves < nodes && Clock::now() < deadline)
+		std::this_thread::sleep_for(1ms);
+
+	BOOST_TEST(moves == nodes);
+	BOOST_TEST((scheduler.next() == Clock::time_point::max()));
+
+	// the stopped timer runs no step, the io_context is finished after its handler is cancelled
+	scheduler.start("PTZNODE_0", tour, Clock::now() + 100ms);
+	timer->schedule();
+	timer->stop();
+	timer->schedule();
+	work.reset();
+	io_thread.join();
+
+	BOOST_TEST(moves == nodes);
+}
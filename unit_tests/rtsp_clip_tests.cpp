@@ -0,0 +1,82 @@
+#include <boost/test/unit_test.hpp>
+
+#include "../utility/RtspClip.h"
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace fs = std::filesystem;
+
+// a slice before the first key frame, a key frame with the parameter sets,
+// a picture of two slices and a picture after an access unit delimiter
+static const std::string H264_STREAM = std::string(
+	"\x00\x00\x01\x41\x9a\x01"
+	"\x00\x00\x00\x01\x67\x64\x00\x1f"
+	"\x00\x00\x00\x01\x68\xee\x3c\x80"
+	"\x00\x00\x01\x65\x88\x84\x21"
+	"\x00\x00\x01\x41\x9a\x02"
+	"\x00\x00\x01\x41\x40\x03"
+	"\x00\x00\x00\x01\x09\xf0"
+	"\x00\x00\x01\x41\x9a\x04", 53);
+
+BOOST_AUTO_TEST_CASE(rtsp_clip_index_func)
+{
+	using namespace utility::rtsp;
+
+	const auto access_units = index_access_units(H264_STREAM.data(), H264_STREAM.size(), Codec::H264);
+	BOOST_REQUIRE(access_units.size() == 3);
+
+	BOOST_TEST(access_units[0].offset == 6);
+	BOOST_TEST(access_units[0].size == 23);
+	BOOST_TEST(access_units[0].key_frame);
+
+	BOOST_TEST(access_units[1].offset == 29);
+	BOOST_TEST(access_units[1].size == 12);
+	BOOST_TEST(!access_units[1].key_frame);
+
+	BOOST_TEST(access_units[2].offset == 41);
+	BOOST_TEST(access_units[2].size == 12);
+	BOOST_TEST(!access_units[2].key_frame);
+
+	// a stream without a key frame can't be looped
+	BOOST_CHECK_THROW(index_access_units(H264_STREAM.data(), 6, Codec::H264), std::runtime_error);
+
+	// VPS, SPS, PPS and IDR_W_RADL, then TRAIL_R
+	const std::string h265_stream(
+		"\x00\x00\x00\x01\x40\x01\x0c"
+		"\x00\x00\x00\x01\x42\x01\x01"
+		"\x00\x00\x00\x01\x44\x01\xc1"
+		"\x00\x00\x01\x26\x01\xaf\x05"
+		"\x00\x00\x01\x02\x01\xd0\x06", 35);
+	const auto h265_units = index_access_units(h265_stream.data(), h265_stream.size(), Codec::H265);
+	BOOST_REQUIRE(h265_units.size() == 2);
+	BOOST_TEST(h265_units[0].offset == 0);
+	BOOST_TEST(h265_units[0].key_frame);
+	BOOST_TEST(h265_units[1].offset == 28);
+	BOOST_TEST(!h265_units[1].key_frame);
+}
+
+BOOST_AUTO_TEST_CASE(rtsp_clip_func)
+{
+	using namespace utility::rtsp;
+
+	const auto path = (fs::temp_directory_path() / "osrv_rtsp_clip_test.h264").string();
+	{
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		out.write(H264_STREAM.data(), H264_STREAM.size());
+	}
+
+	const auto clip = Clip::open(path, Codec::H264);
+	BOOST_TEST(clip->size() == H264_STREAM.size());
+	BOOST_TEST(clip->access_units().size() == 3);
+	BOOST_TEST(std::string(clip->data() + clip->access_units()[0].offset, 5) == std::string("\x00\x00\x00\x01\x67", 5));
+
+	// the mounts of the same clip share its mapping
+	BOOST_TEST(Clip::open(path, Codec::H264) == clip);
+
+	BOOST_CHECK_THROW(Clip::open(path + ".missing", Codec::H264), std::runtime_error);
+
+	fs::remove(path);
+}
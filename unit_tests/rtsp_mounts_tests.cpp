@@ -0,0 +1,258 @@
+#include <boost/test/unit_test.hpp>
+
+#include "../utility/RtspMounts.h"
+#include "../ConsoleLogger.h"
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+namespace pt = boost::property_tree;
+
+BOOST_AUTO_TEST_CASE(rtsp_launch_func)
+{
+	using namespace utility::media;
+	using utility::rtsp::make_launch;
+
+	VideoEncoderConfiguration encoder;
+	encoder.encoding = "H264";
+	encoder.resolution = { 1280, 720 };
+	encoder.rate_control = RateControl{};
+	encoder.rate_control->frame_rate_limit = 25;
+	encoder.rate_control->bitrate_limit = 4096;
+	encoder.h264 = H264Configuration{ 30, "Main" };
+
+	BOOST_TEST(make_launch(encoder) == "( videotestsrc is-live=1 ! video/x-raw,width=1280,height=720,framerate=25/1"
+		" ! x264enc bitrate=4096 key-int-max=30 ! video/x-h264,profile=main ! rtph264pay name=pay0 pt=96 )");
+
+	encoder.encoding = "JPEG";
+	encoder.resolution = { 640, 480 };
+	encoder.rate_control->frame_rate_limit = 12.5f;
+	BOOST_TEST(make_launch(encoder) == "( videotestsrc is-live=1 ! video/x-raw,width=640,height=480,framerate=12500/1000"
+		" ! jpegenc ! rtpjpegpay name=pay0 pt=26 )");
+
+	encoder.encoding = "MPEG4";
+	BOOST_CHECK_THROW(make_launch(encoder), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(rtsp_shared_encoding_func)
+{
+	using namespace utility::media;
+	using namespace utility::rtsp;
+
+	VideoEncoderConfiguration encoder;
+	encoder.encoding = "H264";
+	encoder.resolution = { 640, 480 };
+	encoder.h264 = H264Configuration{ 25, "High" };
+
+	StreamOptions options;
+	options.shared_encoding = true;
+
+	BOOST_TEST(make_launch(encoder, options)
+		== "( appsrc name=src is-live=true format=time ! rtph264pay name=pay0 pt=96 config-interval=-1 )");
+	BOOST_TEST(make_shared_encoding(encoder) == "videotestsrc is-live=1 ! video/x-raw,width=640,height=480"
+		" ! x264enc key-int-max=25 ! video/x-h264,profile=high"
+		" ! h264parse ! video/x-h264,stream-format=byte-stream,alignment=au ! appsink name=sink sync=false");
+
+	encoder.encoding = "MPEG4";
+	BOOST_CHECK_THROW(make_launch(encoder, options), std::invalid_argument);
+	BOOST_CHECK_THROW(make_shared_encoding(encoder), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(rtsp_snapshot_func)
+{
+	using namespace utility::media;
+	using namespace utility::rtsp;
+
+	VideoEncoderConfiguration encoder;
+	encoder.token = "VideoEncoderToken0";
+	encoder.encoding = "H264";
+	encoder.resolution = { 640, 480 };
+
+	BOOST_TEST(make_snapshot(encoder) == "videotestsrc num-buffers=1 ! video/x-raw,width=640,height=480"
+		" ! jpegenc snapshot=true ! appsink name=sink");
+
+	// the first frame of the clip
+	StreamOptions options;
+	options.clips[encoder.token] = "clips/high.h264";
+	BOOST_TEST(make_snapshot(encoder, options) == "filesrc location=\"clips/high.h264\" ! h264parse ! decodebin"
+		" ! videoconvert ! jpegenc snapshot=true ! appsink name=sink");
+}
+
+BOOST_AUTO_TEST_CASE(rtsp_presets_func)
+{
+	using namespace utility::media;
+	using namespace utility::rtsp;
+
+	pt::ptree rtsp_configs;
+	std::istringstream is(R"({
+		"preset": "lowLatency",
+		"presets": {
+			"lowLatency": { "speedPreset": "ultrafast", "tune": "zerolatency", "threads": 1 },
+			"quality": { "speedPreset": "medium" },
+			"passthrough": { "passthrough": true }
+		},
+		"encoderPresets": { "VideoEncoderToken1": "quality", "VideoEncoderToken2": "passthrough" }
+	})");
+	pt::read_json(is, rtsp_configs);
+	const auto options = read_stream_options(rtsp_configs);
+
+	VideoEncoderConfiguration encoder;
+	encoder.token = "VideoEncoderToken0";
+	encoder.encoding = "H264";
+	encoder.resolution = { 640, 480 };
+	encoder.h264 = H264Configuration{ 25, "" };
+
+	BOOST_TEST(make_launch(encoder, options) == "( videotestsrc is-live=1 ! video/x-raw,width=640,height=480"
+		" ! x264enc speed-preset=ultrafast tune=zerolatency threads=1 key-int-max=25 ! rtph264pay name=pay0 pt=96 )");
+
+	encoder.token = "VideoEncoderToken1";
+	encoder.encoding = "H265";
+	BOOST_TEST(make_shared_encoding(encoder, options) == "videotestsrc is-live=1 ! video/x-raw,width=640,height=480"
+		" ! x265enc speed-preset=medium key-int-max=25"
+		" ! h265parse ! video/x-h265,stream-format=byte-stream,alignment=au ! appsink name=sink sync=false");
+
+	// nothing can be passed through without a clip
+	encoder.token = "VideoEncoderToken2";
+	BOOST_CHECK_THROW(make_launch(encoder, options), std::invalid_argument);
+
+	auto with_clip = options;
+	with_clip.clips[encoder.token] = "clips/clip.h265";
+	BOOST_TEST(make_launch(encoder, with_clip)
+		== "( appsrc name=src is-live=true format=time ! rtph265pay name=pay0 pt=96 config-interval=-1 )");
+
+	rtsp_configs.put("presets.quality.speedPreset", "fastest");
+	BOOST_CHECK_THROW(read_stream_options(rtsp_configs), std::runtime_error);
+	rtsp_configs.put("presets.quality.speedPreset", "medium");
+	rtsp_configs.put("encoderPresets.VideoEncoderToken0", "unknown");
+	BOOST_CHECK_THROW(read_stream_options(rtsp_configs), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(rtsp_mounts_func)
+{
+	using namespace utility::media;
+
+	pt::ptree configs_file;
+	pt::json_parser::read_json("../../unit_tests/test_data/media2_service_test.config", configs_file);
+	const MediaProfiles profiles(configs_file);
+
+	pt::ptree stream_configs;
+	std::istringstream is(R"([
+		{ "VideoEncoderToken": "VideoEncoderToken0", "Uri": "Live&HighStream" },
+		{ "VideoEncoderToken": "VideoEncoderToken1", "Uri": "Live&LowStream" }
+	])");
+	pt::read_json(is, stream_configs);
+
+	ConsoleLogger logger(ILogger::LVL_ERR);
+	utility::rtsp::StreamOptions options;
+	auto mounts = utility::rtsp::make_mounts(profiles, profiles.resolve_stream_uris(stream_configs), options, logger);
+	BOOST_REQUIRE(mounts.size() == 2);
+	BOOST_TEST(mounts[0].path == "/Live&HighStream");
+	BOOST_TEST(mounts[0].profile_token == "ProfileToken0");
+	BOOST_TEST(mounts[0].encoder.token == "VideoEncoderToken0");
+	BOOST_TEST(mounts[0].launch.find("width=1280,height=720") != std::string::npos);
+	BOOST_TEST(mounts[0].shared_encoding.empty());
+	BOOST_TEST(mounts[1].path == "/Live&LowStream");
+
+	// the mounts with the same encoder's configuration have the same encoding
+	options.shared_encoding = true;
+	mounts = utility::rtsp::make_mounts(profiles, profiles.resolve_stream_uris(stream_configs), options, logger);
+	BOOST_REQUIRE(mounts.size() == 2);
+	BOOST_TEST(!mounts[0].shared_encoding.empty());
+	BOOST_TEST((mounts[0].shared_encoding == mounts[1].shared_encoding));
+	BOOST_TEST(mounts[0].launch == mounts[1].launch);
+
+	// the clip of an encoder is streamed instead of the shared encoding
+	options.clips["VideoEncoderToken1"] = "clips/low.h264";
+	mounts = utility::rtsp::make_mounts(profiles, profiles.resolve_stream_uris(stream_configs), options, logger);
+	BOOST_REQUIRE(mounts.size() == 2);
+	BOOST_TEST(mounts[0].clip.empty());
+	BOOST_TEST(mounts[1].clip == "clips/low.h264");
+	BOOST_TEST(mounts[1].shared_encoding.empty());
+	BOOST_TEST(mounts[1].launch == mounts[0].launch);
+	options.clips.clear();
+
+	// a profile without a URI is not served
+	stream_configs.clear();
+	std::istringstream one_uri(R"([{ "VideoEncoderToken": "VideoEncoderToken0", "Uri": "Live&HighStream" }])");
+	pt::read_json(one_uri, stream_configs);
+	mounts = utility::rtsp::make_mounts(profiles, profiles.resolve_stream_uris(stream_configs), options, logger);
+	BOOST_REQUIRE(mounts.size() == 1);
+	BOOST_TEST(mounts[0].profile_token == "ProfileToken0");
+}
+
+BOOST_AUTO_TEST_CASE(rtsp_sessions_func)
+{
+	using namespace utility::media;
+
+	pt::ptree profiles_configs;
+	pt::json_parser::read_json("../../server_configs/media_profiles.config", profiles_configs);
+	const MediaProfiles profiles(profiles_configs);
+
+	pt::ptree media_configs;
+	pt::json_parser::read_json("../../server_configs/media.config", media_configs);
+
+	// the timeout of the Media1 configuration is used with the Media2 one
+	ConsoleLogger logger(ILogger::LVL_ERR);
+	const auto mounts = utility::rtsp::make_mounts(profiles,
+		profiles.resolve_stream_uris(media_configs.get_child("GetStreamUri")), {}, logger);
+	BOOST_REQUIRE(!mounts.empty());
+	for (const auto& mount : mounts)
+		BOOST_TEST(mount.session_timeout.count() == 30);
+
+	pt::ptree rtsp_configs;
+	std::istringstream is(R"({ "maxSessions": 16, "maxMountSessions": 4, "clientThreads": 2 })");
+	pt::read_json(is, rtsp_configs);
+	const auto options = utility::rtsp::read_session_options(rtsp_configs);
+	BOOST_TEST(options.max_sessions == 16u);
+	BOOST_TEST(options.max_mount_sessions == 4u);
+	BOOST_TEST(options.cleanup_interval == 1u);
+	BOOST_TEST(options.client_threads == 2u);
+
+	rtsp_configs.put("sessionsCleanupInterval", 0);
+	BOOST_CHECK_THROW(utility::rtsp::read_session_options(rtsp_configs), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(rtsp_multicast_func)
+{
+	using namespace utility::media;
+
+	pt::ptree profiles_configs;
+	pt::json_parser::read_json("../../server_configs/media_profiles.config", profiles_configs);
+	auto& encoders = profiles_configs.get_child("VideoEncoderConfigurations");
+	auto& high = encoders.front().second;
+	high.put("Multicast.Address.IPv4Address", "239.0.0.1");
+	high.put("Multicast.Port", 5000);
+	high.put("Multicast.TTL", 4);
+	high.put("Multicast.AutoStart", true);
+	// the RTP port must be even
+	auto& low = std::next(encoders.begin())->second;
+	low.put("Multicast.Address.IPv4Address", "239.0.0.2");
+	low.put("Multicast.Port", 5001);
+
+	pt::ptree media_configs;
+	pt::json_parser::read_json("../../server_configs/media.config", media_configs);
+
+	const MediaProfiles profiles(profiles_configs);
+	ConsoleLogger logger(ILogger::LVL_ERR);
+	auto mounts = utility::rtsp::make_mounts(profiles,
+		profiles.resolve_stream_uris(media_configs.get_child("GetStreamUri")), {}, logger);
+	BOOST_REQUIRE(mounts.size() == 2);
+	BOOST_REQUIRE(mounts[0].multicast);
+	BOOST_TEST(mounts[0].multicast->ipv4_address == "239.0.0.1");
+	BOOST_TEST(mounts[0].multicast->port == 5000);
+	BOOST_TEST(mounts[0].multicast->ttl == 4);
+	BOOST_TEST(mounts[0].multicast->auto_start);
+	BOOST_TEST(!mounts[1].multicast);
+
+	// a unicast address is not a group
+	high.put("Multicast.Address.IPv4Address", "192.168.0.1");
+	const MediaProfiles unicast(profiles_configs);
+	mounts = utility::rtsp::make_mounts(unicast,
+		unicast.resolve_stream_uris(media_configs.get_child("GetStreamUri")), {}, logger);
+	BOOST_REQUIRE(!mounts.empty());
+	BOOST_TEST(!mounts[0].multicast);
+}
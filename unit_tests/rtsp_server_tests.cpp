@@ -0,0 +1,78 @@
+#include <boost/test/unit_test.hpp>
+
+#include "../RtspServer.h"
+#include "../Server.h"
+#include "../ConsoleLogger.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+static const std::string SERVER_CONFIGS_DIR = "../../server_configs/";
+
+// the server is attached to its port by its own thread
+static int wait_for_port(const osrv::rtsp::Server& server)
+{
+	for (int i = 0; i < 100 && server.bound_port() <= 0; ++i)
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+	return server.bound_port();
+}
+
+// the port is free, if it can be bound without SO_REUSEADDR
+static bool is_port_free(int port)
+{
+	using boost::asio::ip::tcp;
+
+	boost::asio::io_context io_context;
+	tcp::acceptor acceptor(io_context);
+	acceptor.open(tcp::v4());
+
+	boost::system::error_code ec;
+	acceptor.bind(tcp::endpoint(boost::asio::ip::make_address_v4("127.0.0.1"), static_cast<unsigned short>(port)), ec);
+
+	return !ec;
+}
+
+BOOST_AUTO_TEST_CASE(rtsp_server_stop_func)
+{
+	ConsoleLogger logger(ILogger::LVL_ERR);
+
+	osrv::ServerConfigs server_configs{};
+	server_configs.ipv4_address_ = "127.0.0.1";
+	// each server gets an ephemeral port
+	server_configs.rtsp_port_ = "0";
+
+	// the servers have their own main contexts, so one of them is stopped without the other
+	osrv::rtsp::Server first(&logger, server_configs, SERVER_CONFIGS_DIR);
+	osrv::rtsp::Server second(&logger, server_configs, SERVER_CONFIGS_DIR);
+	BOOST_TEST(first.bound_port() == -1);
+
+	first.run();
+	second.run();
+
+	const auto first_port = wait_for_port(first);
+	const auto second_port = wait_for_port(second);
+	BOOST_TEST(first_port > 0);
+	BOOST_TEST(second_port > 0);
+	BOOST_TEST(first_port != second_port);
+	BOOST_TEST(!is_port_free(first_port));
+
+	// it returns after the server's thread is joined
+	first.stop();
+	BOOST_TEST(first.bound_port() == -1);
+	BOOST_TEST(is_port_free(first_port));
+
+	BOOST_TEST(second.bound_port() == second_port);
+	BOOST_TEST(!is_port_free(second_port));
+
+	second.stop();
+	BOOST_TEST(is_port_free(second_port));
+
+	// the stopped servers are stopped again by their destructors
+	first.stop();
+	BOOST_TEST(first.bound_port() == -1);
+}
@@ -46,6 +46,25 @@ BOOST_AUTO_TEST_CASE(read_server_configs_func)
 	BOOST_TEST(true == (user.type == USER_TYPE::USER));
 }
 
+BOOST_AUTO_TEST_CASE(read_http_paths_func)
+{
+	pt::ptree configs_tree;
+	pt::read_json("../../unit_tests/test_data/system_users_list_test.config", configs_tree);
+
+	configs_tree.put("snapshots.path", "/snapshots/jpeg");
+	BOOST_TEST(osrv::read_server_configs(configs_tree).snapshots_path_ == "/snapshots/jpeg");
+
+	// the path is put into the route's regex
+	configs_tree.put("snapshots.path", "/snapshot(s)?");
+	BOOST_CHECK_THROW(osrv::read_server_configs(configs_tree), std::runtime_error);
+	configs_tree.put("snapshots.path", "snapshot");
+	BOOST_CHECK_THROW(osrv::read_server_configs(configs_tree), std::runtime_error);
+
+	configs_tree.put("snapshots.path", "/snapshot");
+	configs_tree.put("metrics.path", "/metrics.*");
+	BOOST_CHECK_THROW(osrv::read_server_configs(configs_tree), std::runtime_error);
+}
+
 BOOST_AUTO_TEST_CASE(read_digital_inputs_func)
 {
 	const std::string config_example =
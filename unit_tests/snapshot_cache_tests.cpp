@@ -0,0 +1,70 @@
+#include <boost/test/unit_test.hpp>
+
+#include "../utility/SnapshotCache.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE(snapshot_cache_interval_func)
+{
+	int encoded = 0;
+	auto encode = [&encoded]() { return "frame" + std::to_string(++encoded); };
+
+	utility::SnapshotCache cache(std::chrono::hours(1));
+	const auto first = cache.get("ProfileToken0", encode);
+	BOOST_TEST(*first == "frame1");
+	BOOST_TEST((cache.get("ProfileToken0", encode) == first));
+	BOOST_TEST(*cache.get("ProfileToken1", encode) == "frame2");
+
+	cache.erase("ProfileToken0");
+	BOOST_TEST(*cache.get("ProfileToken0", encode) == "frame3");
+
+	// each request encodes a new frame without the interval
+	utility::SnapshotCache uncached(std::chrono::milliseconds(0));
+	BOOST_TEST(*uncached.get("ProfileToken0", encode) == "frame4");
+	BOOST_TEST(*uncached.get("ProfileToken0", encode) == "frame5");
+
+	utility::SnapshotCache permanent(utility::SnapshotCache::PERMANENT);
+	const auto kept = permanent.get("ProfileToken0", encode);
+	BOOST_TEST(*kept == "frame6");
+	BOOST_TEST((permanent.get("ProfileToken0", encode) == kept));
+	permanent.erase("ProfileToken0");
+	BOOST_TEST(*permanent.get("ProfileToken0", encode) == "frame7");
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_cache_concurrency_func)
+{
+	std::atomic<int> encoded{ 0 };
+	auto encode = [&encoded]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		++encoded;
+		return std::string("frame");
+	};
+
+	utility::SnapshotCache cache(std::chrono::hours(1));
+	std::vector<utility::SnapshotCache::Frame> frames(8);
+	std::vector<std::thread> threads;
+	for (auto& frame : frames)
+		threads.emplace_back([&cache, &encode, &frame]() { frame = cache.get("ProfileToken0", encode); });
+	for (auto& thread : threads)
+		thread.join();
+
+	// the requests share the bytes of one encoding
+	BOOST_TEST(encoded == 1);
+	for (const auto& frame : frames)
+		BOOST_TEST((frame == frames.front()));
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_cache_failure_func)
+{
+	utility::SnapshotCache cache(std::chrono::hours(1));
+	BOOST_CHECK_THROW(cache.get("ProfileToken0", []() -> std::string { throw std::runtime_error("no frame"); }),
+		std::runtime_error);
+
+	// the failure is not cached
+	BOOST_TEST(*cache.get("ProfileToken0", []() { return std::string("frame"); }) == "frame");
+}
@@ -0,0 +1,72 @@
+#include <boost/test/unit_test.hpp>
+
+#include "../utility/Uuid.h"
+
+#include <chrono>
+#include <mutex>
+#include <regex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE(uuid_format_func)
+{
+	const std::regex v4("urn:uuid:[0-9a-f]{8}-[0-9a-f]{4}-4[0-9a-f]{3}-[89ab][0-9a-f]{3}-[0-9a-f]{12}");
+	const std::regex v7("urn:uuid:[0-9a-f]{8}-[0-9a-f]{4}-7[0-9a-f]{3}-[89ab][0-9a-f]{3}-[0-9a-f]{12}");
+
+	for (int i = 0; i < 100; ++i)
+	{
+		const auto urn4 = utility::uuid::urn_v4().str();
+		BOOST_TEST(urn4.size() == utility::uuid::URN_LENGTH);
+		BOOST_TEST(std::regex_match(urn4, v4), urn4);
+
+		const auto urn7 = utility::uuid::urn_v7().str();
+		BOOST_TEST(std::regex_match(urn7, v7), urn7);
+	}
+
+	utility::uuid::Urn urn(utility::uuid::Bytes{ 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef,
+		0xfe, 0xdc, 0xba, 0x98, 0x76, 0x54, 0x32, 0x10 });
+	BOOST_TEST(urn.view() == "urn:uuid:01234567-89ab-cdef-fedc-ba9876543210");
+	BOOST_TEST(urn.uuid() == "01234567-89ab-cdef-fedc-ba9876543210");
+}
+
+BOOST_AUTO_TEST_CASE(uuid_v7_time_func)
+{
+	const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+
+	const auto bytes = utility::uuid::generate_v7();
+	long long timestamp = 0;
+	for (int i = 0; i < 6; ++i)
+		timestamp = (timestamp << 8) | bytes[i];
+
+	BOOST_TEST(timestamp >= ms);
+	BOOST_TEST(timestamp - ms < 1000);
+}
+
+BOOST_AUTO_TEST_CASE(uuid_unique_func)
+{
+	const int THREADS = 4;
+	const int IDS = 10000;
+
+	std::mutex mutex;
+	std::set<std::string> ids;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < THREADS; ++t)
+	{
+		threads.emplace_back([&]() {
+				std::vector<std::string> generated;
+				for (int i = 0; i < IDS; ++i)
+					generated.push_back(utility::uuid::urn_v4().str());
+
+				std::lock_guard<std::mutex> lock(mutex);
+				ids.insert(generated.begin(), generated.end());
+			});
+	}
+
+	for (auto& t : threads)
+		t.join();
+
+	BOOST_TEST(ids.size() == THREADS * IDS);
+}
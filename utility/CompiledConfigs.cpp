@@ -0,0 +1,344 @@
+#include "CompiledConfigs.h"
+#include "MappedFile.h"
+
+#include <boost/property_tree/json_parser.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+namespace pt = boost::property_tree;
+
+namespace
+{
+	const char MAGIC[8] = { 'O', 'S', 'R', 'V', 'C', 'F', 'G', '\0' };
+	const std::uint32_t VERSION = 1;
+	const std::uint32_t NO_CHILDREN = 0;
+
+	struct StringRef
+	{
+		std::uint32_t offset;
+		std::uint32_t length;
+	};
+
+	struct Header
+	{
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t files_count;
+		std::uint32_t nodes_count;
+		std::uint32_t strings_size;
+	};
+
+	struct FileEntry
+	{
+		StringRef name;
+		std::uint32_t root;
+		std::uint32_t reserved;
+		std::int64_t write_time;
+	};
+
+	struct Node
+	{
+		StringRef key;
+		StringRef value;
+		// the children are stored one after another, always after their parent
+		std::uint32_t first_child;
+		std::uint32_t children_count;
+	};
+
+	// the sections follow each other without padding
+	static_assert(sizeof(Header) % alignof(FileEntry) == 0 && sizeof(FileEntry) % alignof(Node) == 0
+		&& sizeof(Node) % alignof(FileEntry) == 0, "the compiled sections must stay aligned");
+
+	class StringTable
+	{
+	public:
+		StringRef add(const std::string& str)
+		{
+			auto it = offsets_.find(str);
+			if (it == offsets_.end())
+			{
+				it = offsets_.emplace(str, static_cast<std::uint32_t>(data_.size())).first;
+				data_ += str;
+			}
+
+			return { it->second, static_cast<std::uint32_t>(str.size()) };
+		}
+
+		const std::string& data() const { return data_; }
+
+	private:
+		std::string data_;
+		std::unordered_map<std::string, std::uint32_t> offsets_;
+	};
+
+	std::uint32_t add_tree(const pt::ptree& tree, std::vector<Node>& nodes, StringTable& strings)
+	{
+		const auto root = static_cast<std::uint32_t>(nodes.size());
+		nodes.push_back({ strings.add(""), strings.add(tree.data()), NO_CHILDREN, 0 });
+
+		// breadth-first, so the children of each node are adjacent
+		std::vector<std::pair<const pt::ptree*, std::uint32_t>> queue{ { &tree, root } };
+		for (std::size_t i = 0; i < queue.size(); ++i)
+		{
+			const auto [node, index] = queue[i];
+			if (node->empty())
+				continue;
+
+			nodes[index].first_child = static_cast<std::uint32_t>(nodes.size());
+			nodes[index].children_count = static_cast<std::uint32_t>(node->size());
+			for (const auto& child : *node)
+			{
+				queue.emplace_back(&child.second, static_cast<std::uint32_t>(nodes.size()));
+				nodes.push_back({ strings.add(child.first), strings.add(child.second.data()), NO_CHILDREN, 0 });
+			}
+		}
+
+		return root;
+	}
+
+	template<typename T>
+	void append(std::string& out, const T& value)
+	{
+		out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	std::int64_t write_time_of(const fs::path& path)
+	{
+		std::error_code ec;
+		const auto time = fs::last_write_time(path, ec);
+		return ec ? 0 : static_cast<std::int64_t>(time.time_since_epoch().count());
+	}
+}
+
+namespace utility::config
+{
+	const std::string COMPILED_CONFIGS_FILE = "configs.bin";
+
+	std::string compile(const std::vector<SourceConfig>& configs)
+	{
+		std::vector<Node> nodes;
+		StringTable strings;
+
+		std::vector<FileEntry> files;
+		files.reserve(configs.size());
+		for (const auto& config : configs)
+		{
+			files.push_back({ strings.add(config.name), 0, 0, config.write_time });
+			files.back().root = add_tree(config.tree, nodes, strings);
+		}
+
+		Header header{};
+		std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		header.files_count = static_cast<std::uint32_t>(files.size());
+		header.nodes_count = static_cast<std::uint32_t>(nodes.size());
+		header.strings_size = static_cast<std::uint32_t>(strings.data().size());
+
+		std::string result;
+		result.reserve(sizeof(header) + files.size() * sizeof(FileEntry) + nodes.size() * sizeof(Node)
+			+ strings.data().size());
+
+		append(result, header);
+		for (const auto& f : files)
+			append(result, f);
+		for (const auto& n : nodes)
+			append(result, n);
+		result += strings.data();
+
+		return result;
+	}
+
+	std::vector<std::string> compile_dir(const std::string& configs_dir, const std::string& output_path)
+	{
+		std::vector<SourceConfig> configs;
+		for (const auto& entry : fs::directory_iterator(configs_dir))
+		{
+			if (!entry.is_regular_file() || entry.path().extension() != ".config")
+				continue;
+
+			SourceConfig config;
+			config.name = entry.path().filename().string();
+			config.write_time = write_time_of(entry.path());
+			pt::read_json(entry.path().string(), config.tree);
+			configs.push_back(std::move(config));
+		}
+
+		// the same input gives the same output
+		std::sort(configs.begin(), configs.end(),
+			[](const SourceConfig& lhs, const SourceConfig& rhs) { return lhs.name < rhs.name; });
+
+		const auto content = compile(configs);
+
+		// written under another name and renamed, so a running server never maps a partially written file
+		const auto tmp_path = output_path + ".tmp";
+		{
+			std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+			if (!out.is_open() || !out.write(content.data(), content.size()))
+				throw std::runtime_error("Could not write the compiled configs: " + tmp_path);
+		}
+		fs::rename(tmp_path, output_path);
+
+		std::vector<std::string> result;
+		for (const auto& config : configs)
+			result.push_back(config.name);
+
+		return result;
+	}
+
+	struct CompiledConfigs::Mapping
+	{
+		explicit Mapping(const std::string& path)
+			: file(path)
+			, data(file.data())
+			, size(file.size())
+		{
+		}
+
+		const MappedFile file;
+		const char* const data;
+		const std::size_t size;
+
+		const Header& header() const { return *reinterpret_cast<const Header*>(data); }
+
+		const FileEntry* files() const { return reinterpret_cast<const FileEntry*>(data + sizeof(Header)); }
+
+		const Node* nodes() const
+		{
+			return reinterpret_cast<const Node*>(data + sizeof(Header) + header().files_count * sizeof(FileEntry));
+		}
+
+		const char* strings() const { return reinterpret_cast<const char*>(nodes() + header().nodes_count); }
+
+		std::string str(StringRef ref) const { return std::string(strings() + ref.offset, ref.length); }
+	};
+
+	CompiledConfigs::CompiledConfigs(const std::string& configs_dir, const std::string& path)
+		: configs_dir_(configs_dir)
+		, mapping_(std::make_unique<Mapping>(path))
+	{
+		const auto& m = *mapping_;
+		auto broken = [&path](const std::string& reason) {
+			return std::runtime_error("The compiled configs " + path + " are broken: " + reason);
+		};
+
+		if (m.size < sizeof(Header) || std::memcmp(m.header().magic, MAGIC, sizeof(MAGIC)) != 0)
+			throw broken("not a compiled configs file");
+		if (m.header().version != VERSION)
+			throw broken("unsupported version " + std::to_string(m.header().version));
+
+		const auto& h = m.header();
+		const auto expected_size = sizeof(Header) + std::uint64_t{ h.files_count } * sizeof(FileEntry)
+			+ std::uint64_t{ h.nodes_count } * sizeof(Node) + h.strings_size;
+		if (m.size != expected_size)
+			throw broken("unexpected size");
+
+		// everything is checked once, so the reading needs no checks
+		auto valid_string = [&h](StringRef ref) {
+			return std::uint64_t{ ref.offset } + ref.length <= h.strings_size;
+		};
+
+		for (std::uint32_t i = 0; i < h.files_count; ++i)
+		{
+			const auto& f = m.files()[i];
+			if (!valid_string(f.name) || f.root >= h.nodes_count)
+				throw broken("incorrect file entry");
+		}
+
+		for (std::uint32_t i = 0; i < h.nodes_count; ++i)
+		{
+			const auto& n = m.nodes()[i];
+			if (!valid_string(n.key) || !valid_string(n.value))
+				throw broken("incorrect string reference");
+
+			// the children after the parent also exclude the cycles
+			if (n.children_count != 0 && (n.first_child <= i
+				|| std::uint64_t{ n.first_child } + n.children_count > h.nodes_count))
+				throw broken("incorrect node");
+		}
+	}
+
+	CompiledConfigs::~CompiledConfigs() = default;
+
+	std::shared_ptr<const CompiledConfigs> CompiledConfigs::instance(const std::string& configs_dir)
+	{
+		static std::mutex m;
+		static std::map<std::string, std::shared_ptr<const CompiledConfigs>> instances;
+
+		std::lock_guard<std::mutex> lock(m);
+		auto it = instances.find(configs_dir);
+		if (it == instances.end())
+		{
+			const auto path = configs_dir + COMPILED_CONFIGS_FILE;
+			std::shared_ptr<const CompiledConfigs> compiled;
+			if (fs::exists(path))
+				compiled = std::make_shared<const CompiledConfigs>(configs_dir, path);
+
+			it = instances.emplace(configs_dir, std::move(compiled)).first;
+		}
+
+		return it->second;
+	}
+
+	std::optional<pt::ptree> CompiledConfigs::read(const std::string& file_name) const
+	{
+		const auto& m = *mapping_;
+
+		const auto files_end = m.files() + m.header().files_count;
+		const auto file = std::find_if(m.files(), files_end,
+			[&](const FileEntry& f) { return f.name.length == file_name.size()
+				&& file_name.compare(0, file_name.size(), m.strings() + f.name.offset, f.name.length) == 0; });
+		if (file == files_end)
+			return std::nullopt;
+
+		// without the JSON file the compiled one is used as is
+		const auto json_write_time = write_time_of(configs_dir_ + file_name);
+		if (json_write_time != 0 && json_write_time != file->write_time)
+			return std::nullopt;
+
+		pt::ptree result(m.str(m.nodes()[file->root].value));
+
+		std::vector<std::pair<pt::ptree*, std::uint32_t>> stack{ { &result, file->root } };
+		while (!stack.empty())
+		{
+			const auto [tree, index] = stack.back();
+			stack.pop_back();
+
+			const auto& node = m.nodes()[index];
+			for (std::uint32_t i = 0; i < node.children_count; ++i)
+			{
+				const auto& child = m.nodes()[node.first_child + i];
+				auto& child_tree = tree->push_back({ m.str(child.key), pt::ptree(m.str(child.value)) })->second;
+				if (child.children_count != 0)
+					stack.emplace_back(&child_tree, node.first_child + i);
+			}
+		}
+
+		return result;
+	}
+
+	std::size_t CompiledConfigs::size() const
+	{
+		return mapping_->header().files_count;
+	}
+
+	pt::ptree read_config(const std::string& configs_dir, const std::string& file_name)
+	{
+		if (auto compiled = CompiledConfigs::instance(configs_dir))
+		{
+			if (auto tree = compiled->read(file_name))
+				return std::move(*tree);
+		}
+
+		pt::ptree result;
+		pt::read_json(configs_dir + file_name, result);
+		return result;
+	}
+}
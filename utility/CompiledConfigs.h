@@ -0,0 +1,66 @@
+#pragma once
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// The configs compiled into one binary file, which is memory-mapped at start instead of parsing JSON.
+// The file contains the trees of all the config files as a flat array of nodes, where the children
+// of a node are stored one after another, and a table of the unique keys and values.
+// A config file, which was modified after the compilation, is read from JSON again,
+// so the compiled file can't hide the changes made by hand.
+namespace utility::config
+{
+	// the name of the compiled file in the configs' directory
+	extern const std::string COMPILED_CONFIGS_FILE;
+
+	struct SourceConfig
+	{
+		std::string name;
+		boost::property_tree::ptree tree;
+		// the modification time of the JSON file, as the count of std::filesystem::file_time_type
+		std::int64_t write_time = 0;
+	};
+
+	// the result is in the native byte order, it's not intended to be moved between machines
+	std::string compile(const std::vector<SourceConfig>& /*configs*/);
+
+	// compiles all "*.config" files of the directory into @output_path,
+	// returns the names of the compiled files, throws if a file could not be parsed or written
+	std::vector<std::string> compile_dir(const std::string& /*configs_dir*/, const std::string& /*output_path*/);
+
+	class CompiledConfigs
+	{
+	public:
+		using ptree = boost::property_tree::ptree;
+
+		// maps the file, throws if it could not be opened or it's not a correct compiled file
+		CompiledConfigs(const std::string& configs_dir, const std::string& path);
+		~CompiledConfigs();
+
+		CompiledConfigs(const CompiledConfigs&) = delete;
+		CompiledConfigs& operator=(const CompiledConfigs&) = delete;
+
+		// the directory is checked only once, returns nullptr if there is no compiled file in it
+		static std::shared_ptr<const CompiledConfigs> instance(const std::string& configs_dir);
+
+		// returns nullopt if the config was not compiled or its JSON file was modified after the compilation
+		std::optional<ptree> read(const std::string& file_name) const;
+
+		std::size_t size() const;
+
+	private:
+		struct Mapping;
+
+		const std::string configs_dir_;
+		std::unique_ptr<Mapping> mapping_;
+	};
+
+	// takes the config from the compiled file if it's possible, otherwise parses the JSON file
+	boost::property_tree::ptree read_config(const std::string& configs_dir, const std::string& file_name);
+}
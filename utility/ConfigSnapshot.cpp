@@ -0,0 +1,39 @@
+#include "ConfigSnapshot.h"
+#include "CompiledConfigs.h"
+
+#include <boost/property_tree/json_parser.hpp>
+
+namespace utility::config
+{
+	ConfigView ConfigView::get_child(const std::string& path) const
+	{
+		return ConfigView(node_->get_child(path));
+	}
+
+	std::optional<ConfigView> ConfigView::get_child_optional(const std::string& path) const
+	{
+		if (auto child = node_->get_child_optional(path))
+			return ConfigView(*child);
+
+		return std::nullopt;
+	}
+
+	std::shared_ptr<const ConfigSnapshot> ConfigSnapshot::read_json(const std::string& path)
+	{
+		boost::property_tree::ptree tree;
+		boost::property_tree::read_json(path, tree);
+
+		return std::make_shared<const ConfigSnapshot>(std::move(tree));
+	}
+
+	std::shared_ptr<const ConfigSnapshot> ConfigSnapshot::read(const std::string& configs_dir, const std::string& file_name)
+	{
+		return std::make_shared<const ConfigSnapshot>(read_config(configs_dir, file_name));
+	}
+
+	void ConfigSnapshot::require(const std::vector<std::string>& paths) const
+	{
+		for (const auto& path : paths)
+			tree_.get_child(path);
+	}
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Read-only access to the services' config files.
+// A config file is read into an immutable ConfigSnapshot, which is shared by pointer.
+// All the accessors return ConfigView, a non-owning reference to a node, so the handlers
+// can freely write `auto node = configs->get_child(...)` without copying the config subtree.
+namespace utility::config
+{
+	class ConfigView
+	{
+	public:
+		using ptree = boost::property_tree::ptree;
+
+		// an iterated item, the node is not copied
+		using value_type = std::pair<const std::string&, ConfigView>;
+
+		class const_iterator
+		{
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = ConfigView::value_type;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = value_type;
+
+			explicit const_iterator(ptree::const_iterator it) : it_(it) {}
+
+			value_type operator*() const { return { it_->first, ConfigView(it_->second) }; }
+			const_iterator& operator++() { ++it_; return *this; }
+			const_iterator operator++(int) { auto tmp = *this; ++it_; return tmp; }
+
+			bool operator==(const const_iterator& other) const { return it_ == other.it_; }
+			bool operator!=(const const_iterator& other) const { return it_ != other.it_; }
+
+		private:
+			ptree::const_iterator it_;
+		};
+
+		explicit ConfigView(const ptree& node) : node_(&node) {}
+
+		// throws boost::property_tree::ptree_bad_path if there is no such child
+		ConfigView get_child(const std::string& path) const;
+		std::optional<ConfigView> get_child_optional(const std::string& path) const;
+
+		template<typename T>
+		T get(const std::string& path) const { return node_->get<T>(path); }
+
+		template<typename T>
+		T get(const std::string& path, const T& default_value) const { return node_->get<T>(path, default_value); }
+
+		std::string get(const std::string& path, const char* default_value) const
+		{
+			return node_->get<std::string>(path, default_value);
+		}
+
+		template<typename T>
+		T get_value() const { return node_->get_value<T>(); }
+
+		const_iterator begin() const { return const_iterator(node_->begin()); }
+		const_iterator end() const { return const_iterator(node_->end()); }
+		std::size_t size() const { return node_->size(); }
+		bool empty() const { return node_->empty(); }
+
+		// to pass the node into the functions which work with ptree
+		const ptree& tree() const { return *node_; }
+
+	private:
+		const ptree* node_;
+	};
+
+	// the whole point of the view is to be copied for free
+	static_assert(std::is_trivially_copyable_v<ConfigView> && sizeof(ConfigView) == sizeof(void*),
+		"ConfigView must not own a config node");
+
+	class ConfigSnapshot
+	{
+	public:
+		using ptree = boost::property_tree::ptree;
+
+		explicit ConfigSnapshot(ptree&& tree) : tree_(std::move(tree)) {}
+
+		// a snapshot is shared only by pointer
+		ConfigSnapshot(const ConfigSnapshot&) = delete;
+		ConfigSnapshot& operator=(const ConfigSnapshot&) = delete;
+
+		// throws if the file could not be read or parsed
+		static std::shared_ptr<const ConfigSnapshot> read_json(const std::string& path);
+
+		// the same, but takes the config from the compiled configs of the directory if they are present
+		static std::shared_ptr<const ConfigSnapshot> read(const std::string& configs_dir, const std::string& file_name);
+
+		// throws boost::property_tree::ptree_bad_path if any of the paths is missing,
+		// it's used to check a reloaded config before it replaces the current one
+		void require(const std::vector<std::string>& /*paths*/) const;
+
+		ConfigView root() const { return ConfigView(tree_); }
+
+		ConfigView get_child(const std::string& path) const { return root().get_child(path); }
+		std::optional<ConfigView> get_child_optional(const std::string& path) const { return root().get_child_optional(path); }
+
+		template<typename T>
+		T get(const std::string& path) const { return tree_.get<T>(path); }
+
+		template<typename T>
+		T get(const std::string& path, const T& default_value) const { return tree_.get<T>(path, default_value); }
+
+		const ptree& tree() const { return tree_; }
+
+	private:
+		const ptree tree_;
+	};
+
+	using ConfigSnapshotSP = std::shared_ptr<const ConfigSnapshot>;
+
+	// A snapshot (or a state derived from it) shared by the request handlers and the configs' reloading.
+	// A handler takes the current snapshot once with load() and keeps it until it's finished,
+	// so all the views it has stay valid, and a reload publishes a new snapshot with store().
+	template<typename T>
+	class Published
+	{
+	public:
+		std::shared_ptr<const T> load() const { return std::atomic_load(&ptr_); }
+		void store(std::shared_ptr<const T> ptr) { std::atomic_store(&ptr_, std::move(ptr)); }
+
+		explicit operator bool() const { return static_cast<bool>(load()); }
+
+	private:
+		std::shared_ptr<const T> ptr_;
+	};
+}
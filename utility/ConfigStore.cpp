@@ -0,0 +1,434 @@
+#include "ConfigStore.h"
+#include "CompiledConfigs.h"
+#include "ConfigWatcher.h"
+
+#include "../Logger.h"
+
+#include <boost/property_tree/json_parser.hpp>
+
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace pt = boost::property_tree;
+
+namespace
+{
+	// the values, which are written without quotes
+	bool is_json_literal(const std::string& value)
+	{
+		static const std::regex number(R"(-?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?)");
+
+		return value == "true" || value == "false" || value == "null" || std::regex_match(value, number);
+	}
+
+	void write_string(const std::string& str, std::string& out)
+	{
+		out += '"';
+		for (const char c : str)
+		{
+			switch (c)
+			{
+			case '"': out += "\\\""; break;
+			case '\\': out += "\\\\"; break;
+			case '\n': out += "\\n"; break;
+			case '\r': out += "\\r"; break;
+			case '\t': out += "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20)
+				{
+					char buffer[8];
+					std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned>(c));
+					out += buffer;
+				}
+				else
+				{
+					out += c;
+				}
+			}
+		}
+		out += '"';
+	}
+
+	void write_node(const pt::ptree& node, bool pretty, std::size_t indent, std::string& out)
+	{
+		if (node.empty())
+		{
+			if (is_json_literal(node.data()))
+				out += node.data();
+			else
+				write_string(node.data(), out);
+			return;
+		}
+
+		// the children without names are the items of an array
+		const bool is_array = node.begin()->first.empty();
+		const auto new_line = [&](std::size_t level) {
+			if (pretty)
+				out.append("\n").append(level * 4, ' ');
+		};
+
+		out += is_array ? '[' : '{';
+		bool first = true;
+		for (const auto& child : node)
+		{
+			if (!first)
+				out += ',';
+			first = false;
+
+			new_line(indent + 1);
+			if (!is_array)
+			{
+				write_string(child.first, out);
+				out += pretty ? ": " : ":";
+			}
+			write_node(child.second, pretty, indent + 1, out);
+		}
+		new_line(indent);
+		out += is_array ? ']' : '}';
+	}
+
+	// the file is replaced only when the new content is on the disk
+	void write_file_synced(const std::string& path, const std::string& content)
+	{
+		const auto tmp_path = path + ".tmp";
+		std::FILE* file = std::fopen(tmp_path.c_str(), "wb");
+		if (file == nullptr)
+			throw std::runtime_error("Could not write a file: " + tmp_path);
+
+		bool written = std::fwrite(content.data(), 1, content.size(), file) == content.size()
+			&& std::fflush(file) == 0;
+#ifdef _WIN32
+		written = written && _commit(_fileno(file)) == 0;
+#else
+		written = written && fsync(fileno(file)) == 0;
+#endif
+		std::fclose(file);
+
+		if (!written)
+			throw std::runtime_error("Could not write a file: " + tmp_path);
+
+		std::filesystem::rename(tmp_path, path);
+	}
+
+	void append_file(const std::string& from, const std::string& to)
+	{
+		std::ifstream in(from, std::ios::binary);
+		if (!in.is_open())
+			return;
+
+		std::ofstream out(to, std::ios::binary | std::ios::app);
+		out << in.rdbuf();
+		if (!out.flush())
+			throw std::runtime_error("Could not write a file: " + to);
+	}
+}
+
+namespace utility::config
+{
+	void apply_change(const Change& change, pt::ptree& tree)
+	{
+		if (auto list = tree.get_child_optional(change.array))
+		{
+			for (auto& item : *list)
+			{
+				if (item.second.get<std::string>(change.key_field, "") == change.key)
+				{
+					item.second = change.item;
+					return;
+				}
+			}
+		}
+
+		throw std::out_of_range("There is no item in " + change.array + " with "
+			+ change.key_field + " equal to " + change.key);
+	}
+
+	const pt::ptree& find_item(const pt::ptree& tree, const std::string& array, const std::string& key_field,
+		const std::string& key)
+	{
+		if (auto list = tree.get_child_optional(array))
+		{
+			for (const auto& item : *list)
+			{
+				if (item.second.get<std::string>(key_field, "") == key)
+					return item.second;
+			}
+		}
+
+		throw std::out_of_range("There is no item in " + array + " with " + key_field + " equal to " + key);
+	}
+
+	std::string to_config_json(const pt::ptree& tree, bool pretty)
+	{
+		std::string result;
+		write_node(tree, pretty, 0, result);
+		if (pretty)
+			result += '\n';
+
+		return result;
+	}
+
+	ConfigStore::ConfigStore(std::string configs_dir, std::string file_name, std::vector<std::string> required, ILogger& logger)
+		: configs_dir_(std::move(configs_dir))
+		, file_name_(std::move(file_name))
+		, journal_path_(configs_dir_ + file_name_ + ".journal")
+		, required_(std::move(required))
+		, logger_(&logger)
+	{
+		snapshot_.store(read(journal_entries_));
+		if (journal_entries_ != 0)
+			logger_->Info("The changes of " + file_name_ + " are restored from the journal: " + std::to_string(journal_entries_));
+
+		journal_.open(journal_path_, std::ios::binary | std::ios::app);
+		if (!journal_.is_open())
+			throw std::runtime_error("Could not open the journal: " + journal_path_);
+
+		compaction_thread_ = std::thread([this]() { run_compaction(); });
+	}
+
+	ConfigStore::~ConfigStore()
+	{
+		{
+			std::lock_guard<std::mutex> lock(write_mutex_);
+			stopped_ = true;
+		}
+		compaction_cv_.notify_all();
+
+		if (compaction_thread_.joinable())
+			compaction_thread_.join();
+	}
+
+	std::shared_ptr<ConfigStore> ConfigStore::instance(const std::string& configs_dir, const std::string& file_name,
+		const std::vector<std::string>& required, ILogger& logger)
+	{
+		static std::mutex m;
+		static std::map<std::string, std::shared_ptr<ConfigStore>> instances;
+
+		std::lock_guard<std::mutex> lock(m);
+		auto& result = instances[configs_dir + file_name];
+		if (!result)
+			result = std::make_shared<ConfigStore>(configs_dir, file_name, required, logger);
+
+		return result;
+	}
+
+	ConfigSnapshotSP ConfigStore::commit(const std::vector<Change>& changes)
+	{
+		std::lock_guard<std::mutex> lock(write_mutex_);
+
+		// the copy is modified, the readers keep using the current snapshot
+		auto tree = snapshot_.load()->tree();
+		for (const auto& change : changes)
+			apply_change(change, tree);
+
+		return append(changes, std::move(tree));
+	}
+
+	ConfigSnapshotSP ConfigStore::commit(const std::string& array, const std::string& key_field, const std::string& key,
+		const Mutator& mutate)
+	{
+		std::lock_guard<std::mutex> lock(write_mutex_);
+
+		auto tree = snapshot_.load()->tree();
+		Change change{ array, key_field, key, find_item(tree, array, key_field, key) };
+		mutate(change.item);
+		apply_change(change, tree);
+
+		return append({ change }, std::move(tree));
+	}
+
+	ConfigSnapshotSP ConfigStore::append(const std::vector<Change>& changes, pt::ptree&& tree)
+	{
+		pt::ptree changes_node;
+		for (const auto& change : changes)
+		{
+			pt::ptree change_node;
+			change_node.put("array", change.array);
+			change_node.put("key_field", change.key_field);
+			change_node.put("key", change.key);
+			change_node.add_child("item", change.item);
+			changes_node.push_back({ "", change_node });
+		}
+
+		pt::ptree transaction;
+		transaction.add_child("changes", changes_node);
+
+		journal_ << to_config_json(transaction, false) << '\n';
+		if (!journal_.flush())
+		{
+			journal_.clear();
+			throw std::runtime_error("Could not write the journal: " + journal_path_);
+		}
+
+		auto snapshot = std::make_shared<const ConfigSnapshot>(std::move(tree));
+		publish(snapshot);
+
+		if (++journal_entries_ == 1 || journal_entries_ >= MAX_JOURNAL_ENTRIES)
+			compaction_cv_.notify_one();
+
+		return snapshot;
+	}
+
+	void ConfigStore::reload()
+	{
+		std::lock_guard<std::mutex> lock(write_mutex_);
+
+		std::size_t journal_entries = 0;
+		publish(read(journal_entries));
+	}
+
+	void ConfigStore::watch(ConfigWatcher& watcher)
+	{
+		std::lock_guard<std::mutex> lock(write_mutex_);
+		if (watched_)
+			return;
+
+		watcher.watch(file_name_, [this]() { reload(); });
+		watched_ = true;
+	}
+
+	void ConfigStore::subscribe(Listener listener)
+	{
+		std::lock_guard<std::mutex> lock(write_mutex_);
+		listeners_.push_back(std::move(listener));
+	}
+
+	void ConfigStore::compact()
+	{
+		const auto compacting_path = journal_path_ + ".compacting";
+
+		ConfigSnapshotSP snapshot;
+		{
+			std::lock_guard<std::mutex> lock(write_mutex_);
+			if (journal_entries_ == 0)
+				return;
+
+			// the compacted entries are kept aside until the config is written,
+			// the next commits go to the empty journal
+			snapshot = snapshot_.load();
+			journal_.close();
+			append_file(journal_path_, compacting_path);
+			journal_.open(journal_path_, std::ios::binary | std::ios::trunc);
+			if (!journal_.is_open())
+				throw std::runtime_error("Could not open the journal: " + journal_path_);
+
+			journal_entries_ = 0;
+		}
+
+		write_file_synced(configs_dir_ + file_name_, to_config_json(snapshot->tree()));
+		std::filesystem::remove(compacting_path);
+
+		logger_->Debug("The journal is compacted into " + file_name_);
+	}
+
+	ConfigSnapshotSP ConfigStore::read(std::size_t& journal_entries) const
+	{
+		auto tree = read_config(configs_dir_, file_name_);
+
+		// the entries of an interrupted compaction are older than the journal, replacing an item twice changes nothing
+		journal_entries = replay(journal_path_ + ".compacting", tree);
+		journal_entries += replay(journal_path_, tree);
+
+		auto snapshot = std::make_shared<const ConfigSnapshot>(std::move(tree));
+		snapshot->require(required_);
+
+		return snapshot;
+	}
+
+	std::size_t ConfigStore::replay(const std::string& journal_path, pt::ptree& tree) const
+	{
+		std::ifstream journal(journal_path, std::ios::binary);
+		if (!journal.is_open())
+			return 0;
+
+		std::size_t count = 0;
+		std::string line;
+		while (std::getline(journal, line))
+		{
+			if (line.empty())
+				continue;
+
+			// a transaction is applied as a whole, the last line may be cut by a crash
+			try
+			{
+				std::istringstream is(line);
+				pt::ptree transaction;
+				pt::read_json(is, transaction);
+
+				auto result = tree;
+				for (const auto& change_node : transaction.get_child("changes"))
+				{
+					Change change;
+					change.array = change_node.second.get<std::string>("array");
+					change.key_field = change_node.second.get<std::string>("key_field");
+					change.key = change_node.second.get<std::string>("key");
+					change.item = change_node.second.get_child("item");
+					apply_change(change, result);
+				}
+
+				tree = std::move(result);
+				++count;
+			}
+			catch (const std::exception& e)
+			{
+				logger_->Warn("A transaction from " + journal_path + " is skipped: " + e.what());
+			}
+		}
+
+		return count;
+	}
+
+	void ConfigStore::publish(ConfigSnapshotSP snapshot)
+	{
+		snapshot_.store(snapshot);
+
+		// the snapshot is already in use, so a failed listener can't cancel it
+		for (const auto& listener : listeners_)
+		{
+			try
+			{
+				listener(snapshot);
+			}
+			catch (const std::exception& e)
+			{
+				logger_->Error("Could not apply the changed " + file_name_ + ": " + e.what());
+			}
+		}
+	}
+
+	void ConfigStore::run_compaction()
+	{
+		std::unique_lock<std::mutex> lock(write_mutex_);
+		while (!stopped_)
+		{
+			compaction_cv_.wait(lock, [this]() { return stopped_ || journal_entries_ != 0; });
+
+			// more commits are collected, unless the journal is long already
+			compaction_cv_.wait_for(lock, COMPACTION_DELAY,
+				[this]() { return stopped_ || journal_entries_ >= MAX_JOURNAL_ENTRIES; });
+			if (stopped_)
+				break;
+
+			lock.unlock();
+			try
+			{
+				compact();
+			}
+			catch (const std::exception& e)
+			{
+				logger_->Error("Could not compact the journal of " + file_name_ + ": " + e.what());
+			}
+			lock.lock();
+		}
+	}
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "ConfigSnapshot.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ILogger;
+
+// A config changed by the Set* requests.
+// The content is an immutable ConfigSnapshot published for the readers, a commit modifies a copy of it
+// and publishes the copy, so the Get* requests never wait for the writers.
+// A committed transaction is appended to "<config>.journal" before it's published, and the journal is merged
+// into the JSON config by the compaction thread later, so a request doesn't wait for the disk.
+// The journal is not synced, the changes survive a crash of the server, but the last of them
+// may be lost with a crash of the machine.
+namespace utility::config
+{
+	class ConfigWatcher;
+
+	// replaces the item of the list @array, which has the field @key_field equal to @key, with @item
+	struct Change
+	{
+		std::string array;
+		std::string key_field;
+		std::string key;
+		boost::property_tree::ptree item;
+	};
+
+	// throws std::out_of_range if there is no such item
+	void apply_change(const Change& /*change*/, boost::property_tree::ptree& /*tree*/);
+
+	// the item of the list @array, which has the field @key_field equal to @key,
+	// throws std::out_of_range if there is no such item
+	const boost::property_tree::ptree& find_item(const boost::property_tree::ptree& /*tree*/,
+		const std::string& /*array*/, const std::string& /*key_field*/, const std::string& /*key*/);
+
+	// writes the tree in JSON with the numbers and the booleans unquoted, as the configs are written by hand,
+	// not @pretty JSON is written in one line
+	std::string to_config_json(const boost::property_tree::ptree& /*tree*/, bool pretty = true);
+
+	class ConfigStore
+	{
+	public:
+		// called with the new snapshot after each commit or reload, under the store's lock,
+		// so a listener must not commit into the same store
+		using Listener = std::function<void(const ConfigSnapshotSP&)>;
+
+		// the delay collects several commits into one compaction
+		static constexpr std::chrono::milliseconds COMPACTION_DELAY{ 1000 };
+		// a longer journal is compacted without the delay
+		static constexpr std::size_t MAX_JOURNAL_ENTRIES = 1024;
+
+		// reads the config and applies the journal left by the previous run,
+		// throws if the config could not be read or any of the @required paths is missing
+		ConfigStore(std::string configs_dir, std::string file_name, std::vector<std::string> required, ILogger& logger);
+
+		// the not compacted changes stay in the journal until the next start
+		~ConfigStore();
+
+		ConfigStore(const ConfigStore&) = delete;
+		ConfigStore& operator=(const ConfigStore&) = delete;
+
+		// the services, which use the same config, share a store, the first call creates it
+		static std::shared_ptr<ConfigStore> instance(const std::string& configs_dir, const std::string& file_name,
+			const std::vector<std::string>& required, ILogger& logger);
+
+		ConfigSnapshotSP load() const { return snapshot_.load(); }
+
+		// changes a copy of an item, it's called under the store's lock, so it must not commit into the same store
+		using Mutator = std::function<void(boost::property_tree::ptree& item)>;
+
+		// applies all the changes or none of them, throws std::out_of_range if an item is not found
+		ConfigSnapshotSP commit(const std::vector<Change>& /*changes*/);
+		// changes the item of the current config under the store's lock, so the concurrent commits of the item
+		// don't lose each other's fields. Nothing is committed if @mutate throws,
+		// throws std::out_of_range if there is no such item
+		ConfigSnapshotSP commit(const std::string& array, const std::string& key_field, const std::string& key,
+			const Mutator& mutate);
+
+		// re-reads the JSON config, e.g. after it's edited by hand, with the not compacted journal on top of it
+		void reload();
+
+		// reloads the store when its config is changed, several calls register it only once
+		void watch(ConfigWatcher& /*watcher*/);
+
+		void subscribe(Listener listener);
+
+		// writes the current snapshot into the JSON config and clears the journal,
+		// it's called by the compaction thread, but may be called directly
+		void compact();
+
+		const std::string& file_name() const { return file_name_; }
+
+	private:
+		ConfigSnapshotSP read(std::size_t& journal_entries) const;
+		// writes the journal entry and publishes the changed tree, it's called under write_mutex_
+		ConfigSnapshotSP append(const std::vector<Change>& changes, boost::property_tree::ptree&& tree);
+		// returns the number of the applied transactions
+		std::size_t replay(const std::string& journal_path, boost::property_tree::ptree& tree) const;
+		void publish(ConfigSnapshotSP snapshot);
+		void run_compaction();
+
+		const std::string configs_dir_;
+		const std::string file_name_;
+		const std::string journal_path_;
+		const std::vector<std::string> required_;
+		ILogger* logger_;
+
+		Published<ConfigSnapshot> snapshot_;
+
+		// serializes the writers, the readers take only the published snapshot
+		std::mutex write_mutex_;
+		std::ofstream journal_;
+		std::size_t journal_entries_ = 0;
+		std::vector<Listener> listeners_;
+		bool watched_ = false;
+
+		std::condition_variable compaction_cv_;
+		bool stopped_ = false;
+		std::thread compaction_thread_;
+	};
+
+	using ConfigStoreSP = std::shared_ptr<ConfigStore>;
+}
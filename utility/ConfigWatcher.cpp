@@ -0,0 +1,155 @@
+#include "ConfigWatcher.h"
+
+#include "../Logger.h"
+
+#include <chrono>
+#include <filesystem>
+#include <set>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace utility::config
+{
+	// editors usually write a file by several operations, so the changes are collected for a while
+	static const std::chrono::milliseconds SETTLE_TIME{ 200 };
+
+	ConfigWatcher::ConfigWatcher(std::string configs_dir, ILogger& logger)
+		: configs_dir_(std::move(configs_dir))
+		, logger_(&logger)
+	{
+	}
+
+	ConfigWatcher::~ConfigWatcher()
+	{
+		stop();
+	}
+
+	void ConfigWatcher::watch(const std::string& file_name, Reload reload)
+	{
+		reloads_[file_name].push_back(std::move(reload));
+	}
+
+	void ConfigWatcher::start()
+	{
+		if (worker_ || reloads_.empty())
+			return;
+
+		stopped_ = false;
+		worker_ = std::make_unique<std::thread>([this]() { run(); });
+
+		logger_->Info("Watching the configs for changes in: " + configs_dir_);
+	}
+
+	void ConfigWatcher::stop()
+	{
+		stopped_ = true;
+
+		if (worker_ && worker_->joinable())
+			worker_->join();
+
+		worker_.reset();
+	}
+
+	void ConfigWatcher::reload(const std::string& file_name)
+	{
+		auto it = reloads_.find(file_name);
+		if (it == reloads_.end())
+			return;
+
+		logger_->Info("Reloading the changed config: " + file_name);
+
+		for (const auto& reload : it->second)
+		{
+			try
+			{
+				reload();
+			}
+			catch (const std::exception& e)
+			{
+				logger_->Error("The config " + file_name + " is not applied, the previous one is kept: " + e.what());
+			}
+		}
+	}
+
+#ifdef __linux__
+	void ConfigWatcher::run()
+	{
+		const int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (fd < 0 || inotify_add_watch(fd, configs_dir_.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+		{
+			logger_->Error("Can't watch the configs in: " + configs_dir_);
+			if (fd >= 0)
+				close(fd);
+			return;
+		}
+
+		std::set<std::string> changed;
+		auto settled_at = std::chrono::steady_clock::now();
+
+		alignas(inotify_event) char buffer[4096];
+		while (!stopped_)
+		{
+			pollfd pfd{ fd, POLLIN, 0 };
+			if (poll(&pfd, 1, static_cast<int>(SETTLE_TIME.count())) > 0)
+			{
+				for (auto length = read(fd, buffer, sizeof(buffer)); length > 0; length = read(fd, buffer, sizeof(buffer)))
+				{
+					for (auto ptr = buffer; ptr < buffer + length;)
+					{
+						const auto event = reinterpret_cast<const inotify_event*>(ptr);
+						if (event->len && reloads_.count(event->name))
+						{
+							changed.insert(event->name);
+							settled_at = std::chrono::steady_clock::now() + SETTLE_TIME;
+						}
+
+						ptr += sizeof(inotify_event) + event->len;
+					}
+				}
+			}
+
+			if (!changed.empty() && std::chrono::steady_clock::now() >= settled_at)
+			{
+				for (const auto& file_name : changed)
+					reload(file_name);
+				changed.clear();
+			}
+		}
+
+		close(fd);
+	}
+#else
+	void ConfigWatcher::run()
+	{
+		namespace fs = std::filesystem;
+
+		auto write_time = [this](const std::string& file_name) {
+			std::error_code ec;
+			return fs::last_write_time(fs::path(configs_dir_) / file_name, ec);
+		};
+
+		std::map<std::string, fs::file_time_type> write_times;
+		for (const auto& r : reloads_)
+			write_times[r.first] = write_time(r.first);
+
+		while (!stopped_)
+		{
+			std::this_thread::sleep_for(SETTLE_TIME);
+
+			for (auto& [file_name, time] : write_times)
+			{
+				auto current = write_time(file_name);
+				if (current != time)
+				{
+					time = current;
+					reload(file_name);
+				}
+			}
+		}
+	}
+#endif
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ILogger;
+
+namespace utility::config
+{
+	// Watches the configs' directory and calls the reloads of the changed files in its own thread.
+	// On Linux the changes are taken from inotify, on other platforms the files' modification times are polled.
+	// A reload should re-read and check a file, and publish the new snapshot only if it's correct,
+	// an exception thrown by a reload is logged and the previous configs stay in use.
+	class ConfigWatcher
+	{
+	public:
+		using Reload = std::function<void()>;
+
+		ConfigWatcher(std::string configs_dir, ILogger& logger);
+		~ConfigWatcher();
+
+		ConfigWatcher(const ConfigWatcher&) = delete;
+		ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+		// several reloads may be called for the same file, should be called before start()
+		void watch(const std::string& file_name, Reload reload);
+
+		void start();
+		void stop();
+
+	private:
+		void run();
+		void reload(const std::string& file_name);
+
+		const std::string configs_dir_;
+		ILogger* logger_;
+
+		std::map<std::string, std::vector<Reload>> reloads_;
+
+		std::atomic<bool> stopped_{ false };
+		std::unique_ptr<std::thread> worker_;
+	};
+}
@@ -1,6 +1,12 @@
 #pragma once
 
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <optional>
 #include <sstream>
+#include <string>
 
 #include <boost/date_time/posix_time/posix_time.hpp>
 
@@ -52,5 +58,61 @@ namespace utility
 			return posix_time_to_utc(pt::microsec_clock::universal_time());
 
 		}
+
+		// xs:duration without years and months, e.g. "PT30S", "P1DT12H", "PT0.5S",
+		// returns nullopt if it's not correct
+		inline std::optional<std::chrono::milliseconds> parse_duration(const std::string& duration)
+		{
+			if (duration.size() < 2 || duration[0] != 'P')
+				return std::nullopt;
+
+			double milliseconds = 0;
+			bool time = false;
+			bool has_value = false;
+			for (std::size_t i = 1; i < duration.size();)
+			{
+				if (duration[i] == 'T')
+				{
+					if (time)
+						return std::nullopt;
+
+					time = true;
+					++i;
+					continue;
+				}
+
+				std::size_t end = i;
+				while (end < duration.size() && (std::isdigit(static_cast<unsigned char>(duration[end])) || duration[end] == '.'))
+					++end;
+				if (end == i || end == duration.size())
+					return std::nullopt;
+
+				char* parsed_end = nullptr;
+				const auto number = duration.substr(i, end - i);
+				const double value = std::strtod(number.c_str(), &parsed_end);
+				if (parsed_end != number.c_str() + number.size())
+					return std::nullopt;
+
+				const char unit = duration[end];
+				if (!time && unit == 'D')
+					milliseconds += value * 24 * 60 * 60 * 1000;
+				else if (time && unit == 'H')
+					milliseconds += value * 60 * 60 * 1000;
+				else if (time && unit == 'M')
+					milliseconds += value * 60 * 1000;
+				else if (time && unit == 'S')
+					milliseconds += value * 1000;
+				else
+					return std::nullopt;
+
+				has_value = true;
+				i = end + 1;
+			}
+
+			if (!has_value || duration.back() == 'T')
+				return std::nullopt;
+
+			return std::chrono::milliseconds(std::llround(milliseconds));
+		}
 	}
-}
\ No newline at end of file
+}
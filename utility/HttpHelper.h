@@ -1,6 +1,7 @@
 #pragma once
 
 #include "AuthHelper.h"
+#include "Metrics.h"
 
 #include "../Simple-Web-Server/server_http.hpp"
 
@@ -98,11 +99,25 @@ namespace utility
 				return security_level_;
 			}
 
+			// an id is assigned when a service is initialized
+			void set_metrics_id(metrics::method_id_t id)
+			{
+				metrics_id_ = id;
+			}
+
+			metrics::method_id_t get_metrics_id() const
+			{
+				return metrics_id_;
+			}
+
 		private:
 			//Method name should be exactly match the name in the specification
 			std::string name_;
 
 			osrv::auth::SECURITY_LEVELS security_level_;
+
+			// requests of a handler without an id are not counted
+			metrics::method_id_t metrics_id_ = metrics::MAX_METHODS;
 		};
 		using HandlerSP = std::shared_ptr<RequestHandlerBase>;
 	}
@@ -0,0 +1,89 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace utility
+{
+#ifdef _WIN32
+	MappedFile::MappedFile(const std::string& path)
+	{
+		file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file_ == INVALID_HANDLE_VALUE)
+			throw std::runtime_error("Could not open the file: " + path);
+
+		LARGE_INTEGER file_size{};
+		GetFileSizeEx(file_, &file_size);
+		size_ = static_cast<std::size_t>(file_size.QuadPart);
+		if (size_ == 0)
+			return;
+
+		mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping_ != nullptr)
+			data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+		if (data_ == nullptr)
+		{
+			release();
+			throw std::runtime_error("Could not map the file: " + path);
+		}
+	}
+
+	void MappedFile::release()
+	{
+		if (data_ != nullptr)
+			UnmapViewOfFile(data_);
+		if (mapping_ != nullptr)
+			CloseHandle(mapping_);
+		if (file_ != INVALID_HANDLE_VALUE)
+			CloseHandle(file_);
+
+		data_ = nullptr;
+		mapping_ = nullptr;
+		file_ = INVALID_HANDLE_VALUE;
+	}
+#else
+	MappedFile::MappedFile(const std::string& path)
+	{
+		const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+			throw std::runtime_error("Could not open the file: " + path);
+
+		struct stat st {};
+		if (fstat(fd, &st) == 0 && st.st_size > 0)
+		{
+			size_ = static_cast<std::size_t>(st.st_size);
+			void* ptr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+			data_ = ptr != MAP_FAILED ? static_cast<const char*>(ptr) : nullptr;
+		}
+		close(fd);
+
+		if (size_ != 0 && data_ == nullptr)
+			throw std::runtime_error("Could not map the file: " + path);
+	}
+
+	void MappedFile::release()
+	{
+		if (data_ != nullptr)
+			munmap(const_cast<char*>(data_), size_);
+
+		data_ = nullptr;
+	}
+#endif
+
+	MappedFile::~MappedFile()
+	{
+		release();
+	}
+}
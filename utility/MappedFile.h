@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace utility
+{
+	// A read-only memory mapping of a whole file.
+	// The pages are loaded on demand and shared with the other processes mapping the same file.
+	class MappedFile
+	{
+	public:
+		// throws std::runtime_error if the file could not be opened or mapped
+		explicit MappedFile(const std::string& path);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		// nullptr for an empty file
+		const char* data() const { return data_; }
+		std::size_t size() const { return size_; }
+
+	private:
+		void release();
+
+		const char* data_ = nullptr;
+		std::size_t size_ = 0;
+
+#ifdef _WIN32
+		void* file_;
+		void* mapping_ = nullptr;
+#endif
+	};
+}
@@ -0,0 +1,254 @@
+#include "MediaProfiles.h"
+#include "ConfigStore.h"
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+namespace pt = boost::property_tree;
+
+namespace
+{
+	using namespace utility::media;
+
+	VideoSourceConfiguration read_video_source(const pt::ptree& node)
+	{
+		VideoSourceConfiguration result;
+		result.token = node.get<std::string>("token");
+		result.name = node.get<std::string>("Name");
+		result.use_count = node.get<int>("UseCount");
+		result.view_mode = node.get<std::string>("ViewMode");
+		result.source_token = node.get<std::string>("SourceToken");
+		result.bounds.x = node.get<int>("Bounds.x");
+		result.bounds.y = node.get<int>("Bounds.y");
+		result.bounds.width = node.get<int>("Bounds.width");
+		result.bounds.height = node.get<int>("Bounds.height");
+
+		return result;
+	}
+
+	void read_encoder_common(const pt::ptree& node, VideoEncoderConfiguration& result)
+	{
+		result.token = node.get<std::string>("token");
+		result.name = node.get<std::string>("Name");
+		result.use_count = node.get<int>("UseCount");
+		result.encoding = node.get<std::string>("Encoding");
+		result.resolution.width = node.get<int>("Resolution.Width");
+		result.resolution.height = node.get<int>("Resolution.Height");
+		result.quality = node.get<float>("Quality");
+	}
+
+	// "VideoEncoderConfigurations" list item
+	VideoEncoderConfiguration read_video_encoder(const pt::ptree& node)
+	{
+		VideoEncoderConfiguration result;
+		read_encoder_common(node, result);
+
+		if (auto rc_node = node.get_child_optional("RateControl"))
+		{
+			RateControl rc;
+			rc.guaranteed_frame_rate = rc_node->get<bool>("GuaranteedFrameRate");
+			rc.frame_rate_limit = rc_node->get<float>("FrameRateLimit");
+			rc.encoding_interval = rc_node->get<int>("EncodingInterval");
+			rc.bitrate_limit = rc_node->get<int>("BitrateLimit");
+			result.rate_control = rc;
+		}
+
+		if (auto h264_node = node.get_child_optional("H264"))
+			result.h264 = H264Configuration{ h264_node->get<int>("GovLength"), h264_node->get<std::string>("H264Profile") };
+
+		if (auto multicast_node = node.get_child_optional("Multicast"))
+		{
+			Multicast multicast;
+			multicast.address_type = multicast_node->get<std::string>("Address.Type");
+			multicast.ipv4_address = multicast_node->get<std::string>("Address.IPv4Address");
+			multicast.port = multicast_node->get<int>("Port");
+			multicast.ttl = multicast_node->get<int>("TTL");
+			multicast.auto_start = multicast_node->get<bool>("AutoStart");
+			result.multicast = multicast;
+		}
+
+		result.session_timeout = node.get<std::string>("SessionTimeout", "");
+
+		return result;
+	}
+
+	// "VideoEncoderConfigurations2" list item
+	VideoEncoderConfiguration read_video_encoder2(const pt::ptree& node)
+	{
+		VideoEncoderConfiguration result;
+		read_encoder_common(node, result);
+
+		result.h264 = H264Configuration{ node.get<int>("GovLength"), node.get<std::string>("Profile") };
+
+		RateControl rc;
+		rc.guaranteed_frame_rate = node.get<bool>("GuaranteedFrameRate");
+		rc.constant_bitrate = node.get<bool>("RateControl.ConstantBitRate");
+		rc.frame_rate_limit = node.get<float>("RateControl.FrameRateLimit");
+		rc.bitrate_limit = node.get<int>("RateControl.BitrateLimit");
+		result.rate_control = rc;
+
+		return result;
+	}
+
+	template<typename T, typename Reader>
+	void read_list(const pt::ptree& configs, const std::string& name, Reader reader,
+		std::vector<T>& result)
+	{
+		auto list = configs.get_child_optional(name);
+		if (!list)
+			return;
+
+		result.reserve(list->size());
+		for (const auto& item : *list)
+			result.push_back(reader(item.second));
+	}
+
+	std::size_t index_of(const std::unordered_map<std::string, std::size_t>& index, const std::string& token)
+	{
+		auto it = index.find(token);
+		return it != index.end() ? it->second : NOT_FOUND;
+	}
+}
+
+namespace utility::media
+{
+	MediaProfiles::MediaProfiles(const pt::ptree& configs)
+	{
+		read_list(configs, "VideoSourceConfigurations", read_video_source, video_sources_);
+		read_list(configs, "VideoEncoderConfigurations", read_video_encoder, video_encoders_);
+		read_list(configs, "VideoEncoderConfigurations2", read_video_encoder2, video_encoders2_);
+
+		for (std::size_t i = 0; i < video_sources_.size(); ++i)
+			video_sources_index_.emplace(video_sources_[i].token, i);
+
+		std::unordered_map<std::string, std::size_t> encoders_index;
+		for (std::size_t i = 0; i < video_encoders_.size(); ++i)
+			encoders_index.emplace(video_encoders_[i].token, i);
+
+		std::unordered_map<std::string, std::size_t> encoders2_index;
+		for (std::size_t i = 0; i < video_encoders2_.size(); ++i)
+			encoders2_index.emplace(video_encoders2_[i].token, i);
+
+		read_list(configs, "MediaProfiles",
+			[&](const pt::ptree& node)
+			{
+				Profile profile;
+				profile.token = node.get<std::string>("token");
+				profile.fixed = node.get<bool>("fixed");
+				profile.name = node.get<std::string>("Name");
+				profile.video_source_token = node.get<std::string>("VideoSourceConfiguration");
+				profile.video_encoder_token = node.get<std::string>("VideoEncoderConfiguration");
+				profile.ptz_configuration_token = node.get<std::string>("PTZConfiguration", "");
+
+				profile.video_source = index_of(video_sources_index_, profile.video_source_token);
+				profile.video_encoder = index_of(encoders_index, profile.video_encoder_token);
+				profile.video_encoder2 = index_of(encoders2_index, profile.video_encoder_token);
+
+				return profile;
+			},
+			profiles_);
+
+		for (std::size_t i = 0; i < profiles_.size(); ++i)
+			profiles_index_.emplace(profiles_[i].token, i);
+	}
+
+	const std::string MediaProfiles::CONFIG_FILE = "media_profiles.config";
+
+	std::shared_ptr<config::ConfigStore> MediaProfiles::store(const std::string& configs_dir, ILogger& logger)
+	{
+		return config::ConfigStore::instance(configs_dir, CONFIG_FILE,
+			{ "MediaProfiles", "VideoSourceConfigurations", "VideoEncoderConfigurationOptions2" }, logger);
+	}
+
+	std::shared_ptr<const MediaProfiles> MediaProfiles::instance(const config::ConfigSnapshotSP& configs)
+	{
+		static std::mutex m;
+		// the snapshot is kept, so its address can't be reused by another one
+		static config::ConfigSnapshotSP last_configs;
+		static std::shared_ptr<const MediaProfiles> last_result;
+
+		std::lock_guard<std::mutex> lock(m);
+		if (configs != last_configs)
+		{
+			last_result = std::make_shared<const MediaProfiles>(configs->tree());
+			last_configs = configs;
+		}
+
+		return last_result;
+	}
+
+	std::size_t MediaProfiles::profile_index(const std::string& token) const
+	{
+		return index_of(profiles_index_, token);
+	}
+
+	std::size_t MediaProfiles::video_source_index(const std::string& token) const
+	{
+		return index_of(video_sources_index_, token);
+	}
+
+	const Profile* MediaProfiles::find_profile(const std::string& token) const
+	{
+		auto index = profile_index(token);
+		return index != NOT_FOUND ? &profiles_[index] : nullptr;
+	}
+
+	const VideoSourceConfiguration* MediaProfiles::find_video_source(const std::string& token) const
+	{
+		auto index = video_source_index(token);
+		return index != NOT_FOUND ? &video_sources_[index] : nullptr;
+	}
+
+	const VideoSourceConfiguration& MediaProfiles::video_source_of(const Profile& profile) const
+	{
+		if (profile.video_source == NOT_FOUND)
+			throw std::runtime_error("Can't find VideoSourceConfiguration with token '" + profile.video_source_token + "'");
+
+		return video_sources_[profile.video_source];
+	}
+
+	const VideoEncoderConfiguration& MediaProfiles::video_encoder_of(const Profile& profile) const
+	{
+		if (profile.video_encoder == NOT_FOUND)
+			throw std::runtime_error("Can't find VideoEncoderConfiguration with token '" + profile.video_encoder_token + "'");
+
+		return video_encoders_[profile.video_encoder];
+	}
+
+	const VideoEncoderConfiguration& MediaProfiles::video_encoder2_of(const Profile& profile) const
+	{
+		if (profile.video_encoder2 == NOT_FOUND)
+			throw std::runtime_error("Can't find VideoEncoderConfiguration with token '" + profile.video_encoder_token + "'");
+
+		return video_encoders2_[profile.video_encoder2];
+	}
+
+	std::vector<std::optional<StreamUri>> MediaProfiles::resolve_stream_uris(const pt::ptree& stream_configs) const
+	{
+		std::unordered_map<std::string, StreamUri> streams;
+		for (const auto& item : stream_configs)
+		{
+			const auto& node = item.second;
+			streams.emplace(node.get<std::string>("VideoEncoderToken"),
+				StreamUri{
+					node.get<std::string>("Uri"),
+					node.get<bool>("InvalidAfterConnect", false),
+					node.get<bool>("InvalidAfterReboot", false),
+					node.get<std::string>("Timeout", "")
+				});
+		}
+
+		std::vector<std::optional<StreamUri>> result(profiles_.size());
+		for (std::size_t i = 0; i < profiles_.size(); ++i)
+		{
+			auto it = streams.find(profiles_[i].video_encoder_token);
+			if (it != streams.end())
+				result[i] = it->second;
+		}
+
+		return result;
+	}
+}
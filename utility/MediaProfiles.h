@@ -0,0 +1,165 @@
+#pragma once
+
+#include <boost/property_tree/ptree_fwd.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ILogger;
+
+namespace utility::config
+{
+	class ConfigSnapshot;
+	class ConfigStore;
+	using ConfigSnapshotSP = std::shared_ptr<const ConfigSnapshot>;
+}
+
+// Typed model of media_profiles.config.
+// The config is parsed once and all the tokens references are resolved to indices,
+// so the services don't need to search and copy the config tree on every request.
+// The model is immutable after reading and may be shared between threads.
+namespace utility::media
+{
+	// means the referenced configuration is not found
+	static const std::size_t NOT_FOUND = static_cast<std::size_t>(-1);
+
+	struct Resolution
+	{
+		int width = 0;
+		int height = 0;
+	};
+
+	struct Bounds
+	{
+		int x = 0;
+		int y = 0;
+		int width = 0;
+		int height = 0;
+	};
+
+	struct VideoSourceConfiguration
+	{
+		std::string token;
+		std::string name;
+		int use_count = 0;
+		std::string view_mode;
+		std::string source_token;
+		Bounds bounds;
+	};
+
+	struct RateControl
+	{
+		bool guaranteed_frame_rate = false;
+		bool constant_bitrate = false; // Media2 only
+		float frame_rate_limit = 0;
+		int encoding_interval = 1; // Media1 only
+		int bitrate_limit = 0;
+	};
+
+	struct H264Configuration
+	{
+		int gov_length = 0;
+		std::string profile;
+	};
+
+	struct Multicast
+	{
+		std::string address_type;
+		std::string ipv4_address;
+		int port = 0;
+		int ttl = 0;
+		bool auto_start = false;
+	};
+
+	struct VideoEncoderConfiguration
+	{
+		std::string token;
+		std::string name;
+		int use_count = 0;
+		std::string encoding;
+		Resolution resolution;
+		float quality = 0;
+		std::optional<RateControl> rate_control;
+		std::optional<H264Configuration> h264;
+		std::optional<Multicast> multicast;
+		std::string session_timeout;
+	};
+
+	struct Profile
+	{
+		std::string token;
+		bool fixed = false;
+		std::string name;
+
+		// the tokens are kept to report about misconfigured profiles
+		std::string video_source_token;
+		std::string video_encoder_token;
+		// the token of an item of "Configurations" of ptz.config, empty if the profile has no PTZ configuration
+		std::string ptz_configuration_token;
+
+		// indices in the appropriate lists of MediaProfiles or NOT_FOUND
+		std::size_t video_source = NOT_FOUND;
+		std::size_t video_encoder = NOT_FOUND;
+		std::size_t video_encoder2 = NOT_FOUND;
+	};
+
+	struct StreamUri
+	{
+		std::string uri;
+		bool invalid_after_connect = false;
+		bool invalid_after_reboot = false;
+		std::string timeout;
+	};
+
+	class MediaProfiles
+	{
+	public:
+		// @configs is a content of media_profiles.config
+		explicit MediaProfiles(const boost::property_tree::ptree& configs);
+
+		static const std::string CONFIG_FILE;
+
+		// media_profiles.config is changed by Set* requests of Media2, so it's shared by the services through the store
+		static std::shared_ptr<config::ConfigStore> store(const std::string& configs_dir, ILogger& logger);
+
+		// the model of the same snapshot is built only once for all the services
+		static std::shared_ptr<const MediaProfiles> instance(const config::ConfigSnapshotSP& configs);
+
+		const std::vector<Profile>& profiles() const { return profiles_; }
+		const std::vector<VideoSourceConfiguration>& video_sources() const { return video_sources_; }
+
+		// Media1 and Media2 use different sets of encoders' configs
+		const std::vector<VideoEncoderConfiguration>& video_encoders() const { return video_encoders_; }
+		const std::vector<VideoEncoderConfiguration>& video_encoders2() const { return video_encoders2_; }
+
+		// return NOT_FOUND if there is no an item with the token
+		std::size_t profile_index(const std::string& token) const;
+		std::size_t video_source_index(const std::string& token) const;
+
+		// return nullptr if there is no an item with the token
+		const Profile* find_profile(const std::string& token) const;
+		const VideoSourceConfiguration* find_video_source(const std::string& token) const;
+
+		// these throw if the profile refers to a not existing configuration
+		const VideoSourceConfiguration& video_source_of(const Profile& profile) const;
+		const VideoEncoderConfiguration& video_encoder_of(const Profile& profile) const;
+		const VideoEncoderConfiguration& video_encoder2_of(const Profile& profile) const;
+
+		// joins GetStreamUri list of a service's config with the profiles by VideoEncoderToken.
+		// The result is indexed the same as profiles(), a profile without a stream has an empty value
+		std::vector<std::optional<StreamUri>> resolve_stream_uris(const boost::property_tree::ptree& stream_configs) const;
+
+	private:
+		std::vector<Profile> profiles_;
+		std::vector<VideoSourceConfiguration> video_sources_;
+		std::vector<VideoEncoderConfiguration> video_encoders_;
+		std::vector<VideoEncoderConfiguration> video_encoders2_;
+
+		std::unordered_map<std::string, std::size_t> profiles_index_;
+		std::unordered_map<std::string, std::size_t> video_sources_index_;
+	};
+}
@@ -0,0 +1,414 @@
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+	using utility::metrics::LatencyHistogram;
+	using utility::metrics::MAX_METHODS;
+
+	// Every slot is written only by the thread owning the shard,
+	// so a plain load+store is enough and there is no any RMW on the hot path.
+	struct MethodSlot
+	{
+		std::atomic<std::uint64_t> requests;
+		std::atomic<std::uint64_t> client_errors;
+		std::atomic<std::uint64_t> server_errors;
+		std::atomic<std::uint64_t> auth_failures;
+		std::atomic<std::uint64_t> latency_sum_us;
+		std::array<std::atomic<std::uint64_t>, LatencyHistogram::BUCKETS_COUNT> latency_buckets;
+	};
+
+	struct ThreadShard
+	{
+		std::array<MethodSlot, MAX_METHODS> slots;
+	};
+
+	inline void increment(std::atomic<std::uint64_t>& v, std::uint64_t n = 1)
+	{
+		v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+
+	template<typename T>
+	struct RegisteredMetric
+	{
+		std::string name;
+		std::string help;
+		utility::metrics::Labels labels;
+		std::weak_ptr<T> metric;
+	};
+
+	struct Registry
+	{
+		std::mutex mutex;
+
+		// never deleted, so statistics of finished threads are still exported
+		std::vector<ThreadShard*> shards;
+
+		std::vector<std::pair<std::string, std::string>> methods; // service, method
+		std::map<std::pair<std::string, std::string>, utility::metrics::method_id_t> methods_ids;
+
+		std::vector<RegisteredMetric<utility::metrics::Counter>> counters;
+		std::vector<RegisteredMetric<utility::metrics::Gauge>> gauges;
+	};
+
+	Registry& registry()
+	{
+		static Registry* instance = new Registry;
+		return *instance;
+	}
+
+	ThreadShard& local_shard()
+	{
+		thread_local ThreadShard* shard = nullptr;
+		if (!shard)
+		{
+			// value-initialization zeroes all atomics
+			shard = new ThreadShard();
+
+			auto& r = registry();
+			std::lock_guard<std::mutex> lg(r.mutex);
+			r.shards.push_back(shard);
+		}
+
+		return *shard;
+	}
+
+	std::string labels_to_string(const utility::metrics::Labels& labels)
+	{
+		if (labels.empty())
+			return {};
+
+		std::string result = "{";
+		for (const auto& [name, value] : labels)
+		{
+			if (result.size() > 1)
+				result += ",";
+			result += name + "=\"" + utility::metrics::escape_label_value(value) + "\"";
+		}
+		result += "}";
+
+		return result;
+	}
+
+	template<typename T, typename Writer>
+	void write_registered(std::ostream& os, std::vector<RegisteredMetric<T>>& metrics,
+		const char* type, Writer write_value)
+	{
+		// drop the metrics whose owners are already destroyed
+		metrics.erase(std::remove_if(metrics.begin(), metrics.end(),
+			[](const RegisteredMetric<T>& m) { return m.metric.expired(); }), metrics.end());
+
+		std::string last_name;
+		for (const auto& m : metrics)
+		{
+			auto metric = m.metric.lock();
+			if (!metric)
+				continue;
+
+			if (m.name != last_name)
+			{
+				os << "# HELP " << m.name << " " << m.help << "\n";
+				os << "# TYPE " << m.name << " " << type << "\n";
+				last_name = m.name;
+			}
+
+			os << m.name << labels_to_string(m.labels) << " ";
+			write_value(os, *metric);
+			os << "\n";
+		}
+	}
+
+	template<typename T>
+	std::shared_ptr<T> make_registered(std::vector<RegisteredMetric<T>>& metrics, const std::string& name,
+		const std::string& help, const utility::metrics::Labels& labels)
+	{
+		auto metric = std::make_shared<T>();
+
+		// metrics with the same name are kept together, it's required by the exposition format
+		auto it = std::find_if(metrics.rbegin(), metrics.rend(),
+			[&name](const RegisteredMetric<T>& m) { return m.name == name; });
+		metrics.insert(it.base(), RegisteredMetric<T>{ name, help, labels, metric });
+
+		return metric;
+	}
+}
+
+namespace utility::metrics
+{
+	std::size_t LatencyHistogram::bucket_index(std::uint64_t value)
+	{
+		if (value < SUB_BUCKETS_COUNT)
+			return static_cast<std::size_t>(value);
+
+		int magnitude = 63;
+		while (!(value >> magnitude))
+			--magnitude;
+
+		if (magnitude > MAX_MAGNITUDE)
+			return BUCKETS_COUNT - 1;
+
+		auto sub_bucket = (value >> (magnitude - SUB_BUCKET_BITS)) & (SUB_BUCKETS_COUNT - 1);
+		return static_cast<std::size_t>((magnitude - SUB_BUCKET_BITS + 1) * SUB_BUCKETS_COUNT + sub_bucket);
+	}
+
+	std::uint64_t LatencyHistogram::bucket_upper_bound(std::size_t index)
+	{
+		if (index < SUB_BUCKETS_COUNT)
+			return index + 1;
+
+		const int magnitude = static_cast<int>(index / SUB_BUCKETS_COUNT) + SUB_BUCKET_BITS - 1;
+		const std::uint64_t sub_bucket = index % SUB_BUCKETS_COUNT;
+		const std::uint64_t width = std::uint64_t(1) << (magnitude - SUB_BUCKET_BITS);
+
+		return (std::uint64_t(1) << magnitude) + (sub_bucket + 1) * width;
+	}
+
+	void LatencyHistogram::record(std::uint64_t value)
+	{
+		++buckets_[bucket_index(value)];
+		++count_;
+		sum_ += value;
+	}
+
+	void LatencyHistogram::record_bucket(std::size_t index, std::uint64_t count)
+	{
+		buckets_[std::min(index, BUCKETS_COUNT - 1)] += count;
+		count_ += count;
+	}
+
+	void LatencyHistogram::merge(const LatencyHistogram& other)
+	{
+		for (std::size_t i = 0; i < BUCKETS_COUNT; ++i)
+			buckets_[i] += other.buckets_[i];
+
+		count_ += other.count_;
+		sum_ += other.sum_;
+	}
+
+	std::uint64_t LatencyHistogram::count_below(std::uint64_t bound) const
+	{
+		std::uint64_t result = 0;
+		for (std::size_t i = 0; i < BUCKETS_COUNT && bucket_upper_bound(i) <= bound; ++i)
+			result += buckets_[i];
+
+		return result;
+	}
+
+	std::uint64_t LatencyHistogram::percentile(double p) const
+	{
+		if (!count_)
+			return 0;
+
+		auto rank = static_cast<std::uint64_t>(std::ceil(std::clamp(p, 0.0, 100.0) / 100.0 * count_));
+		rank = std::max<std::uint64_t>(rank, 1);
+
+		std::uint64_t cumulative = 0;
+		for (std::size_t i = 0; i < BUCKETS_COUNT; ++i)
+		{
+			cumulative += buckets_[i];
+			if (cumulative >= rank)
+				return bucket_upper_bound(i);
+		}
+
+		return bucket_upper_bound(BUCKETS_COUNT - 1);
+	}
+
+	std::uint64_t LatencyHistogram::max() const
+	{
+		for (std::size_t i = BUCKETS_COUNT; i > 0; --i)
+		{
+			if (buckets_[i - 1])
+				return bucket_upper_bound(i - 1);
+		}
+
+		return 0;
+	}
+
+	method_id_t register_method(const std::string& service, const std::string& method)
+	{
+		auto& r = registry();
+		std::lock_guard<std::mutex> lg(r.mutex);
+
+		auto key = std::make_pair(service, method);
+		if (auto it = r.methods_ids.find(key); it != r.methods_ids.end())
+			return it->second;
+
+		if (r.methods.size() >= MAX_METHODS)
+			throw std::runtime_error("Too many methods are registered for metrics");
+
+		r.methods.push_back(key);
+		return r.methods_ids[key] = r.methods.size() - 1;
+	}
+
+	void record_request(method_id_t id, Outcome outcome, std::chrono::steady_clock::duration latency)
+	{
+		if (id >= MAX_METHODS)
+			return;
+
+		auto& slot = local_shard().slots[id];
+
+		increment(slot.requests);
+
+		switch (outcome)
+		{
+		case Outcome::AUTH_FAILED:
+			increment(slot.auth_failures);
+			increment(slot.client_errors);
+			break;
+		case Outcome::CLIENT_ERROR:
+			increment(slot.client_errors);
+			break;
+		case Outcome::SERVER_ERROR:
+			increment(slot.server_errors);
+			break;
+		default:
+			break;
+		}
+
+		auto us = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+		auto value = static_cast<std::uint64_t>(std::max<decltype(us)>(us, 0));
+		increment(slot.latency_sum_us, value);
+		increment(slot.latency_buckets[LatencyHistogram::bucket_index(value)]);
+	}
+
+	LatencyHistogram method_latency(method_id_t id)
+	{
+		LatencyHistogram result;
+		if (id >= MAX_METHODS)
+			return result;
+
+		auto& r = registry();
+		std::lock_guard<std::mutex> lg(r.mutex);
+		for (const auto* shard : r.shards)
+		{
+			const auto& slot = shard->slots[id];
+			for (std::size_t b = 0; b < LatencyHistogram::BUCKETS_COUNT; ++b)
+			{
+				if (auto n = slot.latency_buckets[b].load(std::memory_order_relaxed))
+					result.record_bucket(b, n);
+			}
+		}
+
+		return result;
+	}
+
+	std::shared_ptr<Counter> make_counter(const std::string& name, const std::string& help, const Labels& labels)
+	{
+		auto& r = registry();
+		std::lock_guard<std::mutex> lg(r.mutex);
+		return make_registered(r.counters, name, help, labels);
+	}
+
+	std::shared_ptr<Gauge> make_gauge(const std::string& name, const std::string& help, const Labels& labels)
+	{
+		auto& r = registry();
+		std::lock_guard<std::mutex> lg(r.mutex);
+		return make_registered(r.gauges, name, help, labels);
+	}
+
+	std::string to_prometheus()
+	{
+		struct MethodTotals
+		{
+			std::uint64_t requests = 0;
+			std::uint64_t client_errors = 0;
+			std::uint64_t server_errors = 0;
+			std::uint64_t auth_failures = 0;
+			std::uint64_t latency_sum_us = 0;
+			LatencyHistogram latency;
+		};
+
+		auto& r = registry();
+		std::lock_guard<std::mutex> lg(r.mutex);
+
+		// aggregate shards on scrape
+		std::vector<MethodTotals> totals(r.methods.size());
+		for (const auto* shard : r.shards)
+		{
+			for (std::size_t id = 0; id < totals.size(); ++id)
+			{
+				const auto& slot = shard->slots[id];
+				auto& t = totals[id];
+				t.requests += slot.requests.load(std::memory_order_relaxed);
+				t.client_errors += slot.client_errors.load(std::memory_order_relaxed);
+				t.server_errors += slot.server_errors.load(std::memory_order_relaxed);
+				t.auth_failures += slot.auth_failures.load(std::memory_order_relaxed);
+				t.latency_sum_us += slot.latency_sum_us.load(std::memory_order_relaxed);
+				for (std::size_t b = 0; b < LatencyHistogram::BUCKETS_COUNT; ++b)
+				{
+					if (auto n = slot.latency_buckets[b].load(std::memory_order_relaxed))
+						t.latency.record_bucket(b, n);
+				}
+			}
+		}
+
+		std::ostringstream os;
+
+		auto method_labels = [&r](std::size_t id) {
+			return "service=\"" + escape_label_value(r.methods[id].first)
+				+ "\",method=\"" + escape_label_value(r.methods[id].second) + "\"";
+		};
+
+		auto write_counter = [&](const char* name, const char* help, std::uint64_t MethodTotals::* field) {
+			os << "# HELP " << name << " " << help << "\n";
+			os << "# TYPE " << name << " counter\n";
+			for (std::size_t id = 0; id < totals.size(); ++id)
+				os << name << "{" << method_labels(id) << "} " << totals[id].*field << "\n";
+		};
+
+		write_counter("onvif_requests_total", "Handled ONVIF requests.", &MethodTotals::requests);
+		write_counter("onvif_requests_client_errors_total", "Requests responded with 4xx.", &MethodTotals::client_errors);
+		write_counter("onvif_requests_server_errors_total", "Requests responded with 5xx.", &MethodTotals::server_errors);
+		write_counter("onvif_auth_failures_total", "Requests rejected by the authentication.", &MethodTotals::auth_failures);
+
+		// buckets' bounds are exported only for powers of two (16us - 16s), they match the HDR buckets' bounds
+		const char latency_name[] = "onvif_request_duration_seconds";
+		os << "# HELP " << latency_name << " Time spent in the request's handler.\n";
+		os << "# TYPE " << latency_name << " histogram\n";
+		for (std::size_t id = 0; id < totals.size(); ++id)
+		{
+			const auto& t = totals[id];
+			const auto labels = method_labels(id);
+			for (int p = 4; p <= 24; ++p)
+			{
+				const std::uint64_t bound_us = std::uint64_t(1) << p;
+				os << latency_name << "_bucket{" << labels << ",le=\"" << bound_us / 1e6 << "\"} "
+					<< t.latency.count_below(bound_us) << "\n";
+			}
+			os << latency_name << "_bucket{" << labels << ",le=\"+Inf\"} " << t.latency.count() << "\n";
+			os << latency_name << "_sum{" << labels << "} " << t.latency_sum_us / 1e6 << "\n";
+			os << latency_name << "_count{" << labels << "} " << t.latency.count() << "\n";
+		}
+
+		write_registered(os, r.counters, "counter",
+			[](std::ostream& s, const Counter& c) { s << c.value(); });
+		write_registered(os, r.gauges, "gauge",
+			[](std::ostream& s, const Gauge& g) { s << g.value(); });
+
+		return os.str();
+	}
+
+	std::string escape_label_value(const std::string& value)
+	{
+		std::string result;
+		result.reserve(value.size());
+		for (auto c : value)
+		{
+			switch (c)
+			{
+			case '\\': result += "\\\\"; break;
+			case '"': result += "\\\""; break;
+			case '\n': result += "\\n"; break;
+			default: result += c;
+			}
+		}
+
+		return result;
+	}
+}
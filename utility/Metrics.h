@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Lightweight instrumentation of the server.
+// Request statistics are written into per-thread shards without any locking
+// and are only summed up when the metrics are scraped.
+namespace utility::metrics
+{
+	using Labels = std::vector<std::pair<std::string, std::string>>;
+
+	// HDR-style log-linear histogram. Values (microseconds) below 2^SUB_BUCKET_BITS have their own bucket,
+	// every next power of two range is split into 2^SUB_BUCKET_BITS equal sub-buckets,
+	// so a relative error of a recorded value is less than 12.5%.
+	// NOTE: it is not thread-safe, it's used to merge shards and to calculate percentiles
+	class LatencyHistogram
+	{
+	public:
+		static const int SUB_BUCKET_BITS = 3;
+		static const int SUB_BUCKETS_COUNT = 1 << SUB_BUCKET_BITS;
+		static const int MAX_MAGNITUDE = 35; // ~9.5 hours in microseconds, bigger values are clamped
+		static const std::size_t BUCKETS_COUNT = SUB_BUCKETS_COUNT * (MAX_MAGNITUDE - SUB_BUCKET_BITS + 2);
+
+		static std::size_t bucket_index(std::uint64_t value);
+
+		// returns the smallest value which does not fall into the bucket anymore
+		static std::uint64_t bucket_upper_bound(std::size_t index);
+
+		void record(std::uint64_t value);
+		void record_bucket(std::size_t index, std::uint64_t count);
+		void merge(const LatencyHistogram& other);
+
+		std::uint64_t count() const { return count_; }
+		std::uint64_t sum() const { return sum_; }
+
+		// number of recorded values which are less than @bound
+		std::uint64_t count_below(std::uint64_t bound) const;
+
+		// @p is in range [0, 100], returns an upper bound of the bucket containing the percentile
+		std::uint64_t percentile(double p) const;
+
+		std::uint64_t max() const;
+
+	private:
+		std::array<std::uint64_t, BUCKETS_COUNT> buckets_{};
+		std::uint64_t count_ = 0;
+		std::uint64_t sum_ = 0;
+	};
+
+	enum class Outcome
+	{
+		OK = 0,
+		CLIENT_ERROR, // 4xx
+		AUTH_FAILED, // 401, also counted as a client error
+		SERVER_ERROR // 5xx
+	};
+
+	using method_id_t = std::size_t;
+
+	// max number of registered service/method pairs
+	const method_id_t MAX_METHODS = 256;
+
+	// Should be called during a service initialization, i.e. not on the hot path.
+	// Registering the same pair twice returns the same id.
+	// Throws std::runtime_error if there are no free slots
+	method_id_t register_method(const std::string& /*service*/, const std::string& /*method*/);
+
+	// Contention-free: only the calling thread's shard is modified
+	void record_request(method_id_t /*id*/, Outcome /*outcome*/, std::chrono::steady_clock::duration /*latency*/);
+
+	// Aggregated over all threads' shards
+	LatencyHistogram method_latency(method_id_t /*id*/);
+
+	class Counter
+	{
+	public:
+		void inc(std::uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+		std::uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+	private:
+		std::atomic<std::uint64_t> value_{ 0 };
+	};
+
+	class Gauge
+	{
+	public:
+		void set(std::int64_t v) { value_.store(v, std::memory_order_relaxed); }
+		void add(std::int64_t v) { value_.fetch_add(v, std::memory_order_relaxed); }
+		std::int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+	private:
+		std::atomic<std::int64_t> value_{ 0 };
+	};
+
+	// A metric is exported while its owner holds the returned pointer,
+	// so it's enough to release it to stop exporting, e.g. when a PullPoint is destroyed.
+	std::shared_ptr<Counter> make_counter(const std::string& /*name*/, const std::string& /*help*/, const Labels& /*labels*/ = {});
+	std::shared_ptr<Gauge> make_gauge(const std::string& /*name*/, const std::string& /*help*/, const Labels& /*labels*/ = {});
+
+	// Returns all metrics in the Prometheus text exposition format (version 0.0.4)
+	std::string to_prometheus();
+
+	// value="a\"b" -> value="a\\\"b"
+	std::string escape_label_value(const std::string& /*value*/);
+}
@@ -0,0 +1,233 @@
+#include "PtzMotion.h"
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+	using namespace utility::ptz;
+
+	float clamp(float value, const Range& range)
+	{
+		return std::min(std::max(value, range.min), range.max);
+	}
+
+	Range read_range(const boost::property_tree::ptree& range_configs, const std::string& space)
+	{
+		Range result;
+		result.min = range_configs.get<float>("Min");
+		result.max = range_configs.get<float>("Max");
+		if (result.min > result.max)
+			throw std::runtime_error("The range of " + space + " is empty");
+
+		return result;
+	}
+}
+
+namespace utility::ptz
+{
+	bool operator==(const Limits& lhs, const Limits& rhs)
+	{
+		return lhs.pan.min == rhs.pan.min && lhs.pan.max == rhs.pan.max
+			&& lhs.tilt.min == rhs.tilt.min && lhs.tilt.max == rhs.tilt.max
+			&& lhs.zoom.min == rhs.zoom.min && lhs.zoom.max == rhs.zoom.max
+			&& lhs.pan_tilt_speed == rhs.pan_tilt_speed && lhs.zoom_speed == rhs.zoom_speed;
+	}
+
+	bool operator!=(const Limits& lhs, const Limits& rhs)
+	{
+		return !(lhs == rhs);
+	}
+
+	Limits read_limits(const boost::property_tree::ptree& node_configs)
+	{
+		Limits result;
+
+		if (const auto spaces = node_configs.get_child_optional("SupportedPTZSpaces"))
+		{
+			for (const auto& space : *spaces)
+			{
+				const auto name = space.second.get<std::string>("space");
+				if (name == "AbsolutePanTiltPositionSpace")
+				{
+					result.pan = read_range(space.second.get_child("XRange"), name);
+					result.tilt = read_range(space.second.get_child("YRange"), name);
+				}
+				else if (name == "AbsoluteZoomPositionSpace")
+				{
+					result.zoom = read_range(space.second.get_child("XRange"), name);
+				}
+			}
+		}
+
+		result.pan_tilt_speed = node_configs.get<float>("MaxPanTiltSpeed", result.pan_tilt_speed);
+		result.zoom_speed = node_configs.get<float>("MaxZoomSpeed", result.zoom_speed);
+		if (result.pan_tilt_speed <= 0 || result.zoom_speed <= 0)
+			throw std::runtime_error("The max speeds of the PTZ node should be positive");
+
+		return result;
+	}
+
+	float Head::Axis::at(Clock::time_point now) const
+	{
+		if (velocity == 0 || now <= started)
+			return clamp(start, range);
+
+		const auto elapsed = std::min(now - started, duration);
+		return clamp(start + velocity * std::chrono::duration<float>(elapsed).count(), range);
+	}
+
+	bool Head::Axis::moving(Clock::time_point now) const
+	{
+		if (velocity == 0 || now - started >= duration)
+			return false;
+
+		// it stays at the bound until the timeout
+		const auto position = at(now);
+		return velocity > 0 ? position < range.max : position > range.min;
+	}
+
+	Clock::time_point Head::Axis::stops_at(Clock::time_point now) const
+	{
+		if (!moving(now))
+			return now;
+
+		const auto position = at(now);
+		const auto to_bound = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(
+			(velocity > 0 ? range.max - position : position - range.min) / std::fabs(velocity)));
+		if (duration == Clock::duration::max())
+			return now + to_bound;
+
+		return now + std::min(duration - (now - started), to_bound);
+	}
+
+	void Head::Axis::move(float new_velocity, Clock::duration new_duration, Clock::time_point now)
+	{
+		start = at(now);
+		velocity = new_velocity;
+		started = now;
+		duration = new_duration;
+	}
+
+	void Head::Axis::move_to(float target, float speed, Clock::time_point now)
+	{
+		start = at(now);
+		started = now;
+
+		const auto distance = clamp(target, range) - start;
+		if (distance == 0)
+		{
+			velocity = 0;
+			duration = Clock::duration::zero();
+			return;
+		}
+
+		velocity = distance > 0 ? speed : -speed;
+		duration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(std::fabs(distance) / speed));
+	}
+
+	Head::Head(const Limits& limits, const Vector& position)
+		: limits_(limits)
+	{
+		pan_.range = limits.pan;
+		pan_.start = clamp(position.pan, limits.pan);
+		tilt_.range = limits.tilt;
+		tilt_.start = clamp(position.tilt, limits.tilt);
+		zoom_.range = limits.zoom;
+		zoom_.start = clamp(position.zoom, limits.zoom);
+	}
+
+	void Head::continuous_move(const Vector& velocity, Clock::duration timeout, Clock::time_point now)
+	{
+		const Range unit{ -1, 1 };
+		const auto duration = timeout > Clock::duration::zero() ? timeout : Clock::duration::max();
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		pan_.move(clamp(velocity.pan, unit) * limits_.pan_tilt_speed, duration, now);
+		tilt_.move(clamp(velocity.tilt, unit) * limits_.pan_tilt_speed, duration, now);
+		zoom_.move(clamp(velocity.zoom, unit) * limits_.zoom_speed, duration, now);
+	}
+
+	void Head::absolute_move(const Vector& position, const Vector& speed, Clock::time_point now)
+	{
+		const auto speed_of = [](float fraction, float max) {
+			return fraction > 0 ? std::min(fraction, 1.0f) * max : max;
+		};
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		pan_.move_to(position.pan, speed_of(speed.pan, limits_.pan_tilt_speed), now);
+		tilt_.move_to(position.tilt, speed_of(speed.tilt, limits_.pan_tilt_speed), now);
+		zoom_.move_to(position.zoom, speed_of(speed.zoom, limits_.zoom_speed), now);
+	}
+
+	void Head::relative_move(const Vector& translation, const Vector& speed, Clock::time_point now)
+	{
+		Vector target;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			target = position(now);
+		}
+		target.pan += translation.pan;
+		target.tilt += translation.tilt;
+		target.zoom += translation.zoom;
+
+		absolute_move(target, speed, now);
+	}
+
+	void Head::stop(bool pan_tilt, bool zoom, Clock::time_point now)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (pan_tilt)
+		{
+			pan_.move(0, Clock::duration::zero(), now);
+			tilt_.move(0, Clock::duration::zero(), now);
+		}
+		if (zoom)
+			zoom_.move(0, Clock::duration::zero(), now);
+	}
+
+	Status Head::status(Clock::time_point now) const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		Status result;
+		result.position = position(now);
+		result.pan_tilt = pan_.moving(now) || tilt_.moving(now) ? MoveStatus::MOVING : MoveStatus::IDLE;
+		result.zoom = zoom_.moving(now) ? MoveStatus::MOVING : MoveStatus::IDLE;
+		return result;
+	}
+
+	Clock::time_point Head::idle_at(Clock::time_point now) const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return std::max({ pan_.stops_at(now), tilt_.stops_at(now), zoom_.stops_at(now) });
+	}
+
+	Limits Head::limits() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return limits_;
+	}
+
+	void Head::set_limits(const Limits& limits, Clock::time_point now)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		for (auto axis : { std::make_pair(&pan_, limits.pan), std::make_pair(&tilt_, limits.tilt),
+			std::make_pair(&zoom_, limits.zoom) })
+		{
+			axis.first->move(0, Clock::duration::zero(), now);
+			axis.first->range = axis.second;
+			axis.first->start = clamp(axis.first->start, axis.second);
+		}
+		limits_ = limits;
+	}
+
+	Vector Head::position(Clock::time_point now) const
+	{
+		return { pan_.at(now), tilt_.at(now), zoom_.at(now) };
+	}
+}
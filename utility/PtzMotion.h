@@ -0,0 +1,112 @@
+#pragma once
+
+#include <boost/property_tree/ptree_fwd.hpp>
+
+#include <chrono>
+#include <mutex>
+
+// The simulated motion of a PTZ head.
+// A move only records where and when it started, the position is computed from that and the time of a query,
+// so an idle or a moving head costs nothing between the requests and no timer ticks for it.
+namespace utility::ptz
+{
+	using Clock = std::chrono::steady_clock;
+
+	struct Range
+	{
+		float min = 0;
+		float max = 0;
+	};
+
+	// pan and tilt in the position spaces, zoom in its own one
+	struct Vector
+	{
+		float pan = 0;
+		float tilt = 0;
+		float zoom = 0;
+	};
+
+	struct Limits
+	{
+		// AbsolutePanTiltPositionSpace and AbsoluteZoomPositionSpace
+		Range pan{ -1, 1 };
+		Range tilt{ -1, 1 };
+		Range zoom{ 0, 1 };
+		// the position units per second at the max speed, i.e. at 1 of the generic speed and velocity spaces
+		float pan_tilt_speed = 1;
+		float zoom_speed = 0.5f;
+	};
+
+	bool operator==(const Limits& /*lhs*/, const Limits& /*rhs*/);
+	bool operator!=(const Limits& /*lhs*/, const Limits& /*rhs*/);
+
+	// the limits of an item of "Nodes" of ptz.config, the generic spaces are used for the missing ones,
+	// throws std::runtime_error if a range is empty or a speed is not positive
+	Limits read_limits(const boost::property_tree::ptree& /*node_configs*/);
+
+	enum class MoveStatus
+	{
+		IDLE,
+		MOVING
+	};
+
+	struct Status
+	{
+		Vector position;
+		MoveStatus pan_tilt = MoveStatus::IDLE;
+		MoveStatus zoom = MoveStatus::IDLE;
+	};
+
+	// it's thread-safe, the velocities and the speeds are the fractions of the limits' speeds,
+	// the positions are clamped to the limits
+	class Head
+	{
+	public:
+		explicit Head(const Limits& limits, const Vector& position = {});
+
+		// moves with @velocity (in [-1, 1]) during @timeout, a zero timeout moves until the next command
+		void continuous_move(const Vector& velocity, Clock::duration timeout, Clock::time_point now = Clock::now());
+		// moves to @position with @speed (in [0, 1]), a zero speed of an axis means the max one
+		void absolute_move(const Vector& position, const Vector& speed, Clock::time_point now = Clock::now());
+		// moves by @translation from the current position
+		void relative_move(const Vector& translation, const Vector& speed, Clock::time_point now = Clock::now());
+		void stop(bool pan_tilt, bool zoom, Clock::time_point now = Clock::now());
+
+		Status status(Clock::time_point now = Clock::now()) const;
+		// when all the current moves end, a move without a timeout ends at the bound of the limits
+		Clock::time_point idle_at(Clock::time_point now = Clock::now()) const;
+
+		Limits limits() const;
+		// the head stops at its current position clamped to the new limits
+		void set_limits(const Limits& limits, Clock::time_point now = Clock::now());
+
+	private:
+		// a uniform motion from @start, which lasts @duration or until the range's bound
+		struct Axis
+		{
+			float start = 0;
+			// units per second
+			float velocity = 0;
+			Clock::time_point started;
+			// Clock::duration::max() - until the next command
+			Clock::duration duration = Clock::duration::zero();
+			Range range;
+
+			float at(Clock::time_point now) const;
+			bool moving(Clock::time_point now) const;
+			// the end of the move, it's earlier than started + duration if the move reaches the range's bound
+			Clock::time_point stops_at(Clock::time_point now) const;
+			void move(float velocity, Clock::duration duration, Clock::time_point now);
+			// with the speed in units per second
+			void move_to(float target, float speed, Clock::time_point now);
+		};
+
+		Vector position(Clock::time_point now) const;
+
+		mutable std::mutex mutex_;
+		Limits limits_;
+		Axis pan_;
+		Axis tilt_;
+		Axis zoom_;
+	};
+}
@@ -0,0 +1,193 @@
+#include "PtzPresets.h"
+#include "DateTime.hpp"
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <mutex>
+#include <stdexcept>
+
+namespace pt = boost::property_tree;
+
+namespace
+{
+	using namespace utility::ptz;
+
+	Preset read_preset(const pt::ptree& node)
+	{
+		Preset result;
+		result.token = node.get<std::string>("token");
+		result.name = node.get<std::string>("Name", result.token);
+		result.position.pan = node.get<float>("Pan", 0);
+		result.position.tilt = node.get<float>("Tilt", 0);
+		result.position.zoom = node.get<float>("Zoom", 0);
+
+		return result;
+	}
+
+	pt::ptree preset_to_config(const Preset& preset)
+	{
+		pt::ptree result;
+		result.put("token", preset.token);
+		result.put("Name", preset.name);
+		result.put("Pan", preset.position.pan);
+		result.put("Tilt", preset.position.tilt);
+		result.put("Zoom", preset.position.zoom);
+
+		return result;
+	}
+
+	PresetTour read_tour(const pt::ptree& node)
+	{
+		PresetTour result;
+		result.token = node.get<std::string>("token");
+		result.name = node.get<std::string>("Name", result.token);
+		result.auto_start = node.get<bool>("AutoStart", false);
+		result.recurring_time = node.get<unsigned>("RecurringTime", 0);
+
+		if (const auto spots = node.get_child_optional("Spots"))
+		{
+			for (const auto& spot_node : *spots)
+			{
+				TourSpot spot;
+				spot.preset_token = spot_node.second.get<std::string>("PresetToken");
+				spot.speed = spot_node.second.get<float>("Speed", 0);
+
+				const auto stay_time = spot_node.second.get<std::string>("StayTime", "PT0S");
+				const auto duration = utility::datetime::parse_duration(stay_time);
+				if (!duration)
+					throw std::runtime_error("The stay time of the preset tour " + result.token + " is not a duration: "
+						+ stay_time);
+				spot.stay_time = *duration;
+
+				result.spots.push_back(spot);
+			}
+		}
+
+		return result;
+	}
+
+	template<typename T, typename Reader>
+	void read_list(const pt::ptree& configs, const std::string& name, Reader reader,
+		std::vector<T>& result, std::unordered_map<std::string, std::size_t>& index)
+	{
+		auto list = configs.get_child_optional(name);
+		if (!list)
+			return;
+
+		result.reserve(list->size());
+		for (const auto& item : *list)
+		{
+			result.push_back(reader(item.second));
+			if (!index.emplace(result.back().token, result.size() - 1).second)
+				throw std::runtime_error("The token is repeated in " + name + ": " + result.back().token);
+		}
+	}
+
+	template<typename T>
+	const T* find(const std::vector<T>& items, const std::unordered_map<std::string, std::size_t>& index,
+		const std::string& token)
+	{
+		auto it = index.find(token);
+		return it != index.end() ? &items[it->second] : nullptr;
+	}
+}
+
+namespace utility::ptz
+{
+	NodePresets::NodePresets(const pt::ptree& node_configs)
+	{
+		read_list(node_configs, "Presets", read_preset, presets_, presets_index_);
+		read_list(node_configs, "PresetTours", read_tour, tours_, tours_index_);
+	}
+
+	const Preset* NodePresets::find_preset(const std::string& token) const
+	{
+		return find(presets_, presets_index_, token);
+	}
+
+	const PresetTour* NodePresets::find_tour(const std::string& token) const
+	{
+		return find(tours_, tours_index_, token);
+	}
+
+	std::string NodePresets::new_preset_token() const
+	{
+		for (auto i = presets_.size() + 1;; ++i)
+		{
+			auto token = "Preset" + std::to_string(i);
+			if (presets_index_.count(token) == 0)
+				return token;
+		}
+	}
+
+	Presets::Presets(const pt::ptree& configs)
+	{
+		const auto list = configs.get_child_optional("NodePresets");
+		if (!list)
+			return;
+
+		for (const auto& item : *list)
+			nodes_.emplace(item.second.get<std::string>("NodeToken"), NodePresets(item.second));
+	}
+
+	std::shared_ptr<const Presets> Presets::instance(const config::ConfigSnapshotSP& configs)
+	{
+		static std::mutex m;
+		// the snapshot is kept, so its address can't be reused by another one
+		static config::ConfigSnapshotSP last_configs;
+		static std::shared_ptr<const Presets> last_result;
+
+		std::lock_guard<std::mutex> lock(m);
+		if (configs != last_configs)
+		{
+			last_result = std::make_shared<const Presets>(configs->tree());
+			last_configs = configs;
+		}
+
+		return last_result;
+	}
+
+	const NodePresets* Presets::find_node(const std::string& node_token) const
+	{
+		auto it = nodes_.find(node_token);
+		return it != nodes_.end() ? &it->second : nullptr;
+	}
+
+	pt::ptree set_preset(const pt::ptree& node_configs, const Preset& preset)
+	{
+		auto result = node_configs;
+		if (!result.get_child_optional("Presets"))
+			result.put_child("Presets", pt::ptree());
+
+		auto& list = result.get_child("Presets");
+		for (auto& item : list)
+		{
+			if (item.second.get<std::string>("token", "") == preset.token)
+			{
+				item.second = preset_to_config(preset);
+				return result;
+			}
+		}
+
+		list.push_back({ "", preset_to_config(preset) });
+		return result;
+	}
+
+	pt::ptree remove_preset(const pt::ptree& node_configs, const std::string& token)
+	{
+		auto result = node_configs;
+		if (auto list = result.get_child_optional("Presets"))
+		{
+			for (auto it = list->begin(); it != list->end(); ++it)
+			{
+				if (it->second.get<std::string>("token", "") == token)
+				{
+					list->erase(it);
+					break;
+				}
+			}
+		}
+
+		return result;
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "ConfigSnapshot.h"
+#include "PtzMotion.h"
+
+#include <boost/property_tree/ptree_fwd.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The presets and the preset tours of the PTZ nodes, they're kept in "NodePresets" of ptz.config,
+// an item per node, which is replaced by a commit of the PTZ service's store:
+//   { "NodeToken": "PTZNODE_1", "Presets": [ { "token", "Name", "Pan", "Tilt", "Zoom" } ],
+//     "PresetTours": [ { "token", "Name", "AutoStart", "RecurringTime", "Spots": [ { "PresetToken", "Speed", "StayTime" } ] } ] }
+namespace utility::ptz
+{
+	struct Preset
+	{
+		std::string token;
+		std::string name;
+		Vector position;
+	};
+
+	struct TourSpot
+	{
+		std::string preset_token;
+		// a fraction of the max speeds, 0 - the max speed
+		float speed = 0;
+		// how long the head stays at the preset before it moves to the next one
+		std::chrono::milliseconds stay_time{ 0 };
+	};
+
+	struct PresetTour
+	{
+		std::string token;
+		std::string name;
+		// the tour is started with the server
+		bool auto_start = false;
+		// how many times the spots are passed, 0 - until the tour is stopped
+		unsigned recurring_time = 0;
+		std::vector<TourSpot> spots;
+	};
+
+	// the presets and the tours of one node in the order of the config, the tokens are indexed
+	class NodePresets
+	{
+	public:
+		// @node_configs is an item of "NodePresets",
+		// throws std::runtime_error if a token is repeated or a stay time is not a duration
+		explicit NodePresets(const boost::property_tree::ptree& node_configs);
+
+		const std::vector<Preset>& presets() const { return presets_; }
+		const std::vector<PresetTour>& tours() const { return tours_; }
+
+		// return nullptr if there is no an item with the token
+		const Preset* find_preset(const std::string& token) const;
+		const PresetTour* find_tour(const std::string& token) const;
+
+		// a token, which is not used by the node's presets
+		std::string new_preset_token() const;
+
+	private:
+		std::vector<Preset> presets_;
+		std::unordered_map<std::string, std::size_t> presets_index_;
+		std::vector<PresetTour> tours_;
+		std::unordered_map<std::string, std::size_t> tours_index_;
+	};
+
+	class Presets
+	{
+	public:
+		// @configs is a content of ptz.config, a node without an item of "NodePresets" has no presets
+		explicit Presets(const boost::property_tree::ptree& configs);
+
+		// the model of the same snapshot is built only once, the requests between the commits share it
+		static std::shared_ptr<const Presets> instance(const config::ConfigSnapshotSP& configs);
+
+		// returns nullptr if the node has no item of "NodePresets"
+		const NodePresets* find_node(const std::string& node_token) const;
+
+		const std::unordered_map<std::string, NodePresets>& nodes() const { return nodes_; }
+
+	private:
+		std::unordered_map<std::string, NodePresets> nodes_;
+	};
+
+	// the item of "NodePresets" with @preset added to the end or replacing the preset with the same token
+	boost::property_tree::ptree set_preset(const boost::property_tree::ptree& /*node_configs*/, const Preset& /*preset*/);
+	// the item of "NodePresets" without the preset, the tours' spots referring to it are skipped by the tours
+	boost::property_tree::ptree remove_preset(const boost::property_tree::ptree& /*node_configs*/,
+		const std::string& /*token*/);
+}
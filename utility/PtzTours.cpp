@@ -0,0 +1,207 @@
+#include "PtzTours.h"
+
+#include <stdexcept>
+
+namespace utility::ptz
+{
+	TourScheduler::TourScheduler(Mover mover)
+		: mover_(std::move(mover))
+	{
+	}
+
+	std::string TourScheduler::key_of(const std::string& node_token, const std::string& tour_token)
+	{
+		// the tokens have no control characters
+		return node_token + '\n' + tour_token;
+	}
+
+	void TourScheduler::start(const std::string& node_token, const PresetTour& tour, Clock::time_point now)
+	{
+		if (tour.spots.empty())
+			throw std::runtime_error("The preset tour has no spots: " + tour.token);
+
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		const auto key = key_of(node_token, tour.token);
+		for (auto& item : tours_)
+		{
+			if (item.first != key && item.second.node_token == node_token)
+				item.second.state = TourState::IDLE;
+		}
+
+		auto& state = tours_[key];
+		if (state.state == TourState::TOURING)
+			return;
+
+		if (state.state == TourState::IDLE)
+		{
+			state.spot = 0;
+			state.round = 0;
+		}
+		state.node_token = node_token;
+		state.tour = tour;
+		// the spots of the changed tour may be fewer
+		if (state.spot >= state.tour.spots.size())
+			state.spot = 0;
+		state.state = TourState::TOURING;
+
+		schedule(state, key, now);
+	}
+
+	void TourScheduler::pause(const std::string& node_token, const std::string& tour_token)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		auto it = tours_.find(key_of(node_token, tour_token));
+		if (it != tours_.end() && it->second.state == TourState::TOURING)
+			it->second.state = TourState::PAUSED;
+	}
+
+	void TourScheduler::stop(const std::string& node_token, const std::string& tour_token)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		auto it = tours_.find(key_of(node_token, tour_token));
+		if (it != tours_.end())
+			it->second.state = TourState::IDLE;
+	}
+
+	void TourScheduler::stop_node(const std::string& node_token)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		for (auto& item : tours_)
+		{
+			if (item.second.node_token == node_token)
+				item.second.state = TourState::IDLE;
+		}
+	}
+
+	TourState TourScheduler::state(const std::string& node_token, const std::string& tour_token) const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		auto it = tours_.find(key_of(node_token, tour_token));
+		return it != tours_.end() ? it->second.state : TourState::IDLE;
+	}
+
+	void TourScheduler::run(Clock::time_point now)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		while (!queue_.empty() && queue_.top().time <= now)
+		{
+			const auto due = queue_.top();
+			queue_.pop();
+
+			auto it = tours_.find(due.key);
+			if (it == tours_.end() || it->second.generation != due.generation || it->second.state != TourState::TOURING)
+				continue;
+
+			step(it->second, due.key, now);
+		}
+	}
+
+	Clock::time_point TourScheduler::next() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		drop_stale_steps();
+		return queue_.empty() ? Clock::time_point::max() : queue_.top().time;
+	}
+
+	void TourScheduler::schedule(Tour& tour, const std::string& key, Clock::time_point time)
+	{
+		queue_.push({ time, ++tour.generation, key });
+	}
+
+	void TourScheduler::step(Tour& tour, const std::string& key, Clock::time_point now)
+	{
+		// the spots with the removed presets are skipped, but a tour without any preset left is stopped
+		for (std::size_t skipped = 0; skipped < tour.tour.spots.size(); ++skipped)
+		{
+			if (tour.spot == tour.tour.spots.size())
+			{
+				tour.spot = 0;
+				if (tour.tour.recurring_time != 0 && ++tour.round >= tour.tour.recurring_time)
+				{
+					tour.state = TourState::IDLE;
+					return;
+				}
+			}
+
+			const auto& spot = tour.tour.spots[tour.spot++];
+			if (const auto arrival = mover_(tour.node_token, spot, now))
+				return schedule(tour, key, std::max(*arrival, now) + spot.stay_time);
+		}
+
+		tour.state = TourState::IDLE;
+	}
+
+	void TourScheduler::drop_stale_steps() const
+	{
+		while (!queue_.empty())
+		{
+			const auto& top = queue_.top();
+			auto it = tours_.find(top.key);
+			if (it != tours_.end() && it->second.generation == top.generation
+				&& it->second.state == TourState::TOURING)
+			{
+				return;
+			}
+
+			queue_.pop();
+		}
+	}
+
+	TourTimer::TourTimer(boost::asio::io_context& io_context, TourScheduler& scheduler)
+		: scheduler_(scheduler)
+		, timer_(io_context)
+	{
+	}
+
+	void TourTimer::schedule()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		arm();
+	}
+
+	void TourTimer::stop()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		stopped_ = true;
+		timer_.cancel();
+	}
+
+	void TourTimer::arm()
+	{
+		if (stopped_)
+			return;
+
+		// the waiting handler is cancelled
+		const auto next = scheduler_.next();
+		if (next == Clock::time_point::max())
+		{
+			timer_.cancel();
+			return;
+		}
+
+		timer_.expires_at(next);
+		timer_.async_wait(
+			[self = shared_from_this()](const boost::system::error_code& ec)
+			{
+				if (ec)
+					return;
+
+				// the steps are run under the lock, so stop() waits for them
+				std::lock_guard<std::mutex> lock(self->mutex_);
+				if (self->stopped_)
+					return;
+
+				self->scheduler_.run();
+				self->arm();
+			}
+		);
+	}
+}
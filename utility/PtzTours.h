@@ -0,0 +1,120 @@
+#pragma once
+
+#include "PtzMotion.h"
+#include "PtzPresets.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Runs the preset tours of all the heads from one timer.
+// The next step of each running tour is kept in a queue ordered by its time, the owner's timer waits
+// for the earliest one and calls run(), so the tours cost no threads and no timers of their own.
+namespace utility::ptz
+{
+	enum class TourState
+	{
+		IDLE,
+		TOURING,
+		PAUSED
+	};
+
+	class TourScheduler
+	{
+	public:
+		// moves the head of the node to the spot's preset and returns when the head arrives,
+		// nullopt if the preset is not found, then the spot is skipped.
+		// It's called under the scheduler's lock, so it must not call the scheduler
+		using Mover = std::function<std::optional<Clock::time_point>(const std::string& node_token, const TourSpot& spot,
+			Clock::time_point now)>;
+
+		explicit TourScheduler(Mover mover);
+
+		TourScheduler(const TourScheduler&) = delete;
+		TourScheduler& operator=(const TourScheduler&) = delete;
+
+		// starts the tour from its first spot or resumes the paused one, a running tour is not restarted.
+		// The other tours of the node are stopped, as they would move the same head.
+		// Throws std::runtime_error if the tour has no spots
+		void start(const std::string& node_token, const PresetTour& tour, Clock::time_point now = Clock::now());
+		// the paused tour continues from the next spot
+		void pause(const std::string& node_token, const std::string& tour_token);
+		void stop(const std::string& node_token, const std::string& tour_token);
+		// stops all the tours of the node, e.g. when its head is moved by a request
+		void stop_node(const std::string& node_token);
+
+		TourState state(const std::string& node_token, const std::string& tour_token) const;
+
+		// moves the heads of the tours, which steps are due, and schedules their next steps
+		void run(Clock::time_point now = Clock::now());
+		// the time of the earliest step, Clock::time_point::max() if no tour is running
+		Clock::time_point next() const;
+
+	private:
+		struct Tour
+		{
+			std::string node_token;
+			PresetTour tour;
+			TourState state = TourState::IDLE;
+			// the spot of the next step
+			std::size_t spot = 0;
+			unsigned round = 0;
+			// the steps of the previous runs of the tour are left in the queue, they're skipped by it
+			std::uint64_t generation = 0;
+		};
+
+		struct Step
+		{
+			Clock::time_point time;
+			std::uint64_t generation;
+			std::string key;
+
+			bool operator>(const Step& other) const { return time > other.time; }
+		};
+
+		static std::string key_of(const std::string& node_token, const std::string& tour_token);
+
+		void schedule(Tour& tour, const std::string& key, Clock::time_point time);
+		void step(Tour& tour, const std::string& key, Clock::time_point now);
+		void drop_stale_steps() const;
+
+		const Mover mover_;
+
+		mutable std::mutex mutex_;
+		std::unordered_map<std::string, Tour> tours_;
+		mutable std::priority_queue<Step, std::vector<Step>, std::greater<Step>> queue_;
+	};
+
+	// the timer of a scheduler, it waits on the io_context for the earliest step and runs the due ones.
+	// The waiting handler shares the timer, so it's created by std::make_shared
+	class TourTimer : public std::enable_shared_from_this<TourTimer>
+	{
+	public:
+		TourTimer(boost::asio::io_context& io_context, TourScheduler& scheduler);
+
+		// it's called after each change of the scheduler's tours. The earliest step is read under the timer's lock,
+		// so a concurrent call with an older step can't cancel the timer armed for a newer one
+		void schedule();
+		// cancels the waiting, no step is run after it returns, so the scheduler may be destroyed
+		void stop();
+
+	private:
+		// it's called under @mutex_
+		void arm();
+
+		TourScheduler& scheduler_;
+
+		std::mutex mutex_;
+		bool stopped_ = false;
+		boost::asio::steady_timer timer_;
+	};
+}
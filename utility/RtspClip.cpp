@@ -0,0 +1,160 @@
+#include "RtspClip.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+	using utility::rtsp::Codec;
+
+	struct Nal
+	{
+		// the start code's offset, a leading zero byte is included
+		std::size_t offset;
+		const unsigned char* header;
+		// the bytes of the NAL after its header's first byte
+		std::size_t tail;
+	};
+
+	std::vector<Nal> find_nals(const unsigned char* data, std::size_t size)
+	{
+		std::vector<Nal> result;
+		for (std::size_t i = 0; i + 3 < size; ++i)
+		{
+			if (data[i] != 0 || data[i + 1] != 0 || data[i + 2] != 1)
+				continue;
+
+			const auto offset = i > 0 && data[i - 1] == 0 ? i - 1 : i;
+			result.push_back({ offset, data + i + 3, 0 });
+			i += 2;
+		}
+
+		for (std::size_t i = 0; i < result.size(); ++i)
+		{
+			const auto end = i + 1 < result.size() ? data + result[i + 1].offset : data + size;
+			result[i].tail = static_cast<std::size_t>(end - result[i].header) - 1;
+		}
+
+		return result;
+	}
+
+	struct NalInfo
+	{
+		bool vcl;
+		// the first slice of a picture
+		bool first_slice;
+		// the NAL types, which may only precede the first slice of a picture
+		bool prefix;
+		bool key_frame;
+	};
+
+	NalInfo info_of(const Nal& nal, Codec codec)
+	{
+		NalInfo result{};
+		if (codec == Codec::H264)
+		{
+			const int type = nal.header[0] & 0x1f;
+			result.vcl = type >= 1 && type <= 5;
+			// first_mb_in_slice is 0, its ue(v) code is the single bit 1
+			result.first_slice = result.vcl && nal.tail >= 1 && (nal.header[1] & 0x80) != 0;
+			result.prefix = type == 6 || type == 7 || type == 8 || type == 9 || (type >= 14 && type <= 18);
+			result.key_frame = type == 5;
+		}
+		else
+		{
+			const int type = (nal.header[0] >> 1) & 0x3f;
+			result.vcl = type < 32;
+			// first_slice_segment_in_pic_flag follows the 2 bytes of the header
+			result.first_slice = result.vcl && nal.tail >= 2 && (nal.header[2] & 0x80) != 0;
+			result.prefix = (type >= 32 && type <= 35) || type == 39 || (type >= 41 && type <= 44)
+				|| (type >= 48 && type <= 55);
+			result.key_frame = type >= 16 && type <= 23;
+		}
+
+		return result;
+	}
+}
+
+namespace utility::rtsp
+{
+	std::vector<AccessUnit> index_access_units(const char* data, std::size_t size, Codec codec)
+	{
+		const auto bytes = reinterpret_cast<const unsigned char*>(data);
+
+		std::vector<AccessUnit> result;
+		bool has_vcl = false;
+		for (const auto& nal : find_nals(bytes, size))
+		{
+			const auto info = info_of(nal, codec);
+
+			// a picture's access unit ends before the next picture's prefix or first slice
+			if (result.empty() || (has_vcl && (info.prefix || info.first_slice)))
+			{
+				if (!result.empty())
+					result.back().size = static_cast<std::uint32_t>(nal.offset - result.back().offset);
+
+				result.push_back({ nal.offset, 0, false });
+				has_vcl = false;
+			}
+
+			has_vcl = has_vcl || info.vcl;
+			result.back().key_frame = result.back().key_frame || info.key_frame;
+		}
+
+		if (!result.empty())
+			result.back().size = static_cast<std::uint32_t>(size - result.back().offset);
+
+		// the access units without a picture are not streamed separately
+		if (!result.empty() && !has_vcl)
+			result.pop_back();
+
+		// the stream can be decoded only from a key frame, it's also the start of each loop
+		const auto first_key = std::find_if(result.begin(), result.end(),
+			[](const AccessUnit& access_unit) { return access_unit.key_frame; });
+		if (first_key == result.end())
+			throw std::runtime_error("There is no key frame in the stream");
+
+		result.erase(result.begin(), first_key);
+		result.shrink_to_fit();
+
+		return result;
+	}
+
+	Clip::Clip(const std::string& path, Codec codec)
+		: path_(path)
+		, codec_(codec)
+		, file_(path)
+		, access_units_([this]() {
+				try
+				{
+					return index_access_units(file_.data(), file_.size(), codec_);
+				}
+				catch (const std::exception& e)
+				{
+					throw std::runtime_error("Could not index the clip " + path_ + ": " + e.what());
+				}
+			}())
+	{
+	}
+
+	std::shared_ptr<const Clip> Clip::open(const std::string& path, Codec codec)
+	{
+		static std::mutex clips_mutex;
+		static std::map<std::pair<std::string, Codec>, std::weak_ptr<const Clip>> clips;
+
+		std::lock_guard<std::mutex> lock(clips_mutex);
+
+		auto& clip = clips[{ path, codec }];
+		auto result = clip.lock();
+		if (!result)
+		{
+			result = std::make_shared<const Clip>(path, codec);
+			clip = result;
+		}
+
+		return result;
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The recorded clips served by RTSP instead of an encoded test pattern.
+// A clip is an H.264 or H.265 elementary stream in the Annex B byte-stream format,
+// its access units are indexed once, so the streaming only slices the mapped file.
+// An MP4 file may be converted by: ffmpeg -i clip.mp4 -c:v copy -bsf:v h264_mp4toannexb -an clip.h264
+// (hevc_mp4toannexb for H.265).
+namespace utility::rtsp
+{
+	enum class Codec
+	{
+		H264,
+		H265
+	};
+
+	struct AccessUnit
+	{
+		// the offset of the first start code in the file
+		std::uint64_t offset = 0;
+		std::uint32_t size = 0;
+		// IDR for H.264, IRAP for H.265
+		bool key_frame = false;
+	};
+
+	// the access units from the first key frame, the start codes are included,
+	// throws std::runtime_error if there is no key frame
+	std::vector<AccessUnit> index_access_units(const char* /*data*/, std::size_t /*size*/, Codec /*codec*/);
+
+	class Clip
+	{
+	public:
+		// maps and indexes the file, throws std::runtime_error if it could not be read or indexed
+		Clip(const std::string& path, Codec codec);
+
+		// the same file of the same codec is mapped once while any of its users exists
+		static std::shared_ptr<const Clip> open(const std::string& path, Codec codec);
+
+		const std::string& path() const { return path_; }
+		Codec codec() const { return codec_; }
+		const char* data() const { return file_.data(); }
+		std::size_t size() const { return file_.size(); }
+		const std::vector<AccessUnit>& access_units() const { return access_units_; }
+
+	private:
+		const std::string path_;
+		const Codec codec_;
+		const MappedFile file_;
+		const std::vector<AccessUnit> access_units_;
+	};
+}
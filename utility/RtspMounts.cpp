@@ -0,0 +1,325 @@
+#include "RtspMounts.h"
+
+#include "DateTime.hpp"
+
+#include "../Logger.h"
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+	using namespace utility::media;
+
+	// GStreamer's fraction, a not integer rate is kept with 1/1000 precision
+	std::string to_fraction(float frame_rate)
+	{
+		const auto rounded = std::lround(frame_rate);
+		if (std::fabs(frame_rate - rounded) < 0.001f)
+			return std::to_string(rounded) + "/1";
+
+		return std::to_string(std::lround(frame_rate * 1000)) + "/1000";
+	}
+
+	std::string to_lower(std::string str)
+	{
+		std::transform(str.begin(), str.end(), str.begin(),
+			[](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return str;
+	}
+
+	void check_encoding(const VideoEncoderConfiguration& encoder)
+	{
+		if (encoder.encoding != "H264" && encoder.encoding != "H265" && encoder.encoding != "JPEG")
+			throw std::invalid_argument("The encoding is not supported: " + encoder.encoding);
+	}
+
+	const std::string* clip_of(const VideoEncoderConfiguration& encoder, const utility::rtsp::StreamOptions& options)
+	{
+		const auto it = options.clips.find(encoder.token);
+		if (it == options.clips.end())
+			return nullptr;
+
+		if (encoder.encoding == "JPEG")
+			throw std::invalid_argument("A clip can't be streamed as " + encoder.encoding);
+
+		return &it->second;
+	}
+
+	// 224.0.0.0/4
+	bool is_ipv4_multicast(const std::string& address)
+	{
+		std::istringstream is(address);
+		int octets[4];
+		char dots[3];
+		if (!(is >> octets[0] >> dots[0] >> octets[1] >> dots[1] >> octets[2] >> dots[2] >> octets[3]) || !is.eof())
+			return false;
+
+		for (int i = 0; i < 4; ++i)
+		{
+			if (octets[i] < 0 || octets[i] > 255 || (i < 3 && dots[i] != '.'))
+				return false;
+		}
+
+		return octets[0] >= 224 && octets[0] <= 239;
+	}
+
+	// nullptr if the encoder has no preset, throws std::invalid_argument if it's unknown
+	const utility::rtsp::EncoderPreset* preset_of(const VideoEncoderConfiguration& encoder,
+		const utility::rtsp::StreamOptions& options)
+	{
+		const auto it = options.encoder_presets.find(encoder.token);
+		const auto& name = it != options.encoder_presets.end() ? it->second : options.preset;
+		if (name.empty())
+			return nullptr;
+
+		const auto preset = options.presets.find(name);
+		if (preset == options.presets.end())
+			throw std::invalid_argument("The preset is unknown: " + name);
+
+		return &preset->second;
+	}
+
+	// the test pattern with the encoder's resolution and frame rate
+	std::string source_of(const VideoEncoderConfiguration& encoder)
+	{
+		std::ostringstream source;
+		source << "videotestsrc is-live=1 ! video/x-raw,width=" << encoder.resolution.width
+			<< ",height=" << encoder.resolution.height;
+		if (encoder.rate_control && encoder.rate_control->frame_rate_limit > 0)
+			source << ",framerate=" << to_fraction(encoder.rate_control->frame_rate_limit);
+
+		return source.str();
+	}
+
+	std::string encoder_of(const VideoEncoderConfiguration& encoder, const utility::rtsp::EncoderPreset* preset)
+	{
+		if (encoder.encoding == "JPEG")
+			return "jpegenc";
+
+		const bool h264 = encoder.encoding == "H264";
+		const int bitrate = encoder.rate_control ? encoder.rate_control->bitrate_limit : 0;
+		const int gov_length = encoder.h264 ? encoder.h264->gov_length : 0;
+
+		std::ostringstream result;
+		result << (h264 ? "x264enc" : "x265enc");
+		if (preset && !preset->speed_preset.empty())
+			result << " speed-preset=" << preset->speed_preset;
+		if (preset && !preset->tune.empty())
+			result << " tune=" << preset->tune;
+		if (preset && preset->threads > 0 && h264)
+			result << " threads=" << preset->threads;
+		if (bitrate > 0)
+			result << " bitrate=" << bitrate;
+		if (gov_length > 0)
+			result << " key-int-max=" << gov_length;
+
+		if (h264 && encoder.h264 && !encoder.h264->profile.empty())
+			result << " ! video/x-h264,profile=" << to_lower(encoder.h264->profile);
+
+		return result.str();
+	}
+
+	// a payloader fed by appsrc gets the parameter sets only in the stream, so they are repeated on each key frame
+	std::string payloader_of(const VideoEncoderConfiguration& encoder, bool shared_encoding)
+	{
+		if (encoder.encoding == "JPEG")
+			return "rtpjpegpay name=pay0 pt=26";
+
+		return std::string(encoder.encoding == "H264" ? "rtph264pay" : "rtph265pay") + " name=pay0 pt=96"
+			+ (shared_encoding ? " config-interval=-1" : "");
+	}
+}
+
+namespace utility::rtsp
+{
+	StreamOptions read_stream_options(const boost::property_tree::ptree& rtsp_configs)
+	{
+		static const std::set<std::string> SPEED_PRESETS = { "ultrafast", "superfast", "veryfast", "faster", "fast",
+			"medium", "slow", "slower", "veryslow", "placebo" };
+		static const std::set<std::string> TUNES = { "stillimage", "fastdecode", "zerolatency" };
+
+		StreamOptions result;
+		result.shared_encoding = rtsp_configs.get<bool>("sharedEncoding", result.shared_encoding);
+
+		if (const auto clips = rtsp_configs.get_child_optional("clips"))
+		{
+			for (const auto& clip : *clips)
+				result.clips[clip.first] = clip.second.get_value<std::string>();
+		}
+
+		if (const auto presets = rtsp_configs.get_child_optional("presets"))
+		{
+			for (const auto& node : *presets)
+			{
+				EncoderPreset preset;
+				preset.speed_preset = node.second.get<std::string>("speedPreset", "");
+				preset.tune = node.second.get<std::string>("tune", "");
+				preset.threads = node.second.get<int>("threads", 0);
+				preset.passthrough = node.second.get<bool>("passthrough", false);
+
+				if (!preset.speed_preset.empty() && SPEED_PRESETS.count(preset.speed_preset) == 0)
+					throw std::runtime_error("The preset " + node.first + " has unknown speedPreset: " + preset.speed_preset);
+				if (!preset.tune.empty() && TUNES.count(preset.tune) == 0)
+					throw std::runtime_error("The preset " + node.first + " has unknown tune: " + preset.tune);
+				if (preset.threads < 0)
+					throw std::runtime_error("The preset " + node.first + " has negative threads");
+
+				result.presets[node.first] = preset;
+			}
+		}
+
+		auto check_preset = [&result](const std::string& name) {
+			if (result.presets.count(name) == 0)
+				throw std::runtime_error("The preset is unknown: " + name);
+		};
+
+		result.preset = rtsp_configs.get<std::string>("preset", "");
+		if (!result.preset.empty())
+			check_preset(result.preset);
+
+		if (const auto encoder_presets = rtsp_configs.get_child_optional("encoderPresets"))
+		{
+			for (const auto& encoder_preset : *encoder_presets)
+			{
+				result.encoder_presets[encoder_preset.first] = encoder_preset.second.get_value<std::string>();
+				check_preset(result.encoder_presets[encoder_preset.first]);
+			}
+		}
+
+		return result;
+	}
+
+	SessionOptions read_session_options(const boost::property_tree::ptree& rtsp_configs)
+	{
+		SessionOptions result;
+		result.max_sessions = rtsp_configs.get<unsigned>("maxSessions", result.max_sessions);
+		result.max_mount_sessions = rtsp_configs.get<unsigned>("maxMountSessions", result.max_mount_sessions);
+		result.cleanup_interval = rtsp_configs.get<unsigned>("sessionsCleanupInterval", result.cleanup_interval);
+		if (result.cleanup_interval == 0)
+			throw std::runtime_error("sessionsCleanupInterval should be positive");
+		result.client_threads = rtsp_configs.get<unsigned>("clientThreads", result.client_threads);
+
+		return result;
+	}
+
+	std::string make_launch(const VideoEncoderConfiguration& encoder, const StreamOptions& options)
+	{
+		check_encoding(encoder);
+
+		const auto preset = preset_of(encoder, options);
+		const auto clip = clip_of(encoder, options);
+		if (preset && preset->passthrough && clip == nullptr)
+			throw std::invalid_argument("The passthrough preset requires a clip of " + encoder.token);
+
+		if (options.shared_encoding || clip != nullptr)
+			return "( appsrc name=src is-live=true format=time ! " + payloader_of(encoder, true) + " )";
+
+		return "( " + source_of(encoder) + " ! " + encoder_of(encoder, preset) + " ! "
+			+ payloader_of(encoder, false) + " )";
+	}
+
+	std::string make_shared_encoding(const VideoEncoderConfiguration& encoder, const StreamOptions& options)
+	{
+		check_encoding(encoder);
+
+		std::string parser;
+		if (encoder.encoding == "H264")
+			parser = " ! h264parse ! video/x-h264,stream-format=byte-stream,alignment=au";
+		else if (encoder.encoding == "H265")
+			parser = " ! h265parse ! video/x-h265,stream-format=byte-stream,alignment=au";
+
+		return source_of(encoder) + " ! " + encoder_of(encoder, preset_of(encoder, options)) + parser
+			+ " ! appsink name=sink sync=false";
+	}
+
+	std::string make_snapshot(const VideoEncoderConfiguration& encoder, const StreamOptions& options)
+	{
+		if (const auto clip = clip_of(encoder, options))
+		{
+			return "filesrc location=\"" + *clip + "\" ! " + to_lower(encoder.encoding) + "parse ! decodebin"
+				" ! videoconvert ! jpegenc snapshot=true ! appsink name=sink";
+		}
+
+		std::ostringstream result;
+		result << "videotestsrc num-buffers=1 ! video/x-raw,width=" << encoder.resolution.width
+			<< ",height=" << encoder.resolution.height << " ! jpegenc snapshot=true ! appsink name=sink";
+		return result.str();
+	}
+
+	std::vector<Mount> make_mounts(const MediaProfiles& profiles,
+		const std::vector<std::optional<StreamUri>>& stream_uris, const StreamOptions& options, ILogger& logger)
+	{
+		std::vector<Mount> result;
+		std::set<std::string> paths;
+
+		for (std::size_t i = 0; i < profiles.profiles().size() && i < stream_uris.size(); ++i)
+		{
+			const auto& profile = profiles.profiles()[i];
+			if (!stream_uris[i])
+			{
+				logger.Warn("The profile " + profile.token + " has no stream URI, it's not served by RTSP");
+				continue;
+			}
+
+			const auto path = "/" + stream_uris[i]->uri;
+			if (paths.count(path) != 0)
+				continue;
+
+			try
+			{
+				Mount mount;
+				mount.path = path;
+				mount.profile_token = profile.token;
+				mount.encoder = profile.video_encoder2 != NOT_FOUND ? profiles.video_encoder2_of(profile)
+					: profiles.video_encoder_of(profile);
+				mount.launch = make_launch(mount.encoder, options);
+				if (const auto clip = clip_of(mount.encoder, options))
+					mount.clip = *clip;
+				else if (options.shared_encoding)
+					mount.shared_encoding = make_shared_encoding(mount.encoder, options);
+				mount.snapshot = make_snapshot(mount.encoder, options);
+
+				// only the Media1 configuration has the session timeout
+				const auto& session_timeout = profile.video_encoder != NOT_FOUND
+					? profiles.video_encoder_of(profile).session_timeout : mount.encoder.session_timeout;
+				if (!session_timeout.empty())
+				{
+					if (const auto timeout = utility::datetime::parse_duration(session_timeout))
+						mount.session_timeout = std::chrono::duration_cast<std::chrono::seconds>(*timeout);
+					else
+						logger.Warn("The session timeout of " + profile.token + " is not correct: " + session_timeout);
+				}
+
+				// as well as the multicast group
+				const auto& multicast = profile.video_encoder != NOT_FOUND
+					? profiles.video_encoder_of(profile).multicast : mount.encoder.multicast;
+				if (multicast && multicast->port != 0)
+				{
+					if (multicast->address_type == "IPv4" && is_ipv4_multicast(multicast->ipv4_address)
+						&& multicast->port > 0 && multicast->port < 65535 && multicast->port % 2 == 0
+						&& multicast->ttl >= 0 && multicast->ttl <= 255)
+						mount.multicast = multicast;
+					else
+						logger.Warn("The multicast group of " + profile.token + " is not correct: "
+							+ multicast->ipv4_address + ":" + std::to_string(multicast->port));
+				}
+
+				result.push_back(std::move(mount));
+				paths.insert(path);
+			}
+			catch (const std::exception& e)
+			{
+				logger.Warn("The profile " + profile.token + " is not served by RTSP: " + e.what());
+			}
+		}
+
+		return result;
+	}
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "MediaProfiles.h"
+
+#include <boost/property_tree/ptree_fwd.hpp>
+
+#include <chrono>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+class ILogger;
+
+// The RTSP mounts derived from the media profiles.
+// A profile is served on the path of its GetStreamUri with the parameters of its video encoder,
+// so the URIs returned by the media services and the served streams stay consistent.
+// It doesn't depend on GStreamer, rtsp::Server creates the factories from the descriptions.
+namespace utility::rtsp
+{
+	// the parameters of x264enc, the speed preset and the tune are also used by x265enc
+	struct EncoderPreset
+	{
+		// e.g. "ultrafast", the encoder's default if it's empty
+		std::string speed_preset;
+		// "zerolatency" disables B-frames and the lookahead, so a frame is sent as soon as it's encoded
+		std::string tune;
+		// 0 - chosen by the encoder
+		int threads = 0;
+		// nothing is encoded, the encoder's clip is streamed as it is
+		bool passthrough = false;
+	};
+
+	// how the streams are produced
+	struct StreamOptions
+	{
+		// the mounts with the same encoder's configuration share one encoding pipeline,
+		// each mount only payloads the encoded stream
+		bool shared_encoding = false;
+		// encoder's token -> the clip's file, which is streamed instead of encoding the test pattern,
+		// see RtspClip.h
+		std::map<std::string, std::string> clips;
+
+		// name -> preset
+		std::map<std::string, EncoderPreset> presets;
+		// the preset of the encoders, which are not in @encoder_presets, the encoders' defaults are used if it's empty
+		std::string preset;
+		// encoder's token -> preset's name
+		std::map<std::string, std::string> encoder_presets;
+	};
+
+	// reads the "rtsp" section of common.config, throws std::runtime_error if a preset is incorrect
+	// or an unknown preset is used
+	StreamOptions read_stream_options(const boost::property_tree::ptree& /*rtsp_configs*/);
+
+	// the limits of the RTSP sessions, 0 - unlimited
+	struct SessionOptions
+	{
+		unsigned max_sessions = 0;
+		// the sessions of each mount
+		unsigned max_mount_sessions = 0;
+		// how often the expired sessions are removed, in seconds
+		unsigned cleanup_interval = 1;
+		// the threads serving the clients, each with its own main context, the clients are spread among them,
+		// 0 - all the clients are served by the server's thread
+		unsigned client_threads = 0;
+	};
+
+	// reads the "rtsp" section of common.config
+	SessionOptions read_session_options(const boost::property_tree::ptree& /*rtsp_configs*/);
+
+	struct Mount
+	{
+		// starts with "/"
+		std::string path;
+		std::string profile_token;
+		media::VideoEncoderConfiguration encoder;
+		// the description of the factory's pipeline
+		std::string launch;
+		// the description of the shared encoding pipeline, which feeds the factory's appsrc "src",
+		// it's empty if the factory encodes the stream itself
+		std::string shared_encoding;
+		// the clip, which feeds the factory's appsrc "src" in the encoder's frame rate, if it's not empty
+		std::string clip;
+		// the description of the pipeline encoding a JPEG snapshot of the stream, see make_snapshot
+		std::string snapshot;
+		// the encoder's SessionTimeout, the server's default is used if it's 0
+		std::chrono::seconds session_timeout{ 0 };
+		// the encoder's multicast group, its Port is RTP's and the next one is RTCP's,
+		// the mount is served only by unicast without it
+		std::optional<media::Multicast> multicast;
+	};
+
+	// the pipeline of a test pattern encoded with the encoder's parameters, or the pipeline,
+	// which payloads the stream from the shared encoding or the encoder's clip of @options,
+	// throws std::invalid_argument if the encoding is not supported or the encoder's passthrough preset has no clip
+	std::string make_launch(const media::VideoEncoderConfiguration& /*encoder*/, const StreamOptions& /*options*/ = {});
+
+	// the pipeline encoding a test pattern into the access units of the byte-stream, which are taken
+	// from its appsink "sink", throws std::invalid_argument if the encoding is not supported
+	std::string make_shared_encoding(const media::VideoEncoderConfiguration& /*encoder*/,
+		const StreamOptions& /*options*/ = {});
+
+	// the pipeline encoding one JPEG frame of the test pattern with the encoder's resolution or the first frame
+	// of the encoder's clip of @options, the frame is taken from its appsink "sink"
+	std::string make_snapshot(const media::VideoEncoderConfiguration& /*encoder*/, const StreamOptions& /*options*/ = {});
+
+	// @stream_uris are indexed the same as the profiles, see MediaProfiles::resolve_stream_uris.
+	// The Media2 configuration of an encoder is used if there is one, as it's changed by the requests.
+	// The multicast group is used if its address is IPv4 multicast and its port is even and not 0,
+	// so the default "0.0.0.0" disables it.
+	// The profiles with the same URI are served by the first of them, the profiles without a URI
+	// or with a broken encoder are skipped with a warning
+	std::vector<Mount> make_mounts(const media::MediaProfiles& /*profiles*/,
+		const std::vector<std::optional<media::StreamUri>>& /*stream_uris*/, const StreamOptions& /*options*/,
+		ILogger& /*logger*/);
+}
@@ -0,0 +1,63 @@
+#include "SnapshotCache.h"
+
+namespace utility
+{
+	SnapshotCache::SnapshotCache(std::chrono::milliseconds interval)
+		: interval_(interval)
+	{
+	}
+
+	SnapshotCache::Frame SnapshotCache::get(const std::string& key, const std::function<std::string()>& encode)
+	{
+		std::promise<Frame> promise;
+		std::shared_future<Frame> frame;
+		std::uint64_t id = 0;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+
+			const auto now = std::chrono::steady_clock::now();
+			const auto it = entries_.find(key);
+			// the age is compared in milliseconds, so PERMANENT doesn't overflow
+			if (it != entries_.end()
+				&& (std::chrono::duration_cast<std::chrono::milliseconds>(now - it->second.started) < interval_
+				|| it->second.frame.wait_for(std::chrono::seconds(0)) != std::future_status::ready))
+			{
+				frame = it->second.frame;
+			}
+			else
+			{
+				frame = promise.get_future().share();
+				id = ++next_id_;
+				entries_[key] = Entry{ frame, now, id };
+			}
+		}
+
+		// the frame is waited for without the lock
+		if (id == 0)
+			return frame.get();
+
+		try
+		{
+			promise.set_value(std::make_shared<const std::string>(encode()));
+		}
+		catch (...)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+
+				const auto it = entries_.find(key);
+				if (it != entries_.end() && it->second.id == id)
+					entries_.erase(it);
+			}
+			promise.set_exception(std::current_exception());
+		}
+
+		return frame.get();
+	}
+
+	void SnapshotCache::erase(const std::string& key)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		entries_.erase(key);
+	}
+}
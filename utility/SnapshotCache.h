@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace utility
+{
+	// The latest encoded frames of the keys, e.g. the JPEG snapshots of the media profiles.
+	// A key's frame is encoded at most once per interval, the concurrent requests of a key wait for
+	// the same encoding and share its bytes, so the polling clients hit the memory instead of the encoder.
+	class SnapshotCache
+	{
+	public:
+		using Frame = std::shared_ptr<const std::string>;
+
+		// the frames are kept until they are erased, e.g. the first frame of a clip
+		static constexpr std::chrono::milliseconds PERMANENT = std::chrono::milliseconds::max();
+
+		explicit SnapshotCache(std::chrono::milliseconds interval);
+
+		// the frame of @key, whose encoding was started less than the interval ago, otherwise @encode is called
+		// once for all the concurrent callers, its exception is thrown to all of them and is not cached
+		Frame get(const std::string& /*key*/, const std::function<std::string()>& /*encode*/);
+
+		// the next request of @key encodes a new frame, e.g. after the key's encoder is changed
+		void erase(const std::string& /*key*/);
+
+	private:
+		struct Entry
+		{
+			std::shared_future<Frame> frame;
+			std::chrono::steady_clock::time_point started;
+			// tells the failed encoding from the next one
+			std::uint64_t id;
+		};
+
+		const std::chrono::milliseconds interval_;
+
+		std::mutex mutex_;
+		std::map<std::string, Entry> entries_;
+		std::uint64_t next_id_ = 0;
+	};
+}
@@ -1,4 +1,5 @@
 #include "SoapHelper.h"
+#include "Uuid.h"
 
 #include <boost\property_tree\ptree.hpp>
 
@@ -16,7 +17,7 @@ namespace utility
 
 			envelope_tree.put("s:Header", "");
 
-			for (auto it : xmlns)
+			for (const auto& it : xmlns)
 			{
 				envelope_tree.put("<xmlattr>.xmlns:" + it.first,
 					it.second);
@@ -25,6 +26,14 @@ namespace utility
 			return envelope_tree;
 		}
 
+		void addResponseMessageId(boost::property_tree::ptree& envelope_tree, const std::string& requestMessageId)
+		{
+			envelope_tree.add("s:Header.wsa:MessageID", utility::uuid::urn_v4().str());
+
+			if (!requestMessageId.empty())
+				envelope_tree.add("s:Header.wsa:RelatesTo", requestMessageId);
+		}
+
 		void jsonNodeToXml(const pt::ptree& jsonNode,
 			pt::ptree& xmlNode,
 			const std::string nsPrefix,
@@ -32,7 +41,7 @@ namespace utility
 		{
 			auto ns = nsPrefix.empty() ? "" : nsPrefix + ":";
 
-			for (auto i : jsonNode)
+			for (const auto& i : jsonNode)
 			{
 				//it's a JSON object
 				if (i.second.size())
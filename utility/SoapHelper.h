@@ -13,6 +13,10 @@ namespace utility
 		
 		boost::property_tree::ptree getEnvelopeTree(const osrv::StringsMap& xmlns);
 
+		//adds a new MessageID of a response and RelatesTo with @requestMessageId (if it's not empty)
+		//NOTE: "wsa" prefix should be declared by the envelope's namespaces
+		void addResponseMessageId(boost::property_tree::ptree& envelope_tree, const std::string& requestMessageId);
+
 		using ElementsProcessor = std::function<void(std::string&, std::string&)>;
 
 		inline void DefaultProcessor(const std::string& element, const std::string& value)
@@ -0,0 +1,120 @@
+#include "Uuid.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <random>
+
+namespace utility::uuid
+{
+	// xoshiro256** (https://prng.di.unimi.it/), it's much faster and smaller than std::mt19937_64
+	class Random
+	{
+	public:
+		Random()
+		{
+			// the seeds of the threads differ even if std::random_device is deterministic on a platform
+			static std::atomic<std::uint64_t> threads_counter{ 0 };
+
+			std::random_device device;
+			std::uint64_t seed = (static_cast<std::uint64_t>(device()) << 32) ^ device();
+			seed ^= static_cast<std::uint64_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+			seed ^= threads_counter.fetch_add(1) * 0x9E3779B97F4A7C15ull;
+			seed ^= reinterpret_cast<std::uintptr_t>(&seed);
+
+			for (auto& s : state_)
+				s = splitmix64(seed);
+		}
+
+		std::uint64_t next()
+		{
+			const auto result = rotl(state_[1] * 5, 7) * 9;
+			const auto t = state_[1] << 17;
+
+			state_[2] ^= state_[0];
+			state_[3] ^= state_[1];
+			state_[1] ^= state_[2];
+			state_[0] ^= state_[3];
+			state_[2] ^= t;
+			state_[3] = rotl(state_[3], 45);
+
+			return result;
+		}
+
+	private:
+		static std::uint64_t rotl(std::uint64_t x, int k)
+		{
+			return (x << k) | (x >> (64 - k));
+		}
+
+		static std::uint64_t splitmix64(std::uint64_t& x)
+		{
+			auto z = (x += 0x9E3779B97F4A7C15ull);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return z ^ (z >> 31);
+		}
+
+		std::uint64_t state_[4];
+	};
+
+	static Random& thread_random()
+	{
+		thread_local Random random;
+		return random;
+	}
+
+	static void set_version_and_variant(Bytes& bytes, std::uint8_t version)
+	{
+		bytes[6] = static_cast<std::uint8_t>((bytes[6] & 0x0F) | (version << 4));
+		bytes[8] = static_cast<std::uint8_t>((bytes[8] & 0x3F) | 0x80);
+	}
+
+	static void put_random(Bytes& bytes, std::size_t from)
+	{
+		auto& random = thread_random();
+		const std::uint64_t values[2] = { random.next(), random.next() };
+		std::memcpy(bytes.data() + from, values, bytes.size() - from);
+	}
+
+	Bytes generate_v4()
+	{
+		Bytes bytes;
+		put_random(bytes, 0);
+		set_version_and_variant(bytes, 4);
+		return bytes;
+	}
+
+	Bytes generate_v7()
+	{
+		const auto ms = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count());
+
+		Bytes bytes;
+		for (int i = 0; i < 6; ++i)
+			bytes[i] = static_cast<std::uint8_t>(ms >> (8 * (5 - i)));
+
+		put_random(bytes, 6);
+		set_version_and_variant(bytes, 7);
+		return bytes;
+	}
+
+	Urn::Urn(const Bytes& bytes)
+	{
+		static const char HEX[] = "0123456789abcdef";
+		static const char PREFIX[] = "urn:uuid:";
+
+		auto out = chars_.data();
+		std::memcpy(out, PREFIX, sizeof(PREFIX) - 1);
+		out += sizeof(PREFIX) - 1;
+
+		for (std::size_t i = 0; i < bytes.size(); ++i)
+		{
+			if (i == 4 || i == 6 || i == 8 || i == 10)
+				*out++ = '-';
+
+			*out++ = HEX[bytes[i] >> 4];
+			*out++ = HEX[bytes[i] & 0x0F];
+		}
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Generation of random (version 4) and time-ordered (version 7) UUIDs, RFC 9562.
+// Each thread has its own PRNG state seeded from std::random_device, so the generation
+// takes no locks and the ids are unique across the threads and the processes.
+namespace utility::uuid
+{
+	using Bytes = std::array<std::uint8_t, 16>;
+
+	Bytes generate_v4();
+
+	// the first 48 bits are the Unix time in milliseconds, so the ids are ordered by the creation time
+	Bytes generate_v7();
+
+	// "urn:uuid:" + 36 symbols of the canonical form
+	static const std::size_t URN_LENGTH = 45;
+
+	// a formatted id is kept on the stack until it's copied into a message
+	class Urn
+	{
+	public:
+		explicit Urn(const Bytes& bytes);
+
+		std::string_view view() const { return std::string_view(chars_.data(), chars_.size()); }
+		std::string str() const { return std::string(chars_.data(), chars_.size()); }
+
+		// only the canonical form without "urn:uuid:"
+		std::string_view uuid() const { return view().substr(9); }
+
+	private:
+		std::array<char, URN_LENGTH> chars_;
+	};
+
+	inline Urn urn_v4() { return Urn(generate_v4()); }
+	inline Urn urn_v7() { return Urn(generate_v7()); }
+}
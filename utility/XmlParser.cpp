@@ -103,6 +103,24 @@ namespace exns
 		return {};
 	}
 	
+	const pt::ptree* find_path(const std::string& path, const pt::ptree& node)
+	{
+		std::vector<std::string> tokens;
+		boost::split(tokens, path, boost::is_any_of("."));
+
+		const pt::ptree* result = &node;
+		for (const auto& token : tokens)
+		{
+			auto it = exns::find(token, *result);
+			if (it == result->not_found())
+				return nullptr;
+
+			result = &it->second;
+		}
+
+		return result;
+	}
+
 	pt::ptree to_ptree(const std::string& str)
 	{
 		std::istringstream is(str);
@@ -116,4 +116,21 @@ namespace exns
 	std::string find_hierarchy(const std::string& /*path*/, const pt::ptree& /*node*/);
 
 	pt::ptree to_ptree(const std::string& str);
+
+	// Finds a node by a dot separated path ignoring XML NS preffixes, the attributes are found with "<xmlattr>.name",
+	// returns nullptr if there is no such node
+	const pt::ptree* find_path(const std::string& /*path*/, const pt::ptree& /*node*/);
+
+	// Puts the value of the node found by @path into @to by @to_path, if the node is present.
+	// The value is converted to T, so a value with a wrong format throws pt::ptree_bad_data
+	template<typename T>
+	bool copy_value(const std::string& path, const pt::ptree& from, pt::ptree& to, const std::string& to_path)
+	{
+		auto node = find_path(path, from);
+		if (node == nullptr)
+			return false;
+
+		to.put(to_path, node->get_value<T>());
+		return true;
+	}
 }